@@ -93,6 +93,20 @@ public class LlamaContext {
       params.hasKey("use_mlock") ? params.getBoolean("use_mlock") : true,
       // boolean use_mmap,
       params.hasKey("use_mmap") ? params.getBoolean("use_mmap") : true,
+      // boolean prefetch_layers,
+      params.hasKey("prefetch_layers") ? params.getBoolean("prefetch_layers") : false,
+      // boolean evict_layers,
+      params.hasKey("evict_layers") ? params.getBoolean("evict_layers") : false,
+      // String repack_cache,
+      params.hasKey("repack_cache") ? params.getString("repack_cache") : "",
+      // String warm_start_cache,
+      params.hasKey("warm_start_cache") ? params.getString("warm_start_cache") : "",
+      // String kv_spill_path,
+      params.hasKey("kv_spill_path") ? params.getString("kv_spill_path") : "",
+      // boolean fit_memory,
+      params.hasKey("fit_memory") ? params.getBoolean("fit_memory") : false,
+      // double memory_budget,
+      params.hasKey("memory_budget") ? params.getDouble("memory_budget") : 0,
       //boolean vocab_only,
       params.hasKey("vocab_only") ? params.getBoolean("vocab_only") : false,
       // String lora,
@@ -109,6 +123,10 @@ public class LlamaContext {
       params.hasKey("pooling_type") ? params.getInt("pooling_type") : -1,
       // boolean ctx_shift,
       params.hasKey("ctx_shift") ? params.getBoolean("ctx_shift") : true,
+      // int n_rs_ckpt,
+      params.hasKey("n_rs_ckpt") ? params.getInt("n_rs_ckpt") : 0,
+      // int rs_ckpt_interval,
+      params.hasKey("rs_ckpt_interval") ? params.getInt("rs_ckpt_interval") : 256,
       // LoadProgressCallback load_progress_callback
       params.hasKey("use_progress_callback") ? new LoadProgressCallback(this) : null
     );
@@ -326,6 +344,8 @@ public class LlamaContext {
       params.hasKey("dry_penalty_last_n") ? params.getInt("dry_penalty_last_n") : -1,
       // float top_n_sigma,
       params.hasKey("top_n_sigma") ? (float) params.getDouble("top_n_sigma") : -1.0f,
+      // float control_vector_strength,
+      params.hasKey("control_vector_strength") ? (float) params.getDouble("control_vector_strength") : 1.0f,
       // String[] dry_sequence_breakers, when undef, we use the default definition from common.h
       params.hasKey("dry_sequence_breakers") ? params.getArray("dry_sequence_breakers").toArrayList().toArray(new String[0]) : new String[]{"\n", ":", "\"", "*"},
       // String[] media_paths
@@ -404,6 +424,10 @@ public class LlamaContext {
     return bench(this.context, pp, tg, pl, nr);
   }
 
+  public WritableMap tuneThreads(String cachePath, boolean force) {
+    return tuneThreads(this.context, cachePath == null ? "" : cachePath, force);
+  }
+
   public int applyLoraAdapters(ReadableArray loraAdapters) {
     int result = applyLoraAdapters(this.context, loraAdapters);
     if (result != 0) {
@@ -420,6 +444,22 @@ public class LlamaContext {
     return getLoadedLoraAdapters(this.context);
   }
 
+  public int applyControlVectors(ReadableArray controlVectors, int layerStart, int layerEnd) {
+    int result = applyControlVectors(this.context, controlVectors, layerStart, layerEnd);
+    if (result != 0) {
+      throw new IllegalStateException("Failed to apply control vectors");
+    }
+    return result;
+  }
+
+  public void removeControlVectors() {
+    removeControlVectors(this.context);
+  }
+
+  public WritableArray getLoadedControlVectors() {
+    return getLoadedControlVectors(this.context);
+  }
+
   public boolean initMultimodal(ReadableMap params) {
     String mmprojPath = params.getString("path");
     boolean mmprojUseGpu = params.hasKey("use_gpu") ? params.getBoolean("use_gpu") : true;
@@ -498,31 +538,11 @@ public class LlamaContext {
     Log.d(NAME, "- isAtLeastArmV82: " + isAtLeastArmV82);
     Log.d(NAME, "- isAtLeastArmV84: " + isAtLeastArmV84);
 
-    // TODO: Add runtime check for cpu features
+    // dotprod / i8mm kernels are selected at runtime by the library itself
     if (LlamaContext.isArm64V8a()) {
-      if (hasDotProd && hasI8mm) {
-        Log.d(NAME, "Loading librnllama_v8_2_dotprod_i8mm.so");
-        System.loadLibrary("rnllama_v8_2_dotprod_i8mm");
-        loadedLibrary = "rnllama_v8_2_dotprod_i8mm";
-      } else if (hasDotProd) {
-        Log.d(NAME, "Loading librnllama_v8_2_dotprod.so");
-        System.loadLibrary("rnllama_v8_2_dotprod");
-        loadedLibrary = "rnllama_v8_2_dotprod";
-      } else if (hasI8mm) {
-        Log.d(NAME, "Loading librnllama_v8_2_i8mm.so");
-        System.loadLibrary("rnllama_v8_2_i8mm");
-        loadedLibrary = "rnllama_v8_2_i8mm";
-      } else if (hasFp16) {
-        Log.d(NAME, "Loading librnllama_v8_2.so");
-        System.loadLibrary("rnllama_v8_2");
-        loadedLibrary = "rnllama_v8_2";
-      } else {
-        Log.d(NAME, "Loading default librnllama_v8.so");
-        System.loadLibrary("rnllama_v8");
-        loadedLibrary = "rnllama_v8";
-      }
-      //  Log.d(NAME, "Loading librnllama_v8_7.so with runtime feature detection");
-      //  System.loadLibrary("rnllama_v8_7");
+      Log.d(NAME, "Loading librnllama_v8.so");
+      System.loadLibrary("rnllama_v8");
+      loadedLibrary = "rnllama_v8";
     } else if (LlamaContext.isX86_64()) {
       Log.d(NAME, "Loading librnllama_x86_64.so");
       System.loadLibrary("rnllama_x86_64");
@@ -584,6 +604,13 @@ public class LlamaContext {
     String cache_type_v,
     boolean use_mlock,
     boolean use_mmap,
+    boolean prefetch_layers,
+    boolean evict_layers,
+    String repack_cache,
+    String warm_start_cache,
+    String kv_spill_path,
+    boolean fit_memory,
+    double memory_budget,
     boolean vocab_only,
     String lora,
     float lora_scaled,
@@ -592,6 +619,8 @@ public class LlamaContext {
     float rope_freq_scale,
     int pooling_type,
     boolean ctx_shift,
+    int n_rs_ckpt,
+    int rs_ckpt_interval,
     LoadProgressCallback load_progress_callback
   );
 
@@ -673,6 +702,7 @@ public class LlamaContext {
     int dry_allowed_length,
     int dry_penalty_last_n,
     float top_n_sigma,
+    float control_vector_strength,
     String[] dry_sequence_breakers,
     String[] media_paths,
     PartialCompletionCallback partial_completion_callback
@@ -697,6 +727,7 @@ public class LlamaContext {
   protected static native WritableArray rerank(long contextPtr, String query, String[] documents, int normalize);
 
   protected static native String bench(long contextPtr, int pp, int tg, int pl, int nr);
+  protected static native WritableMap tuneThreads(long contextPtr, String cachePath, boolean force);
 
   protected static native int applyLoraAdapters(long contextPtr, ReadableArray loraAdapters);
 
@@ -704,6 +735,12 @@ public class LlamaContext {
 
   protected static native WritableArray getLoadedLoraAdapters(long contextPtr);
 
+  protected static native int applyControlVectors(long contextPtr, ReadableArray controlVectors, int layerStart, int layerEnd);
+
+  protected static native void removeControlVectors(long contextPtr);
+
+  protected static native WritableArray getLoadedControlVectors(long contextPtr);
+
   protected static native void freeContext(long contextPtr);
 
   protected static native void setupLog(NativeLogCallback logCallback);
@@ -164,26 +164,26 @@ Java_com_rnllama_LlamaContext_modelInfo(
         env->ReleaseStringUTFChars(skip_str, skip_chars);
     }
 
-    struct lm_gguf_init_params params = {
-        /*.no_alloc = */ false,
-        /*.ctx      = */ NULL,
-    };
-    struct lm_gguf_context * ctx = lm_gguf_init_from_file(model_path_chars, params);
+    // the header is indexed in place from a mapping of the file, the skipped keys are never formatted
+    struct lm_gguf_view * view = lm_gguf_view_init_from_file(model_path_chars, nullptr, 0);
 
-    if (!ctx) {
+    if (!view) {
         LOGI("%s: failed to load '%s'\n", __func__, model_path_chars);
+        env->ReleaseStringUTFChars(model_path_str, model_path_chars);
         return nullptr;
     }
 
     auto info = createWriteableMap(env);
-    putInt(env, info, "version", lm_gguf_get_version(ctx));
-    putInt(env, info, "alignment", lm_gguf_get_alignment(ctx));
-    putInt(env, info, "data_offset", lm_gguf_get_data_offset(ctx));
+    putInt(env, info, "version", lm_gguf_view_get_version(view));
+    putInt(env, info, "alignment", lm_gguf_view_get_alignment(view));
+    putInt(env, info, "data_offset", lm_gguf_view_get_data_offset(view));
     {
-        const int n_kv = lm_gguf_get_n_kv(ctx);
+        const int n_kv = lm_gguf_view_get_n_kv(view);
 
         for (int i = 0; i < n_kv; ++i) {
-            const char * key = lm_gguf_get_key(ctx, i);
+            size_t key_len;
+            const char * key_chars = lm_gguf_view_get_key(view, i, &key_len);
+            const std::string key(key_chars, key_len);
 
             bool skipped = false;
             if (skip_len > 0) {
@@ -199,13 +199,13 @@ Java_com_rnllama_LlamaContext_modelInfo(
                 continue;
             }
 
-            const std::string value = lm_gguf_kv_to_str(ctx, i);
-            putString(env, info, key, value.c_str());
+            const std::string value = lm_gguf_view_kv_to_str(view, i);
+            putString(env, info, key.c_str(), value.c_str());
         }
     }
 
     env->ReleaseStringUTFChars(model_path_str, model_path_chars);
-    lm_gguf_free(ctx);
+    lm_gguf_view_free(view);
 
     return reinterpret_cast<jobject>(info);
 }
@@ -236,6 +236,13 @@ Java_com_rnllama_LlamaContext_initContext(
     jstring cache_type_v,
     jboolean use_mlock,
     jboolean use_mmap,
+    jboolean prefetch_layers,
+    jboolean evict_layers,
+    jstring repack_cache,
+    jstring warm_start_cache,
+    jstring kv_spill_path,
+    jboolean fit_memory,
+    jdouble memory_budget,
     jboolean vocab_only,
     jstring lora_str,
     jfloat lora_scaled,
@@ -244,6 +251,8 @@ Java_com_rnllama_LlamaContext_initContext(
     jfloat rope_freq_scale,
     jint pooling_type,
     jboolean ctx_shift,
+    jint n_rs_ckpt,
+    jint rs_ckpt_interval,
     jobject load_progress_callback
 ) {
     UNUSED(thiz);
@@ -265,6 +274,8 @@ Java_com_rnllama_LlamaContext_initContext(
     defaultParams.n_batch = n_batch;
     defaultParams.n_ubatch = n_ubatch;
     defaultParams.ctx_shift = ctx_shift;
+    defaultParams.n_rs_ckpt = n_rs_ckpt;
+    defaultParams.rs_ckpt_interval = rs_ckpt_interval;
 
     if (pooling_type != -1) {
         defaultParams.pooling_type = static_cast<enum llama_pooling_type>(pooling_type);
@@ -294,6 +305,20 @@ Java_com_rnllama_LlamaContext_initContext(
 
     defaultParams.use_mlock = use_mlock;
     defaultParams.use_mmap = use_mmap;
+    defaultParams.prefetch_layers = prefetch_layers;
+    defaultParams.evict_layers = evict_layers;
+
+    const char *repack_cache_chars = env->GetStringUTFChars(repack_cache, nullptr);
+    defaultParams.repack_cache = repack_cache_chars;
+
+    const char *warm_start_cache_chars = env->GetStringUTFChars(warm_start_cache, nullptr);
+    defaultParams.warm_start_cache = warm_start_cache_chars;
+
+    const char *kv_spill_path_chars = env->GetStringUTFChars(kv_spill_path, nullptr);
+    defaultParams.kv_spill_path = kv_spill_path_chars;
+
+    defaultParams.fit_memory = fit_memory;
+    defaultParams.memory_budget = memory_budget > 0 ? (size_t) memory_budget : 0;
 
     defaultParams.rope_freq_base = rope_freq_base;
     defaultParams.rope_freq_scale = rope_freq_scale;
@@ -331,6 +356,9 @@ Java_com_rnllama_LlamaContext_initContext(
     env->ReleaseStringUTFChars(chat_template, chat_template_chars);
     env->ReleaseStringUTFChars(cache_type_k, cache_type_k_chars);
     env->ReleaseStringUTFChars(cache_type_v, cache_type_v_chars);
+    env->ReleaseStringUTFChars(repack_cache, repack_cache_chars);
+    env->ReleaseStringUTFChars(warm_start_cache, warm_start_cache_chars);
+    env->ReleaseStringUTFChars(kv_spill_path, kv_spill_path_chars);
 
     LOGI("[RNLlama] is_model_loaded %s", (is_model_loaded ? "true" : "false"));
     if (is_model_loaded) {
@@ -364,6 +392,7 @@ Java_com_rnllama_LlamaContext_initContext(
                 common_adapter_lora_info la;
                 la.path = path_chars;
                 la.scale = readablemap::getFloat(env, lora_adapter, "scaled", 1.0f);
+                la.merged = readablemap::getBool(env, lora_adapter, "merged", false);
                 lora.push_back(la);
                 env->ReleaseStringUTFChars(path, path_chars);
             }
@@ -459,6 +488,20 @@ Java_com_rnllama_LlamaContext_loadModelDetails(
     putMap(env, result, "metadata", meta);
     putMap(env, result, "chatTemplates", chat_templates);
 
+    const auto & plan = llama->memory_plan;
+    auto memory_plan = createWriteableMap(env);
+    putInt(env, memory_plan, "nCtx", llama_n_ctx(llama->ctx));
+    putInt(env, memory_plan, "nUbatch", llama_n_ubatch(llama->ctx));
+    putString(env, memory_plan, "cacheTypeK", lm_ggml_type_name(llama->params.cache_type_k));
+    putString(env, memory_plan, "cacheTypeV", lm_ggml_type_name(llama->params.cache_type_v));
+    putDouble(env, memory_plan, "weightsMapped", plan.weights_mapped);
+    putDouble(env, memory_plan, "weightsAllocated", plan.weights_alloc);
+    putDouble(env, memory_plan, "kv", plan.kv);
+    putDouble(env, memory_plan, "compute", plan.compute);
+    putDouble(env, memory_plan, "budget", plan.budget == SIZE_MAX ? -1 : (double) plan.budget);
+    putBoolean(env, memory_plan, "fits", plan.fits);
+    putMap(env, result, "memoryPlan", memory_plan);
+
     // deprecated
     putBoolean(env, result, "isChatTemplateSupported", llama->validateModelChatTemplate(false, nullptr));
 
@@ -706,6 +749,7 @@ Java_com_rnllama_LlamaContext_doCompletion(
     jint dry_allowed_length,
     jint dry_penalty_last_n,
     jfloat top_n_sigma,
+    jfloat control_vector_strength,
     jobjectArray dry_sequence_breakers,
     jobjectArray media_paths,
     jobject partial_completion_callback
@@ -787,6 +831,10 @@ Java_com_rnllama_LlamaContext_doCompletion(
     sparams.dry_penalty_last_n = dry_penalty_last_n;
     sparams.top_n_sigma = top_n_sigma;
 
+    if (llama->setControlVectorStrength(control_vector_strength) != 0) {
+        LOGI("[RNLlama] Failed to set control vector strength");
+    }
+
     // grammar
     auto grammar_chars = env->GetStringUTFChars(grammar, nullptr);
     if (grammar_chars && grammar_chars[0] != '\0') {
@@ -1312,6 +1360,31 @@ Java_com_rnllama_LlamaContext_bench(
     return env->NewStringUTF(result.c_str());
 }
 
+JNIEXPORT jobject JNICALL
+Java_com_rnllama_LlamaContext_tuneThreads(
+    JNIEnv *env,
+    jobject thiz,
+    jlong context_ptr,
+    jstring cache_path,
+    jboolean force
+) {
+    UNUSED(thiz);
+    auto llama = context_map[(long) context_ptr];
+    const char *cache_path_chars = env->GetStringUTFChars(cache_path, nullptr);
+
+    rnllama::llama_rn_thread_config config = llama->tuneThreads(cache_path_chars, force);
+    env->ReleaseStringUTFChars(cache_path, cache_path_chars);
+
+    auto result = createWriteableMap(env);
+    putInt(env, result, "n_threads", config.n_threads);
+    putString(env, result, "cpumask", config.cpumask.c_str());
+    putInt(env, result, "n_threads_batch", config.n_threads_batch);
+    putString(env, result, "cpumask_batch", config.cpumask_batch.c_str());
+    putDouble(env, result, "tg_speed", config.tg_speed);
+    putDouble(env, result, "pp_speed", config.pp_speed);
+    return reinterpret_cast<jobject>(result);
+}
+
 JNIEXPORT jint JNICALL
 Java_com_rnllama_LlamaContext_applyLoraAdapters(
     JNIEnv *env, jobject thiz, jlong context_ptr, jobjectArray loraAdapters) {
@@ -1326,12 +1399,13 @@ Java_com_rnllama_LlamaContext_applyLoraAdapters(
         jstring path = readablemap::getString(env, lora_adapter, "path", nullptr);
         if (path != nullptr) {
           const char *path_chars = env->GetStringUTFChars(path, nullptr);
-          env->ReleaseStringUTFChars(path, path_chars);
           float scaled = readablemap::getFloat(env, lora_adapter, "scaled", 1.0f);
           common_adapter_lora_info la;
           la.path = path_chars;
           la.scale = scaled;
+          la.merged = readablemap::getBool(env, lora_adapter, "merged", false);
           lora_adapters.push_back(la);
+          env->ReleaseStringUTFChars(path, path_chars);
         }
     }
     return llama->applyLoraAdapters(lora_adapters);
@@ -1362,6 +1436,55 @@ Java_com_rnllama_LlamaContext_getLoadedLoraAdapters(
     return result;
 }
 
+JNIEXPORT jint JNICALL
+Java_com_rnllama_LlamaContext_applyControlVectors(
+    JNIEnv *env, jobject thiz, jlong context_ptr, jobjectArray controlVectors, jint layer_start, jint layer_end) {
+    UNUSED(thiz);
+    auto llama = context_map[(long) context_ptr];
+
+    // control_vectors: ReadableArray<ReadableMap>
+    std::vector<common_control_vector_load_info> control_vectors;
+    int control_vectors_size = readablearray::size(env, controlVectors);
+    for (int i = 0; i < control_vectors_size; i++) {
+        jobject control_vector = readablearray::getMap(env, controlVectors, i);
+        jstring path = readablemap::getString(env, control_vector, "path", nullptr);
+        if (path != nullptr) {
+          const char *path_chars = env->GetStringUTFChars(path, nullptr);
+          common_control_vector_load_info cv;
+          cv.fname = path_chars;
+          cv.strength = readablemap::getFloat(env, control_vector, "strength", 1.0f);
+          control_vectors.push_back(cv);
+          env->ReleaseStringUTFChars(path, path_chars);
+        }
+    }
+    return llama->applyControlVectors(control_vectors, layer_start, layer_end);
+}
+
+JNIEXPORT void JNICALL
+Java_com_rnllama_LlamaContext_removeControlVectors(
+    JNIEnv *env, jobject thiz, jlong context_ptr) {
+    UNUSED(env);
+    UNUSED(thiz);
+    auto llama = context_map[(long) context_ptr];
+    llama->removeControlVectors();
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_rnllama_LlamaContext_getLoadedControlVectors(
+    JNIEnv *env, jobject thiz, jlong context_ptr) {
+    UNUSED(thiz);
+    auto llama = context_map[(long) context_ptr];
+    auto loaded_control_vectors = llama->getLoadedControlVectors();
+    auto result = createWritableArray(env);
+    for (common_control_vector_load_info &cv : loaded_control_vectors) {
+        auto map = createWriteableMap(env);
+        putString(env, map, "path", cv.fname.c_str());
+        putDouble(env, map, "strength", cv.strength);
+        pushMap(env, result, map);
+    }
+    return result;
+}
+
 JNIEXPORT void JNICALL
 Java_com_rnllama_LlamaContext_freeContext(
         JNIEnv *env, jobject thiz, jlong context_ptr) {
@@ -122,6 +122,11 @@ public class RNLlamaModule extends NativeRNLlamaSpec {
     rnllama.bench(id, pp, tg, pl, nr, promise);
   }
 
+  @ReactMethod
+  public void tuneThreads(double id, final String cachePath, final boolean force, final Promise promise) {
+    rnllama.tuneThreads(id, cachePath, force, promise);
+  }
+
   @ReactMethod
   public void applyLoraAdapters(double id, final ReadableArray loraAdapters, final Promise promise) {
     rnllama.applyLoraAdapters(id, loraAdapters, promise);
@@ -137,6 +142,21 @@ public class RNLlamaModule extends NativeRNLlamaSpec {
     rnllama.getLoadedLoraAdapters(id, promise);
   }
 
+  @ReactMethod
+  public void applyControlVectors(double id, final ReadableArray controlVectors, final double layerStart, final double layerEnd, final Promise promise) {
+    rnllama.applyControlVectors(id, controlVectors, layerStart, layerEnd, promise);
+  }
+
+  @ReactMethod
+  public void removeControlVectors(double id, final Promise promise) {
+    rnllama.removeControlVectors(id, promise);
+  }
+
+  @ReactMethod
+  public void getLoadedControlVectors(double id, final Promise promise) {
+    rnllama.getLoadedControlVectors(id, promise);
+  }
+
   @ReactMethod
   public void initVocoder(double id, final String vocoderModelPath, final Promise promise) {
     rnllama.initVocoder(id, vocoderModelPath, promise);
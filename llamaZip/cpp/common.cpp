@@ -916,23 +916,45 @@ std::string fs_get_cache_file(const std::string & filename) {
 //
 
 struct common_init_result common_init_from_params(common_params & params) {
-    common_init_result iparams;
     auto mparams = common_model_params_to_llama(params);
 
     llama_model * model = llama_model_load_from_file(params.model.path.c_str(), mparams);
     if (model == NULL) {
         LOG_ERR("%s: failed to load model '%s'\n", __func__, params.model.path.c_str());
+        return common_init_result();
+    }
+
+    common_init_result iparams = common_init_from_model(params, model);
+    if (iparams.context == nullptr) {
+        llama_model_free(model);
         return iparams;
     }
 
+    iparams.model.reset(model);
+
+    return iparams;
+}
+
+struct common_init_result common_init_from_model(common_params & params, llama_model * model) {
+    common_init_result iparams;
+
     const llama_vocab * vocab = llama_model_get_vocab(model);
 
     auto cparams = common_context_params_to_llama(params);
 
+    if (params.fit_memory) {
+        llama_memory_plan_fit(model, &cparams, params.memory_budget);
+
+        // keep the params in sync with what the context is created with
+        params.n_ctx        = cparams.n_ctx;
+        params.n_ubatch     = cparams.n_ubatch;
+        params.cache_type_k = cparams.type_k;
+        params.cache_type_v = cparams.type_v;
+    }
+
     llama_context * lctx = llama_init_from_model(model, cparams);
     if (lctx == NULL) {
         LOG_ERR("%s: failed to create context with model '%s'\n", __func__, params.model.path.c_str());
-        llama_model_free(model);
         return iparams;
     }
 
@@ -948,7 +970,6 @@ struct common_init_result common_init_from_params(common_params & params) {
         const auto cvec = common_control_vector_load(params.control_vectors);
         if (cvec.n_embd == -1) {
             llama_free(lctx);
-            llama_model_free(model);
 
             return iparams;
         }
@@ -962,7 +983,6 @@ struct common_init_result common_init_from_params(common_params & params) {
                 params.control_vector_layer_end);
         if (err) {
             llama_free(lctx);
-            llama_model_free(model);
 
             return iparams;
         }
@@ -991,7 +1011,6 @@ struct common_init_result common_init_from_params(common_params & params) {
 
         if (!ok) {
             llama_free(lctx);
-            llama_model_free(model);
 
             return iparams;
         }
@@ -1004,10 +1023,13 @@ struct common_init_result common_init_from_params(common_params & params) {
         if (lora == nullptr) {
             LOG_ERR("%s: failed to apply lora adapter '%s'\n", __func__, la.path.c_str());
             llama_free(lctx);
-            llama_model_free(model);
             return iparams;
         }
 
+        if (la.merged && llama_adapter_lora_merge(model, lora.get(), la.scale, params.cpuparams.n_threads) != 0) {
+            LOG_WRN("%s: failed to merge lora adapter '%s', it is applied at runtime\n", __func__, la.path.c_str());
+        }
+
         la.ptr = lora.get();
         iparams.lora.emplace_back(std::move(lora)); // copy to list of loaded adapters
     }
@@ -1046,7 +1068,9 @@ struct common_init_result common_init_from_params(common_params & params) {
         params.sampling.dry_penalty_last_n = llama_n_ctx(lctx);
     }
 
-    if (params.warmup) {
+    if (params.warmup && llama_warm_started(lctx)) {
+        LOG_INF("%s: skipping the warmup run, the context was sized from the warm start cache\n", __func__);
+    } else if (params.warmup) {
         LOG_WRN("%s: warming up the model with an empty run - please wait ... (--no-warmup to disable)\n", __func__);
 
         llama_set_warmup(lctx, true);
@@ -1084,7 +1108,6 @@ struct common_init_result common_init_from_params(common_params & params) {
         llama_set_warmup(lctx, false);
     }
 
-    iparams.model.reset(model);
     iparams.context.reset(lctx);
 
     return iparams;
@@ -1112,6 +1135,10 @@ void common_set_adapter_lora(struct llama_context * ctx, std::vector<common_adap
     }
 }
 
+bool common_set_adapter_lora_seq(struct llama_context * ctx, llama_seq_id seq_id, const common_adapter_lora_info & lora) {
+    return llama_set_adapter_lora_seq(ctx, seq_id, lora.ptr, lora.scale) == 0;
+}
+
 struct llama_model_params common_model_params_to_llama(common_params & params) {
     auto mparams = llama_model_default_params();
 
@@ -1130,6 +1157,9 @@ struct llama_model_params common_model_params_to_llama(common_params & params) {
     mparams.use_mmap        = params.use_mmap;
     mparams.use_mlock       = params.use_mlock;
     mparams.check_tensors   = params.check_tensors;
+    mparams.prefetch_layers = params.prefetch_layers;
+    mparams.evict_layers    = params.evict_layers;
+    mparams.repack_cache    = params.repack_cache.empty() ? NULL : params.repack_cache.c_str();
 
     if (params.kv_overrides.empty()) {
         mparams.kv_overrides = NULL;
@@ -1186,6 +1216,10 @@ struct llama_context_params common_context_params_to_llama(const common_params &
     cparams.op_offload        = !params.no_op_offload;
     cparams.swa_full          = params.swa_full;
     cparams.kv_unified        = params.kv_unified;
+    cparams.kv_spill_path     = params.kv_spill_path.empty() ? nullptr : params.kv_spill_path.c_str();
+    cparams.warm_start_cache  = params.warm_start_cache.empty() ? nullptr : params.warm_start_cache.c_str();
+    cparams.n_rs_ckpt         = params.n_rs_ckpt;
+    cparams.rs_ckpt_interval  = params.rs_ckpt_interval;
 
     cparams.type_k = params.cache_type_k;
     cparams.type_v = params.cache_type_v;
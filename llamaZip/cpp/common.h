@@ -30,6 +30,7 @@
 struct common_adapter_lora_info {
     std::string path;
     float scale;
+    bool merged = false; // merge into copies of the weights it modifies, see llama_adapter_lora_merge
 
     struct llama_adapter_lora * ptr;
 };
@@ -254,6 +255,9 @@ struct common_params {
     float   yarn_beta_slow        =  1.0f; // YaRN high correction dim
     int32_t yarn_orig_ctx         =     0; // YaRN original context length
     float   defrag_thold          =  0.1f; // KV cache defragmentation threshold
+    int32_t n_rs_ckpt             =     0; // recurrent state checkpoints kept per sequence (0 = disabled)
+    int32_t rs_ckpt_interval      =   256; // number of tokens between recurrent state checkpoints
+    size_t  memory_budget         =     0; // bytes for the KV cache and compute buffers with fit_memory (0 = available memory)
 
     // offload params
     std::vector<lm_ggml_backend_dev_t> devices; // devices to use for offloading
@@ -293,6 +297,9 @@ struct common_params {
     std::string input_suffix         = ""; // string to suffix user inputs with                             // NOLINT
     std::string lookup_cache_static  = ""; // path of static ngram cache file for lookup decoding           // NOLINT
     std::string lookup_cache_dynamic = ""; // path of dynamic ngram cache file for lookup decoding          // NOLINT
+    std::string repack_cache         = ""; // path of the cache of CPU-repacked weights                     // NOLINT
+    std::string kv_spill_path        = ""; // path to file for offloading the KV cells of idle sequences    // NOLINT
+    std::string warm_start_cache     = ""; // path to cache of the compute buffer sizes per configuration  // NOLINT
     std::string logits_file          = ""; // file for saving *all* logits                                  // NOLINT
 
     std::vector<std::string> in_files;   // all input files
@@ -343,10 +350,13 @@ struct common_params {
     bool ctx_shift         = true;  // context shift on inifinite text generation
     bool swa_full          = false; // use full-size SWA cache (https://github.com/ggml-org/llama.cpp/pull/13194#issuecomment-2868343055)
     bool kv_unified        = false; // enable unified KV cache
+    bool fit_memory        = false; // shrink n_ubatch, the KV cache types and n_ctx to fit the memory budget
 
     bool input_prefix_bos  = false; // prefix BOS to user inputs, preceding input_prefix
     bool use_mmap          = true;  // use mmap for faster loads
     bool use_mlock         = false; // use mlock to keep model in memory
+    bool prefetch_layers   = false; // page in the mapped weights layer by layer ahead of the computation
+    bool evict_layers      = false; // release the mapped weights of each layer once it is computed
     bool verbose_prompt    = false; // print prompt tokens before generation
     bool display_prompt    = true;  // print prompt before generation
     bool no_kv_offload     = false; // disable KV offloading
@@ -573,6 +583,8 @@ struct common_init_result {
 };
 
 struct common_init_result     common_init_from_params(common_params & params);
+// create the context and the adapters for a model that is already loaded, the result does not own the model
+struct common_init_result     common_init_from_model (common_params & params, llama_model * model);
 
 struct llama_model_params     common_model_params_to_llama  (      common_params & params);
 struct llama_context_params   common_context_params_to_llama(const common_params & params);
@@ -581,6 +593,9 @@ struct lm_ggml_threadpool_params lm_ggml_threadpool_params_from_cpu_params(const
 // clear LoRA adapters from context, then apply new list of adapters
 void common_set_adapter_lora(struct llama_context * ctx, std::vector<common_adapter_lora_info> & lora);
 
+// route one adapter to the tokens of a sequence, a scale of 0 removes the route
+bool common_set_adapter_lora_seq(struct llama_context * ctx, llama_seq_id seq_id, const common_adapter_lora_info & lora);
+
 std::string                   get_model_endpoint();
 
 //
@@ -765,6 +765,41 @@ bool lm_ggml_gallocr_reserve_n(lm_ggml_gallocr_t galloc, struct lm_ggml_cgraph *
     return true;
 }
 
+bool lm_ggml_gallocr_reserve_size(lm_ggml_gallocr_t galloc, const size_t * sizes) {
+    // no node placement is known, the next graph goes through lm_ggml_gallocr_reserve_n
+    galloc->n_nodes = 0;
+    galloc->n_leafs = 0;
+
+    for (int i = 0; i < galloc->n_buffers; i++) {
+        // if the buffer type is used multiple times, we reuse the same buffer
+        bool shared = false;
+        for (int j = 0; j < i; j++) {
+            if (galloc->buf_tallocs[j] == galloc->buf_tallocs[i]) {
+                galloc->buffers[i] = galloc->buffers[j];
+                shared = true;
+                break;
+            }
+        }
+        if (shared) {
+            continue;
+        }
+
+        size_t cur_size = galloc->buffers[i] ? lm_ggml_backend_buffer_get_size(galloc->buffers[i]) : 0;
+
+        if (sizes[i] > cur_size || galloc->buffers[i] == NULL) {
+            lm_ggml_backend_buffer_free(galloc->buffers[i]);
+            galloc->buffers[i] = lm_ggml_backend_buft_alloc_buffer(galloc->bufts[i], sizes[i]);
+            if (galloc->buffers[i] == NULL) {
+                LM_GGML_LOG_ERROR("%s: failed to allocate %s buffer of size %zu\n", __func__, lm_ggml_backend_buft_name(galloc->bufts[i]), sizes[i]);
+                return false;
+            }
+            lm_ggml_backend_buffer_set_usage(galloc->buffers[i], LM_GGML_BACKEND_BUFFER_USAGE_COMPUTE);
+        }
+    }
+
+    return true;
+}
+
 bool lm_ggml_gallocr_reserve(lm_ggml_gallocr_t galloc, struct lm_ggml_cgraph *graph) {
     return lm_ggml_gallocr_reserve_n(galloc, graph, NULL, NULL);
 }
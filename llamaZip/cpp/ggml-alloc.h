@@ -60,6 +60,11 @@ LM_GGML_API bool lm_ggml_gallocr_reserve_n(
     const int * node_buffer_ids,
     const int * leaf_buffer_ids);
 
+// allocate the buffers with known sizes (e.g. measured by lm_ggml_gallocr_reserve in an earlier run) without a measure graph
+// the nodes are placed by the next lm_ggml_gallocr_reserve_n, which then only reallocates the buffers that are too small
+// returns false if the buffer allocation failed
+LM_GGML_API bool lm_ggml_gallocr_reserve_size(lm_ggml_gallocr_t galloc, const size_t * sizes);
+
 // automatic reallocation if the topology changes when using a single buffer
 // returns false if using multiple buffers and a re-allocation is needed (call lm_ggml_gallocr_reserve_n first to set the node buffers)
 LM_GGML_API bool lm_ggml_gallocr_alloc_graph(lm_ggml_gallocr_t galloc, struct lm_ggml_cgraph * graph);
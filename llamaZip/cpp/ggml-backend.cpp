@@ -1548,6 +1548,18 @@ bool lm_ggml_backend_sched_reserve(lm_ggml_backend_sched_t sched, struct lm_ggml
     return true;
 }
 
+bool lm_ggml_backend_sched_reserve_size(lm_ggml_backend_sched_t sched, const size_t * sizes) {
+    lm_ggml_backend_sched_synchronize(sched);
+
+    if (!lm_ggml_gallocr_reserve_size(sched->galloc, sizes)) {
+        return false;
+    }
+
+    lm_ggml_backend_sched_reset(sched);
+
+    return true;
+}
+
 bool lm_ggml_backend_sched_alloc_graph(lm_ggml_backend_sched_t sched, struct lm_ggml_cgraph * graph) {
     LM_GGML_ASSERT((int)sched->hash_set.size >= graph->n_nodes + graph->n_leafs);
 
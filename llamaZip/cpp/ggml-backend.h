@@ -294,6 +294,8 @@ extern "C" {
 
     // Initialize backend buffers from a measure graph
     LM_GGML_API bool                 lm_ggml_backend_sched_reserve(lm_ggml_backend_sched_t sched, struct lm_ggml_cgraph * measure_graph); // returns success
+    // Initialize backend buffers with known sizes, one per backend (e.g. from lm_ggml_backend_sched_get_buffer_size in an earlier run)
+    LM_GGML_API bool                 lm_ggml_backend_sched_reserve_size(lm_ggml_backend_sched_t sched, const size_t * sizes); // returns success
 
     LM_GGML_API int                  lm_ggml_backend_sched_get_n_backends(lm_ggml_backend_sched_t sched);
     LM_GGML_API lm_ggml_backend_t       lm_ggml_backend_sched_get_backend(lm_ggml_backend_sched_t sched, int i);
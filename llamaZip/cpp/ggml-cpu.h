@@ -110,11 +110,16 @@ extern "C" {
     typedef void (*lm_ggml_vec_dot_t)  (int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT x, size_t bx,
                                        const void * LM_GGML_RESTRICT y, size_t by, int nrc);
 
+    // dot products of one row of x with nc columns of y that are by bytes apart, s[i] = x*y[i]
+    typedef void (*lm_ggml_vec_dot_cols_t)(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT x,
+                                          const void * LM_GGML_RESTRICT y, size_t by, int nc);
+
     struct lm_ggml_type_traits_cpu {
         lm_ggml_from_float_t        from_float;
         lm_ggml_vec_dot_t           vec_dot;
         enum lm_ggml_type           vec_dot_type;
         int64_t                  nrows; // number of rows to process simultaneously
+        lm_ggml_vec_dot_cols_t      vec_dot_cols; // optional, one row with up to 8 columns
     };
 
     LM_GGML_BACKEND_API const struct lm_ggml_type_traits_cpu * lm_ggml_get_type_traits_cpu(enum lm_ggml_type type);
@@ -134,6 +139,11 @@ extern "C" {
 
     LM_GGML_BACKEND_API lm_ggml_backend_reg_t lm_ggml_backend_cpu_reg(void);
 
+    // id of the interleaved layout the CPU_REPACK buffer stores this tensor in on this CPU, 0 if it is not repacked
+    LM_GGML_BACKEND_API uint32_t              lm_ggml_backend_cpu_repack_layout(const struct lm_ggml_tensor * tensor);
+    // CPU_REPACK buffer over memory that already holds repacked tensors, e.g. a mapped cache of a previous load
+    LM_GGML_BACKEND_API lm_ggml_backend_buffer_t lm_ggml_backend_cpu_repack_buffer_from_ptr(void * ptr, size_t size);
+
     LM_GGML_BACKEND_API void lm_ggml_cpu_fp32_to_fp32(const float *,       float *, int64_t);
     LM_GGML_BACKEND_API void lm_ggml_cpu_fp32_to_fp16(const float *, lm_ggml_fp16_t *, int64_t);
     LM_GGML_BACKEND_API void lm_ggml_cpu_fp16_to_fp32(const lm_ggml_fp16_t *, float *, int64_t);
@@ -37,17 +37,25 @@
 #define lm_ggml_gemv_q4_0_4x8_q8_0_generic lm_ggml_gemv_q4_0_4x8_q8_0
 #define lm_ggml_gemv_q4_0_8x8_q8_0_generic lm_ggml_gemv_q4_0_8x8_q8_0
 #define lm_ggml_gemv_q4_K_8x8_q8_K_generic lm_ggml_gemv_q4_K_8x8_q8_K
+#define lm_ggml_gemv_q5_K_8x8_q8_K_generic lm_ggml_gemv_q5_K_8x8_q8_K
+#define lm_ggml_gemv_q6_K_8x8_q8_K_generic lm_ggml_gemv_q6_K_8x8_q8_K
+#define lm_ggml_gemv_q8_0_8x8_q8_0_generic lm_ggml_gemv_q8_0_8x8_q8_0
 #define lm_ggml_gemv_iq4_nl_4x4_q8_0_generic lm_ggml_gemv_iq4_nl_4x4_q8_0
+#define lm_ggml_gemv_iq4_nl_8x8_q8_0_generic lm_ggml_gemv_iq4_nl_8x8_q8_0
 #define lm_ggml_gemm_q4_0_4x4_q8_0_generic lm_ggml_gemm_q4_0_4x4_q8_0
 #define lm_ggml_gemm_q4_0_4x8_q8_0_generic lm_ggml_gemm_q4_0_4x8_q8_0
 #define lm_ggml_gemm_q4_0_8x8_q8_0_generic lm_ggml_gemm_q4_0_8x8_q8_0
 #define lm_ggml_gemm_q4_K_8x8_q8_K_generic lm_ggml_gemm_q4_K_8x8_q8_K
+#define lm_ggml_gemm_q5_K_8x8_q8_K_generic lm_ggml_gemm_q5_K_8x8_q8_K
+#define lm_ggml_gemm_q6_K_8x8_q8_K_generic lm_ggml_gemm_q6_K_8x8_q8_K
+#define lm_ggml_gemm_q8_0_8x8_q8_0_generic lm_ggml_gemm_q8_0_8x8_q8_0
 #define lm_ggml_gemm_iq4_nl_4x4_q8_0_generic lm_ggml_gemm_iq4_nl_4x4_q8_0
+#define lm_ggml_gemm_iq4_nl_8x8_q8_0_generic lm_ggml_gemm_iq4_nl_8x8_q8_0
 #elif defined(__aarch64__) || defined(__arm__) || defined(_M_ARM) || defined(_M_ARM64)
 // repack.cpp
 #define lm_ggml_quantize_mat_q8_K_4x8_generic lm_ggml_quantize_mat_q8_K_4x8
-#define lm_ggml_gemv_q4_K_8x8_q8_K_generic lm_ggml_gemv_q4_K_8x8_q8_K
-#define lm_ggml_gemm_q4_K_8x8_q8_K_generic lm_ggml_gemm_q4_K_8x8_q8_K
+#define lm_ggml_gemv_iq4_nl_8x8_q8_0_generic lm_ggml_gemv_iq4_nl_8x8_q8_0
+#define lm_ggml_gemm_iq4_nl_8x8_q8_0_generic lm_ggml_gemm_iq4_nl_8x8_q8_0
 #elif defined(__x86_64__) || defined(__i386__) || defined(_M_IX86) || defined(_M_X64)
 // repack.cpp
 #define lm_ggml_quantize_mat_q8_0_4x4_generic lm_ggml_quantize_mat_q8_0_4x4
@@ -72,12 +80,20 @@
 #define lm_ggml_gemv_q4_0_4x8_q8_0_generic lm_ggml_gemv_q4_0_4x8_q8_0
 #define lm_ggml_gemv_q4_0_8x8_q8_0_generic lm_ggml_gemv_q4_0_8x8_q8_0
 #define lm_ggml_gemv_q4_K_8x8_q8_K_generic lm_ggml_gemv_q4_K_8x8_q8_K
+#define lm_ggml_gemv_q5_K_8x8_q8_K_generic lm_ggml_gemv_q5_K_8x8_q8_K
+#define lm_ggml_gemv_q6_K_8x8_q8_K_generic lm_ggml_gemv_q6_K_8x8_q8_K
+#define lm_ggml_gemv_q8_0_8x8_q8_0_generic lm_ggml_gemv_q8_0_8x8_q8_0
 #define lm_ggml_gemv_iq4_nl_4x4_q8_0_generic lm_ggml_gemv_iq4_nl_4x4_q8_0
+#define lm_ggml_gemv_iq4_nl_8x8_q8_0_generic lm_ggml_gemv_iq4_nl_8x8_q8_0
 #define lm_ggml_gemm_q4_0_4x4_q8_0_generic lm_ggml_gemm_q4_0_4x4_q8_0
 #define lm_ggml_gemm_q4_0_4x8_q8_0_generic lm_ggml_gemm_q4_0_4x8_q8_0
 #define lm_ggml_gemm_q4_0_8x8_q8_0_generic lm_ggml_gemm_q4_0_8x8_q8_0
 #define lm_ggml_gemm_q4_K_8x8_q8_K_generic lm_ggml_gemm_q4_K_8x8_q8_K
+#define lm_ggml_gemm_q5_K_8x8_q8_K_generic lm_ggml_gemm_q5_K_8x8_q8_K
+#define lm_ggml_gemm_q6_K_8x8_q8_K_generic lm_ggml_gemm_q6_K_8x8_q8_K
+#define lm_ggml_gemm_q8_0_8x8_q8_0_generic lm_ggml_gemm_q8_0_8x8_q8_0
 #define lm_ggml_gemm_iq4_nl_4x4_q8_0_generic lm_ggml_gemm_iq4_nl_4x4_q8_0
+#define lm_ggml_gemm_iq4_nl_8x8_q8_0_generic lm_ggml_gemm_iq4_nl_8x8_q8_0
 #elif defined(__loongarch64)
 // quants.c
 #define quantize_row_q8_K_generic quantize_row_q8_K
@@ -92,12 +108,20 @@
 #define lm_ggml_gemv_q4_0_4x8_q8_0_generic lm_ggml_gemv_q4_0_4x8_q8_0
 #define lm_ggml_gemv_q4_0_8x8_q8_0_generic lm_ggml_gemv_q4_0_8x8_q8_0
 #define lm_ggml_gemv_q4_K_8x8_q8_K_generic lm_ggml_gemv_q4_K_8x8_q8_K
+#define lm_ggml_gemv_q5_K_8x8_q8_K_generic lm_ggml_gemv_q5_K_8x8_q8_K
+#define lm_ggml_gemv_q6_K_8x8_q8_K_generic lm_ggml_gemv_q6_K_8x8_q8_K
+#define lm_ggml_gemv_q8_0_8x8_q8_0_generic lm_ggml_gemv_q8_0_8x8_q8_0
 #define lm_ggml_gemv_iq4_nl_4x4_q8_0_generic lm_ggml_gemv_iq4_nl_4x4_q8_0
+#define lm_ggml_gemv_iq4_nl_8x8_q8_0_generic lm_ggml_gemv_iq4_nl_8x8_q8_0
 #define lm_ggml_gemm_q4_0_4x4_q8_0_generic lm_ggml_gemm_q4_0_4x4_q8_0
 #define lm_ggml_gemm_q4_0_4x8_q8_0_generic lm_ggml_gemm_q4_0_4x8_q8_0
 #define lm_ggml_gemm_q4_0_8x8_q8_0_generic lm_ggml_gemm_q4_0_8x8_q8_0
 #define lm_ggml_gemm_q4_K_8x8_q8_K_generic lm_ggml_gemm_q4_K_8x8_q8_K
+#define lm_ggml_gemm_q5_K_8x8_q8_K_generic lm_ggml_gemm_q5_K_8x8_q8_K
+#define lm_ggml_gemm_q6_K_8x8_q8_K_generic lm_ggml_gemm_q6_K_8x8_q8_K
+#define lm_ggml_gemm_q8_0_8x8_q8_0_generic lm_ggml_gemm_q8_0_8x8_q8_0
 #define lm_ggml_gemm_iq4_nl_4x4_q8_0_generic lm_ggml_gemm_iq4_nl_4x4_q8_0
+#define lm_ggml_gemm_iq4_nl_8x8_q8_0_generic lm_ggml_gemm_iq4_nl_8x8_q8_0
 #elif defined(__riscv)
 // quants.c
 #define quantize_row_q8_K_generic quantize_row_q8_K
@@ -119,11 +143,19 @@
 #define lm_ggml_gemv_q4_0_4x4_q8_0_generic lm_ggml_gemv_q4_0_4x4_q8_0
 #define lm_ggml_gemv_q4_0_4x8_q8_0_generic lm_ggml_gemv_q4_0_4x8_q8_0
 #define lm_ggml_gemv_q4_K_8x8_q8_K_generic lm_ggml_gemv_q4_K_8x8_q8_K
+#define lm_ggml_gemv_q5_K_8x8_q8_K_generic lm_ggml_gemv_q5_K_8x8_q8_K
+#define lm_ggml_gemv_q6_K_8x8_q8_K_generic lm_ggml_gemv_q6_K_8x8_q8_K
+#define lm_ggml_gemv_q8_0_8x8_q8_0_generic lm_ggml_gemv_q8_0_8x8_q8_0
 #define lm_ggml_gemv_iq4_nl_4x4_q8_0_generic lm_ggml_gemv_iq4_nl_4x4_q8_0
+#define lm_ggml_gemv_iq4_nl_8x8_q8_0_generic lm_ggml_gemv_iq4_nl_8x8_q8_0
 #define lm_ggml_gemm_q4_0_4x4_q8_0_generic lm_ggml_gemm_q4_0_4x4_q8_0
 #define lm_ggml_gemm_q4_0_4x8_q8_0_generic lm_ggml_gemm_q4_0_4x8_q8_0
 #define lm_ggml_gemm_q4_K_8x8_q8_K_generic lm_ggml_gemm_q4_K_8x8_q8_K
+#define lm_ggml_gemm_q5_K_8x8_q8_K_generic lm_ggml_gemm_q5_K_8x8_q8_K
+#define lm_ggml_gemm_q6_K_8x8_q8_K_generic lm_ggml_gemm_q6_K_8x8_q8_K
+#define lm_ggml_gemm_q8_0_8x8_q8_0_generic lm_ggml_gemm_q8_0_8x8_q8_0
 #define lm_ggml_gemm_iq4_nl_4x4_q8_0_generic lm_ggml_gemm_iq4_nl_4x4_q8_0
+#define lm_ggml_gemm_iq4_nl_8x8_q8_0_generic lm_ggml_gemm_iq4_nl_8x8_q8_0
 #elif defined(__s390x__)
 // quants.c
 #define quantize_row_q8_K_generic quantize_row_q8_K
@@ -147,12 +179,20 @@
 #define lm_ggml_gemv_q4_0_4x8_q8_0_generic lm_ggml_gemv_q4_0_4x8_q8_0
 #define lm_ggml_gemv_q4_0_8x8_q8_0_generic lm_ggml_gemv_q4_0_8x8_q8_0
 #define lm_ggml_gemv_q4_K_8x8_q8_K_generic lm_ggml_gemv_q4_K_8x8_q8_K
+#define lm_ggml_gemv_q5_K_8x8_q8_K_generic lm_ggml_gemv_q5_K_8x8_q8_K
+#define lm_ggml_gemv_q6_K_8x8_q8_K_generic lm_ggml_gemv_q6_K_8x8_q8_K
+#define lm_ggml_gemv_q8_0_8x8_q8_0_generic lm_ggml_gemv_q8_0_8x8_q8_0
 #define lm_ggml_gemv_iq4_nl_4x4_q8_0_generic lm_ggml_gemv_iq4_nl_4x4_q8_0
+#define lm_ggml_gemv_iq4_nl_8x8_q8_0_generic lm_ggml_gemv_iq4_nl_8x8_q8_0
 #define lm_ggml_gemm_q4_0_4x4_q8_0_generic lm_ggml_gemm_q4_0_4x4_q8_0
 #define lm_ggml_gemm_q4_0_4x8_q8_0_generic lm_ggml_gemm_q4_0_4x8_q8_0
 #define lm_ggml_gemm_q4_0_8x8_q8_0_generic lm_ggml_gemm_q4_0_8x8_q8_0
 #define lm_ggml_gemm_q4_K_8x8_q8_K_generic lm_ggml_gemm_q4_K_8x8_q8_K
+#define lm_ggml_gemm_q5_K_8x8_q8_K_generic lm_ggml_gemm_q5_K_8x8_q8_K
+#define lm_ggml_gemm_q6_K_8x8_q8_K_generic lm_ggml_gemm_q6_K_8x8_q8_K
+#define lm_ggml_gemm_q8_0_8x8_q8_0_generic lm_ggml_gemm_q8_0_8x8_q8_0
 #define lm_ggml_gemm_iq4_nl_4x4_q8_0_generic lm_ggml_gemm_iq4_nl_4x4_q8_0
+#define lm_ggml_gemm_iq4_nl_8x8_q8_0_generic lm_ggml_gemm_iq4_nl_8x8_q8_0
 #elif defined(__wasm__)
 // quants.c
 #define lm_ggml_vec_dot_q4_1_q8_1_generic lm_ggml_vec_dot_q4_1_q8_1
@@ -175,10 +215,18 @@
 #define lm_ggml_gemv_q4_0_4x8_q8_0_generic lm_ggml_gemv_q4_0_4x8_q8_0
 #define lm_ggml_gemv_q4_0_8x8_q8_0_generic lm_ggml_gemv_q4_0_8x8_q8_0
 #define lm_ggml_gemv_q4_K_8x8_q8_K_generic lm_ggml_gemv_q4_K_8x8_q8_K
+#define lm_ggml_gemv_q5_K_8x8_q8_K_generic lm_ggml_gemv_q5_K_8x8_q8_K
+#define lm_ggml_gemv_q6_K_8x8_q8_K_generic lm_ggml_gemv_q6_K_8x8_q8_K
+#define lm_ggml_gemv_q8_0_8x8_q8_0_generic lm_ggml_gemv_q8_0_8x8_q8_0
 #define lm_ggml_gemv_iq4_nl_4x4_q8_0_generic lm_ggml_gemv_iq4_nl_4x4_q8_0
+#define lm_ggml_gemv_iq4_nl_8x8_q8_0_generic lm_ggml_gemv_iq4_nl_8x8_q8_0
 #define lm_ggml_gemm_q4_0_4x4_q8_0_generic lm_ggml_gemm_q4_0_4x4_q8_0
 #define lm_ggml_gemm_q4_0_4x8_q8_0_generic lm_ggml_gemm_q4_0_4x8_q8_0
 #define lm_ggml_gemm_q4_0_8x8_q8_0_generic lm_ggml_gemm_q4_0_8x8_q8_0
 #define lm_ggml_gemm_q4_K_8x8_q8_K_generic lm_ggml_gemm_q4_K_8x8_q8_K
+#define lm_ggml_gemm_q5_K_8x8_q8_K_generic lm_ggml_gemm_q5_K_8x8_q8_K
+#define lm_ggml_gemm_q6_K_8x8_q8_K_generic lm_ggml_gemm_q6_K_8x8_q8_K
+#define lm_ggml_gemm_q8_0_8x8_q8_0_generic lm_ggml_gemm_q8_0_8x8_q8_0
 #define lm_ggml_gemm_iq4_nl_4x4_q8_0_generic lm_ggml_gemm_iq4_nl_4x4_q8_0
+#define lm_ggml_gemm_iq4_nl_8x8_q8_0_generic lm_ggml_gemm_iq4_nl_8x8_q8_0
 #endif
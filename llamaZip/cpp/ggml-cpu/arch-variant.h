@@ -0,0 +1,70 @@
+#pragma once
+
+// The arch kernels in arch/*/quants.c, arch/*/repack.cpp and llamafile/sgemm.cpp can be compiled more than once into the
+// same library, each time for a higher feature level (e.g. -march=armv8.2-a+dotprod or -mavx2).
+// Every extra copy is compiled with -DLM_GGML_CPU_VARIANT=<name>, which suffixes the exported kernels
+// with the variant name so they don't clash with the baseline build. The baseline copy is compiled
+// with -DLM_GGML_CPU_ALL_VARIANTS and lm_ggml_cpu_init installs the best variant the CPU supports.
+
+#define LM_GGML_CPU_VARIANT_CONCAT_IMPL(name, variant) name ## _ ## variant
+#define LM_GGML_CPU_VARIANT_CONCAT(name, variant)      LM_GGML_CPU_VARIANT_CONCAT_IMPL(name, variant)
+
+#if defined(LM_GGML_CPU_VARIANT)
+#define LM_GGML_CPU_VARIANT_NAME(name) LM_GGML_CPU_VARIANT_CONCAT(name, LM_GGML_CPU_VARIANT)
+
+#define lm_ggml_cpu_variant_quants LM_GGML_CPU_VARIANT_NAME(lm_ggml_cpu_variant_quants)
+#define lm_ggml_cpu_variant_repack LM_GGML_CPU_VARIANT_NAME(lm_ggml_cpu_variant_repack)
+// quants.c
+#define quantize_row_q8_0 LM_GGML_CPU_VARIANT_NAME(quantize_row_q8_0)
+#define quantize_row_q8_1 LM_GGML_CPU_VARIANT_NAME(quantize_row_q8_1)
+#define quantize_row_q8_K LM_GGML_CPU_VARIANT_NAME(quantize_row_q8_K)
+#define lm_ggml_vec_dot_q4_0_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_q4_0_q8_0)
+#define lm_ggml_vec_dot_q4_1_q8_1 LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_q4_1_q8_1)
+#define lm_ggml_vec_dot_q5_0_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_q5_0_q8_0)
+#define lm_ggml_vec_dot_q5_1_q8_1 LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_q5_1_q8_1)
+#define lm_ggml_vec_dot_q8_0_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_q8_0_q8_0)
+#define lm_ggml_vec_dot_tq1_0_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_tq1_0_q8_K)
+#define lm_ggml_vec_dot_tq2_0_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_tq2_0_q8_K)
+#define lm_ggml_vec_dot_q2_K_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_q2_K_q8_K)
+#define lm_ggml_vec_dot_q3_K_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_q3_K_q8_K)
+#define lm_ggml_vec_dot_q4_K_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_q4_K_q8_K)
+#define lm_ggml_vec_dot_q5_K_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_q5_K_q8_K)
+#define lm_ggml_vec_dot_q6_K_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_q6_K_q8_K)
+#define lm_ggml_vec_dot_iq2_xxs_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_iq2_xxs_q8_K)
+#define lm_ggml_vec_dot_iq2_xs_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_iq2_xs_q8_K)
+#define lm_ggml_vec_dot_iq2_s_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_iq2_s_q8_K)
+#define lm_ggml_vec_dot_iq3_xxs_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_iq3_xxs_q8_K)
+#define lm_ggml_vec_dot_iq3_s_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_iq3_s_q8_K)
+#define lm_ggml_vec_dot_iq1_s_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_iq1_s_q8_K)
+#define lm_ggml_vec_dot_iq1_m_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_iq1_m_q8_K)
+#define lm_ggml_vec_dot_iq4_nl_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_iq4_nl_q8_0)
+#define lm_ggml_vec_dot_iq4_xs_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_iq4_xs_q8_K)
+#define lm_ggml_vec_dot_cols_q4_0_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_cols_q4_0_q8_0)
+#define lm_ggml_vec_dot_cols_q8_0_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_cols_q8_0_q8_0)
+#define lm_ggml_vec_dot_cols_q4_K_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_cols_q4_K_q8_K)
+#define lm_ggml_vec_dot_cols_q6_K_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_vec_dot_cols_q6_K_q8_K)
+// repack.cpp
+#define lm_ggml_quantize_mat_q8_0_4x4 LM_GGML_CPU_VARIANT_NAME(lm_ggml_quantize_mat_q8_0_4x4)
+#define lm_ggml_quantize_mat_q8_0_4x8 LM_GGML_CPU_VARIANT_NAME(lm_ggml_quantize_mat_q8_0_4x8)
+#define lm_ggml_quantize_mat_q8_K_4x8 LM_GGML_CPU_VARIANT_NAME(lm_ggml_quantize_mat_q8_K_4x8)
+#define lm_ggml_gemv_q4_0_4x4_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemv_q4_0_4x4_q8_0)
+#define lm_ggml_gemv_q4_0_4x8_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemv_q4_0_4x8_q8_0)
+#define lm_ggml_gemv_q4_0_8x8_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemv_q4_0_8x8_q8_0)
+#define lm_ggml_gemv_q4_K_8x8_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemv_q4_K_8x8_q8_K)
+#define lm_ggml_gemv_q5_K_8x8_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemv_q5_K_8x8_q8_K)
+#define lm_ggml_gemv_q6_K_8x8_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemv_q6_K_8x8_q8_K)
+#define lm_ggml_gemv_q8_0_8x8_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemv_q8_0_8x8_q8_0)
+#define lm_ggml_gemv_iq4_nl_4x4_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemv_iq4_nl_4x4_q8_0)
+#define lm_ggml_gemv_iq4_nl_8x8_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemv_iq4_nl_8x8_q8_0)
+#define lm_ggml_gemm_q4_0_4x4_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemm_q4_0_4x4_q8_0)
+#define lm_ggml_gemm_q4_0_4x8_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemm_q4_0_4x8_q8_0)
+#define lm_ggml_gemm_q4_0_8x8_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemm_q4_0_8x8_q8_0)
+#define lm_ggml_gemm_q4_K_8x8_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemm_q4_K_8x8_q8_K)
+#define lm_ggml_gemm_q5_K_8x8_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemm_q5_K_8x8_q8_K)
+#define lm_ggml_gemm_q6_K_8x8_q8_K LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemm_q6_K_8x8_q8_K)
+#define lm_ggml_gemm_q8_0_8x8_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemm_q8_0_8x8_q8_0)
+#define lm_ggml_gemm_iq4_nl_4x4_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemm_iq4_nl_4x4_q8_0)
+#define lm_ggml_gemm_iq4_nl_8x8_q8_0 LM_GGML_CPU_VARIANT_NAME(lm_ggml_gemm_iq4_nl_8x8_q8_0)
+// llamafile/sgemm.cpp
+#define llamafile_sgemm LM_GGML_CPU_VARIANT_NAME(llamafile_sgemm)
+#endif // LM_GGML_CPU_VARIANT
@@ -4112,3 +4112,255 @@ void lm_ggml_vec_dot_iq4_xs_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, c
 #endif
 }
 
+
+#if defined(__ARM_NEON)
+// one row of x against nc columns of y: every block of x is loaded and unpacked once and kept in
+// registers while it is multiplied with the same block of each column, so the weights are streamed once
+
+void lm_ggml_vec_dot_cols_q4_0_q8_0(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc) {
+    const int qk = QK8_0;
+    const int nb = n / qk;
+
+    assert(n % qk == 0);
+    assert(nc <= LM_GGML_VEC_DOT_COLS_MAX);
+
+    const block_q4_0 * LM_GGML_RESTRICT x = vx;
+
+    const uint8x16_t m4b = vdupq_n_u8(0x0F);
+    const int8x16_t  s8b = vdupq_n_s8(0x8);
+
+    float32x4_t acc[LM_GGML_VEC_DOT_COLS_MAX];
+    for (int c = 0; c < nc; ++c) {
+        acc[c] = vdupq_n_f32(0.0f);
+    }
+
+    for (int ib = 0; ib < nb; ++ib) {
+        const float dx = LM_GGML_CPU_FP16_TO_FP32(x[ib].d);
+
+        const uint8x16_t v0 = vld1q_u8(x[ib].qs);
+        const int8x16_t  xl = vsubq_s8(vreinterpretq_s8_u8(vandq_u8  (v0, m4b)), s8b);
+        const int8x16_t  xh = vsubq_s8(vreinterpretq_s8_u8(vshrq_n_u8(v0, 4)),   s8b);
+
+        for (int c = 0; c < nc; ++c) {
+            const block_q8_0 * LM_GGML_RESTRICT y = (const block_q8_0 *) ((const char *) vy + c*by) + ib;
+
+            const int32x4_t p = lm_ggml_vdotq_s32(lm_ggml_vdotq_s32(vdupq_n_s32(0), xl, vld1q_s8(y->qs)), xh, vld1q_s8(y->qs + 16));
+
+            acc[c] = vmlaq_n_f32(acc[c], vcvtq_f32_s32(p), dx * LM_GGML_CPU_FP16_TO_FP32(y->d));
+        }
+    }
+
+    for (int c = 0; c < nc; ++c) {
+        s[c] = vaddvq_f32(acc[c]);
+    }
+}
+
+void lm_ggml_vec_dot_cols_q8_0_q8_0(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc) {
+    const int qk = QK8_0;
+    const int nb = n / qk;
+
+    assert(n % qk == 0);
+    assert(nc <= LM_GGML_VEC_DOT_COLS_MAX);
+
+    const block_q8_0 * LM_GGML_RESTRICT x = vx;
+
+    float32x4_t acc[LM_GGML_VEC_DOT_COLS_MAX];
+    for (int c = 0; c < nc; ++c) {
+        acc[c] = vdupq_n_f32(0.0f);
+    }
+
+    for (int ib = 0; ib < nb; ++ib) {
+        const float dx = LM_GGML_CPU_FP16_TO_FP32(x[ib].d);
+
+        const int8x16_t x0 = vld1q_s8(x[ib].qs);
+        const int8x16_t x1 = vld1q_s8(x[ib].qs + 16);
+
+        for (int c = 0; c < nc; ++c) {
+            const block_q8_0 * LM_GGML_RESTRICT y = (const block_q8_0 *) ((const char *) vy + c*by) + ib;
+
+            const int32x4_t p = lm_ggml_vdotq_s32(lm_ggml_vdotq_s32(vdupq_n_s32(0), x0, vld1q_s8(y->qs)), x1, vld1q_s8(y->qs + 16));
+
+            acc[c] = vmlaq_n_f32(acc[c], vcvtq_f32_s32(p), dx * LM_GGML_CPU_FP16_TO_FP32(y->d));
+        }
+    }
+
+    for (int c = 0; c < nc; ++c) {
+        s[c] = vaddvq_f32(acc[c]);
+    }
+}
+
+void lm_ggml_vec_dot_cols_q4_K_q8_K(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc) {
+    assert(n % QK_K == 0);
+    assert(nc <= LM_GGML_VEC_DOT_COLS_MAX);
+
+    const block_q4_K * LM_GGML_RESTRICT x = vx;
+
+    const int nb = n / QK_K;
+
+    static const uint32_t kmask1 = 0x3f3f3f3f;
+    static const uint32_t kmask2 = 0x0f0f0f0f;
+    static const uint32_t kmask3 = 0x03030303;
+
+    uint32_t utmp[4];
+
+    const uint8x16_t m4b = vdupq_n_u8(0xf);
+    const int32x4_t mzero = vdupq_n_s32(0);
+
+    float sumf[LM_GGML_VEC_DOT_COLS_MAX] = { 0 };
+
+    for (int i = 0; i < nb; ++i) {
+        const float d    = LM_GGML_CPU_FP16_TO_FP32(x[i].d);
+        const float dmin = LM_GGML_CPU_FP16_TO_FP32(x[i].dmin);
+
+        memcpy(utmp, x[i].scales, 12);
+
+        uint32x2_t mins8 = { 0 };
+        mins8 = vset_lane_u32(utmp[1] & kmask1, mins8, 0);
+        mins8 = vset_lane_u32(((utmp[2] >> 4) & kmask2) | (((utmp[1] >> 6) & kmask3) << 4), mins8, 1);
+
+        utmp[1] = (utmp[2] & kmask2) | (((utmp[0] >> 6) & kmask3) << 4);
+        utmp[0] &= kmask1;
+
+        const int16x8_t mins = vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(mins8)));
+        const uint8_t * scales = (const uint8_t *) utmp;
+
+        // quants of the 32-value sub-blocks, two vectors each
+        int8x16_t q4[QK_K/16];
+        for (int j = 0; j < QK_K/64; ++j) {
+            const lm_ggml_uint8x16x2_t q4bits = lm_ggml_vld1q_u8_x2(x[i].qs + 32*j);
+            q4[4*j+0] = vreinterpretq_s8_u8(vandq_u8  (q4bits.val[0], m4b));
+            q4[4*j+1] = vreinterpretq_s8_u8(vandq_u8  (q4bits.val[1], m4b));
+            q4[4*j+2] = vreinterpretq_s8_u8(vshrq_n_u8(q4bits.val[0], 4));
+            q4[4*j+3] = vreinterpretq_s8_u8(vshrq_n_u8(q4bits.val[1], 4));
+        }
+
+        for (int c = 0; c < nc; ++c) {
+            const block_q8_K * LM_GGML_RESTRICT y = (const block_q8_K *) ((const char *) vy + c*by) + i;
+
+            const int16x8_t q8sums = vpaddq_s16(vld1q_s16(y->bsums), vld1q_s16(y->bsums + 8));
+            const int32x4_t prod = vaddq_s32(vmull_s16(vget_low_s16 (q8sums), vget_low_s16 (mins)),
+                                             vmull_s16(vget_high_s16(q8sums), vget_high_s16(mins)));
+
+            int32x4_t sumi = mzero;
+            for (int k = 0; k < QK_K/32; ++k) {
+                const lm_ggml_int8x16x2_t q8bytes = lm_ggml_vld1q_s8_x2(y->qs + 32*k);
+                const int32x4_t p = lm_ggml_vdotq_s32(lm_ggml_vdotq_s32(mzero, q4[2*k+0], q8bytes.val[0]), q4[2*k+1], q8bytes.val[1]);
+                sumi = vmlaq_n_s32(sumi, p, scales[k]);
+            }
+
+            sumf[c] += y->d * (d * vaddvq_s32(sumi) - dmin * vaddvq_s32(prod));
+        }
+    }
+
+    for (int c = 0; c < nc; ++c) {
+        s[c] = sumf[c];
+    }
+}
+
+void lm_ggml_vec_dot_cols_q6_K_q8_K(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc) {
+    assert(n % QK_K == 0);
+    assert(nc <= LM_GGML_VEC_DOT_COLS_MAX);
+
+    const block_q6_K * LM_GGML_RESTRICT x = vx;
+
+    const int nb = n / QK_K;
+
+    const uint8x16_t m4b = vdupq_n_u8(0xF);
+    const uint8x16_t mone = vdupq_n_u8(3);
+    const int32x4_t  vzero = vdupq_n_s32(0);
+
+    float sumf[LM_GGML_VEC_DOT_COLS_MAX] = { 0 };
+
+    for (int i = 0; i < nb; ++i) {
+        const float d_all = LM_GGML_CPU_FP16_TO_FP32(x[i].d);
+
+        const int8_t * LM_GGML_RESTRICT scale = x[i].scales;
+
+        const int8x16_t scales = vld1q_s8(scale);
+        const lm_ggml_int16x8x2_t q6scales = {{vmovl_s8(vget_low_s8(scales)), vmovl_s8(vget_high_s8(scales))}};
+
+        // quants of the 16-value sub-blocks, without the -32 offset which is applied through the bsums
+        int8x16_t q6[QK_K/16];
+        for (int j = 0; j < QK_K/128; ++j) {
+            const lm_ggml_uint8x16x2_t qhbits = lm_ggml_vld1q_u8_x2(x[i].qh + 32*j);
+            const lm_ggml_uint8x16x4_t q6bits = lm_ggml_vld1q_u8_x4(x[i].ql + 64*j);
+
+            q6[8*j+0] = vreinterpretq_s8_u8(vorrq_u8(vandq_u8(q6bits.val[0], m4b), vshlq_n_u8(vandq_u8(mone, qhbits.val[0]), 4)));
+            q6[8*j+1] = vreinterpretq_s8_u8(vorrq_u8(vandq_u8(q6bits.val[1], m4b), vshlq_n_u8(vandq_u8(mone, qhbits.val[1]), 4)));
+            q6[8*j+2] = vreinterpretq_s8_u8(vorrq_u8(vandq_u8(q6bits.val[2], m4b), vshlq_n_u8(vandq_u8(mone, vshrq_n_u8(qhbits.val[0], 2)), 4)));
+            q6[8*j+3] = vreinterpretq_s8_u8(vorrq_u8(vandq_u8(q6bits.val[3], m4b), vshlq_n_u8(vandq_u8(mone, vshrq_n_u8(qhbits.val[1], 2)), 4)));
+            q6[8*j+4] = vreinterpretq_s8_u8(vorrq_u8(vshrq_n_u8(q6bits.val[0], 4), vshlq_n_u8(vandq_u8(mone, vshrq_n_u8(qhbits.val[0], 4)), 4)));
+            q6[8*j+5] = vreinterpretq_s8_u8(vorrq_u8(vshrq_n_u8(q6bits.val[1], 4), vshlq_n_u8(vandq_u8(mone, vshrq_n_u8(qhbits.val[1], 4)), 4)));
+            q6[8*j+6] = vreinterpretq_s8_u8(vorrq_u8(vshrq_n_u8(q6bits.val[2], 4), vshlq_n_u8(vandq_u8(mone, vshrq_n_u8(qhbits.val[0], 6)), 4)));
+            q6[8*j+7] = vreinterpretq_s8_u8(vorrq_u8(vshrq_n_u8(q6bits.val[3], 4), vshlq_n_u8(vandq_u8(mone, vshrq_n_u8(qhbits.val[1], 6)), 4)));
+        }
+
+        for (int c = 0; c < nc; ++c) {
+            const block_q8_K * LM_GGML_RESTRICT y = (const block_q8_K *) ((const char *) vy + c*by) + i;
+
+            const lm_ggml_int16x8x2_t q8sums = lm_ggml_vld1q_s16_x2(y->bsums);
+            const int32x4_t prod = vaddq_s32(vaddq_s32(vmull_s16(vget_low_s16 (q8sums.val[0]), vget_low_s16 (q6scales.val[0])),
+                                                       vmull_s16(vget_high_s16(q8sums.val[0]), vget_high_s16(q6scales.val[0]))),
+                                             vaddq_s32(vmull_s16(vget_low_s16 (q8sums.val[1]), vget_low_s16 (q6scales.val[1])),
+                                                       vmull_s16(vget_high_s16(q8sums.val[1]), vget_high_s16(q6scales.val[1]))));
+
+            int32x4_t isum = vzero;
+            for (int k = 0; k < QK_K/16; ++k) {
+                isum = vmlaq_n_s32(isum, lm_ggml_vdotq_s32(vzero, q6[k], vld1q_s8(y->qs + 16*k)), scale[k]);
+            }
+
+            sumf[c] += d_all * y->d * (vaddvq_s32(isum) - 32 * vaddvq_s32(prod));
+        }
+    }
+
+    for (int c = 0; c < nc; ++c) {
+        s[c] = sumf[c];
+    }
+}
+#endif // __ARM_NEON
+
+#if defined(LM_GGML_CPU_VARIANT)
+void lm_ggml_cpu_variant_quants(struct lm_ggml_type_traits_cpu * traits) {
+    traits[LM_GGML_TYPE_Q8_0].from_float    = quantize_row_q8_0;
+    traits[LM_GGML_TYPE_Q8_1].from_float    = quantize_row_q8_1;
+    traits[LM_GGML_TYPE_Q8_K].from_float    = quantize_row_q8_K;
+
+    traits[LM_GGML_TYPE_Q4_0].vec_dot       = lm_ggml_vec_dot_q4_0_q8_0;
+    traits[LM_GGML_TYPE_Q4_1].vec_dot       = lm_ggml_vec_dot_q4_1_q8_1;
+    traits[LM_GGML_TYPE_Q5_0].vec_dot       = lm_ggml_vec_dot_q5_0_q8_0;
+    traits[LM_GGML_TYPE_Q5_1].vec_dot       = lm_ggml_vec_dot_q5_1_q8_1;
+    traits[LM_GGML_TYPE_Q8_0].vec_dot       = lm_ggml_vec_dot_q8_0_q8_0;
+    traits[LM_GGML_TYPE_Q2_K].vec_dot       = lm_ggml_vec_dot_q2_K_q8_K;
+    traits[LM_GGML_TYPE_Q3_K].vec_dot       = lm_ggml_vec_dot_q3_K_q8_K;
+    traits[LM_GGML_TYPE_Q4_K].vec_dot       = lm_ggml_vec_dot_q4_K_q8_K;
+    traits[LM_GGML_TYPE_Q5_K].vec_dot       = lm_ggml_vec_dot_q5_K_q8_K;
+    traits[LM_GGML_TYPE_Q6_K].vec_dot       = lm_ggml_vec_dot_q6_K_q8_K;
+    traits[LM_GGML_TYPE_IQ2_XXS].vec_dot    = lm_ggml_vec_dot_iq2_xxs_q8_K;
+    traits[LM_GGML_TYPE_IQ2_XS].vec_dot     = lm_ggml_vec_dot_iq2_xs_q8_K;
+    traits[LM_GGML_TYPE_IQ3_XXS].vec_dot    = lm_ggml_vec_dot_iq3_xxs_q8_K;
+    traits[LM_GGML_TYPE_IQ3_S].vec_dot      = lm_ggml_vec_dot_iq3_s_q8_K;
+    traits[LM_GGML_TYPE_IQ2_S].vec_dot      = lm_ggml_vec_dot_iq2_s_q8_K;
+    traits[LM_GGML_TYPE_IQ1_S].vec_dot      = lm_ggml_vec_dot_iq1_s_q8_K;
+    traits[LM_GGML_TYPE_IQ1_M].vec_dot      = lm_ggml_vec_dot_iq1_m_q8_K;
+    traits[LM_GGML_TYPE_IQ4_NL].vec_dot     = lm_ggml_vec_dot_iq4_nl_q8_0;
+    traits[LM_GGML_TYPE_IQ4_XS].vec_dot     = lm_ggml_vec_dot_iq4_xs_q8_K;
+    traits[LM_GGML_TYPE_TQ1_0].vec_dot      = lm_ggml_vec_dot_tq1_0_q8_K;
+    traits[LM_GGML_TYPE_TQ2_0].vec_dot      = lm_ggml_vec_dot_tq2_0_q8_K;
+
+#if defined(LM_GGML_CPU_HAS_VEC_DOT_COLS)
+    traits[LM_GGML_TYPE_Q4_0].vec_dot_cols  = lm_ggml_vec_dot_cols_q4_0_q8_0;
+    traits[LM_GGML_TYPE_Q8_0].vec_dot_cols  = lm_ggml_vec_dot_cols_q8_0_q8_0;
+    traits[LM_GGML_TYPE_Q4_K].vec_dot_cols  = lm_ggml_vec_dot_cols_q4_K_q8_K;
+    traits[LM_GGML_TYPE_Q6_K].vec_dot_cols  = lm_ggml_vec_dot_cols_q6_K_q8_K;
+#endif
+
+#if defined(__ARM_FEATURE_MATMUL_INT8)
+    // the i8mm kernels compute two rows per call
+    traits[LM_GGML_TYPE_Q4_0].nrows         = 2;
+    traits[LM_GGML_TYPE_Q4_1].nrows         = 2;
+    traits[LM_GGML_TYPE_Q8_0].nrows         = 2;
+    traits[LM_GGML_TYPE_Q4_K].nrows         = 2;
+    traits[LM_GGML_TYPE_Q6_K].nrows         = 2;
+#endif
+}
+#endif // LM_GGML_CPU_VARIANT
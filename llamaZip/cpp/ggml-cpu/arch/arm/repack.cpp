@@ -24,6 +24,93 @@
 
 #define UNUSED LM_GGML_UNUSED
 
+#if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+// The kernels of the 8x8 interleaved Q4_K, Q5_K, Q6_K and Q8_0 blocks work on 8 bytes of quants per column at a
+// time: the chunk of the 8 columns takes 4 registers w[0..3], w[p] holding the columns 2p and 2p+1. The dot products
+// against 8 repeated bytes of activations leave the partial sums of column 2p in lanes 0-1 and of 2p+1 in lanes 2-3.
+
+// repeat 8 bytes of activations over both 64 bit halves
+static inline int8x16_t load_repeat_i8x8(const int8_t * p) {
+    return vreinterpretq_s8_u64(vld1q_dup_u64((const uint64_t *) p));
+}
+
+// add the dot products of a with the chunk of 8 columns in w to acc
+static inline void dot_cols_i8x8(int32x4_t * acc, const int8x16_t * w, const int8x16_t a) {
+    for (int p = 0; p < 4; p++) {
+        acc[p] = vdotq_s32(acc[p], w[p], a);
+    }
+}
+
+// reduce the partial sums of acc to one int32 per column and add them, times the int16 scales of the 8 columns, to
+// iacc_0123 and iacc_4567
+static inline void mla_cols_int32x8(int32x4_t & iacc_0123, int32x4_t & iacc_4567, const int32x4_t * acc, const int16x8_t scales) {
+    iacc_0123 = vmlaq_s32(iacc_0123, vpaddq_s32(acc[0], acc[1]), vmovl_s16(vget_low_s16(scales)));
+    iacc_4567 = vmlaq_s32(iacc_4567, vpaddq_s32(acc[2], acc[3]), vmovl_s16(vget_high_s16(scales)));
+}
+
+// unpack the 6 bit scales and mins of a block_q4_Kx8 or block_q5_Kx8: bytes 16 * sb + j and 16 * sb + 8 + j of
+// utmp are the scale and the min of sub block sb of column j
+static inline void unpack_scales_mins_Kx8(uint32_t * utmp, const uint8_t * scales) {
+    static const uint32_t kmask1 = 0x3f3f3f3f;
+    static const uint32_t kmask2 = 0x0f0f0f0f;
+    static const uint32_t kmask3 = 0x03030303;
+
+    for (int sb = 0; sb < 8; sb++) {
+        memcpy(utmp + sb * 4, scales + sb * 12, 12);
+        utmp[sb * 4 + 3] = ((utmp[sb * 4 + 2] >> 4) & kmask2) | (((utmp[sb * 4 + 1] >> 6) & kmask3) << 4);
+        const uint32_t uaux_0 = utmp[sb * 4 + 1] & kmask1;
+        utmp[sb * 4 + 1] = (utmp[sb * 4 + 2] & kmask2) | (((utmp[sb * 4 + 0] >> 6) & kmask3) << 4);
+        utmp[sb * 4 + 2] = uaux_0;
+        utmp[sb * 4 + 0] &= kmask1;
+    }
+}
+
+// decode the 4 bit quants of sub block sb of a block_q4_Kx8: the low (even sb) or high (odd sb) nibbles of the qs
+// chunks 4 * (sb / 2) + k, k = 0..3, into w[4 * k .. 4 * k + 3]
+static inline void load_q4_Kx8_sub_block(const block_q4_Kx8 * b, int sb, int8x16_t * w) {
+    const uint8x16_t m4b = vdupq_n_u8(0x0F);
+    for (int k = 0; k < 4; k++) {
+        for (int p = 0; p < 4; p++) {
+            const uint8x16_t q = vld1q_u8(b->qs + ((sb / 2) * 4 + k) * 64 + p * 16);
+            w[k * 4 + p] = vreinterpretq_s8_u8(sb % 2 ? vshrq_n_u8(q, 4) : vandq_u8(q, m4b));
+        }
+    }
+}
+
+// same as load_q4_Kx8_sub_block, the fifth bit of the quants of sub block sb being bit sb of the qh chunk k
+static inline void load_q5_Kx8_sub_block(const block_q5_Kx8 * b, int sb, int8x16_t * w) {
+    const uint8x16_t m4b = vdupq_n_u8(0x0F);
+    const uint8x16_t m10 = vdupq_n_u8(0x10);
+    const int8x16_t shift = vdupq_n_s8(4 - sb);
+    for (int k = 0; k < 4; k++) {
+        for (int p = 0; p < 4; p++) {
+            const uint8x16_t q  = vld1q_u8(b->qs + ((sb / 2) * 4 + k) * 64 + p * 16);
+            const uint8x16_t qh = vld1q_u8(b->qh + k * 64 + p * 16);
+            const uint8x16_t lo = sb % 2 ? vshrq_n_u8(q, 4) : vandq_u8(q, m4b);
+            w[k * 4 + p] = vreinterpretq_s8_u8(vorrq_u8(lo, vandq_u8(vshlq_u8(qh, shift), m10)));
+        }
+    }
+}
+
+// decode the 6 bit quants 128 * h + 32 * q + 8 * k, k = 0..3, of a block_q6_Kx8 into w[4 * k .. 4 * k + 3], minus 32:
+// they are in the low (q < 2) or high nibbles of the ql chunk 8 * h + 4 * (q & 1) + k, with their upper 2 bits at
+// bit 2 * q of the qh chunk 4 * h + k
+static inline void load_q6_Kx8_quarter(const block_q6_Kx8 * b, int h, int q, int8x16_t * w) {
+    const uint8x16_t m4b = vdupq_n_u8(0x0F);
+    const uint8x16_t m30 = vdupq_n_u8(0x30);
+    const int8x16_t  m32s = vdupq_n_s8(32);
+    const int8x16_t shift = vdupq_n_s8(4 - 2 * q);
+    for (int k = 0; k < 4; k++) {
+        for (int p = 0; p < 4; p++) {
+            const uint8x16_t ql = vld1q_u8(b->ql + (8 * h + 4 * (q & 1) + k) * 64 + p * 16);
+            const uint8x16_t qh = vld1q_u8(b->qh + (4 * h + k) * 64 + p * 16);
+            const uint8x16_t lo = q < 2 ? vandq_u8(ql, m4b) : vshrq_n_u8(ql, 4);
+            w[k * 4 + p] = vsubq_s8(vreinterpretq_s8_u8(vorrq_u8(lo, vandq_u8(vshlq_u8(qh, shift), m30))), m32s);
+        }
+    }
+}
+#endif // #if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+
 void lm_ggml_quantize_mat_q8_0_4x4(const float * LM_GGML_RESTRICT x, void * LM_GGML_RESTRICT vy, int64_t k) {
     assert(QK8_0 == 32);
     assert(k % QK8_0 == 0);
@@ -524,6 +611,251 @@ void lm_ggml_gemv_q4_0_8x8_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs, co
     }
 }
 
+void lm_ggml_gemv_q4_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK_K;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    uint32_t utmp[32];
+
+    const block_q8_K * a_ptr = (const block_q8_K *) vy;
+    for (int x = 0; x < nc / ncols_interleaved; x++) {
+        const block_q4_Kx8 * b_ptr = (const block_q4_Kx8 *) vx + (x * nb);
+
+        float32x4_t acc_0123 = vdupq_n_f32(0);
+        float32x4_t acc_4567 = vdupq_n_f32(0);
+
+        for (int b = 0; b < nb; b++) {
+            unpack_scales_mins_Kx8(utmp, b_ptr[b].scales);
+            const uint8_t * scales_mins = (const uint8_t *) utmp;
+
+            int32x4_t iacc_0123 = vdupq_n_s32(0);
+            int32x4_t iacc_4567 = vdupq_n_s32(0);
+            int32x4_t imin_0123 = vdupq_n_s32(0);
+            int32x4_t imin_4567 = vdupq_n_s32(0);
+            for (int sb = 0; sb < QK_K / 32; sb++) {
+                int8x16_t w[16];
+                load_q4_Kx8_sub_block(&b_ptr[b], sb, w);
+
+                int32x4_t acc[4] = { vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0) };
+                for (int k = 0; k < 4; k++) {
+                    dot_cols_i8x8(acc, w + k * 4, load_repeat_i8x8(a_ptr[b].qs + sb * 32 + k * blocklen));
+                }
+                mla_cols_int32x8(iacc_0123, iacc_4567, acc, vreinterpretq_s16_u16(vmovl_u8(vld1_u8(scales_mins + sb * 16))));
+
+                const int16x8_t mins = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(scales_mins + sb * 16 + 8)));
+                const int16_t bsum = a_ptr[b].bsums[sb * 2] + a_ptr[b].bsums[sb * 2 + 1];
+                imin_0123 = vmlal_n_s16(imin_0123, vget_low_s16(mins), bsum);
+                imin_4567 = vmlal_n_s16(imin_4567, vget_high_s16(mins), bsum);
+            }
+
+            const float32x4_t ad = vdupq_n_f32(a_ptr[b].d);
+            const float32x4_t d_0123    = vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d)), ad);
+            const float32x4_t d_4567    = vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d + 4)), ad);
+            const float32x4_t dmin_0123 = vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].dmin)), ad);
+            const float32x4_t dmin_4567 = vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].dmin + 4)), ad);
+            acc_0123 = vfmsq_f32(vfmaq_f32(acc_0123, vcvtq_f32_s32(iacc_0123), d_0123), vcvtq_f32_s32(imin_0123), dmin_0123);
+            acc_4567 = vfmsq_f32(vfmaq_f32(acc_4567, vcvtq_f32_s32(iacc_4567), d_4567), vcvtq_f32_s32(imin_4567), dmin_4567);
+        }
+        vst1q_f32(s + x * ncols_interleaved, acc_0123);
+        vst1q_f32(s + x * ncols_interleaved + 4, acc_4567);
+    }
+    return;
+#endif // #if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    lm_ggml_gemv_q4_K_8x8_q8_K_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemv_q5_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK_K;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    uint32_t utmp[32];
+
+    const block_q8_K * a_ptr = (const block_q8_K *) vy;
+    for (int x = 0; x < nc / ncols_interleaved; x++) {
+        const block_q5_Kx8 * b_ptr = (const block_q5_Kx8 *) vx + (x * nb);
+
+        float32x4_t acc_0123 = vdupq_n_f32(0);
+        float32x4_t acc_4567 = vdupq_n_f32(0);
+
+        for (int b = 0; b < nb; b++) {
+            unpack_scales_mins_Kx8(utmp, b_ptr[b].scales);
+            const uint8_t * scales_mins = (const uint8_t *) utmp;
+
+            int32x4_t iacc_0123 = vdupq_n_s32(0);
+            int32x4_t iacc_4567 = vdupq_n_s32(0);
+            int32x4_t imin_0123 = vdupq_n_s32(0);
+            int32x4_t imin_4567 = vdupq_n_s32(0);
+            for (int sb = 0; sb < QK_K / 32; sb++) {
+                int8x16_t w[16];
+                load_q5_Kx8_sub_block(&b_ptr[b], sb, w);
+
+                int32x4_t acc[4] = { vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0) };
+                for (int k = 0; k < 4; k++) {
+                    dot_cols_i8x8(acc, w + k * 4, load_repeat_i8x8(a_ptr[b].qs + sb * 32 + k * blocklen));
+                }
+                mla_cols_int32x8(iacc_0123, iacc_4567, acc, vreinterpretq_s16_u16(vmovl_u8(vld1_u8(scales_mins + sb * 16))));
+
+                const int16x8_t mins = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(scales_mins + sb * 16 + 8)));
+                const int16_t bsum = a_ptr[b].bsums[sb * 2] + a_ptr[b].bsums[sb * 2 + 1];
+                imin_0123 = vmlal_n_s16(imin_0123, vget_low_s16(mins), bsum);
+                imin_4567 = vmlal_n_s16(imin_4567, vget_high_s16(mins), bsum);
+            }
+
+            const float32x4_t ad = vdupq_n_f32(a_ptr[b].d);
+            const float32x4_t d_0123    = vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d)), ad);
+            const float32x4_t d_4567    = vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d + 4)), ad);
+            const float32x4_t dmin_0123 = vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].dmin)), ad);
+            const float32x4_t dmin_4567 = vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].dmin + 4)), ad);
+            acc_0123 = vfmsq_f32(vfmaq_f32(acc_0123, vcvtq_f32_s32(iacc_0123), d_0123), vcvtq_f32_s32(imin_0123), dmin_0123);
+            acc_4567 = vfmsq_f32(vfmaq_f32(acc_4567, vcvtq_f32_s32(iacc_4567), d_4567), vcvtq_f32_s32(imin_4567), dmin_4567);
+        }
+        vst1q_f32(s + x * ncols_interleaved, acc_0123);
+        vst1q_f32(s + x * ncols_interleaved + 4, acc_4567);
+    }
+    return;
+#endif // #if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    lm_ggml_gemv_q5_K_8x8_q8_K_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemv_q6_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK_K;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    const block_q8_K * a_ptr = (const block_q8_K *) vy;
+    for (int x = 0; x < nc / ncols_interleaved; x++) {
+        const block_q6_Kx8 * b_ptr = (const block_q6_Kx8 *) vx + (x * nb);
+
+        float32x4_t acc_0123 = vdupq_n_f32(0);
+        float32x4_t acc_4567 = vdupq_n_f32(0);
+
+        for (int b = 0; b < nb; b++) {
+            int32x4_t iacc_0123 = vdupq_n_s32(0);
+            int32x4_t iacc_4567 = vdupq_n_s32(0);
+            for (int h = 0; h < 2; h++) {
+                for (int q = 0; q < 4; q++) {
+                    int8x16_t w[16];
+                    load_q6_Kx8_quarter(&b_ptr[b], h, q, w);
+
+                    // the chunks 0-1 and 2-3 are the groups of 16 quants 8 * h + 2 * q and 8 * h + 2 * q + 1
+                    for (int g = 0; g < 2; g++) {
+                        int32x4_t acc[4] = { vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0) };
+                        for (int k = 2 * g; k < 2 * g + 2; k++) {
+                            dot_cols_i8x8(acc, w + k * 4, load_repeat_i8x8(a_ptr[b].qs + 128 * h + 32 * q + k * blocklen));
+                        }
+                        mla_cols_int32x8(iacc_0123, iacc_4567, acc, vmovl_s8(vld1_s8(b_ptr[b].scales + (8 * h + 2 * q + g) * 8)));
+                    }
+                }
+            }
+
+            const float32x4_t ad = vdupq_n_f32(a_ptr[b].d);
+            acc_0123 = vfmaq_f32(acc_0123, vcvtq_f32_s32(iacc_0123), vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d)), ad));
+            acc_4567 = vfmaq_f32(acc_4567, vcvtq_f32_s32(iacc_4567), vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d + 4)), ad));
+        }
+        vst1q_f32(s + x * ncols_interleaved, acc_0123);
+        vst1q_f32(s + x * ncols_interleaved + 4, acc_4567);
+    }
+    return;
+#endif // #if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    lm_ggml_gemv_q6_K_8x8_q8_K_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemv_q8_0_8x8_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK8_0;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    const block_q8_0 * a_ptr = (const block_q8_0 *) vy;
+    for (int x = 0; x < nc / ncols_interleaved; x++) {
+        const block_q8_0x8 * b_ptr = (const block_q8_0x8 *) vx + (x * nb);
+
+        float32x4_t acc_0123 = vdupq_n_f32(0);
+        float32x4_t acc_4567 = vdupq_n_f32(0);
+
+        for (int b = 0; b < nb; b++) {
+            int32x4_t acc[4] = { vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0) };
+            for (int k = 0; k < qk / blocklen; k++) {
+                const int8x16_t w[4] = {
+                    vld1q_s8(b_ptr[b].qs + k * 64),      vld1q_s8(b_ptr[b].qs + k * 64 + 16),
+                    vld1q_s8(b_ptr[b].qs + k * 64 + 32), vld1q_s8(b_ptr[b].qs + k * 64 + 48),
+                };
+                dot_cols_i8x8(acc, w, load_repeat_i8x8(a_ptr[b].qs + k * blocklen));
+            }
+
+            const float32x4_t ad = vdupq_n_f32(LM_GGML_CPU_FP16_TO_FP32(a_ptr[b].d));
+            acc_0123 = vfmaq_f32(acc_0123, vcvtq_f32_s32(vpaddq_s32(acc[0], acc[1])), vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d)), ad));
+            acc_4567 = vfmaq_f32(acc_4567, vcvtq_f32_s32(vpaddq_s32(acc[2], acc[3])), vmulq_f32(vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d + 4)), ad));
+        }
+        vst1q_f32(s + x * ncols_interleaved, acc_0123);
+        vst1q_f32(s + x * ncols_interleaved + 4, acc_4567);
+    }
+    return;
+#endif // #if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    lm_ggml_gemv_q8_0_8x8_q8_0_generic(n, s, bs, vx, vy, nr, nc);
+}
+
 void lm_ggml_gemv_iq4_nl_4x4_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
     const int qk = QK8_0;
     const int nb = n / qk;
@@ -2053,6 +2385,327 @@ void lm_ggml_gemm_q4_0_8x8_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs, co
     }
 }
 
+void lm_ggml_gemm_q4_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK_K;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nr % 4 == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    uint32_t utmp[32];
+
+    for (int y = 0; y < nr / 4; y++) {
+        const block_q8_Kx4 * a_ptr = (const block_q8_Kx4 *) vy + (y * nb);
+        for (int x = 0; x < nc / ncols_interleaved; x++) {
+            const block_q4_Kx8 * b_ptr = (const block_q4_Kx8 *) vx + (x * nb);
+
+            float32x4_t acc_0123[4];
+            float32x4_t acc_4567[4];
+            for (int m = 0; m < 4; m++) {
+                acc_0123[m] = vdupq_n_f32(0);
+                acc_4567[m] = vdupq_n_f32(0);
+            }
+
+            for (int b = 0; b < nb; b++) {
+                unpack_scales_mins_Kx8(utmp, b_ptr[b].scales);
+                const uint8_t * scales_mins = (const uint8_t *) utmp;
+
+                int32x4_t iacc_0123[4];
+                int32x4_t iacc_4567[4];
+                for (int m = 0; m < 4; m++) {
+                    iacc_0123[m] = vdupq_n_s32(0);
+                    iacc_4567[m] = vdupq_n_s32(0);
+                }
+                for (int sb = 0; sb < QK_K / 32; sb++) {
+                    int8x16_t w[16];
+                    load_q4_Kx8_sub_block(&b_ptr[b], sb, w);
+                    const int16x8_t scales = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(scales_mins + sb * 16)));
+
+                    for (int m = 0; m < 4; m++) {
+                        int32x4_t acc[4] = { vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0) };
+                        for (int k = 0; k < 4; k++) {
+                            dot_cols_i8x8(acc, w + k * 4, load_repeat_i8x8(a_ptr[b].qs + (sb * 4 + k) * 4 * blocklen + m * blocklen));
+                        }
+                        mla_cols_int32x8(iacc_0123[m], iacc_4567[m], acc, scales);
+                    }
+                }
+
+                const float32x4_t d_0123    = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d));
+                const float32x4_t d_4567    = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d + 4));
+                const float32x4_t dmin_0123 = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].dmin));
+                const float32x4_t dmin_4567 = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].dmin + 4));
+                for (int m = 0; m < 4; m++) {
+                    int32x4_t imin_0123 = vdupq_n_s32(0);
+                    int32x4_t imin_4567 = vdupq_n_s32(0);
+                    for (int sb = 0; sb < QK_K / 32; sb++) {
+                        const int16x8_t mins = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(scales_mins + sb * 16 + 8)));
+                        const int16_t * bsums = a_ptr[b].bsums + (sb * 8) + (m * 4) - ((sb % 2) * 6);
+                        const int16_t bsum = bsums[0] + bsums[1];
+                        imin_0123 = vmlal_n_s16(imin_0123, vget_low_s16(mins), bsum);
+                        imin_4567 = vmlal_n_s16(imin_4567, vget_high_s16(mins), bsum);
+                    }
+
+                    const float32x4_t ad = vdupq_n_f32(a_ptr[b].d[m]);
+                    acc_0123[m] = vfmsq_f32(vfmaq_f32(acc_0123[m], vcvtq_f32_s32(iacc_0123[m]), vmulq_f32(d_0123, ad)), vcvtq_f32_s32(imin_0123), vmulq_f32(dmin_0123, ad));
+                    acc_4567[m] = vfmsq_f32(vfmaq_f32(acc_4567[m], vcvtq_f32_s32(iacc_4567[m]), vmulq_f32(d_4567, ad)), vcvtq_f32_s32(imin_4567), vmulq_f32(dmin_4567, ad));
+                }
+            }
+            for (int m = 0; m < 4; m++) {
+                vst1q_f32(s + (y * 4 + m) * bs + x * ncols_interleaved, acc_0123[m]);
+                vst1q_f32(s + (y * 4 + m) * bs + x * ncols_interleaved + 4, acc_4567[m]);
+            }
+        }
+    }
+    return;
+#endif // #if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    lm_ggml_gemm_q4_K_8x8_q8_K_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemm_q5_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK_K;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nr % 4 == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    uint32_t utmp[32];
+
+    for (int y = 0; y < nr / 4; y++) {
+        const block_q8_Kx4 * a_ptr = (const block_q8_Kx4 *) vy + (y * nb);
+        for (int x = 0; x < nc / ncols_interleaved; x++) {
+            const block_q5_Kx8 * b_ptr = (const block_q5_Kx8 *) vx + (x * nb);
+
+            float32x4_t acc_0123[4];
+            float32x4_t acc_4567[4];
+            for (int m = 0; m < 4; m++) {
+                acc_0123[m] = vdupq_n_f32(0);
+                acc_4567[m] = vdupq_n_f32(0);
+            }
+
+            for (int b = 0; b < nb; b++) {
+                unpack_scales_mins_Kx8(utmp, b_ptr[b].scales);
+                const uint8_t * scales_mins = (const uint8_t *) utmp;
+
+                int32x4_t iacc_0123[4];
+                int32x4_t iacc_4567[4];
+                for (int m = 0; m < 4; m++) {
+                    iacc_0123[m] = vdupq_n_s32(0);
+                    iacc_4567[m] = vdupq_n_s32(0);
+                }
+                for (int sb = 0; sb < QK_K / 32; sb++) {
+                    int8x16_t w[16];
+                    load_q5_Kx8_sub_block(&b_ptr[b], sb, w);
+                    const int16x8_t scales = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(scales_mins + sb * 16)));
+
+                    for (int m = 0; m < 4; m++) {
+                        int32x4_t acc[4] = { vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0) };
+                        for (int k = 0; k < 4; k++) {
+                            dot_cols_i8x8(acc, w + k * 4, load_repeat_i8x8(a_ptr[b].qs + (sb * 4 + k) * 4 * blocklen + m * blocklen));
+                        }
+                        mla_cols_int32x8(iacc_0123[m], iacc_4567[m], acc, scales);
+                    }
+                }
+
+                const float32x4_t d_0123    = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d));
+                const float32x4_t d_4567    = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d + 4));
+                const float32x4_t dmin_0123 = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].dmin));
+                const float32x4_t dmin_4567 = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].dmin + 4));
+                for (int m = 0; m < 4; m++) {
+                    int32x4_t imin_0123 = vdupq_n_s32(0);
+                    int32x4_t imin_4567 = vdupq_n_s32(0);
+                    for (int sb = 0; sb < QK_K / 32; sb++) {
+                        const int16x8_t mins = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(scales_mins + sb * 16 + 8)));
+                        const int16_t * bsums = a_ptr[b].bsums + (sb * 8) + (m * 4) - ((sb % 2) * 6);
+                        const int16_t bsum = bsums[0] + bsums[1];
+                        imin_0123 = vmlal_n_s16(imin_0123, vget_low_s16(mins), bsum);
+                        imin_4567 = vmlal_n_s16(imin_4567, vget_high_s16(mins), bsum);
+                    }
+
+                    const float32x4_t ad = vdupq_n_f32(a_ptr[b].d[m]);
+                    acc_0123[m] = vfmsq_f32(vfmaq_f32(acc_0123[m], vcvtq_f32_s32(iacc_0123[m]), vmulq_f32(d_0123, ad)), vcvtq_f32_s32(imin_0123), vmulq_f32(dmin_0123, ad));
+                    acc_4567[m] = vfmsq_f32(vfmaq_f32(acc_4567[m], vcvtq_f32_s32(iacc_4567[m]), vmulq_f32(d_4567, ad)), vcvtq_f32_s32(imin_4567), vmulq_f32(dmin_4567, ad));
+                }
+            }
+            for (int m = 0; m < 4; m++) {
+                vst1q_f32(s + (y * 4 + m) * bs + x * ncols_interleaved, acc_0123[m]);
+                vst1q_f32(s + (y * 4 + m) * bs + x * ncols_interleaved + 4, acc_4567[m]);
+            }
+        }
+    }
+    return;
+#endif // #if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    lm_ggml_gemm_q5_K_8x8_q8_K_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemm_q6_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK_K;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nr % 4 == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    for (int y = 0; y < nr / 4; y++) {
+        const block_q8_Kx4 * a_ptr = (const block_q8_Kx4 *) vy + (y * nb);
+        for (int x = 0; x < nc / ncols_interleaved; x++) {
+            const block_q6_Kx8 * b_ptr = (const block_q6_Kx8 *) vx + (x * nb);
+
+            float32x4_t acc_0123[4];
+            float32x4_t acc_4567[4];
+            for (int m = 0; m < 4; m++) {
+                acc_0123[m] = vdupq_n_f32(0);
+                acc_4567[m] = vdupq_n_f32(0);
+            }
+
+            for (int b = 0; b < nb; b++) {
+                int32x4_t iacc_0123[4];
+                int32x4_t iacc_4567[4];
+                for (int m = 0; m < 4; m++) {
+                    iacc_0123[m] = vdupq_n_s32(0);
+                    iacc_4567[m] = vdupq_n_s32(0);
+                }
+                for (int h = 0; h < 2; h++) {
+                    for (int q = 0; q < 4; q++) {
+                        int8x16_t w[16];
+                        load_q6_Kx8_quarter(&b_ptr[b], h, q, w);
+
+                        // see lm_ggml_gemv_q6_K_8x8_q8_K
+                        for (int g = 0; g < 2; g++) {
+                            const int16x8_t scales = vmovl_s8(vld1_s8(b_ptr[b].scales + (8 * h + 2 * q + g) * 8));
+                            for (int m = 0; m < 4; m++) {
+                                int32x4_t acc[4] = { vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0) };
+                                for (int k = 2 * g; k < 2 * g + 2; k++) {
+                                    dot_cols_i8x8(acc, w + k * 4, load_repeat_i8x8(a_ptr[b].qs + (16 * h + 4 * q + k) * 4 * blocklen + m * blocklen));
+                                }
+                                mla_cols_int32x8(iacc_0123[m], iacc_4567[m], acc, scales);
+                            }
+                        }
+                    }
+                }
+
+                const float32x4_t d_0123 = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d));
+                const float32x4_t d_4567 = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d + 4));
+                for (int m = 0; m < 4; m++) {
+                    const float32x4_t ad = vdupq_n_f32(a_ptr[b].d[m]);
+                    acc_0123[m] = vfmaq_f32(acc_0123[m], vcvtq_f32_s32(iacc_0123[m]), vmulq_f32(d_0123, ad));
+                    acc_4567[m] = vfmaq_f32(acc_4567[m], vcvtq_f32_s32(iacc_4567[m]), vmulq_f32(d_4567, ad));
+                }
+            }
+            for (int m = 0; m < 4; m++) {
+                vst1q_f32(s + (y * 4 + m) * bs + x * ncols_interleaved, acc_0123[m]);
+                vst1q_f32(s + (y * 4 + m) * bs + x * ncols_interleaved + 4, acc_4567[m]);
+            }
+        }
+    }
+    return;
+#endif // #if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    lm_ggml_gemm_q6_K_8x8_q8_K_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemm_q8_0_8x8_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK8_0;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nr % 4 == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    for (int y = 0; y < nr / 4; y++) {
+        const block_q8_0x4 * a_ptr = (const block_q8_0x4 *) vy + (y * nb);
+        for (int x = 0; x < nc / ncols_interleaved; x++) {
+            const block_q8_0x8 * b_ptr = (const block_q8_0x8 *) vx + (x * nb);
+
+            float32x4_t acc_0123[4];
+            float32x4_t acc_4567[4];
+            for (int m = 0; m < 4; m++) {
+                acc_0123[m] = vdupq_n_f32(0);
+                acc_4567[m] = vdupq_n_f32(0);
+            }
+
+            for (int b = 0; b < nb; b++) {
+                int8x16_t w[16];
+                for (int i = 0; i < 16; i++) {
+                    w[i] = vld1q_s8(b_ptr[b].qs + i * 16);
+                }
+
+                const float32x4_t d_0123 = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d));
+                const float32x4_t d_4567 = vcvt_f32_f16(vld1_f16((const __fp16 *) b_ptr[b].d + 4));
+                for (int m = 0; m < 4; m++) {
+                    int32x4_t acc[4] = { vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0) };
+                    for (int k = 0; k < qk / blocklen; k++) {
+                        dot_cols_i8x8(acc, w + k * 4, load_repeat_i8x8(a_ptr[b].qs + k * 4 * blocklen + m * blocklen));
+                    }
+
+                    const float32x4_t ad = vdupq_n_f32(LM_GGML_CPU_FP16_TO_FP32(a_ptr[b].d[m]));
+                    acc_0123[m] = vfmaq_f32(acc_0123[m], vcvtq_f32_s32(vpaddq_s32(acc[0], acc[1])), vmulq_f32(d_0123, ad));
+                    acc_4567[m] = vfmaq_f32(acc_4567[m], vcvtq_f32_s32(vpaddq_s32(acc[2], acc[3])), vmulq_f32(d_4567, ad));
+                }
+            }
+            for (int m = 0; m < 4; m++) {
+                vst1q_f32(s + (y * 4 + m) * bs + x * ncols_interleaved, acc_0123[m]);
+                vst1q_f32(s + (y * 4 + m) * bs + x * ncols_interleaved + 4, acc_4567[m]);
+            }
+        }
+    }
+    return;
+#endif // #if ! ((defined(_MSC_VER)) && ! defined(__clang__)) && defined(__aarch64__) && defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    lm_ggml_gemm_q8_0_8x8_q8_0_generic(n, s, bs, vx, vy, nr, nc);
+}
+
 void lm_ggml_gemm_iq4_nl_4x4_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
     const int qk = QK8_0;
     const int nb = n / qk;
@@ -2161,3 +2814,28 @@ void lm_ggml_gemm_iq4_nl_4x4_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs,
         }
     }
 }
+
+#if defined(LM_GGML_CPU_VARIANT)
+void lm_ggml_cpu_variant_repack(void) {
+    struct lm_ggml_repack_kernels * kernels = lm_ggml_repack_get_kernels();
+
+    kernels->quantize_mat_q8_0_4x4 = lm_ggml_quantize_mat_q8_0_4x4;
+    kernels->quantize_mat_q8_0_4x8 = lm_ggml_quantize_mat_q8_0_4x8;
+    kernels->gemv_q4_0_4x4_q8_0    = lm_ggml_gemv_q4_0_4x4_q8_0;
+    kernels->gemv_q4_0_4x8_q8_0    = lm_ggml_gemv_q4_0_4x8_q8_0;
+    kernels->gemv_q4_0_8x8_q8_0    = lm_ggml_gemv_q4_0_8x8_q8_0;
+    kernels->gemv_q4_K_8x8_q8_K    = lm_ggml_gemv_q4_K_8x8_q8_K;
+    kernels->gemv_q5_K_8x8_q8_K    = lm_ggml_gemv_q5_K_8x8_q8_K;
+    kernels->gemv_q6_K_8x8_q8_K    = lm_ggml_gemv_q6_K_8x8_q8_K;
+    kernels->gemv_q8_0_8x8_q8_0    = lm_ggml_gemv_q8_0_8x8_q8_0;
+    kernels->gemv_iq4_nl_4x4_q8_0  = lm_ggml_gemv_iq4_nl_4x4_q8_0;
+    kernels->gemm_q4_0_4x4_q8_0    = lm_ggml_gemm_q4_0_4x4_q8_0;
+    kernels->gemm_q4_0_4x8_q8_0    = lm_ggml_gemm_q4_0_4x8_q8_0;
+    kernels->gemm_q4_0_8x8_q8_0    = lm_ggml_gemm_q4_0_8x8_q8_0;
+    kernels->gemm_q4_K_8x8_q8_K    = lm_ggml_gemm_q4_K_8x8_q8_K;
+    kernels->gemm_q5_K_8x8_q8_K    = lm_ggml_gemm_q5_K_8x8_q8_K;
+    kernels->gemm_q6_K_8x8_q8_K    = lm_ggml_gemm_q6_K_8x8_q8_K;
+    kernels->gemm_q8_0_8x8_q8_0    = lm_ggml_gemm_q8_0_8x8_q8_0;
+    kernels->gemm_iq4_nl_4x4_q8_0  = lm_ggml_gemm_iq4_nl_4x4_q8_0;
+}
+#endif // LM_GGML_CPU_VARIANT
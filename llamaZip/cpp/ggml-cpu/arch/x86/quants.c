@@ -4309,3 +4309,250 @@ void lm_ggml_vec_dot_iq4_xs_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, c
 #endif
 }
 
+
+#if defined(__AVX2__)
+// one row of x against nc columns of y: every block of x is loaded and unpacked once and kept in
+// registers while it is multiplied with the same block of each column, so the weights are streamed once
+
+void lm_ggml_vec_dot_cols_q4_0_q8_0(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc) {
+    const int qk = QK8_0;
+    const int nb = n / qk;
+
+    assert(n % qk == 0);
+    assert(nc <= LM_GGML_VEC_DOT_COLS_MAX);
+
+    const block_q4_0 * LM_GGML_RESTRICT x = vx;
+
+    __m256 acc[LM_GGML_VEC_DOT_COLS_MAX];
+    for (int c = 0; c < nc; ++c) {
+        acc[c] = _mm256_setzero_ps();
+    }
+
+    for (int ib = 0; ib < nb; ++ib) {
+        const float dx = LM_GGML_CPU_FP16_TO_FP32(x[ib].d);
+        const __m256i qx = _mm256_sub_epi8(bytes_from_nibbles_32(x[ib].qs), _mm256_set1_epi8(8));
+
+        for (int c = 0; c < nc; ++c) {
+            const block_q8_0 * LM_GGML_RESTRICT y = (const block_q8_0 *) ((const char *) vy + c*by) + ib;
+
+            const __m256 d = _mm256_set1_ps(dx * LM_GGML_CPU_FP16_TO_FP32(y->d));
+            const __m256 q = mul_sum_i8_pairs_float(qx, _mm256_loadu_si256((const __m256i *) y->qs));
+
+            acc[c] = _mm256_fmadd_ps(d, q, acc[c]);
+        }
+    }
+
+    for (int c = 0; c < nc; ++c) {
+        s[c] = hsum_float_8(acc[c]);
+    }
+}
+
+void lm_ggml_vec_dot_cols_q8_0_q8_0(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc) {
+    const int qk = QK8_0;
+    const int nb = n / qk;
+
+    assert(n % qk == 0);
+    assert(nc <= LM_GGML_VEC_DOT_COLS_MAX);
+
+    const block_q8_0 * LM_GGML_RESTRICT x = vx;
+
+    __m256 acc[LM_GGML_VEC_DOT_COLS_MAX];
+    for (int c = 0; c < nc; ++c) {
+        acc[c] = _mm256_setzero_ps();
+    }
+
+    for (int ib = 0; ib < nb; ++ib) {
+        const float dx = LM_GGML_CPU_FP16_TO_FP32(x[ib].d);
+        const __m256i qx = _mm256_loadu_si256((const __m256i *) x[ib].qs);
+
+        for (int c = 0; c < nc; ++c) {
+            const block_q8_0 * LM_GGML_RESTRICT y = (const block_q8_0 *) ((const char *) vy + c*by) + ib;
+
+            const __m256 d = _mm256_set1_ps(dx * LM_GGML_CPU_FP16_TO_FP32(y->d));
+            const __m256 q = mul_sum_i8_pairs_float(qx, _mm256_loadu_si256((const __m256i *) y->qs));
+
+            acc[c] = _mm256_fmadd_ps(d, q, acc[c]);
+        }
+    }
+
+    for (int c = 0; c < nc; ++c) {
+        s[c] = hsum_float_8(acc[c]);
+    }
+}
+
+void lm_ggml_vec_dot_cols_q4_K_q8_K(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc) {
+    assert(n % QK_K == 0);
+    assert(nc <= LM_GGML_VEC_DOT_COLS_MAX);
+
+    const block_q4_K * LM_GGML_RESTRICT x = vx;
+
+    const int nb = n / QK_K;
+
+    static const uint32_t kmask1 = 0x3f3f3f3f;
+    static const uint32_t kmask2 = 0x0f0f0f0f;
+    static const uint32_t kmask3 = 0x03030303;
+
+    uint32_t utmp[4];
+
+    const __m256i m4 = _mm256_set1_epi8(0xF);
+
+    __m256 acc  [LM_GGML_VEC_DOT_COLS_MAX];
+    __m128 acc_m[LM_GGML_VEC_DOT_COLS_MAX];
+    for (int c = 0; c < nc; ++c) {
+        acc  [c] = _mm256_setzero_ps();
+        acc_m[c] = _mm_setzero_ps();
+    }
+
+    for (int i = 0; i < nb; ++i) {
+        const float d    = LM_GGML_CPU_FP16_TO_FP32(x[i].d);
+        const float dmin = LM_GGML_CPU_FP16_TO_FP32(x[i].dmin);
+
+        memcpy(utmp, x[i].scales, 12);
+        utmp[3] = ((utmp[2] >> 4) & kmask2) | (((utmp[1] >> 6) & kmask3) << 4);
+        const uint32_t uaux = utmp[1] & kmask1;
+        utmp[1] = (utmp[2] & kmask2) | (((utmp[0] >> 6) & kmask3) << 4);
+        utmp[2] = uaux;
+        utmp[0] &= kmask1;
+
+        const __m256i mins_and_scales = _mm256_cvtepu8_epi16(_mm_set_epi32(utmp[3], utmp[2], utmp[1], utmp[0]));
+        const __m128i mins   = _mm256_extracti128_si256(mins_and_scales, 1);
+        const __m128i sc128  = _mm256_extracti128_si256(mins_and_scales, 0);
+        const __m256i scales = MM256_SET_M128I(sc128, sc128);
+
+        // quants and scales of the 32-value sub-blocks
+        __m256i q4[QK_K/32];
+        __m256i sc[QK_K/32];
+        for (int j = 0; j < QK_K/64; ++j) {
+            const __m256i q4bits = _mm256_loadu_si256((const __m256i *) (x[i].qs + 32*j));
+            q4[2*j+0] = _mm256_and_si256(q4bits, m4);
+            q4[2*j+1] = _mm256_and_si256(_mm256_srli_epi16(q4bits, 4), m4);
+            sc[2*j+0] = _mm256_shuffle_epi8(scales, get_scale_shuffle_k4(2*j+0));
+            sc[2*j+1] = _mm256_shuffle_epi8(scales, get_scale_shuffle_k4(2*j+1));
+        }
+
+        for (int c = 0; c < nc; ++c) {
+            const block_q8_K * LM_GGML_RESTRICT y = (const block_q8_K *) ((const char *) vy + c*by) + i;
+
+            const __m256i q8sums = _mm256_loadu_si256((const __m256i *) y->bsums);
+            const __m128i q8s = _mm_hadd_epi16(_mm256_extracti128_si256(q8sums, 0), _mm256_extracti128_si256(q8sums, 1));
+            const __m128i prod = _mm_madd_epi16(mins, q8s);
+            acc_m[c] = _mm_fmadd_ps(_mm_set1_ps(-y->d * dmin), _mm_cvtepi32_ps(prod), acc_m[c]);
+
+            __m256i sumi = _mm256_setzero_si256();
+            for (int k = 0; k < QK_K/32; ++k) {
+                const __m256i q8 = _mm256_loadu_si256((const __m256i *) (y->qs + 32*k));
+                sumi = _mm256_add_epi32(sumi, _mm256_madd_epi16(sc[k], _mm256_maddubs_epi16(q4[k], q8)));
+            }
+
+            acc[c] = _mm256_fmadd_ps(_mm256_set1_ps(y->d * d), _mm256_cvtepi32_ps(sumi), acc[c]);
+        }
+    }
+
+    for (int c = 0; c < nc; ++c) {
+        __m128 acc_mc = _mm_add_ps(acc_m[c], _mm_movehl_ps(acc_m[c], acc_m[c]));
+        acc_mc = _mm_add_ss(acc_mc, _mm_movehdup_ps(acc_mc));
+        s[c] = hsum_float_8(acc[c]) + _mm_cvtss_f32(acc_mc);
+    }
+}
+
+void lm_ggml_vec_dot_cols_q6_K_q8_K(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc) {
+    assert(n % QK_K == 0);
+    assert(nc <= LM_GGML_VEC_DOT_COLS_MAX);
+
+    const block_q6_K * LM_GGML_RESTRICT x = vx;
+
+    const int nb = n / QK_K;
+
+    const __m256i m4 = _mm256_set1_epi8(0xF);
+    const __m256i m2 = _mm256_set1_epi8(3);
+    const __m256i m32s = _mm256_set1_epi8(32);
+
+    __m256 acc[LM_GGML_VEC_DOT_COLS_MAX];
+    for (int c = 0; c < nc; ++c) {
+        acc[c] = _mm256_setzero_ps();
+    }
+
+    for (int i = 0; i < nb; ++i) {
+        const float d = LM_GGML_CPU_FP16_TO_FP32(x[i].d);
+
+        const __m128i scales = _mm_loadu_si128((const __m128i *) x[i].scales);
+
+        // quants and scales of the 32-value sub-blocks, the scales apply to 16 values each
+        __m256i q6[QK_K/32];
+        __m256i sc[QK_K/32];
+        for (int j = 0; j < QK_K/128; ++j) {
+            const __m256i q4bits1 = _mm256_loadu_si256((const __m256i *) (x[i].ql + 64*j));
+            const __m256i q4bits2 = _mm256_loadu_si256((const __m256i *) (x[i].ql + 64*j + 32));
+            const __m256i q4bitsH = _mm256_loadu_si256((const __m256i *) (x[i].qh + 32*j));
+
+            const __m256i q4h_0 = _mm256_slli_epi16(_mm256_and_si256(q4bitsH, m2), 4);
+            const __m256i q4h_1 = _mm256_slli_epi16(_mm256_and_si256(_mm256_srli_epi16(q4bitsH, 2), m2), 4);
+            const __m256i q4h_2 = _mm256_slli_epi16(_mm256_and_si256(_mm256_srli_epi16(q4bitsH, 4), m2), 4);
+            const __m256i q4h_3 = _mm256_slli_epi16(_mm256_and_si256(_mm256_srli_epi16(q4bitsH, 6), m2), 4);
+
+            q6[4*j+0] = _mm256_or_si256(_mm256_and_si256(q4bits1, m4), q4h_0);
+            q6[4*j+1] = _mm256_or_si256(_mm256_and_si256(q4bits2, m4), q4h_1);
+            q6[4*j+2] = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(q4bits1, 4), m4), q4h_2);
+            q6[4*j+3] = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(q4bits2, 4), m4), q4h_3);
+
+            for (int k = 0; k < 4; ++k) {
+                sc[4*j+k] = _mm256_cvtepi8_epi16(_mm_shuffle_epi8(scales, get_scale_shuffle(4*j+k)));
+            }
+        }
+
+        for (int c = 0; c < nc; ++c) {
+            const block_q8_K * LM_GGML_RESTRICT y = (const block_q8_K *) ((const char *) vy + c*by) + i;
+
+            __m256i sumi = _mm256_setzero_si256();
+            for (int k = 0; k < QK_K/32; ++k) {
+                const __m256i q8 = _mm256_loadu_si256((const __m256i *) (y->qs + 32*k));
+                const __m256i p16 = _mm256_sub_epi16(_mm256_maddubs_epi16(q6[k], q8), _mm256_maddubs_epi16(m32s, q8));
+                sumi = _mm256_add_epi32(sumi, _mm256_madd_epi16(sc[k], p16));
+            }
+
+            acc[c] = _mm256_fmadd_ps(_mm256_set1_ps(y->d * d), _mm256_cvtepi32_ps(sumi), acc[c]);
+        }
+    }
+
+    for (int c = 0; c < nc; ++c) {
+        s[c] = hsum_float_8(acc[c]);
+    }
+}
+#endif // __AVX2__
+
+#if defined(LM_GGML_CPU_VARIANT)
+void lm_ggml_cpu_variant_quants(struct lm_ggml_type_traits_cpu * traits) {
+    traits[LM_GGML_TYPE_Q8_0].from_float    = quantize_row_q8_0;
+    traits[LM_GGML_TYPE_Q8_1].from_float    = quantize_row_q8_1;
+    traits[LM_GGML_TYPE_Q8_K].from_float    = quantize_row_q8_K;
+
+    traits[LM_GGML_TYPE_Q4_0].vec_dot       = lm_ggml_vec_dot_q4_0_q8_0;
+    traits[LM_GGML_TYPE_Q4_1].vec_dot       = lm_ggml_vec_dot_q4_1_q8_1;
+    traits[LM_GGML_TYPE_Q5_0].vec_dot       = lm_ggml_vec_dot_q5_0_q8_0;
+    traits[LM_GGML_TYPE_Q5_1].vec_dot       = lm_ggml_vec_dot_q5_1_q8_1;
+    traits[LM_GGML_TYPE_Q8_0].vec_dot       = lm_ggml_vec_dot_q8_0_q8_0;
+    traits[LM_GGML_TYPE_Q2_K].vec_dot       = lm_ggml_vec_dot_q2_K_q8_K;
+    traits[LM_GGML_TYPE_Q3_K].vec_dot       = lm_ggml_vec_dot_q3_K_q8_K;
+    traits[LM_GGML_TYPE_Q4_K].vec_dot       = lm_ggml_vec_dot_q4_K_q8_K;
+    traits[LM_GGML_TYPE_Q5_K].vec_dot       = lm_ggml_vec_dot_q5_K_q8_K;
+    traits[LM_GGML_TYPE_Q6_K].vec_dot       = lm_ggml_vec_dot_q6_K_q8_K;
+    traits[LM_GGML_TYPE_IQ2_XXS].vec_dot    = lm_ggml_vec_dot_iq2_xxs_q8_K;
+    traits[LM_GGML_TYPE_IQ2_XS].vec_dot     = lm_ggml_vec_dot_iq2_xs_q8_K;
+    traits[LM_GGML_TYPE_IQ3_XXS].vec_dot    = lm_ggml_vec_dot_iq3_xxs_q8_K;
+    traits[LM_GGML_TYPE_IQ3_S].vec_dot      = lm_ggml_vec_dot_iq3_s_q8_K;
+    traits[LM_GGML_TYPE_IQ2_S].vec_dot      = lm_ggml_vec_dot_iq2_s_q8_K;
+    traits[LM_GGML_TYPE_IQ1_S].vec_dot      = lm_ggml_vec_dot_iq1_s_q8_K;
+    traits[LM_GGML_TYPE_IQ1_M].vec_dot      = lm_ggml_vec_dot_iq1_m_q8_K;
+    traits[LM_GGML_TYPE_IQ4_NL].vec_dot     = lm_ggml_vec_dot_iq4_nl_q8_0;
+    traits[LM_GGML_TYPE_IQ4_XS].vec_dot     = lm_ggml_vec_dot_iq4_xs_q8_K;
+    traits[LM_GGML_TYPE_TQ1_0].vec_dot      = lm_ggml_vec_dot_tq1_0_q8_K;
+    traits[LM_GGML_TYPE_TQ2_0].vec_dot      = lm_ggml_vec_dot_tq2_0_q8_K;
+
+#if defined(LM_GGML_CPU_HAS_VEC_DOT_COLS)
+    traits[LM_GGML_TYPE_Q4_0].vec_dot_cols  = lm_ggml_vec_dot_cols_q4_0_q8_0;
+    traits[LM_GGML_TYPE_Q8_0].vec_dot_cols  = lm_ggml_vec_dot_cols_q8_0_q8_0;
+    traits[LM_GGML_TYPE_Q4_K].vec_dot_cols  = lm_ggml_vec_dot_cols_q4_K_q8_K;
+    traits[LM_GGML_TYPE_Q6_K].vec_dot_cols  = lm_ggml_vec_dot_cols_q6_K_q8_K;
+#endif
+}
+#endif // LM_GGML_CPU_VARIANT
@@ -175,6 +175,79 @@ static inline __m256i mul_sum_i8_pairs_acc_int32x8(const __m256i acc, const __m2
 }
 #endif
 
+#if defined(__AVX2__)
+// The kernels of the 8x8 interleaved Q5_K, Q6_K, Q8_0 and IQ4_NL blocks work on 8 bytes of quants per column at a
+// time, so that one 256 bit register holds the quants of the columns 0-3 or 4-7, one column per 64 bit lane.
+
+// broadcast 8 bytes of activations to the four 64 bit lanes
+static inline __m256i load_repeat_i8x8(const void * p) {
+    int64_t v;
+    memcpy(&v, p, sizeof(v));
+    return _mm256_set1_epi64x(v);
+}
+
+// reduce the per lane int32 sums of the columns 0-3 and 4-7 to one int32 per column, in column order
+static inline __m256i hsum_cols_int32x8(const __m256i sum_0123, const __m256i sum_4567) {
+    // hadd leaves the columns in the order 0 1 4 5 2 3 6 7
+    return _mm256_permute4x64_epi64(_mm256_hadd_epi32(sum_0123, sum_4567), 0xD8);
+}
+
+// repeat the int16 scales of the 8 columns over the 64 bit lanes of the columns 0-3 and 4-7
+static inline void expand_scales_int16x8(const __m128i scales, __m256i & scales_0123, __m256i & scales_4567) {
+    const __m256i mask_0123 = _mm256_setr_epi8(0, 1, 0, 1, 0, 1, 0, 1, 2, 3, 2, 3, 2, 3, 2, 3,
+                                               4, 5, 4, 5, 4, 5, 4, 5, 6, 7, 6, 7, 6, 7, 6, 7);
+    const __m256i mask_4567 = _mm256_add_epi8(mask_0123, _mm256_set1_epi8(8));
+    const __m256i scales_x2 = _mm256_broadcastsi128_si256(scales);
+    scales_0123 = _mm256_shuffle_epi8(scales_x2, mask_0123);
+    scales_4567 = _mm256_shuffle_epi8(scales_x2, mask_4567);
+}
+
+// unpack the 6 bit scales and mins of a block_q4_Kx8 or block_q5_Kx8: bytes 16 * sb + j and 16 * sb + 8 + j of
+// utmp are the scale and the min of sub block sb of column j
+static inline void unpack_scales_mins_Kx8(uint32_t * utmp, const uint8_t * scales) {
+    static const uint32_t kmask1 = 0x3f3f3f3f;
+    static const uint32_t kmask2 = 0x0f0f0f0f;
+    static const uint32_t kmask3 = 0x03030303;
+
+    for (int sb = 0; sb < 8; sb++) {
+        memcpy(utmp + sb * 4, scales + sb * 12, 12);
+        utmp[sb * 4 + 3] = ((utmp[sb * 4 + 2] >> 4) & kmask2) | (((utmp[sb * 4 + 1] >> 6) & kmask3) << 4);
+        const uint32_t uaux_0 = utmp[sb * 4 + 1] & kmask1;
+        utmp[sb * 4 + 1] = (utmp[sb * 4 + 2] & kmask2) | (((utmp[sb * 4 + 0] >> 6) & kmask3) << 4);
+        utmp[sb * 4 + 2] = uaux_0;
+        utmp[sb * 4 + 0] &= kmask1;
+    }
+}
+
+// decode the 5 bit quants of chunk k of sub blocks 2 * sb (low nibbles) and 2 * sb + 1 (high nibbles) of a block_q5_Kx8
+static inline void load_q5_Kx8_chunk(const block_q5_Kx8 * b, int sb, int k, __m256i * w0, __m256i * w1) {
+    const __m256i m4b = _mm256_set1_epi8(0x0F);
+    const __m256i m1b = _mm256_set1_epi8(1);
+    for (int i = 0; i < 2; i++) {
+        const __m256i q  = _mm256_loadu_si256((const __m256i *) (b->qs + (sb * 4 + k) * 64 + i * 32));
+        const __m256i qh = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i *) (b->qh + k * 64 + i * 32)), 2 * sb);
+        w0[i] = _mm256_or_si256(_mm256_and_si256(q, m4b), _mm256_slli_epi16(_mm256_and_si256(qh, m1b), 4));
+        w1[i] = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(q, 4), m4b),
+                                _mm256_slli_epi16(_mm256_and_si256(_mm256_srli_epi16(qh, 1), m1b), 4));
+    }
+}
+
+// decode the unsigned (+32) 6 bit quants 128 * h + 32 * q + 8 * r of the columns 0-3 (i = 0) or 4-7 (i = 1) of a
+// block_q6_Kx8, for q = 0..3: they are in the low (q < 2) or high nibbles of ql chunk 8 * h + 4 * (q & 1) + r, with
+// their upper 2 bits at bit 2 * q of qh chunk 4 * h + r
+static inline void load_q6_Kx8_chunks(const block_q6_Kx8 * b, int h, int r, int i, __m256i * w) {
+    const __m256i m4b = _mm256_set1_epi8(0x0F);
+    const __m256i m30 = _mm256_set1_epi8(0x30);
+    const __m256i ql0 = _mm256_loadu_si256((const __m256i *) (b->ql + (8 * h + r) * 64 + i * 32));
+    const __m256i ql1 = _mm256_loadu_si256((const __m256i *) (b->ql + (8 * h + 4 + r) * 64 + i * 32));
+    const __m256i qh  = _mm256_loadu_si256((const __m256i *) (b->qh + (4 * h + r) * 64 + i * 32));
+    w[0] = _mm256_or_si256(_mm256_and_si256(ql0, m4b), _mm256_and_si256(_mm256_slli_epi16(qh, 4), m30));
+    w[1] = _mm256_or_si256(_mm256_and_si256(ql1, m4b), _mm256_and_si256(_mm256_slli_epi16(qh, 2), m30));
+    w[2] = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(ql0, 4), m4b), _mm256_and_si256(qh, m30));
+    w[3] = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(ql1, 4), m4b), _mm256_and_si256(_mm256_srli_epi16(qh, 2), m30));
+}
+#endif
+
 void lm_ggml_quantize_mat_q8_0_4x8(const float * LM_GGML_RESTRICT x, void * LM_GGML_RESTRICT vy, int64_t k) {
     assert(QK8_0 == 32);
     assert(k % QK8_0 == 0);
@@ -990,6 +1063,257 @@ void lm_ggml_gemv_q4_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, co
 #endif
 }
 
+void lm_ggml_gemv_q5_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK_K;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if defined(__AVX2__)
+    uint32_t utmp[32];
+
+    const block_q8_K * a_ptr = (const block_q8_K *) vy;
+    for (int x = 0; x < nc / ncols_interleaved; x++) {
+        const block_q5_Kx8 * b_ptr = (const block_q5_Kx8 *) vx + (x * nb);
+
+        __m256 acc_row = _mm256_setzero_ps();
+        __m256 acc_min_row = _mm256_setzero_ps();
+
+        for (int b = 0; b < nb; b++) {
+            unpack_scales_mins_Kx8(utmp, b_ptr[b].scales);
+            const uint8_t * scales = (const uint8_t *) utmp;
+
+            __m256i iacc_0123 = _mm256_setzero_si256();
+            __m256i iacc_4567 = _mm256_setzero_si256();
+            __m256i iacc_min = _mm256_setzero_si256();
+
+            for (int sb = 0; sb < 4; sb++) {
+                // the products of the 4 chunks of a sub block fit in int16 before they are scaled
+                __m256i p0[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+                __m256i p1[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() };
+                for (int k = 0; k < 4; k++) {
+                    __m256i w0[2], w1[2];
+                    load_q5_Kx8_chunk(b_ptr + b, sb, k, w0, w1);
+                    const __m256i a0 = load_repeat_i8x8(a_ptr[b].qs + sb * 64 + k * 8);
+                    const __m256i a1 = load_repeat_i8x8(a_ptr[b].qs + sb * 64 + 32 + k * 8);
+                    for (int i = 0; i < 2; i++) {
+                        p0[i] = _mm256_add_epi16(p0[i], _mm256_maddubs_epi16(w0[i], a0));
+                        p1[i] = _mm256_add_epi16(p1[i], _mm256_maddubs_epi16(w1[i], a1));
+                    }
+                }
+                __m256i sc0_0123, sc0_4567, sc1_0123, sc1_4567;
+                expand_scales_int16x8(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *) (scales + 32 * sb))), sc0_0123, sc0_4567);
+                expand_scales_int16x8(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *) (scales + 32 * sb + 16))), sc1_0123, sc1_4567);
+                iacc_0123 = _mm256_add_epi32(iacc_0123, _mm256_madd_epi16(p0[0], sc0_0123));
+                iacc_0123 = _mm256_add_epi32(iacc_0123, _mm256_madd_epi16(p1[0], sc1_0123));
+                iacc_4567 = _mm256_add_epi32(iacc_4567, _mm256_madd_epi16(p0[1], sc0_4567));
+                iacc_4567 = _mm256_add_epi32(iacc_4567, _mm256_madd_epi16(p1[1], sc1_4567));
+            }
+            for (int sb = 0; sb < 8; sb++) {
+                const __m256i mins = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (scales + 16 * sb + 8)));
+                const int bsum = a_ptr[b].bsums[sb * 2] + a_ptr[b].bsums[sb * 2 + 1];
+                iacc_min = _mm256_add_epi32(iacc_min, _mm256_mullo_epi32(mins, _mm256_set1_epi32(bsum)));
+            }
+
+            const __m256 d_a = _mm256_set1_ps(a_ptr[b].d);
+            acc_row = _mm256_fmadd_ps(_mm256_cvtepi32_ps(hsum_cols_int32x8(iacc_0123, iacc_4567)),
+                                      _mm256_mul_ps(LM_GGML_F32Cx8_LOAD(b_ptr[b].d), d_a), acc_row);
+            acc_min_row = _mm256_fmadd_ps(_mm256_cvtepi32_ps(iacc_min), _mm256_mul_ps(LM_GGML_F32Cx8_LOAD(b_ptr[b].dmin), d_a), acc_min_row);
+        }
+        _mm256_storeu_ps(s + x * ncols_interleaved, _mm256_sub_ps(acc_row, acc_min_row));
+    }
+    return;
+#endif
+    lm_ggml_gemv_q5_K_8x8_q8_K_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemv_q6_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK_K;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if defined(__AVX2__)
+    const block_q8_K * a_ptr = (const block_q8_K *) vy;
+    for (int x = 0; x < nc / ncols_interleaved; x++) {
+        const block_q6_Kx8 * b_ptr = (const block_q6_Kx8 *) vx + (x * nb);
+
+        __m256 acc_row = _mm256_setzero_ps();
+
+        for (int b = 0; b < nb; b++) {
+            __m256i iacc_0123 = _mm256_setzero_si256();
+            __m256i iacc_4567 = _mm256_setzero_si256();
+
+            for (int h = 0; h < 2; h++) {
+                for (int g = 0; g < 2; g++) {
+                    // the products of the 2 chunks of a group of 16 quants fit in int16 before they are scaled
+                    __m256i p_0123[4], p_4567[4];
+                    for (int q = 0; q < 4; q++) {
+                        p_0123[q] = _mm256_setzero_si256();
+                        p_4567[q] = _mm256_setzero_si256();
+                    }
+                    for (int r = 2 * g; r < 2 * g + 2; r++) {
+                        __m256i w_0123[4], w_4567[4];
+                        load_q6_Kx8_chunks(b_ptr + b, h, r, 0, w_0123);
+                        load_q6_Kx8_chunks(b_ptr + b, h, r, 1, w_4567);
+                        for (int q = 0; q < 4; q++) {
+                            const __m256i a = load_repeat_i8x8(a_ptr[b].qs + 128 * h + 32 * q + 8 * r);
+                            p_0123[q] = _mm256_add_epi16(p_0123[q], _mm256_maddubs_epi16(w_0123[q], a));
+                            p_4567[q] = _mm256_add_epi16(p_4567[q], _mm256_maddubs_epi16(w_4567[q], a));
+                        }
+                    }
+                    for (int q = 0; q < 4; q++) {
+                        __m256i sc_0123, sc_4567;
+                        expand_scales_int16x8(_mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i *) (b_ptr[b].scales + (8 * h + 2 * q + g) * 8))), sc_0123, sc_4567);
+                        iacc_0123 = _mm256_add_epi32(iacc_0123, _mm256_madd_epi16(p_0123[q], sc_0123));
+                        iacc_4567 = _mm256_add_epi32(iacc_4567, _mm256_madd_epi16(p_4567[q], sc_4567));
+                    }
+                }
+            }
+
+            // the quants were used without their -32 offset, take it out through the sums of the activations
+            __m256i iacc_offset = _mm256_setzero_si256();
+            for (int g = 0; g < QK_K / 16; g += 2) {
+                // pair the scales of the groups g and g + 1 of each column with the sums of both groups
+                const __m128i sc = _mm_loadu_si128((const __m128i *) (b_ptr[b].scales + g * 8));
+                const __m256i sc_pairs = _mm256_cvtepi8_epi16(_mm_unpacklo_epi8(sc, _mm_srli_si128(sc, 8)));
+                int32_t bsums;
+                memcpy(&bsums, a_ptr[b].bsums + g, sizeof(bsums));
+                iacc_offset = _mm256_add_epi32(iacc_offset, _mm256_madd_epi16(sc_pairs, _mm256_set1_epi32(bsums)));
+            }
+            const __m256i iacc = _mm256_sub_epi32(hsum_cols_int32x8(iacc_0123, iacc_4567), _mm256_slli_epi32(iacc_offset, 5));
+
+            acc_row = _mm256_fmadd_ps(_mm256_cvtepi32_ps(iacc), _mm256_mul_ps(LM_GGML_F32Cx8_LOAD(b_ptr[b].d), _mm256_set1_ps(a_ptr[b].d)), acc_row);
+        }
+        _mm256_storeu_ps(s + x * ncols_interleaved, acc_row);
+    }
+    return;
+#endif
+    lm_ggml_gemv_q6_K_8x8_q8_K_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemv_q8_0_8x8_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK8_0;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if defined(__AVX2__)
+    const block_q8_0 * a_ptr = (const block_q8_0 *) vy;
+    for (int x = 0; x < nc / ncols_interleaved; x++) {
+        const block_q8_0x8 * b_ptr = (const block_q8_0x8 *) vx + (x * nb);
+
+        __m256 acc_row = _mm256_setzero_ps();
+
+        for (int b = 0; b < nb; b++) {
+            __m256i iacc_0123 = _mm256_setzero_si256();
+            __m256i iacc_4567 = _mm256_setzero_si256();
+            for (int k = 0; k < qk / blocklen; k++) {
+                const __m256i a = load_repeat_i8x8(a_ptr[b].qs + k * blocklen);
+                iacc_0123 = mul_sum_i8_pairs_acc_int32x8(iacc_0123, _mm256_loadu_si256((const __m256i *) (b_ptr[b].qs + k * 64)), a);
+                iacc_4567 = mul_sum_i8_pairs_acc_int32x8(iacc_4567, _mm256_loadu_si256((const __m256i *) (b_ptr[b].qs + k * 64 + 32)), a);
+            }
+            const __m256 d = _mm256_mul_ps(LM_GGML_F32Cx8_LOAD(b_ptr[b].d), _mm256_set1_ps(LM_GGML_CPU_FP16_TO_FP32(a_ptr[b].d)));
+            acc_row = _mm256_fmadd_ps(_mm256_cvtepi32_ps(hsum_cols_int32x8(iacc_0123, iacc_4567)), d, acc_row);
+        }
+        _mm256_storeu_ps(s + x * ncols_interleaved, acc_row);
+    }
+    return;
+#endif
+    lm_ggml_gemv_q8_0_8x8_q8_0_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemv_iq4_nl_8x8_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK8_0;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if defined(__AVX2__)
+    const __m256i kvalues = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) kvalues_iq4nl));
+    const __m256i m4b = _mm256_set1_epi8(0x0F);
+
+    const block_q8_0 * a_ptr = (const block_q8_0 *) vy;
+    for (int x = 0; x < nc / ncols_interleaved; x++) {
+        const block_iq4_nlx8 * b_ptr = (const block_iq4_nlx8 *) vx + (x * nb);
+
+        __m256 acc_row = _mm256_setzero_ps();
+
+        for (int b = 0; b < nb; b++) {
+            __m256i iacc_0123 = _mm256_setzero_si256();
+            __m256i iacc_4567 = _mm256_setzero_si256();
+            for (int k = 0; k < qk / (2 * blocklen); k++) {
+                const __m256i q_0123 = _mm256_loadu_si256((const __m256i *) (b_ptr[b].qs + k * 64));
+                const __m256i q_4567 = _mm256_loadu_si256((const __m256i *) (b_ptr[b].qs + k * 64 + 32));
+                const __m256i a0 = load_repeat_i8x8(a_ptr[b].qs + k * blocklen);
+                const __m256i a1 = load_repeat_i8x8(a_ptr[b].qs + k * blocklen + qk / 2);
+                iacc_0123 = mul_sum_i8_pairs_acc_int32x8(iacc_0123, _mm256_shuffle_epi8(kvalues, _mm256_and_si256(q_0123, m4b)), a0);
+                iacc_0123 = mul_sum_i8_pairs_acc_int32x8(iacc_0123, _mm256_shuffle_epi8(kvalues, _mm256_and_si256(_mm256_srli_epi16(q_0123, 4), m4b)), a1);
+                iacc_4567 = mul_sum_i8_pairs_acc_int32x8(iacc_4567, _mm256_shuffle_epi8(kvalues, _mm256_and_si256(q_4567, m4b)), a0);
+                iacc_4567 = mul_sum_i8_pairs_acc_int32x8(iacc_4567, _mm256_shuffle_epi8(kvalues, _mm256_and_si256(_mm256_srli_epi16(q_4567, 4), m4b)), a1);
+            }
+            const __m256 d = _mm256_mul_ps(LM_GGML_F32Cx8_LOAD(b_ptr[b].d), _mm256_set1_ps(LM_GGML_CPU_FP16_TO_FP32(a_ptr[b].d)));
+            acc_row = _mm256_fmadd_ps(_mm256_cvtepi32_ps(hsum_cols_int32x8(iacc_0123, iacc_4567)), d, acc_row);
+        }
+        _mm256_storeu_ps(s + x * ncols_interleaved, acc_row);
+    }
+    return;
+#endif
+    lm_ggml_gemv_iq4_nl_8x8_q8_0_generic(n, s, bs, vx, vy, nr, nc);
+}
+
 void lm_ggml_gemm_q4_0_8x8_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
     const int qk = QK8_0;
     const int nb = n / qk;
@@ -3283,3 +3607,330 @@ void lm_ggml_gemm_q4_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, co
     }
 #endif
 }
+
+void lm_ggml_gemm_q5_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK_K;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nr % 4 == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if defined(__AVX2__)
+    uint32_t utmp[32];
+
+    for (int y = 0; y < nr / 4; y++) {
+        const block_q8_Kx4 * a_ptr = (const block_q8_Kx4 *) vy + (y * nb);
+        for (int x = 0; x < nc / ncols_interleaved; x++) {
+            const block_q5_Kx8 * b_ptr = (const block_q5_Kx8 *) vx + (x * nb);
+
+            __m256 acc_rows[4];
+            for (int m = 0; m < 4; m++) {
+                acc_rows[m] = _mm256_setzero_ps();
+            }
+
+            for (int b = 0; b < nb; b++) {
+                unpack_scales_mins_Kx8(utmp, b_ptr[b].scales);
+                const uint8_t * scales = (const uint8_t *) utmp;
+
+                __m256i iacc_0123[4], iacc_4567[4], iacc_min[4];
+                for (int m = 0; m < 4; m++) {
+                    iacc_0123[m] = _mm256_setzero_si256();
+                    iacc_4567[m] = _mm256_setzero_si256();
+                    iacc_min[m] = _mm256_setzero_si256();
+                }
+
+                for (int sb = 0; sb < 4; sb++) {
+                    __m256i sc0_0123, sc0_4567, sc1_0123, sc1_4567;
+                    expand_scales_int16x8(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *) (scales + 32 * sb))), sc0_0123, sc0_4567);
+                    expand_scales_int16x8(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *) (scales + 32 * sb + 16))), sc1_0123, sc1_4567);
+                    for (int k = 0; k < 4; k++) {
+                        __m256i w0[2], w1[2];
+                        load_q5_Kx8_chunk(b_ptr + b, sb, k, w0, w1);
+                        for (int m = 0; m < 4; m++) {
+                            const __m256i a0 = load_repeat_i8x8(a_ptr[b].qs + (sb * 8 + k) * 32 + m * 8);
+                            const __m256i a1 = load_repeat_i8x8(a_ptr[b].qs + (sb * 8 + 4 + k) * 32 + m * 8);
+                            iacc_0123[m] = _mm256_add_epi32(iacc_0123[m], _mm256_madd_epi16(_mm256_maddubs_epi16(w0[0], a0), sc0_0123));
+                            iacc_0123[m] = _mm256_add_epi32(iacc_0123[m], _mm256_madd_epi16(_mm256_maddubs_epi16(w1[0], a1), sc1_0123));
+                            iacc_4567[m] = _mm256_add_epi32(iacc_4567[m], _mm256_madd_epi16(_mm256_maddubs_epi16(w0[1], a0), sc0_4567));
+                            iacc_4567[m] = _mm256_add_epi32(iacc_4567[m], _mm256_madd_epi16(_mm256_maddubs_epi16(w1[1], a1), sc1_4567));
+                        }
+                    }
+                }
+                for (int sb = 0; sb < 8; sb++) {
+                    const __m256i mins = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (scales + 16 * sb + 8)));
+                    for (int m = 0; m < 4; m++) {
+                        const int16_t * bsums = a_ptr[b].bsums + (sb >> 1) * 16 + m * 4 + (sb & 1) * 2;
+                        iacc_min[m] = _mm256_add_epi32(iacc_min[m], _mm256_mullo_epi32(mins, _mm256_set1_epi32(bsums[0] + bsums[1])));
+                    }
+                }
+
+                const __m256 d    = LM_GGML_F32Cx8_LOAD(b_ptr[b].d);
+                const __m256 dmin = LM_GGML_F32Cx8_LOAD(b_ptr[b].dmin);
+                for (int m = 0; m < 4; m++) {
+                    const __m256 d_a = _mm256_set1_ps(a_ptr[b].d[m]);
+                    acc_rows[m] = _mm256_fmadd_ps(_mm256_cvtepi32_ps(hsum_cols_int32x8(iacc_0123[m], iacc_4567[m])), _mm256_mul_ps(d, d_a), acc_rows[m]);
+                    acc_rows[m] = _mm256_fnmadd_ps(_mm256_cvtepi32_ps(iacc_min[m]), _mm256_mul_ps(dmin, d_a), acc_rows[m]);
+                }
+            }
+            for (int m = 0; m < 4; m++) {
+                _mm256_storeu_ps(s + (y * 4 + m) * bs + x * ncols_interleaved, acc_rows[m]);
+            }
+        }
+    }
+    return;
+#endif
+    lm_ggml_gemm_q5_K_8x8_q8_K_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemm_q6_K_8x8_q8_K(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK_K;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nr % 4 == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if defined(__AVX2__)
+    for (int y = 0; y < nr / 4; y++) {
+        const block_q8_Kx4 * a_ptr = (const block_q8_Kx4 *) vy + (y * nb);
+        for (int x = 0; x < nc / ncols_interleaved; x++) {
+            const block_q6_Kx8 * b_ptr = (const block_q6_Kx8 *) vx + (x * nb);
+
+            __m256 acc_rows[4];
+            for (int m = 0; m < 4; m++) {
+                acc_rows[m] = _mm256_setzero_ps();
+            }
+
+            for (int b = 0; b < nb; b++) {
+                __m256i iacc_0123[4], iacc_4567[4];
+                for (int m = 0; m < 4; m++) {
+                    iacc_0123[m] = _mm256_setzero_si256();
+                    iacc_4567[m] = _mm256_setzero_si256();
+                }
+
+                for (int h = 0; h < 2; h++) {
+                    for (int g = 0; g < 2; g++) {
+                        __m256i w_0123[2][4], w_4567[2][4];
+                        for (int r = 0; r < 2; r++) {
+                            load_q6_Kx8_chunks(b_ptr + b, h, 2 * g + r, 0, w_0123[r]);
+                            load_q6_Kx8_chunks(b_ptr + b, h, 2 * g + r, 1, w_4567[r]);
+                        }
+                        for (int q = 0; q < 4; q++) {
+                            __m256i sc_0123, sc_4567;
+                            expand_scales_int16x8(_mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i *) (b_ptr[b].scales + (8 * h + 2 * q + g) * 8))), sc_0123, sc_4567);
+                            const int8_t * a_qs = a_ptr[b].qs + (16 * h + 4 * q + 2 * g) * 32;
+                            for (int m = 0; m < 4; m++) {
+                                const __m256i a0 = load_repeat_i8x8(a_qs + m * 8);
+                                const __m256i a1 = load_repeat_i8x8(a_qs + 32 + m * 8);
+                                const __m256i p_0123 = _mm256_add_epi16(_mm256_maddubs_epi16(w_0123[0][q], a0), _mm256_maddubs_epi16(w_0123[1][q], a1));
+                                const __m256i p_4567 = _mm256_add_epi16(_mm256_maddubs_epi16(w_4567[0][q], a0), _mm256_maddubs_epi16(w_4567[1][q], a1));
+                                iacc_0123[m] = _mm256_add_epi32(iacc_0123[m], _mm256_madd_epi16(p_0123, sc_0123));
+                                iacc_4567[m] = _mm256_add_epi32(iacc_4567[m], _mm256_madd_epi16(p_4567, sc_4567));
+                            }
+                        }
+                    }
+                }
+
+                const __m256 d = LM_GGML_F32Cx8_LOAD(b_ptr[b].d);
+                for (int m = 0; m < 4; m++) {
+                    __m256i iacc_offset = _mm256_setzero_si256();
+                    for (int g = 0; g < QK_K / 16; g += 2) {
+                        const __m128i sc = _mm_loadu_si128((const __m128i *) (b_ptr[b].scales + g * 8));
+                        const __m256i sc_pairs = _mm256_cvtepi8_epi16(_mm_unpacklo_epi8(sc, _mm_srli_si128(sc, 8)));
+                        int32_t bsums;
+                        memcpy(&bsums, a_ptr[b].bsums + (g >> 2) * 16 + m * 4 + (g & 3), sizeof(bsums));
+                        iacc_offset = _mm256_add_epi32(iacc_offset, _mm256_madd_epi16(sc_pairs, _mm256_set1_epi32(bsums)));
+                    }
+                    const __m256i iacc = _mm256_sub_epi32(hsum_cols_int32x8(iacc_0123[m], iacc_4567[m]), _mm256_slli_epi32(iacc_offset, 5));
+                    acc_rows[m] = _mm256_fmadd_ps(_mm256_cvtepi32_ps(iacc), _mm256_mul_ps(d, _mm256_set1_ps(a_ptr[b].d[m])), acc_rows[m]);
+                }
+            }
+            for (int m = 0; m < 4; m++) {
+                _mm256_storeu_ps(s + (y * 4 + m) * bs + x * ncols_interleaved, acc_rows[m]);
+            }
+        }
+    }
+    return;
+#endif
+    lm_ggml_gemm_q6_K_8x8_q8_K_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemm_q8_0_8x8_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK8_0;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nr % 4 == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if defined(__AVX2__)
+    for (int y = 0; y < nr / 4; y++) {
+        const block_q8_0x4 * a_ptr = (const block_q8_0x4 *) vy + (y * nb);
+        for (int x = 0; x < nc / ncols_interleaved; x++) {
+            const block_q8_0x8 * b_ptr = (const block_q8_0x8 *) vx + (x * nb);
+
+            __m256 acc_rows[4];
+            for (int m = 0; m < 4; m++) {
+                acc_rows[m] = _mm256_setzero_ps();
+            }
+
+            for (int b = 0; b < nb; b++) {
+                __m256i iacc_0123[4], iacc_4567[4];
+                for (int m = 0; m < 4; m++) {
+                    iacc_0123[m] = _mm256_setzero_si256();
+                    iacc_4567[m] = _mm256_setzero_si256();
+                }
+                for (int k = 0; k < qk / blocklen; k++) {
+                    const __m256i w_0123 = _mm256_loadu_si256((const __m256i *) (b_ptr[b].qs + k * 64));
+                    const __m256i w_4567 = _mm256_loadu_si256((const __m256i *) (b_ptr[b].qs + k * 64 + 32));
+                    for (int m = 0; m < 4; m++) {
+                        const __m256i a = load_repeat_i8x8(a_ptr[b].qs + k * 32 + m * 8);
+                        iacc_0123[m] = mul_sum_i8_pairs_acc_int32x8(iacc_0123[m], w_0123, a);
+                        iacc_4567[m] = mul_sum_i8_pairs_acc_int32x8(iacc_4567[m], w_4567, a);
+                    }
+                }
+                const __m256 d = LM_GGML_F32Cx8_LOAD(b_ptr[b].d);
+                for (int m = 0; m < 4; m++) {
+                    const __m256 d_a = _mm256_set1_ps(LM_GGML_CPU_FP16_TO_FP32(a_ptr[b].d[m]));
+                    acc_rows[m] = _mm256_fmadd_ps(_mm256_cvtepi32_ps(hsum_cols_int32x8(iacc_0123[m], iacc_4567[m])), _mm256_mul_ps(d, d_a), acc_rows[m]);
+                }
+            }
+            for (int m = 0; m < 4; m++) {
+                _mm256_storeu_ps(s + (y * 4 + m) * bs + x * ncols_interleaved, acc_rows[m]);
+            }
+        }
+    }
+    return;
+#endif
+    lm_ggml_gemm_q8_0_8x8_q8_0_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+void lm_ggml_gemm_iq4_nl_8x8_q8_0(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, int nr, int nc) {
+    const int qk = QK8_0;
+    const int nb = n / qk;
+    const int ncols_interleaved = 8;
+    const int blocklen = 8;
+
+    assert (n % qk == 0);
+    assert (nr % 4 == 0);
+    assert (nc % ncols_interleaved == 0);
+
+    UNUSED(s);
+    UNUSED(bs);
+    UNUSED(vx);
+    UNUSED(vy);
+    UNUSED(nr);
+    UNUSED(nc);
+    UNUSED(nb);
+    UNUSED(ncols_interleaved);
+    UNUSED(blocklen);
+
+#if defined(__AVX2__)
+    const __m256i kvalues = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) kvalues_iq4nl));
+    const __m256i m4b = _mm256_set1_epi8(0x0F);
+
+    for (int y = 0; y < nr / 4; y++) {
+        const block_q8_0x4 * a_ptr = (const block_q8_0x4 *) vy + (y * nb);
+        for (int x = 0; x < nc / ncols_interleaved; x++) {
+            const block_iq4_nlx8 * b_ptr = (const block_iq4_nlx8 *) vx + (x * nb);
+
+            __m256 acc_rows[4];
+            for (int m = 0; m < 4; m++) {
+                acc_rows[m] = _mm256_setzero_ps();
+            }
+
+            for (int b = 0; b < nb; b++) {
+                __m256i iacc_0123[4], iacc_4567[4];
+                for (int m = 0; m < 4; m++) {
+                    iacc_0123[m] = _mm256_setzero_si256();
+                    iacc_4567[m] = _mm256_setzero_si256();
+                }
+                for (int k = 0; k < qk / (2 * blocklen); k++) {
+                    const __m256i q_0123 = _mm256_loadu_si256((const __m256i *) (b_ptr[b].qs + k * 64));
+                    const __m256i q_4567 = _mm256_loadu_si256((const __m256i *) (b_ptr[b].qs + k * 64 + 32));
+                    const __m256i w0_0123 = _mm256_shuffle_epi8(kvalues, _mm256_and_si256(q_0123, m4b));
+                    const __m256i w1_0123 = _mm256_shuffle_epi8(kvalues, _mm256_and_si256(_mm256_srli_epi16(q_0123, 4), m4b));
+                    const __m256i w0_4567 = _mm256_shuffle_epi8(kvalues, _mm256_and_si256(q_4567, m4b));
+                    const __m256i w1_4567 = _mm256_shuffle_epi8(kvalues, _mm256_and_si256(_mm256_srli_epi16(q_4567, 4), m4b));
+                    for (int m = 0; m < 4; m++) {
+                        const __m256i a0 = load_repeat_i8x8(a_ptr[b].qs + k * 32 + m * 8);
+                        const __m256i a1 = load_repeat_i8x8(a_ptr[b].qs + k * 32 + m * 8 + qk / 2 * 4);
+                        iacc_0123[m] = mul_sum_i8_pairs_acc_int32x8(iacc_0123[m], w0_0123, a0);
+                        iacc_0123[m] = mul_sum_i8_pairs_acc_int32x8(iacc_0123[m], w1_0123, a1);
+                        iacc_4567[m] = mul_sum_i8_pairs_acc_int32x8(iacc_4567[m], w0_4567, a0);
+                        iacc_4567[m] = mul_sum_i8_pairs_acc_int32x8(iacc_4567[m], w1_4567, a1);
+                    }
+                }
+                const __m256 d = LM_GGML_F32Cx8_LOAD(b_ptr[b].d);
+                for (int m = 0; m < 4; m++) {
+                    const __m256 d_a = _mm256_set1_ps(LM_GGML_CPU_FP16_TO_FP32(a_ptr[b].d[m]));
+                    acc_rows[m] = _mm256_fmadd_ps(_mm256_cvtepi32_ps(hsum_cols_int32x8(iacc_0123[m], iacc_4567[m])), _mm256_mul_ps(d, d_a), acc_rows[m]);
+                }
+            }
+            for (int m = 0; m < 4; m++) {
+                _mm256_storeu_ps(s + (y * 4 + m) * bs + x * ncols_interleaved, acc_rows[m]);
+            }
+        }
+    }
+    return;
+#endif
+    lm_ggml_gemm_iq4_nl_8x8_q8_0_generic(n, s, bs, vx, vy, nr, nc);
+}
+
+#if defined(LM_GGML_CPU_VARIANT)
+void lm_ggml_cpu_variant_repack(void) {
+    struct lm_ggml_repack_kernels * kernels = lm_ggml_repack_get_kernels();
+
+    kernels->quantize_mat_q8_0_4x8 = lm_ggml_quantize_mat_q8_0_4x8;
+    kernels->quantize_mat_q8_K_4x8 = lm_ggml_quantize_mat_q8_K_4x8;
+    kernels->gemv_q4_0_8x8_q8_0    = lm_ggml_gemv_q4_0_8x8_q8_0;
+    kernels->gemv_q4_K_8x8_q8_K    = lm_ggml_gemv_q4_K_8x8_q8_K;
+    kernels->gemv_q5_K_8x8_q8_K    = lm_ggml_gemv_q5_K_8x8_q8_K;
+    kernels->gemv_q6_K_8x8_q8_K    = lm_ggml_gemv_q6_K_8x8_q8_K;
+    kernels->gemv_q8_0_8x8_q8_0    = lm_ggml_gemv_q8_0_8x8_q8_0;
+    kernels->gemv_iq4_nl_8x8_q8_0  = lm_ggml_gemv_iq4_nl_8x8_q8_0;
+    kernels->gemm_q4_0_8x8_q8_0    = lm_ggml_gemm_q4_0_8x8_q8_0;
+    kernels->gemm_q4_K_8x8_q8_K    = lm_ggml_gemm_q4_K_8x8_q8_K;
+    kernels->gemm_q5_K_8x8_q8_K    = lm_ggml_gemm_q5_K_8x8_q8_K;
+    kernels->gemm_q6_K_8x8_q8_K    = lm_ggml_gemm_q6_K_8x8_q8_K;
+    kernels->gemm_q8_0_8x8_q8_0    = lm_ggml_gemm_q8_0_8x8_q8_0;
+    kernels->gemm_iq4_nl_8x8_q8_0  = lm_ggml_gemm_iq4_nl_8x8_q8_0;
+}
+#endif // LM_GGML_CPU_VARIANT
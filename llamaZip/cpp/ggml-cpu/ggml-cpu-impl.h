@@ -24,6 +24,9 @@ struct lm_ggml_compute_params {
     void * wdata;
 
     struct lm_ggml_threadpool * threadpool;
+
+    // index of the node in the graph, for the dynamic split of its rows (-1 if none)
+    int node_n;
 };
 
 
@@ -512,6 +515,14 @@ void lm_ggml_barrier(struct lm_ggml_threadpool * tp);
 void lm_ggml_threadpool_chunk_set(struct lm_ggml_threadpool * tp, int value);
 int  lm_ggml_threadpool_chunk_add(struct lm_ggml_threadpool * tp, int value);
 
+// split nr rows between the threads, in proportion to the capacity of the cores they are pinned to (big.LITTLE)
+void lm_ggml_cpu_thread_range(const struct lm_ggml_compute_params * params, int64_t nr, int64_t * ir0, int64_t * ir1);
+
+// dynamic split of the nr rows of the current node: the threads claim chunks of rows [ir0, ir1) until none is left,
+// so that the faster cores end up computing more of them. can be used for a single loop over the rows per node:
+//   for (int64_t ir0 = 0, ir1 = 0; lm_ggml_cpu_rows_next(params, nr, &ir0, &ir1); ) { ... }
+bool lm_ggml_cpu_rows_next(const struct lm_ggml_compute_params * params, int64_t nr, int64_t * ir0, int64_t * ir1);
+
 #ifdef __cplusplus
 }
 #endif
@@ -37,6 +37,11 @@
 #if defined(__gnu_linux__)
 #include <syscall.h>
 #endif
+#if defined(__linux__) && !defined(LM_GGML_USE_OPENMP)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #ifdef LM_GGML_USE_OPENMP
 #include <omp.h>
@@ -48,6 +53,13 @@
 
 #ifdef LM_GGML_USE_LLAMAFILE
 #include "llamafile/sgemm.h"
+
+// mul_mat only uses the tiled sgemm when src1 has enough columns to reuse the loaded rows of src0,
+// the token generation stays on the vec_dot kernels
+#define LM_GGML_CPU_SGEMM_MIN_COLS 4
+
+// the sgemm of the best kernel variant, see lm_ggml_cpu_init_variant
+static llamafile_sgemm_t lm_ggml_cpu_sgemm = llamafile_sgemm;
 #endif
 
 // Note: once we move threading into a separate C++ file
@@ -78,9 +90,26 @@ float lm_ggml_table_f32_f16[1 << 16];
 #if defined(__ARM_ARCH)
 struct lm_ggml_arm_arch_features_type {
     int sve_cnt;
+    int has_dotprod;
+    int has_i8mm;
 } lm_ggml_arm_arch_features = { 0 };
 #endif
 
+// CPU features of the arch kernel variant selected at runtime (LM_GGML_CPU_ALL_VARIANTS), see arch-variant.h
+enum lm_ggml_cpu_variant_feature {
+    LM_GGML_CPU_FEATURE_DOTPROD     = 1 << 0,
+    LM_GGML_CPU_FEATURE_MATMUL_INT8 = 1 << 1,
+    LM_GGML_CPU_FEATURE_AVX2        = 1 << 2, // with FMA, F16C and BMI2
+    LM_GGML_CPU_FEATURE_AVX512      = 1 << 3, // F, BW, DQ and VL
+    LM_GGML_CPU_FEATURE_AVX512_VNNI = 1 << 4,
+};
+
+static int lm_ggml_cpu_variant_features = 0;
+
+static inline int lm_ggml_cpu_has_variant_feature(enum lm_ggml_cpu_variant_feature feature) {
+    return (lm_ggml_cpu_variant_features & feature) != 0;
+}
+
 
 #if defined(_WIN32)
 
@@ -193,7 +222,8 @@ typedef pthread_t lm_ggml_thread_t;
 #include <TargetConditionals.h>
 #endif
 
-static const struct lm_ggml_type_traits_cpu type_traits_cpu[LM_GGML_TYPE_COUNT] = {
+// not const: lm_ggml_cpu_init_variant replaces the quant kernels with the best variant the CPU supports
+static struct lm_ggml_type_traits_cpu type_traits_cpu[LM_GGML_TYPE_COUNT] = {
     [LM_GGML_TYPE_F32] = {
         .from_float               = (lm_ggml_from_float_t) lm_ggml_cpu_fp32_to_fp32,
         .vec_dot                  = (lm_ggml_vec_dot_t) lm_ggml_vec_dot_f32,
@@ -214,6 +244,9 @@ static const struct lm_ggml_type_traits_cpu type_traits_cpu[LM_GGML_TYPE_COUNT]
         .nrows                    = 2,
 #else
         .nrows                    = 1,
+#endif
+#if defined(LM_GGML_CPU_HAS_VEC_DOT_COLS)
+        .vec_dot_cols             = lm_ggml_vec_dot_cols_q4_0_q8_0,
 #endif
     },
     [LM_GGML_TYPE_Q4_1] = {
@@ -246,6 +279,9 @@ static const struct lm_ggml_type_traits_cpu type_traits_cpu[LM_GGML_TYPE_COUNT]
         .nrows                    = 2,
 #else
         .nrows                    = 1,
+#endif
+#if defined(LM_GGML_CPU_HAS_VEC_DOT_COLS)
+        .vec_dot_cols             = lm_ggml_vec_dot_cols_q8_0_q8_0,
 #endif
     },
     [LM_GGML_TYPE_Q8_1] = {
@@ -273,6 +309,9 @@ static const struct lm_ggml_type_traits_cpu type_traits_cpu[LM_GGML_TYPE_COUNT]
         .nrows                    = 2,
 #else
         .nrows                    = 1,
+#endif
+#if defined(LM_GGML_CPU_HAS_VEC_DOT_COLS)
+        .vec_dot_cols             = lm_ggml_vec_dot_cols_q4_K_q8_K,
 #endif
     },
     [LM_GGML_TYPE_Q5_K] = {
@@ -289,6 +328,9 @@ static const struct lm_ggml_type_traits_cpu type_traits_cpu[LM_GGML_TYPE_COUNT]
         .nrows                    = 2,
 #else
         .nrows                    = 1,
+#endif
+#if defined(LM_GGML_CPU_HAS_VEC_DOT_COLS)
+        .vec_dot_cols             = lm_ggml_vec_dot_cols_q6_K_q8_K,
 #endif
     },
     [LM_GGML_TYPE_IQ2_XXS] = {
@@ -435,6 +477,7 @@ typedef pthread_mutex_t    lm_ggml_mutex_t;
 struct lm_ggml_threadpool {
     lm_ggml_mutex_t mutex;       // mutex for cond.var
     lm_ggml_cond_t  cond;        // cond.var for waiting for new work
+    lm_ggml_cond_t  cond_barrier; // cond.var for sleeping in lm_ggml_barrier where futexes are not available
 
     struct lm_ggml_cgraph * cgraph;
     struct lm_ggml_cplan  * cplan;
@@ -449,6 +492,7 @@ struct lm_ggml_threadpool {
     atomic_bool stop;         // Used for stopping the threadpool altogether
     atomic_bool pause;        // Used for pausing the threadpool or individual threads
     atomic_int abort;         // Used for aborting processing of a graph
+    atomic_bool abort_pending; // abort requested between two barriers, the threads stop at the next one
 
     struct lm_ggml_compute_state * workers;   // per thread state
     int          n_threads_max; // number of threads in the pool
@@ -457,6 +501,30 @@ struct lm_ggml_threadpool {
     int32_t      prio;        // Scheduling priority
     uint32_t     poll;        // Polling level (0 - no polling)
 
+    uint8_t    * node_fused;  // per node: number of nodes of the fused chain it starts (0 = none), see lm_ggml_graph_compute_fusion
+    int          n_node_fused; // size of node_fused
+
+    const struct lm_ggml_tensor ** view_srcs; // sorted view sources of the current graph, see lm_ggml_graph_compute_fusion
+    int          n_view_srcs_max;           // size of view_srcs
+
+    uint8_t    * node_sync;   // per node: LM_GGML_CPU_NODE_*, see lm_ggml_graph_compute_dep_sync
+    int          n_node_sync; // size of node_sync
+    bool         dep_sync;    // node_sync is used for the current graph
+
+    atomic_int * node_chunk;  // per node: next chunk of rows to claim, see lm_ggml_cpu_rows_next
+    int          n_node_chunk; // size of node_chunk
+
+    bool         capacity_weighted; // the threads are pinned to cores of different capacity (big.LITTLE)
+
+    // adaptive wait, see lm_ggml_graph_compute_calibrate_wait
+    atomic_int   barrier_spin_ns; // spin in lm_ggml_barrier for this long before sleeping
+    atomic_int   work_spin_ns;    // spin for this long while waiting for the next graph before sleeping
+    atomic_int   n_barrier_sleep; // number of threads sleeping in lm_ggml_barrier
+    int          n_barrier_graph; // number of barriers in the current graph
+    int64_t      t_graph_end;     // end of the previous graph
+    int64_t      t_graph_avg;     // moving average of the graph compute time
+    int64_t      t_gap_avg;       // moving average of the time between graphs
+
     enum lm_ggml_status ec;
 };
 
@@ -470,6 +538,7 @@ struct lm_ggml_compute_state {
 #endif
     struct lm_ggml_threadpool * threadpool;
     int ith;
+    int capacity; // capacity of the cores the thread is pinned to, 0 if unknown
 };
 
 // Helpers for polling loops
@@ -485,6 +554,16 @@ static inline void lm_ggml_thread_cpu_relax(void) {
 static inline void lm_ggml_thread_cpu_relax(void) {;}
 #endif
 
+static inline int64_t lm_ggml_cpu_time_ns(void) {
+#if defined(_WIN32)
+    return lm_ggml_time_us() * 1000;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec*1000000000 + (int64_t)ts.tv_nsec;
+#endif
+}
+
 //
 // NUMA support
 //
@@ -520,6 +599,50 @@ struct lm_ggml_state {
 
 static struct lm_ggml_state g_state = {0};
 
+// spin, then sleep while waiting at a barrier and for the next graph
+// can be disabled with LM_GGML_CPU_ADAPTIVE_WAIT_DISABLE, the threads then spin at the barriers
+static bool lm_ggml_cpu_use_adaptive_wait = true;
+
+#define LM_GGML_WAIT_SPIN_MIN_NS             5000 // a futex wake-up takes about as long
+#define LM_GGML_WAIT_BARRIER_SPIN_MAX_NS  1000000
+#define LM_GGML_WAIT_POLL_SPIN_NS           20000 // max spin between graphs per polling level
+#define LM_GGML_WAIT_GAP_MAX_NS         100000000 // ignore longer idle periods beyond this
+
+#ifndef LM_GGML_USE_OPENMP
+
+// sleep until the barrier is passed
+static void lm_ggml_barrier_sleep(struct lm_ggml_threadpool * tp, int n_passed) {
+    atomic_fetch_add_explicit(&tp->n_barrier_sleep, 1, memory_order_seq_cst);
+#if defined(__linux__)
+    while (atomic_load_explicit(&tp->n_barrier_passed, memory_order_seq_cst) == n_passed) {
+        syscall(SYS_futex, &tp->n_barrier_passed, FUTEX_WAIT_PRIVATE, n_passed, NULL, NULL, 0);
+    }
+#else
+    lm_ggml_mutex_lock_shared(&tp->mutex);
+    while (atomic_load_explicit(&tp->n_barrier_passed, memory_order_seq_cst) == n_passed) {
+        lm_ggml_cond_wait(&tp->cond_barrier, &tp->mutex);
+    }
+    lm_ggml_mutex_unlock_shared(&tp->mutex);
+#endif
+    atomic_fetch_sub_explicit(&tp->n_barrier_sleep, 1, memory_order_seq_cst);
+}
+
+// wake the threads sleeping in lm_ggml_barrier_sleep, called after passing the barrier
+static void lm_ggml_barrier_wake(struct lm_ggml_threadpool * tp) {
+    if (atomic_load_explicit(&tp->n_barrier_sleep, memory_order_seq_cst) == 0) {
+        return;
+    }
+#if defined(__linux__)
+    syscall(SYS_futex, &tp->n_barrier_passed, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    lm_ggml_mutex_lock(&tp->mutex);
+    lm_ggml_cond_broadcast(&tp->cond_barrier);
+    lm_ggml_mutex_unlock(&tp->mutex);
+#endif
+}
+
+#endif // LM_GGML_USE_OPENMP
+
 void lm_ggml_barrier(struct lm_ggml_threadpool * tp) {
     int n_threads = atomic_load_explicit(&tp->n_threads_cur, memory_order_relaxed);
     if (n_threads == 1) {
@@ -537,15 +660,33 @@ void lm_ggml_barrier(struct lm_ggml_threadpool * tp) {
     if (n_barrier == (n_threads - 1)) {
         // last thread
         atomic_store_explicit(&tp->n_barrier, 0, memory_order_relaxed);
+        tp->n_barrier_graph++;
 
         // exit barrier (fill seq-cst fence)
         atomic_fetch_add_explicit(&tp->n_barrier_passed, 1, memory_order_seq_cst);
+
+        if (lm_ggml_cpu_use_adaptive_wait) {
+            lm_ggml_barrier_wake(tp);
+        }
         return;
     }
 
     // wait for other threads
-    while (atomic_load_explicit(&tp->n_barrier_passed, memory_order_relaxed) == n_passed) {
-        lm_ggml_thread_cpu_relax();
+    if (lm_ggml_cpu_use_adaptive_wait) {
+        // spin for the calibrated time, the clock is read every 256 rounds
+        const int64_t spin_ns = atomic_load_explicit(&tp->barrier_spin_ns, memory_order_relaxed);
+        const int64_t t_start = lm_ggml_cpu_time_ns();
+        for (uint32_t i = 1; atomic_load_explicit(&tp->n_barrier_passed, memory_order_relaxed) == n_passed; i++) {
+            if (i % 256 == 0 && lm_ggml_cpu_time_ns() - t_start > spin_ns) {
+                lm_ggml_barrier_sleep(tp, n_passed);
+                break;
+            }
+            lm_ggml_thread_cpu_relax();
+        }
+    } else {
+        while (atomic_load_explicit(&tp->n_barrier_passed, memory_order_relaxed) == n_passed) {
+            lm_ggml_thread_cpu_relax();
+        }
     }
 
     // exit barrier (full seq-cst fence)
@@ -566,6 +707,61 @@ int lm_ggml_threadpool_chunk_add(struct lm_ggml_threadpool * tp, int value) {
     return atomic_fetch_add_explicit(&tp->current_chunk, value, memory_order_relaxed);
 }
 
+void lm_ggml_cpu_thread_range(const struct lm_ggml_compute_params * params, int64_t nr, int64_t * ir0, int64_t * ir1) {
+    const int ith = params->ith;
+    const int nth = params->nth;
+
+    const struct lm_ggml_threadpool * tp = params->threadpool;
+
+    if (!tp->capacity_weighted || nth == 1) {
+        // rows per thread
+        const int64_t dr = (nr + nth - 1)/nth;
+
+        *ir0 = MIN(dr*ith, nr);
+        *ir1 = MIN(*ir0 + dr, nr);
+        return;
+    }
+
+    int64_t c0 = 0; // capacity of the threads before this one
+    int64_t c  = 0; // capacity of all threads
+    for (int i = 0; i < nth; i++) {
+        c0 += i < ith ? tp->workers[i].capacity : 0;
+        c  += tp->workers[i].capacity;
+    }
+
+    *ir0 = nr*c0/c;
+    *ir1 = nr*(c0 + tp->workers[ith].capacity)/c;
+}
+
+// number of chunks per thread in the dynamic split of the rows
+#define LM_GGML_CPU_ROWS_CHUNKS_PER_THREAD 4
+
+bool lm_ggml_cpu_rows_next(const struct lm_ggml_compute_params * params, int64_t nr, int64_t * ir0, int64_t * ir1) {
+    const int nth = params->nth;
+
+    const struct lm_ggml_threadpool * tp = params->threadpool;
+
+    if (nth == 1 || params->node_n < 0 || params->node_n >= tp->n_node_chunk) {
+        // static split, a single range per thread
+        if (*ir1 > 0) {
+            return false;
+        }
+
+        lm_ggml_cpu_thread_range(params, nr, ir0, ir1);
+
+        return *ir1 > *ir0;
+    }
+
+    const int64_t chunk_size = MAX(1, nr/(nth*LM_GGML_CPU_ROWS_CHUNKS_PER_THREAD));
+
+    const int64_t chunk = atomic_fetch_add_explicit(&tp->node_chunk[params->node_n], 1, memory_order_relaxed);
+
+    *ir0 = MIN(chunk*chunk_size, nr);
+    *ir1 = MIN(*ir0 + chunk_size, nr);
+
+    return *ir1 > *ir0;
+}
+
 #if defined(__gnu_linux__)
 static cpu_set_t lm_ggml_get_numa_affinity(void) {
     cpu_set_t cpuset;
@@ -673,20 +869,191 @@ bool lm_ggml_is_numa(void) {
     return g_state.numa.n_nodes > 1;
 }
 
+// relative capacity of each cpu, 0 if unknown
+// on heterogeneous (big.LITTLE) cpus the rows of a node are split in proportion to it, see lm_ggml_cpu_thread_range
+static int32_t lm_ggml_cpu_capacity[LM_GGML_MAX_N_THREADS];
+
+static void lm_ggml_cpu_capacity_init(void) {
+#if defined(__linux__)
+    char path[256];
+    int rv;
+
+    for (int cpu = 0; cpu < LM_GGML_MAX_N_THREADS; cpu++) {
+        long value = 0;
+
+        // normalized capacity from the device tree (arm), otherwise the max frequency in kHz
+        const char * files[] = { "cpu_capacity", "cpufreq/cpuinfo_max_freq" };
+
+        for (size_t i = 0; i < sizeof(files)/sizeof(files[0]) && value <= 0; i++) {
+            rv = snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, files[i]);
+            LM_GGML_ASSERT(rv > 0 && (unsigned)rv < sizeof(path));
+
+            FILE * f = fopen(path, "r");
+            if (f == NULL) {
+                continue;
+            }
+            if (fscanf(f, "%ld", &value) != 1) {
+                value = 0;
+            }
+            fclose(f);
+
+            // keep the frequency in MHz, only the ratios between the cpus matter
+            value = i == 0 ? value : value/1000;
+        }
+
+        lm_ggml_cpu_capacity[cpu] = value > 0 ? (int32_t) MIN(value, INT32_MAX) : 0;
+    }
+#endif
+}
+
 #if defined(__ARM_ARCH)
 
 #if defined(__linux__) && defined(__aarch64__)
 #include <sys/auxv.h>
+#elif defined(__APPLE__) && defined(__aarch64__)
+#include <sys/sysctl.h>
+#endif
+
+#if !defined(HWCAP_ASIMDDP)
+#define HWCAP_ASIMDDP (1 << 20)
+#endif
+
+#if !defined(HWCAP2_I8MM)
+#define HWCAP2_I8MM (1 << 13)
 #endif
 
 static void lm_ggml_init_arm_arch_features(void) {
 #if defined(__linux__) && defined(__aarch64__) && defined(__ARM_FEATURE_SVE)
     lm_ggml_arm_arch_features.sve_cnt = PR_SVE_VL_LEN_MASK & prctl(PR_SVE_GET_VL);
 #endif
+
+#if defined(__linux__) && defined(__aarch64__)
+    const unsigned long hwcap  = getauxval(AT_HWCAP);
+    const unsigned long hwcap2 = getauxval(AT_HWCAP2);
+
+    lm_ggml_arm_arch_features.has_dotprod = !!(hwcap  & HWCAP_ASIMDDP);
+    lm_ggml_arm_arch_features.has_i8mm    = !!(hwcap2 & HWCAP2_I8MM);
+#elif defined(__APPLE__) && defined(__aarch64__)
+    int oldp = 0;
+    size_t size = sizeof(oldp);
+
+    if (sysctlbyname("hw.optional.arm.FEAT_DotProd", &oldp, &size, NULL, 0) == 0) {
+        lm_ggml_arm_arch_features.has_dotprod = oldp;
+    }
+    if (sysctlbyname("hw.optional.arm.FEAT_I8MM", &oldp, &size, NULL, 0) == 0) {
+        lm_ggml_arm_arch_features.has_i8mm = oldp;
+    }
+#endif
 }
 
 #endif // __ARM_ARCH
 
+#if defined(LM_GGML_CPU_ALL_VARIANTS)
+
+#if !defined(__aarch64__) && !defined(__x86_64__)
+#error "LM_GGML_CPU_ALL_VARIANTS is only supported on aarch64 and x86_64"
+#endif
+
+struct lm_ggml_cpu_variant {
+    const char * name;
+    int          features;
+    void (*init_quants)(struct lm_ggml_type_traits_cpu * traits);
+    void (*init_repack)(void);
+#ifdef LM_GGML_USE_LLAMAFILE
+    llamafile_sgemm_t sgemm;
+#endif
+};
+
+#ifdef LM_GGML_USE_LLAMAFILE
+#define LM_GGML_CPU_VARIANT_DECL_SGEMM(variant) \
+    bool llamafile_sgemm_ ## variant(const struct lm_ggml_compute_params * params, int64_t m, int64_t n, int64_t k, \
+                                     const void * A, int64_t lda, const void * B, int64_t ldb, void * C, int64_t ldc, \
+                                     int Atype, int Btype, int Ctype);
+#define LM_GGML_CPU_VARIANT_SGEMM(variant) , llamafile_sgemm_ ## variant
+#else
+#define LM_GGML_CPU_VARIANT_DECL_SGEMM(variant)
+#define LM_GGML_CPU_VARIANT_SGEMM(variant)
+#endif
+
+#define LM_GGML_CPU_VARIANT_DECL(variant) \
+    void lm_ggml_cpu_variant_quants_ ## variant(struct lm_ggml_type_traits_cpu * traits); \
+    LM_GGML_CPU_VARIANT_DECL_SGEMM(variant) \
+    void lm_ggml_cpu_variant_repack_ ## variant(void)
+
+#define LM_GGML_CPU_VARIANT_ENTRY(variant, features) \
+    { #variant, (features), lm_ggml_cpu_variant_quants_ ## variant, lm_ggml_cpu_variant_repack_ ## variant LM_GGML_CPU_VARIANT_SGEMM(variant) }
+
+// must match the variants compiled by the build, best first
+#if defined(__aarch64__)
+LM_GGML_CPU_VARIANT_DECL(dotprod);
+LM_GGML_CPU_VARIANT_DECL(dotprod_i8mm);
+
+static const struct lm_ggml_cpu_variant lm_ggml_cpu_variants[] = {
+    LM_GGML_CPU_VARIANT_ENTRY(dotprod_i8mm, LM_GGML_CPU_FEATURE_DOTPROD | LM_GGML_CPU_FEATURE_MATMUL_INT8),
+    LM_GGML_CPU_VARIANT_ENTRY(dotprod,      LM_GGML_CPU_FEATURE_DOTPROD),
+};
+#else
+LM_GGML_CPU_VARIANT_DECL(avx2);
+LM_GGML_CPU_VARIANT_DECL(avx512);
+LM_GGML_CPU_VARIANT_DECL(avx512_vnni);
+
+static const struct lm_ggml_cpu_variant lm_ggml_cpu_variants[] = {
+    LM_GGML_CPU_VARIANT_ENTRY(avx512_vnni, LM_GGML_CPU_FEATURE_AVX2 | LM_GGML_CPU_FEATURE_AVX512 | LM_GGML_CPU_FEATURE_AVX512_VNNI),
+    LM_GGML_CPU_VARIANT_ENTRY(avx512,      LM_GGML_CPU_FEATURE_AVX2 | LM_GGML_CPU_FEATURE_AVX512),
+    LM_GGML_CPU_VARIANT_ENTRY(avx2,        LM_GGML_CPU_FEATURE_AVX2),
+};
+#endif
+
+static int lm_ggml_cpu_detect_features(void) {
+    int features = 0;
+#if defined(__aarch64__)
+    features |= lm_ggml_arm_arch_features.has_dotprod ? LM_GGML_CPU_FEATURE_DOTPROD     : 0;
+    features |= lm_ggml_arm_arch_features.has_i8mm    ? LM_GGML_CPU_FEATURE_MATMUL_INT8 : 0;
+#else
+    __builtin_cpu_init();
+
+    // every cpu with AVX2 also has F16C
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("bmi2")) {
+        features |= LM_GGML_CPU_FEATURE_AVX2;
+    }
+    if (__builtin_cpu_supports("avx512f")  && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) {
+        features |= LM_GGML_CPU_FEATURE_AVX512;
+    }
+    if (__builtin_cpu_supports("avx512vnni")) {
+        features |= LM_GGML_CPU_FEATURE_AVX512_VNNI;
+    }
+#endif
+    return features;
+}
+
+// install the quant, repack and sgemm kernels of the best variant the cpu supports, the baseline kernels stay otherwise
+static void lm_ggml_cpu_init_variant(void) {
+    if (getenv("LM_GGML_CPU_VARIANTS_DISABLE") != NULL) {
+        return;
+    }
+
+    const int features = lm_ggml_cpu_detect_features();
+
+    for (size_t i = 0; i < sizeof(lm_ggml_cpu_variants)/sizeof(lm_ggml_cpu_variants[0]); i++) {
+        const struct lm_ggml_cpu_variant * variant = &lm_ggml_cpu_variants[i];
+
+        if ((variant->features & features) == variant->features) {
+            variant->init_quants(type_traits_cpu);
+            variant->init_repack();
+#ifdef LM_GGML_USE_LLAMAFILE
+            lm_ggml_cpu_sgemm = variant->sgemm;
+#endif
+            lm_ggml_cpu_variant_features = variant->features;
+
+            LM_GGML_PRINT_DEBUG("%s: using %s kernels\n", __func__, variant->name);
+            return;
+        }
+    }
+}
+
+#endif // LM_GGML_CPU_ALL_VARIANTS
+
 struct lm_ggml_tensor * lm_ggml_new_i32(struct lm_ggml_context * ctx, int32_t value) {
     LM_GGML_ASSERT(!lm_ggml_get_no_alloc(ctx));
 
@@ -1106,6 +1473,7 @@ void lm_ggml_set_f32_nd(const struct lm_ggml_tensor * tensor, int i0, int i1, in
 static void lm_ggml_compute_forward_mul_mat_one_chunk(
     const struct lm_ggml_compute_params * params,
     struct lm_ggml_tensor * dst,
+    const struct lm_ggml_tensor * bias,
     const enum lm_ggml_type type,
     const int64_t num_rows_per_vec_dot,
     const int64_t ir0_start,
@@ -1188,14 +1556,115 @@ static void lm_ggml_compute_forward_mul_mat_one_chunk(
                 for (int cn = 0; cn < num_rows_per_vec_dot; ++cn) {
                     memcpy(&dst_col[iir0 + cn * nb1 / nb0], tmp + (cn * 16), (MIN(iir0 + blck_0, ir0_end) - iir0) * sizeof(float));
                 }
+
+                // fused add of a bias row (see lm_ggml_compute_forward_mul_mat_add)
+                if (bias) {
+                    for (int cn = 0; cn < num_rows_per_vec_dot; ++cn) {
+                        lm_ggml_vec_acc_f32(MIN(iir0 + blck_0, ir0_end) - iir0, &dst_col[iir0 + cn * nb1 / nb0], (const float *) bias->data + iir0);
+                    }
+                }
             }
         }
     }
 }
 
-void lm_ggml_compute_forward_mul_mat(
+// mul_mat with only a few src1 columns (parallel sequences, speculative drafts): each src0 row is dotted with
+// all the columns of an (i12, i13) slice at once, so the weights are read once instead of once per column
+static void lm_ggml_compute_forward_mul_mat_one_chunk_cols(
+    const struct lm_ggml_compute_params * params,
+    struct lm_ggml_tensor * dst,
+    const struct lm_ggml_tensor * bias,
+    const int64_t ir0_start,
+    const int64_t ir0_end,
+    const int64_t ir1_start,
+    const int64_t ir1_end) {
+
+    const struct lm_ggml_tensor * src0 = dst->src[0];
+    const struct lm_ggml_tensor * src1 = dst->src[1];
+
+    LM_GGML_TENSOR_BINARY_OP_LOCALS
+
+    const bool src1_cont = lm_ggml_is_contiguous(src1);
+
+    lm_ggml_vec_dot_cols_t const vec_dot_cols = type_traits_cpu[src0->type].vec_dot_cols;
+    enum lm_ggml_type      const vec_dot_type = type_traits_cpu[src0->type].vec_dot_type;
+
+    // broadcast factors
+    const int64_t r2 = ne12 / ne02;
+    const int64_t r3 = ne13 / ne03;
+
+    if (ir0_start >= ir0_end || ir1_start >= ir1_end) {
+        return;
+    }
+
+    const void * wdata = (src1->type == vec_dot_type) ? src1->data : params->wdata;
+    const size_t row_size = lm_ggml_row_size(vec_dot_type, ne10);
+
+    const size_t src1_col_stride = src1_cont || src1->type != vec_dot_type ? row_size : nb11;
+
+    float tmp[LM_GGML_VEC_DOT_COLS_MAX];
+
+    for (int64_t ir1 = ir1_start; ir1 < ir1_end; ) {
+        const int64_t i13 = (ir1 / (ne12 * ne1));
+        const int64_t i12 = (ir1 - i13 * ne12 * ne1) / ne1;
+        const int64_t i11 = (ir1 - i13 * ne12 * ne1 - i12 * ne1);
+
+        // the columns of one call must share src0 and be evenly spaced in src1
+        const int nc = MIN(MIN(ir1_end - ir1, ne11 - i11), LM_GGML_VEC_DOT_COLS_MAX);
+
+        // broadcast src0 into src1
+        const int64_t i03 = i13 / r3;
+        const int64_t i02 = i12 / r2;
+
+        const char * src0_row = (const char *) src0->data + (i02 * nb02 + i03 * nb03);
+        const char * src1_col = (const char *) wdata +
+            (src1_cont || src1->type != vec_dot_type
+                ? (i11 + i12 * ne11 + i13 * ne12 * ne11) * row_size
+                : (i11 * nb11 + i12 * nb12 + i13 * nb13));
+        char * dst_col = (char *) dst->data + (i11 * nb1 + i12 * nb2 + i13 * nb3);
+
+        for (int64_t ir0 = ir0_start; ir0 < ir0_end; ++ir0) {
+            vec_dot_cols(ne00, tmp, src0_row + ir0 * nb01, src1_col, src1_col_stride, nc);
+
+            for (int c = 0; c < nc; ++c) {
+                ((float *) (dst_col + c * nb1))[ir0] = tmp[c];
+            }
+        }
+
+        // fused add of a bias row (see lm_ggml_compute_forward_mul_mat_add)
+        if (bias) {
+            for (int c = 0; c < nc; ++c) {
+                lm_ggml_vec_acc_f32(ir0_end - ir0_start, (float *) (dst_col + c * nb1) + ir0_start, (const float *) bias->data + ir0_start);
+            }
+        }
+
+        ir1 += nc;
+    }
+}
+
+// add a bias row to the result of a mul_mat computed by a kernel without a per chunk hook
+static void lm_ggml_compute_forward_mul_mat_acc_bias(
         const struct lm_ggml_compute_params * params,
-              struct lm_ggml_tensor * dst) {
+              struct lm_ggml_tensor * dst,
+        const struct lm_ggml_tensor * bias) {
+
+    lm_ggml_barrier(params->threadpool);
+
+    const int64_t nr = lm_ggml_nrows(dst);
+
+    for (int64_t ir = params->ith; ir < nr; ir += params->nth) {
+        const int64_t i3 = ir/(dst->ne[2]*dst->ne[1]);
+        const int64_t i2 = (ir - i3*dst->ne[2]*dst->ne[1])/dst->ne[1];
+        const int64_t i1 = (ir - i3*dst->ne[2]*dst->ne[1] - i2*dst->ne[1]);
+
+        lm_ggml_vec_acc_f32(dst->ne[0], (float *) ((char *) dst->data + i1*dst->nb[1] + i2*dst->nb[2] + i3*dst->nb[3]), (const float *) bias->data);
+    }
+}
+
+static void lm_ggml_compute_forward_mul_mat_impl(
+        const struct lm_ggml_compute_params * params,
+              struct lm_ggml_tensor * dst,
+        const struct lm_ggml_tensor * bias) {
 
     const struct lm_ggml_tensor * src0 = dst->src[0];
     const struct lm_ggml_tensor * src1 = dst->src[1];
@@ -1235,21 +1704,24 @@ void lm_ggml_compute_forward_mul_mat(
 
     const bool src1_cont = lm_ggml_is_contiguous(src1);
 
-    if (src1_cont) {
+    if (src1_cont && ne11 >= LM_GGML_CPU_SGEMM_MIN_COLS) {
         for (int64_t i13 = 0; i13 < ne13; i13++)
             for (int64_t i12 = 0; i12 < ne12; i12++)
-                if (!llamafile_sgemm(params,
-                                     ne01, ne11, ne00/lm_ggml_blck_size(src0->type),
-                                     (const char *)src0->data + i12/r2*nb02 + i13/r3*nb03,
-                                     nb01/lm_ggml_type_size(src0->type),
-                                     (const char *)src1->data + i12*nb12 + i13*nb13,
-                                     nb11/lm_ggml_type_size(src1->type),
-                                     (char *)dst->data + i12*nb2 + i13*nb3,
-                                     nb1/lm_ggml_type_size(dst->type),
-                                     src0->type,
-                                     src1->type,
-                                     dst->type))
+                if (!lm_ggml_cpu_sgemm(params,
+                                       ne01, ne11, ne00/lm_ggml_blck_size(src0->type),
+                                       (const char *)src0->data + i12/r2*nb02 + i13/r3*nb03,
+                                       nb01/lm_ggml_type_size(src0->type),
+                                       (const char *)src1->data + i12*nb12 + i13*nb13,
+                                       nb11/lm_ggml_type_size(src1->type),
+                                       (char *)dst->data + i12*nb2 + i13*nb3,
+                                       nb1/lm_ggml_type_size(dst->type),
+                                       src0->type,
+                                       src1->type,
+                                       dst->type))
                     goto UseGgmlGemm1;
+        if (bias) {
+            lm_ggml_compute_forward_mul_mat_acc_bias(params, dst, bias);
+        }
         return;
     }
 UseGgmlGemm1:;
@@ -1300,24 +1772,27 @@ UseGgmlGemm1:;
     lm_ggml_barrier(params->threadpool);
 
 #if LM_GGML_USE_LLAMAFILE
-    if (src1->type != vec_dot_type) {
+    if (src1->type != vec_dot_type && ne11 >= LM_GGML_CPU_SGEMM_MIN_COLS) {
         const void* wdata = (src1->type == vec_dot_type) ? src1->data : params->wdata;
         const size_t row_size = lm_ggml_row_size(vec_dot_type, ne10);
 
         for (int64_t i13 = 0; i13 < ne13; i13++)
             for (int64_t i12 = 0; i12 < ne12; i12++)
-                if (!llamafile_sgemm(params,
-                                     ne01, ne11, ne00/lm_ggml_blck_size(src0->type),
-                                     (const char *)src0->data + i12/r2*nb02 + i13/r3*nb03,
-                                     nb01/lm_ggml_type_size(src0->type),
-                                     (const char *)wdata + (i12*ne11 + i13*ne12*ne11)*row_size,
-                                     row_size/lm_ggml_type_size(vec_dot_type),
-                                     (char *)dst->data + i12*nb2 + i13*nb3,
-                                     nb1/lm_ggml_type_size(dst->type),
-                                     src0->type,
-                                     vec_dot_type,
-                                     dst->type))
+                if (!lm_ggml_cpu_sgemm(params,
+                                       ne01, ne11, ne00/lm_ggml_blck_size(src0->type),
+                                       (const char *)src0->data + i12/r2*nb02 + i13/r3*nb03,
+                                       nb01/lm_ggml_type_size(src0->type),
+                                       (const char *)wdata + (i12*ne11 + i13*ne12*ne11)*row_size,
+                                       row_size/lm_ggml_type_size(vec_dot_type),
+                                       (char *)dst->data + i12*nb2 + i13*nb3,
+                                       nb1/lm_ggml_type_size(dst->type),
+                                       src0->type,
+                                       vec_dot_type,
+                                       dst->type))
                     goto UseGgmlGemm2;
+        if (bias) {
+            lm_ggml_compute_forward_mul_mat_acc_bias(params, dst, bias);
+        }
         return;
     }
 UseGgmlGemm2:;
@@ -1356,6 +1831,11 @@ UseGgmlGemm2:;
     const int64_t dr0 = (nr0 + nchunk0 - 1) / nchunk0;
     const int64_t dr1 = (nr1 + nchunk1 - 1) / nchunk1;
 
+    // a few columns are dotted with each row at once when the type has a kernel for it,
+    // the mmla kernels already share the rows between two columns
+    const bool use_vec_dot_cols = type_traits_cpu[src0->type].vec_dot_cols != NULL &&
+                                  ne11 > vec_dot_num_rows && ne11 <= LM_GGML_VEC_DOT_COLS_MAX;
+
     // The first chunk comes from our thread_id, the rest will get auto-assigned.
     int current_chunk = ith;
 
@@ -1377,7 +1857,11 @@ UseGgmlGemm2:;
         if ((nr0 % 2 != 0) || (ne11 % 2 != 0) || ((ir0_end - ir0_start) % 2 != 0) || ((ir1_end - ir1_start) % 2 != 0)) {
             num_rows_per_vec_dot = 1;
         }
-        lm_ggml_compute_forward_mul_mat_one_chunk(params, dst, src0->type, num_rows_per_vec_dot, ir0_start, ir0_end, ir1_start, ir1_end);
+        if (use_vec_dot_cols) {
+            lm_ggml_compute_forward_mul_mat_one_chunk_cols(params, dst, bias, ir0_start, ir0_end, ir1_start, ir1_end);
+        } else {
+            lm_ggml_compute_forward_mul_mat_one_chunk(params, dst, bias, src0->type, num_rows_per_vec_dot, ir0_start, ir0_end, ir1_start, ir1_end);
+        }
 
         if (nth >= nchunk0 * nchunk1) {
             break;
@@ -1387,6 +1871,32 @@ UseGgmlGemm2:;
     }
 }
 
+void lm_ggml_compute_forward_mul_mat(
+        const struct lm_ggml_compute_params * params,
+              struct lm_ggml_tensor * dst) {
+    lm_ggml_compute_forward_mul_mat_impl(params, dst, NULL);
+}
+
+// mul_mat followed by the add of a bias row: the product is written directly into the output of the add
+// and the bias is added to each chunk while it is still in cache
+static void lm_ggml_compute_forward_mul_mat_add(
+        struct lm_ggml_compute_params * params,
+        const struct lm_ggml_tensor * mm,
+              struct lm_ggml_tensor * add) {
+
+    const struct lm_ggml_tensor * bias = add->src[0] == mm ? add->src[1] : add->src[0];
+
+    struct lm_ggml_tensor dst = *mm;
+    dst.data = add->data;
+
+    if (lm_ggml_cpu_extra_compute_forward(params, &dst)) {
+        lm_ggml_compute_forward_mul_mat_acc_bias(params, &dst, bias);
+        return;
+    }
+
+    lm_ggml_compute_forward_mul_mat_impl(params, &dst, bias);
+}
+
 // lm_ggml_compute_forward_mul_mat_id
 
 #define MMID_MATRIX_ROW(row_id, i1) matrix_rows[(row_id)*ids->ne[0]*ids->ne[1] + (i1)]
@@ -2539,6 +3049,25 @@ static bool lm_ggml_thread_cpumask_is_valid(const bool * mask) {
     return false;
 }
 
+// average capacity of the cpus in the mask, 0 if unknown
+static int lm_ggml_thread_cpumask_capacity(const bool * mask) {
+    int64_t sum = 0;
+    int     n   = 0;
+
+    for (int i = 0; i < LM_GGML_MAX_N_THREADS; i++) {
+        if (!mask[i]) {
+            continue;
+        }
+        if (lm_ggml_cpu_capacity[i] == 0) {
+            return 0;
+        }
+        sum += lm_ggml_cpu_capacity[i];
+        n++;
+    }
+
+    return n > 0 ? (int) (sum/n) : 0;
+}
+
 static void lm_ggml_thread_cpumask_next(const bool * global_mask, bool * local_mask, bool strict, int32_t* iter) {
     if (!strict) {
         memcpy(local_mask, global_mask, LM_GGML_MAX_N_THREADS);
@@ -2585,8 +3114,14 @@ void lm_ggml_threadpool_free(struct lm_ggml_threadpool* threadpool) {
 
     lm_ggml_mutex_destroy(&threadpool->mutex);
     lm_ggml_cond_destroy(&threadpool->cond);
+    lm_ggml_cond_destroy(&threadpool->cond_barrier);
 #endif // LM_GGML_USE_OPENMP
 
+    free(threadpool->node_fused);
+    free((void *) threadpool->view_srcs);
+    free(threadpool->node_sync);
+    free(threadpool->node_chunk);
+
     const size_t workers_size = sizeof(struct lm_ggml_compute_state) * n_threads;
     lm_ggml_aligned_free(threadpool->workers, workers_size);
     lm_ggml_aligned_free(threadpool, sizeof(struct lm_ggml_threadpool));
@@ -2776,7 +3311,13 @@ struct lm_ggml_cplan lm_ggml_graph_plan(
                         const int64_t ne10 = node->src[1]->ne[0]; // DK
                         const int64_t ne20 = node->src[2]->ne[0]; // DV
 
-                        cur = sizeof(float)*(1*ne10 + 2*ne20)*n_tasks; // 1x head size K + 2x head size V (per thread)
+                        // per thread: a tile of Q rows, VKQ accumulators and KQ values + M, S and a V row
+                        cur = sizeof(float)*(LM_GGML_FA_TILE_Q*(ne10 + ne20 + LM_GGML_FA_TILE_KV + 2) + ne20 + CACHE_LINE_SIZE_F32)*n_tasks;
+
+                        if (node->src[0]->ne[1] == 1) {
+                            // single-token decode splits the KV length across the threads: (M, S, VKQ) per q row and chunk
+                            cur += sizeof(float)*(2 + ne20)*lm_ggml_nrows(node->src[0])*n_tasks;
+                        }
                     } break;
                 case LM_GGML_OP_FLASH_ATTN_BACK:
                     {
@@ -2823,32 +3364,559 @@ struct lm_ggml_cplan lm_ggml_graph_plan(
     return cplan;
 }
 
-static thread_ret_t lm_ggml_graph_compute_thread(void * data) {
-    struct lm_ggml_compute_state * state = (struct lm_ggml_compute_state *) data;
-    struct lm_ggml_threadpool    * tp    = state->threadpool;
+// fusion of common chains of nodes into a single pass over the data, without the barriers in between
+// can be disabled with LM_GGML_CPU_FUSION_DISABLE
+static bool lm_ggml_cpu_use_fusion = true;
 
-    const struct lm_ggml_cgraph * cgraph = tp->cgraph;
-    const struct lm_ggml_cplan  * cplan  = tp->cplan;
+// max number of nodes of a fused chain: add + add of a row + rms_norm + mul
+#define LM_GGML_CPU_FUSED_MAX 4
 
-    set_numa_thread_affinity(state->ith);
+static bool lm_ggml_cpu_is_f32_rows(const struct lm_ggml_tensor * t) {
+    return t->type == LM_GGML_TYPE_F32 && t->nb[0] == sizeof(float);
+}
 
-    struct lm_ggml_compute_params params = {
-        /*.ith       =*/ state->ith,
-        /*.nth       =*/ atomic_load_explicit(&tp->n_threads_cur, memory_order_relaxed),
-        /*.wsize     =*/ cplan->work_size,
-        /*.wdata     =*/ cplan->work_data,
-        /*.threadpool=*/ tp,
-    };
+// the other operand of the mul that follows an rms_norm must be a weight that is broadcast over its rows
+static bool lm_ggml_cpu_can_fuse_norm_mul(const struct lm_ggml_tensor * norm, const struct lm_ggml_tensor * mul) {
+    const struct lm_ggml_tensor * w = mul->src[0] == norm ? mul->src[1] : mul->src[0];
 
-    for (int node_n = 0; node_n < cgraph->n_nodes && atomic_load_explicit(&tp->abort, memory_order_relaxed) != node_n; node_n++) {
-        struct lm_ggml_tensor * node = cgraph->nodes[node_n];
+    return lm_ggml_cpu_is_f32_rows(mul) && lm_ggml_cpu_is_f32_rows(w) && w->ne[0] == norm->ne[0] && lm_ggml_can_repeat(w, norm);
+}
 
-        lm_ggml_compute_forward(&params, node);
+// the add that follows another add must broadcast a single row over the sum
+static bool lm_ggml_cpu_can_fuse_add_row(const struct lm_ggml_tensor * add, const struct lm_ggml_tensor * add_row) {
+    if (add_row->src[0] != add) {
+        return false;
+    }
 
-        if (state->ith == 0 && cplan->abort_callback &&
-                cplan->abort_callback(cplan->abort_callback_data)) {
-            atomic_store_explicit(&tp->abort, node_n + 1, memory_order_relaxed);
-            tp->ec    = LM_GGML_STATUS_ABORTED;
+    const struct lm_ggml_tensor * row = add_row->src[1];
+
+    return lm_ggml_cpu_is_f32_rows(add_row) && lm_ggml_cpu_is_f32_rows(row) && lm_ggml_is_contiguous(row) &&
+        row->ne[0] == add->ne[0] && lm_ggml_nrows(row) == 1;
+}
+
+// number of nodes starting at node_n that form one of the known patterns and can be computed in a single pass:
+//   rms_norm + mul, add (+ add of a row) (+ rms_norm (+ mul)), mul_mat + add (bias), silu + mul, scale + soft_max
+// returns 0 if the node has to be computed on its own
+// this only matches the ops, see lm_ggml_graph_compute_fusion for the chains that are actually fused
+static int lm_ggml_cpu_fused_count(const struct lm_ggml_cgraph * cgraph, int node_n) {
+    struct lm_ggml_tensor ** nodes = cgraph->nodes + node_n;
+    struct lm_ggml_tensor  * node  = nodes[0];
+
+    if (node_n + 1 >= cgraph->n_nodes || lm_ggml_is_empty(node)) {
+        return 0;
+    }
+
+    switch (node->op) {
+        case LM_GGML_OP_RMS_NORM:
+            {
+                const enum lm_ggml_op ops[] = { LM_GGML_OP_RMS_NORM, LM_GGML_OP_MUL };
+
+                if (lm_ggml_can_fuse(cgraph, node_n, ops, 2) &&
+                    lm_ggml_cpu_is_f32_rows(node->src[0]) && lm_ggml_cpu_can_fuse_norm_mul(node, nodes[1])) {
+                    return 2;
+                }
+            } break;
+        case LM_GGML_OP_ADD:
+            {
+                if (!lm_ggml_cpu_is_f32_rows(node) ||
+                    !lm_ggml_cpu_is_f32_rows(node->src[0]) || !lm_ggml_cpu_is_f32_rows(node->src[1]) ||
+                    !lm_ggml_are_same_shape(node->src[0], node->src[1])) {
+                    break;
+                }
+
+                // a row added to every row of the sum, e.g. the control vector added to the residual
+                int n_fused = 1;
+
+                const enum lm_ggml_op ops_row[] = { LM_GGML_OP_ADD, LM_GGML_OP_ADD };
+
+                if (lm_ggml_can_fuse(cgraph, node_n, ops_row, 2) && lm_ggml_cpu_can_fuse_add_row(node, nodes[1])) {
+                    n_fused = 2;
+                }
+
+                // the sum is usually the residual and has other users, so it is still written out
+                struct lm_ggml_tensor * sum  = nodes[n_fused - 1];
+                struct lm_ggml_tensor * norm = node_n + n_fused < cgraph->n_nodes ? nodes[n_fused] : NULL;
+
+                if (norm && norm->op == LM_GGML_OP_RMS_NORM && norm->src[0] == sum && !lm_ggml_is_empty(norm) &&
+                    lm_ggml_cpu_is_f32_rows(norm)) {
+                    const enum lm_ggml_op ops[] = { LM_GGML_OP_RMS_NORM, LM_GGML_OP_MUL };
+
+                    if (lm_ggml_can_fuse(cgraph, node_n + n_fused, ops, 2) && lm_ggml_cpu_can_fuse_norm_mul(norm, nodes[n_fused + 1])) {
+                        return n_fused + 2;
+                    }
+
+                    return n_fused + 1;
+                }
+
+                return n_fused > 1 ? n_fused : 0;
+            }
+        case LM_GGML_OP_MUL_MAT:
+            {
+                const enum lm_ggml_op ops[] = { LM_GGML_OP_MUL_MAT, LM_GGML_OP_ADD };
+
+                if (!lm_ggml_can_fuse(cgraph, node_n, ops, 2)) {
+                    break;
+                }
+
+                const struct lm_ggml_tensor * add  = nodes[1];
+                const struct lm_ggml_tensor * bias = add->src[0] == node ? add->src[1] : add->src[0];
+
+                if (bias != node && lm_ggml_cpu_is_f32_rows(add) && lm_ggml_cpu_is_f32_rows(bias) &&
+                    lm_ggml_is_contiguous(node) && lm_ggml_is_contiguous(add) && lm_ggml_is_contiguous(bias) &&
+                    bias->ne[0] == node->ne[0] && lm_ggml_nrows(bias) == 1) {
+                    return 2;
+                }
+            } break;
+        case LM_GGML_OP_UNARY:
+            {
+                const enum lm_ggml_op ops[] = { LM_GGML_OP_UNARY, LM_GGML_OP_MUL };
+
+                if (lm_ggml_get_unary_op(node) != LM_GGML_UNARY_OP_SILU || !lm_ggml_can_fuse(cgraph, node_n, ops, 2)) {
+                    break;
+                }
+
+                const struct lm_ggml_tensor * mul  = nodes[1];
+                const struct lm_ggml_tensor * gate = mul->src[0] == node ? mul->src[1] : mul->src[0];
+
+                if (gate != node && lm_ggml_cpu_is_f32_rows(node->src[0]) && lm_ggml_cpu_is_f32_rows(gate) &&
+                    lm_ggml_cpu_is_f32_rows(mul) && lm_ggml_are_same_shape(gate, mul)) {
+                    return 2;
+                }
+            } break;
+        case LM_GGML_OP_SCALE:
+            {
+                const enum lm_ggml_op ops[] = { LM_GGML_OP_SCALE, LM_GGML_OP_SOFT_MAX };
+
+                if (!lm_ggml_can_fuse(cgraph, node_n, ops, 2) || nodes[1]->src[0] != node) {
+                    break;
+                }
+
+                // the soft_max reads the rows of the input of the scale in place of the scaled rows
+                const struct lm_ggml_tensor * soft_max = nodes[1];
+
+                if (!lm_ggml_cpu_is_f32_rows(node->src[0]) || !lm_ggml_are_same_shape(node->src[0], soft_max) ||
+                    !lm_ggml_cpu_is_f32_rows(soft_max) || !lm_ggml_is_contiguous(soft_max)) {
+                    break;
+                }
+
+                float b;
+                memcpy(&b, (float *) node->op_params + 1, sizeof(float));
+
+                if (b == 0.0f) {
+                    return 2;
+                }
+            } break;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+static int lm_ggml_cpu_ptr_cmp(const void * a, const void * b) {
+    const uintptr_t pa = (uintptr_t) *(const void * const *) a;
+    const uintptr_t pb = (uintptr_t) *(const void * const *) b;
+
+    return (pa > pb) - (pa < pb);
+}
+
+static bool lm_ggml_cpu_is_view_src(const struct lm_ggml_threadpool * tp, int n_view_srcs, const struct lm_ggml_tensor * t) {
+    return bsearch(&t, tp->view_srcs, n_view_srcs, sizeof(*tp->view_srcs), lm_ggml_cpu_ptr_cmp) != NULL;
+}
+
+// decide once per graph which chains of nodes are fused, see lm_ggml_cpu_fused_count
+// the nodes before the last one of a chain are not written out. lm_ggml_can_fuse ensures that no other node uses
+// them, but a view created with lm_ggml_view_tensor has no src and can still read them through its view_src, so
+// a chain is cut before the first node that is the view_src of another tensor of the graph
+static void lm_ggml_graph_compute_fusion(struct lm_ggml_threadpool * tp, const struct lm_ggml_cgraph * cgraph) {
+    if (tp->n_node_fused < cgraph->n_nodes) {
+        free(tp->node_fused);
+        tp->node_fused   = malloc(cgraph->n_nodes*sizeof(uint8_t));
+        tp->n_node_fused = cgraph->n_nodes;
+        LM_GGML_ASSERT(tp->node_fused != NULL);
+    }
+
+    memset(tp->node_fused, 0, cgraph->n_nodes);
+
+    if (!lm_ggml_cpu_use_fusion) {
+        return;
+    }
+
+    // the views can be nodes, leafs or srcs of the nodes that are not part of the graph (e.g. a split of the scheduler)
+    const int n_view_srcs_max = cgraph->n_nodes*(1 + LM_GGML_MAX_SRC) + cgraph->n_leafs;
+
+    if (tp->n_view_srcs_max < n_view_srcs_max) {
+        free((void *) tp->view_srcs);
+        tp->view_srcs       = malloc(n_view_srcs_max*sizeof(*tp->view_srcs));
+        tp->n_view_srcs_max = n_view_srcs_max;
+        LM_GGML_ASSERT(tp->view_srcs != NULL);
+    }
+
+    int n_view_srcs = 0;
+
+    for (int i = 0; i < cgraph->n_nodes; i++) {
+        const struct lm_ggml_tensor * node = cgraph->nodes[i];
+
+        if (node->view_src) {
+            tp->view_srcs[n_view_srcs++] = node->view_src;
+        }
+
+        for (int j = 0; j < LM_GGML_MAX_SRC; j++) {
+            if (node->src[j] && node->src[j]->view_src) {
+                tp->view_srcs[n_view_srcs++] = node->src[j]->view_src;
+            }
+        }
+    }
+
+    for (int i = 0; i < cgraph->n_leafs; i++) {
+        if (cgraph->leafs[i]->view_src) {
+            tp->view_srcs[n_view_srcs++] = cgraph->leafs[i]->view_src;
+        }
+    }
+
+    qsort((void *) tp->view_srcs, n_view_srcs, sizeof(*tp->view_srcs), lm_ggml_cpu_ptr_cmp);
+
+    for (int i = 0; i < cgraph->n_nodes; ) {
+        int n_fused = lm_ggml_cpu_fused_count(cgraph, i);
+
+        // every prefix of a matched chain is a valid chain as well
+        for (int k = 0; k < n_fused - 1; k++) {
+            if (lm_ggml_cpu_is_view_src(tp, n_view_srcs, cgraph->nodes[i + k])) {
+                n_fused = k + 1;
+                break;
+            }
+        }
+
+        if (n_fused < 2) {
+            i++;
+            continue;
+        }
+
+        tp->node_fused[i] = n_fused;
+
+        i += n_fused;
+    }
+}
+
+// compute the n_fused nodes starting at node_n, as matched by lm_ggml_cpu_fused_count
+static void lm_ggml_compute_forward_fused(struct lm_ggml_compute_params * params, const struct lm_ggml_cgraph * cgraph, int node_n, int n_fused) {
+    struct lm_ggml_tensor ** nodes = cgraph->nodes + node_n;
+    struct lm_ggml_tensor  * node  = nodes[0];
+
+    switch (node->op) {
+        case LM_GGML_OP_RMS_NORM:
+            {
+                lm_ggml_compute_forward_rms_norm_mul(params, node, nodes[1]);
+            } break;
+        case LM_GGML_OP_ADD:
+            {
+                struct lm_ggml_tensor * add_row = nodes[1]->op == LM_GGML_OP_ADD ? nodes[1] : NULL;
+
+                const int i_norm = add_row ? 2 : 1;
+
+                lm_ggml_compute_forward_add_rms_norm(params, node, add_row,
+                        i_norm     < n_fused ? nodes[i_norm]     : NULL,
+                        i_norm + 1 < n_fused ? nodes[i_norm + 1] : NULL);
+            } break;
+        case LM_GGML_OP_MUL_MAT:
+            {
+                lm_ggml_compute_forward_mul_mat_add(params, node, nodes[1]);
+            } break;
+        case LM_GGML_OP_UNARY:
+            {
+                lm_ggml_compute_forward_silu_mul(params, node, nodes[1]);
+            } break;
+        case LM_GGML_OP_SCALE:
+            {
+                float s;
+                memcpy(&s, (float *) node->op_params + 0, sizeof(float));
+
+                // fold the scale into the one applied by the soft_max
+                struct lm_ggml_tensor soft_max = *nodes[1];
+                soft_max.src[0] = node->src[0];
+
+                float scale;
+                memcpy(&scale, (float *) soft_max.op_params + 0, sizeof(float));
+                scale *= s;
+                memcpy((float *) soft_max.op_params + 0, &scale, sizeof(float));
+
+                lm_ggml_compute_forward_soft_max(params, &soft_max);
+            } break;
+        default:
+            LM_GGML_ABORT("fatal error");
+    }
+}
+
+// dependency-aware synchronization of the threads: instead of a barrier after every node, the threads only
+// synchronize before a node that reads or overwrites memory that was written or read by the nodes computed since
+// the last barrier. chains of independent nodes (e.g. the rope/cpy of Q, K and V) then run back to back and the
+// number of barriers per graph follows the depth of the graph rather than its number of nodes
+// ops that synchronize internally or share the work buffer between the threads (mul_mat, flash_attn, ...) are
+// always computed between two barriers
+// note: all the threads still step through all the nodes in order, independent branches of the graph are not
+// scheduled on separate subsets of the threads - only the barriers between them are removed
+// can be disabled with LM_GGML_CPU_DEP_SYNC_DISABLE
+static bool lm_ggml_cpu_use_dep_sync = true;
+
+// node_sync values
+#define LM_GGML_CPU_NODE_BARRIER 1 // the threads synchronize before computing the node
+#define LM_GGML_CPU_NODE_OVERLAP 2 // the node follows other nodes without a barrier, it never synchronizes internally
+
+// max number of memory ranges tracked between two barriers, a barrier is inserted when exceeded
+#define LM_GGML_CPU_DEP_SYNC_MAX_RANGES 64
+
+struct lm_ggml_cpu_mem_range {
+    const char * p0;
+    const char * p1;
+};
+
+static bool lm_ggml_cpu_mem_range_get(const struct lm_ggml_tensor * t, struct lm_ggml_cpu_mem_range * r) {
+    if (t == NULL || t->data == NULL) {
+        return false;
+    }
+
+    r->p0 = (const char *) t->data;
+    r->p1 = r->p0 + lm_ggml_nbytes(t);
+
+    return r->p1 > r->p0;
+}
+
+static bool lm_ggml_cpu_mem_range_overlaps(const struct lm_ggml_cpu_mem_range * ranges, int n, struct lm_ggml_cpu_mem_range r) {
+    // most recent first, as the dependency is usually on the previous node
+    for (int i = n - 1; i >= 0; --i) {
+        if (r.p0 < ranges[i].p1 && ranges[i].p0 < r.p1) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool lm_ggml_cpu_op_is_noop(const struct lm_ggml_tensor * node) {
+    switch (node->op) {
+        case LM_GGML_OP_NONE:
+        case LM_GGML_OP_RESHAPE:
+        case LM_GGML_OP_VIEW:
+        case LM_GGML_OP_PERMUTE:
+        case LM_GGML_OP_TRANSPOSE:
+            return true;
+        default:
+            return lm_ggml_is_empty(node);
+    }
+}
+
+// ops that only touch their sources and destination, and may use a per-thread slice of the work buffer (scratch)
+// everything else is computed between two barriers
+static bool lm_ggml_cpu_op_can_overlap(const struct lm_ggml_tensor * node, bool * scratch) {
+    switch (node->op) {
+        case LM_GGML_OP_ADD:
+        case LM_GGML_OP_ADD1:
+            {
+                *scratch = lm_ggml_is_quantized(node->src[0]->type);
+            } return true;
+        case LM_GGML_OP_DUP:
+        case LM_GGML_OP_CPY:
+        case LM_GGML_OP_CONT:
+            {
+                *scratch = lm_ggml_is_quantized(node->type) ||
+                    node->src[0]->type == LM_GGML_TYPE_F16 || node->src[0]->type == LM_GGML_TYPE_BF16;
+            } return true;
+        case LM_GGML_OP_SOFT_MAX:
+        case LM_GGML_OP_ROPE:
+            {
+                *scratch = true;
+            } return true;
+        case LM_GGML_OP_SUB:
+        case LM_GGML_OP_MUL:
+        case LM_GGML_OP_DIV:
+        case LM_GGML_OP_SQR:
+        case LM_GGML_OP_SQRT:
+        case LM_GGML_OP_SCALE:
+        case LM_GGML_OP_CLAMP:
+        case LM_GGML_OP_NORM:
+        case LM_GGML_OP_RMS_NORM:
+        case LM_GGML_OP_L2_NORM:
+        case LM_GGML_OP_UNARY:
+        case LM_GGML_OP_GLU:
+        case LM_GGML_OP_GET_ROWS:
+        case LM_GGML_OP_SET_ROWS:
+        case LM_GGML_OP_CONCAT:
+            {
+                *scratch = false;
+            } return true;
+        default:
+            return false;
+    }
+}
+
+// decide before which nodes the threads have to synchronize, see lm_ggml_cpu_use_dep_sync
+// a fused chain of nodes (see lm_ggml_graph_compute_fusion) is handled as a single node
+static void lm_ggml_graph_compute_dep_sync(struct lm_ggml_threadpool * tp, const struct lm_ggml_cgraph * cgraph, int n_threads) {
+    tp->dep_sync = lm_ggml_cpu_use_dep_sync && n_threads > 1 && cgraph->n_nodes > 1;
+    if (!tp->dep_sync) {
+        return;
+    }
+
+    if (tp->n_node_sync < cgraph->n_nodes) {
+        free(tp->node_sync);
+        tp->node_sync   = malloc(cgraph->n_nodes*sizeof(uint8_t));
+        tp->n_node_sync = cgraph->n_nodes;
+        LM_GGML_ASSERT(tp->node_sync != NULL);
+    }
+
+    // memory touched by the nodes computed since the last barrier
+    struct lm_ggml_cpu_mem_range reads [LM_GGML_CPU_DEP_SYNC_MAX_RANGES];
+    struct lm_ggml_cpu_mem_range writes[LM_GGML_CPU_DEP_SYNC_MAX_RANGES];
+
+    int  n_reads      = 0;
+    int  n_writes     = 0;
+    int  n_seg        = 0;     // number of nodes computed since the last barrier
+    bool seg_scratch  = false; // one of them uses the work buffer
+    bool seg_isolated = false; // the last one has to be followed by a barrier
+
+    for (int i = 0; i < cgraph->n_nodes; ) {
+        const int n_fused = tp->node_fused[i];
+        const int n_group = MAX(1, n_fused);
+
+        LM_GGML_ASSERT(n_group <= LM_GGML_CPU_FUSED_MAX);
+
+        memset(tp->node_sync + i, 0, n_group);
+
+        if (n_fused == 0 && lm_ggml_cpu_op_is_noop(cgraph->nodes[i])) {
+            i++;
+            continue;
+        }
+
+        struct lm_ggml_cpu_mem_range g_reads [LM_GGML_CPU_FUSED_MAX*LM_GGML_MAX_SRC];
+        struct lm_ggml_cpu_mem_range g_writes[LM_GGML_CPU_FUSED_MAX];
+
+        int  n_g_reads  = 0;
+        int  n_g_writes = 0;
+        bool overlap    = true;
+        bool scratch    = false;
+        bool hazard     = false;
+
+        for (int k = 0; k < n_group; k++) {
+            const struct lm_ggml_tensor * node = cgraph->nodes[i + k];
+
+            bool node_scratch = false;
+            overlap = overlap && lm_ggml_cpu_op_can_overlap(node, &node_scratch);
+            scratch = scratch || node_scratch;
+
+            for (int j = 0; j < LM_GGML_MAX_SRC; j++) {
+                struct lm_ggml_cpu_mem_range r;
+                if (lm_ggml_cpu_mem_range_get(node->src[j], &r)) {
+                    // read after write
+                    hazard = hazard || lm_ggml_cpu_mem_range_overlaps(writes, n_writes, r);
+                    g_reads[n_g_reads++] = r;
+                }
+            }
+
+            struct lm_ggml_cpu_mem_range r;
+            if (lm_ggml_cpu_mem_range_get(node, &r)) {
+                // write after read, write after write
+                hazard = hazard || lm_ggml_cpu_mem_range_overlaps(reads, n_reads, r) || lm_ggml_cpu_mem_range_overlaps(writes, n_writes, r);
+                g_writes[n_g_writes++] = r;
+            }
+        }
+
+        const bool sync = n_seg > 0 && (seg_isolated || !overlap || hazard || (scratch && seg_scratch) ||
+                n_reads  + n_g_reads  > LM_GGML_CPU_DEP_SYNC_MAX_RANGES ||
+                n_writes + n_g_writes > LM_GGML_CPU_DEP_SYNC_MAX_RANGES);
+
+        if (sync) {
+            n_reads     = 0;
+            n_writes    = 0;
+            n_seg       = 0;
+            seg_scratch = false;
+        }
+
+        tp->node_sync[i] = sync ? LM_GGML_CPU_NODE_BARRIER : n_seg > 0 ? LM_GGML_CPU_NODE_OVERLAP : 0;
+
+        memcpy(reads  + n_reads,  g_reads,  n_g_reads *sizeof(struct lm_ggml_cpu_mem_range));
+        memcpy(writes + n_writes, g_writes, n_g_writes*sizeof(struct lm_ggml_cpu_mem_range));
+
+        n_reads     += n_g_reads;
+        n_writes    += n_g_writes;
+        n_seg       += 1;
+        seg_scratch  = seg_scratch || scratch;
+        seg_isolated = !overlap;
+
+        i += n_group;
+    }
+}
+
+// reset the counters of the dynamic split of the rows of each node, see lm_ggml_cpu_rows_next
+static void lm_ggml_graph_compute_reset_chunks(struct lm_ggml_threadpool * tp, const struct lm_ggml_cgraph * cgraph, int n_threads) {
+    if (n_threads == 1) {
+        return;
+    }
+
+    if (tp->n_node_chunk < cgraph->n_nodes) {
+        free(tp->node_chunk);
+        tp->node_chunk   = malloc(cgraph->n_nodes*sizeof(atomic_int));
+        tp->n_node_chunk = cgraph->n_nodes;
+        LM_GGML_ASSERT(tp->node_chunk != NULL);
+    }
+
+    for (int i = 0; i < cgraph->n_nodes; i++) {
+        atomic_store_explicit(&tp->node_chunk[i], 0, memory_order_relaxed);
+    }
+}
+
+static thread_ret_t lm_ggml_graph_compute_thread(void * data) {
+    struct lm_ggml_compute_state * state = (struct lm_ggml_compute_state *) data;
+    struct lm_ggml_threadpool    * tp    = state->threadpool;
+
+    const struct lm_ggml_cgraph * cgraph = tp->cgraph;
+    const struct lm_ggml_cplan  * cplan  = tp->cplan;
+
+    set_numa_thread_affinity(state->ith);
+
+    struct lm_ggml_compute_params params = {
+        /*.ith       =*/ state->ith,
+        /*.nth       =*/ atomic_load_explicit(&tp->n_threads_cur, memory_order_relaxed),
+        /*.wsize     =*/ cplan->work_size,
+        /*.wdata     =*/ cplan->work_data,
+        /*.threadpool=*/ tp,
+        /*.node_n    =*/ -1,
+    };
+
+    for (int node_n = 0; node_n < cgraph->n_nodes && atomic_load_explicit(&tp->abort, memory_order_relaxed) != node_n; node_n++) {
+        struct lm_ggml_tensor * node = cgraph->nodes[node_n];
+
+        params.node_n = node_n;
+
+        // once an abort is requested, the rest of a run of nodes without barriers is skipped
+        // this is only done for nodes that do not synchronize internally, so the threads still meet at the next barrier
+        const bool skip = tp->dep_sync && tp->node_sync[node_n] == LM_GGML_CPU_NODE_OVERLAP &&
+            atomic_load_explicit(&tp->abort_pending, memory_order_relaxed);
+
+        const int n_fused = tp->node_fused[node_n];
+        if (skip) {
+            node_n += MAX(1, n_fused) - 1;
+        } else if (n_fused > 0) {
+            lm_ggml_compute_forward_fused(&params, cgraph, node_n, n_fused);
+            node_n += n_fused - 1;
+        } else {
+            lm_ggml_compute_forward(&params, node);
+        }
+
+        // the graph can only be aborted at a barrier, so that all threads stop at the same node
+        const bool sync = !tp->dep_sync || node_n + 1 >= cgraph->n_nodes || tp->node_sync[node_n + 1] == LM_GGML_CPU_NODE_BARRIER;
+        if (!sync) {
+            // still poll the callback after every node, so that long runs without barriers can be cancelled
+            if (state->ith == 0 && cplan->abort_callback && !atomic_load_explicit(&tp->abort_pending, memory_order_relaxed) &&
+                    cplan->abort_callback(cplan->abort_callback_data)) {
+                atomic_store_explicit(&tp->abort_pending, true, memory_order_relaxed);
+            }
+            continue;
+        }
+
+        if (state->ith == 0 && (atomic_load_explicit(&tp->abort_pending, memory_order_relaxed) ||
+                (cplan->abort_callback && cplan->abort_callback(cplan->abort_callback_data)))) {
+            atomic_store_explicit(&tp->abort, node_n + 1, memory_order_relaxed);
+            tp->ec    = LM_GGML_STATUS_ABORTED;
         }
 
         if (node_n + 1 < cgraph->n_nodes) {
@@ -2905,6 +3973,21 @@ static inline bool lm_ggml_graph_compute_poll_for_work(struct lm_ggml_compute_st
         return state->pending;
     }
 
+    if (lm_ggml_cpu_use_adaptive_wait) {
+        // spin for the calibrated time, the clock is read every 256 rounds
+        const int64_t spin_ns = atomic_load_explicit(&threadpool->work_spin_ns, memory_order_relaxed);
+        if (spin_ns > 0) {
+            const int64_t t_start = lm_ggml_cpu_time_ns();
+            for (uint32_t i = 1; !lm_ggml_graph_compute_thread_ready(state); i++) {
+                if (i % 256 == 0 && lm_ggml_cpu_time_ns() - t_start > spin_ns) {
+                    break;
+                }
+                lm_ggml_thread_cpu_relax();
+            }
+        }
+        return state->pending;
+    }
+
     // This seems to make 0 ... 100 a decent range for polling level across modern processors.
     // Perhaps, we can adjust it dynamically based on load and things.
     const uint64_t n_rounds = 1024UL * 128 * threadpool->poll;
@@ -2974,6 +4057,40 @@ static thread_ret_t lm_ggml_graph_compute_secondary_thread(void* data) {
     return (thread_ret_t) 0;
 }
 
+// Calibrate the spin budgets from the graph that just finished.
+// Waiting at a barrier normally takes at most about the time between two barriers, spinning much
+// longer means that a thread was preempted or throttled, so sleep instead of burning the core.
+// Between graphs the threads spin only if the next graph usually follows shortly compared to the
+// time of the graph itself (e.g. the ubatches of a prompt), otherwise they sleep (e.g. between tokens).
+static void lm_ggml_graph_compute_calibrate_wait(struct lm_ggml_threadpool * tp, int64_t t_start, int64_t t_end, int n_threads) {
+    const int64_t t_graph = t_end - t_start;
+    const int64_t t_gap   = tp->t_graph_end > 0 ? MIN(t_start - tp->t_graph_end, LM_GGML_WAIT_GAP_MAX_NS) : -1;
+
+    tp->t_graph_end = t_end;
+
+    if (!lm_ggml_cpu_use_adaptive_wait || n_threads == 1) {
+        return;
+    }
+
+    // exponential moving averages over the last few graphs
+    tp->t_graph_avg = tp->t_graph_avg > 0 ? tp->t_graph_avg + (t_graph - tp->t_graph_avg)/4 : t_graph;
+    if (t_gap >= 0) {
+        tp->t_gap_avg = tp->t_gap_avg > 0 ? tp->t_gap_avg + (t_gap - tp->t_gap_avg)/4 : t_gap;
+    }
+
+    const int64_t t_interval = tp->t_graph_avg / (tp->n_barrier_graph + 1);
+    const int64_t barrier_spin_ns = MAX(LM_GGML_WAIT_SPIN_MIN_NS, MIN(4*t_interval, LM_GGML_WAIT_BARRIER_SPIN_MAX_NS));
+
+    const int64_t poll_spin_ns = (int64_t) tp->poll * LM_GGML_WAIT_POLL_SPIN_NS;
+    int64_t work_spin_ns = MIN(LM_GGML_WAIT_SPIN_MIN_NS, poll_spin_ns);
+    if (t_gap >= 0 && tp->t_gap_avg <= tp->t_graph_avg/4) {
+        work_spin_ns = MIN(2*tp->t_gap_avg + LM_GGML_WAIT_SPIN_MIN_NS, poll_spin_ns);
+    }
+
+    atomic_store_explicit(&tp->barrier_spin_ns, (int) barrier_spin_ns, memory_order_relaxed);
+    atomic_store_explicit(&tp->work_spin_ns,    (int) work_spin_ns,    memory_order_relaxed);
+}
+
 // Start processing new graph
 static void lm_ggml_graph_compute_kickoff(struct lm_ggml_threadpool * threadpool, int n_threads)
 {
@@ -3013,6 +4130,8 @@ static struct lm_ggml_threadpool * lm_ggml_threadpool_new_impl(
                struct lm_ggml_cgraph * cgraph,
                 struct lm_ggml_cplan * cplan) {
 
+    lm_ggml_cpu_init();
+
     struct lm_ggml_threadpool * threadpool =
         lm_ggml_aligned_malloc(sizeof(struct lm_ggml_threadpool));
     {
@@ -3025,12 +4144,30 @@ static struct lm_ggml_threadpool * lm_ggml_threadpool_new_impl(
         threadpool->stop             = false;
         threadpool->pause            = tpp->paused;
         threadpool->abort            = -1;
+        threadpool->abort_pending    = false;
         threadpool->workers          = NULL;
         threadpool->n_threads_max    = tpp->n_threads;
         threadpool->n_threads_cur    = tpp->n_threads;
         threadpool->poll             = tpp->poll;
         threadpool->prio             = tpp->prio;
         threadpool->ec               = LM_GGML_STATUS_SUCCESS;
+        threadpool->node_fused       = NULL;
+        threadpool->n_node_fused     = 0;
+        threadpool->view_srcs        = NULL;
+        threadpool->n_view_srcs_max  = 0;
+        threadpool->node_sync        = NULL;
+        threadpool->n_node_sync      = 0;
+        threadpool->dep_sync         = false;
+        threadpool->node_chunk        = NULL;
+        threadpool->n_node_chunk      = 0;
+        threadpool->capacity_weighted = false;
+        threadpool->barrier_spin_ns   = LM_GGML_WAIT_BARRIER_SPIN_MAX_NS;
+        threadpool->work_spin_ns      = tpp->poll * LM_GGML_WAIT_POLL_SPIN_NS;
+        threadpool->n_barrier_sleep   = 0;
+        threadpool->n_barrier_graph   = 0;
+        threadpool->t_graph_end       = 0;
+        threadpool->t_graph_avg       = 0;
+        threadpool->t_gap_avg         = 0;
     }
 
     // Allocate and init workers state
@@ -3048,6 +4185,7 @@ static struct lm_ggml_threadpool * lm_ggml_threadpool_new_impl(
 #ifndef LM_GGML_USE_OPENMP
     lm_ggml_mutex_init(&threadpool->mutex);
     lm_ggml_cond_init(&threadpool->cond);
+    lm_ggml_cond_init(&threadpool->cond_barrier);
 
     // Spin the threads for all workers, and update CPU placements.
     // Place the main thread last (towards the higher numbered CPU cores).
@@ -3070,6 +4208,18 @@ static struct lm_ggml_threadpool * lm_ggml_threadpool_new_impl(
             lm_ggml_thread_apply_affinity(threadpool->workers[0].cpumask);
         }
     }
+
+    // weight the static split of the rows by the capacity of the cores the threads are pinned to
+    // unpinned threads can move between the cores, they split the rows evenly
+    bool weighted = true;
+    bool uniform  = true;
+    for (int j = 0; j < tpp->n_threads; j++) {
+        workers[j].capacity = lm_ggml_thread_cpumask_capacity(workers[j].cpumask);
+
+        weighted = weighted && workers[j].capacity > 0;
+        uniform  = uniform  && workers[j].capacity == workers[0].capacity;
+    }
+    threadpool->capacity_weighted = weighted && !uniform;
 #endif // LM_GGML_USE_OPENMP
 
     return threadpool;
@@ -3104,9 +4254,14 @@ enum lm_ggml_status lm_ggml_graph_compute(struct lm_ggml_cgraph * cgraph, struct
         threadpool->cplan            = cplan;
         threadpool->current_chunk    = 0;
         threadpool->abort            = -1;
+        threadpool->abort_pending    = false;
         threadpool->ec               = LM_GGML_STATUS_SUCCESS;
     }
 
+    lm_ggml_graph_compute_fusion(threadpool, cgraph);
+    lm_ggml_graph_compute_dep_sync(threadpool, cgraph, n_threads);
+    lm_ggml_graph_compute_reset_chunks(threadpool, cgraph, n_threads);
+
 #ifdef LM_GGML_USE_OPENMP
     if (n_threads > 1) {
         #pragma omp parallel num_threads(n_threads)
@@ -3130,11 +4285,17 @@ enum lm_ggml_status lm_ggml_graph_compute(struct lm_ggml_cgraph * cgraph, struct
         n_threads = threadpool->n_threads_max;
     }
 
+    threadpool->n_barrier_graph = 0;
+
+    const int64_t t_start = lm_ggml_cpu_time_ns();
+
     // Kick all threads to start the new graph
     lm_ggml_graph_compute_kickoff(threadpool, n_threads);
 
     // This is a work thread too
     lm_ggml_graph_compute_thread(&threadpool->workers[0]);
+
+    lm_ggml_graph_compute_calibrate_wait(threadpool, t_start, lm_ggml_cpu_time_ns(), n_threads);
 #endif
 
     // don't leave affinity set on the main thread
@@ -3284,7 +4445,7 @@ int lm_ggml_cpu_has_avx(void) {
 #if defined(__AVX__)
     return 1;
 #else
-    return 0;
+    return lm_ggml_cpu_has_variant_feature(LM_GGML_CPU_FEATURE_AVX2);
 #endif
 }
 
@@ -3300,7 +4461,7 @@ int lm_ggml_cpu_has_avx2(void) {
 #if defined(__AVX2__)
     return 1;
 #else
-    return 0;
+    return lm_ggml_cpu_has_variant_feature(LM_GGML_CPU_FEATURE_AVX2);
 #endif
 }
 
@@ -3308,7 +4469,7 @@ int lm_ggml_cpu_has_avx512(void) {
 #if defined(__AVX512F__)
     return 1;
 #else
-    return 0;
+    return lm_ggml_cpu_has_variant_feature(LM_GGML_CPU_FEATURE_AVX512);
 #endif
 }
 
@@ -3324,7 +4485,7 @@ int lm_ggml_cpu_has_avx512_vnni(void) {
 #if defined(__AVX512VNNI__)
     return 1;
 #else
-    return 0;
+    return lm_ggml_cpu_has_variant_feature(LM_GGML_CPU_FEATURE_AVX512_VNNI);
 #endif
 }
 
@@ -3348,7 +4509,7 @@ int lm_ggml_cpu_has_bmi2(void) {
 #if defined(__BMI2__)
     return 1;
 #else
-    return 0;
+    return lm_ggml_cpu_has_variant_feature(LM_GGML_CPU_FEATURE_AVX2);
 #endif
 }
 
@@ -3356,7 +4517,7 @@ int lm_ggml_cpu_has_fma(void) {
 #if defined(__FMA__)
     return 1;
 #else
-    return 0;
+    return lm_ggml_cpu_has_variant_feature(LM_GGML_CPU_FEATURE_AVX2);
 #endif
 }
 
@@ -3380,7 +4541,7 @@ int lm_ggml_cpu_has_f16c(void) {
 #if defined(__F16C__)
     return 1;
 #else
-    return 0;
+    return lm_ggml_cpu_has_variant_feature(LM_GGML_CPU_FEATURE_AVX2);
 #endif
 }
 
@@ -3460,7 +4621,7 @@ int lm_ggml_cpu_has_dotprod(void) {
 #if defined(__ARM_ARCH) && defined(__ARM_FEATURE_DOTPROD)
     return 1;
 #else
-    return 0;
+    return lm_ggml_cpu_has_variant_feature(LM_GGML_CPU_FEATURE_DOTPROD);
 #endif
 }
 
@@ -3476,7 +4637,7 @@ int lm_ggml_cpu_has_matmul_int8(void) {
 #if defined(__ARM_ARCH) && defined(__ARM_FEATURE_MATMUL_INT8)
     return 1;
 #else
-    return 0;
+    return lm_ggml_cpu_has_variant_feature(LM_GGML_CPU_FEATURE_MATMUL_INT8);
 #endif
 }
 
@@ -3546,6 +4707,16 @@ void lm_ggml_cpu_init(void) {
         lm_ggml_init_arm_arch_features();
 #endif
 
+#if defined(LM_GGML_CPU_ALL_VARIANTS)
+        lm_ggml_cpu_init_variant();
+#endif
+
+        lm_ggml_cpu_capacity_init();
+
+        lm_ggml_cpu_use_fusion        = getenv("LM_GGML_CPU_FUSION_DISABLE")        == NULL;
+        lm_ggml_cpu_use_dep_sync      = getenv("LM_GGML_CPU_DEP_SYNC_DISABLE")      == NULL;
+        lm_ggml_cpu_use_adaptive_wait = getenv("LM_GGML_CPU_ADAPTIVE_WAIT_DISABLE") == NULL;
+
         is_first_call = false;
     }
 
@@ -635,6 +635,17 @@ static void * lm_ggml_backend_cpu_get_proc_address(lm_ggml_backend_reg_t reg, co
     if (strcmp(name, "lm_ggml_backend_cpu_is_numa") == 0) {
         return (void *)lm_ggml_is_numa;
     }
+#ifdef LM_GGML_USE_CPU_REPACK
+    if (strcmp(name, "lm_ggml_backend_cpu_repack_buffer_type") == 0) {
+        return (void *)lm_ggml_backend_cpu_repack_buffer_type;
+    }
+    if (strcmp(name, "lm_ggml_backend_cpu_repack_buffer_from_ptr") == 0) {
+        return (void *)lm_ggml_backend_cpu_repack_buffer_from_ptr;
+    }
+    if (strcmp(name, "lm_ggml_backend_cpu_repack_layout") == 0) {
+        return (void *)lm_ggml_backend_cpu_repack_layout;
+    }
+#endif
 
     // threadpool - TODO:  move to ggml-base
     if (strcmp(name, "lm_ggml_threadpool_new") == 0) {
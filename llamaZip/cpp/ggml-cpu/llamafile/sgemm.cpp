@@ -0,0 +1,337 @@
+// tinyBLAS-style matrix multiplication, used by mul_mat for the prompt processing
+//
+// C is computed in tiles of RM x RN floats held in vector registers: every vector of A loaded
+// from memory is reused for RN columns of B and every vector of B for RM rows of A, instead of
+// reloading both for each dot product like the vec_dot kernels do. the tiles are grouped in
+// blocks of rows and columns whose panels of A and B fit in the L2 cache together, and the
+// threads claim these blocks dynamically.
+
+#define LM_GGML_COMMON_DECL_CPP
+#include "ggml-common.h"
+
+#include "sgemm.h"
+#include "ggml-impl.h"
+#include "../ggml-cpu-impl.h"
+#include "../simd-mappings.h"
+
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+#define SGEMM_AVX2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define SGEMM_NEON
+#endif
+
+#if defined(SGEMM_AVX2) || defined(SGEMM_NEON)
+
+namespace {
+
+// bytes of each of the panels of A and B used by a block of C
+constexpr int64_t SGEMM_PANEL_SIZE = 128*1024;
+
+// maximum number of tiles per block in each direction
+constexpr int64_t SGEMM_BLOCK_TILES = 16;
+
+#if defined(SGEMM_AVX2)
+
+typedef __m256  vec_t;
+typedef __m256i qvec_t;
+
+constexpr int KN = 8; // floats per vector
+
+// float tiles: RM*RN accumulators + RM vectors of A + 1 vector of B in the 16 registers
+constexpr int RM_F = 3;
+constexpr int RN_F = 4;
+
+// quantized tiles: the int8 products need a few more temporaries
+constexpr int RM_Q = 4;
+constexpr int RN_Q = 2;
+
+inline vec_t vzero() { return _mm256_setzero_ps(); }
+inline vec_t vset(float x) { return _mm256_set1_ps(x); }
+inline vec_t madd(vec_t a, vec_t b, vec_t c) { return _mm256_fmadd_ps(a, b, c); }
+
+inline float hsum(vec_t x) {
+    __m128 v = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_movehdup_ps(v));
+    return _mm_cvtss_f32(v);
+}
+
+inline vec_t load(const float * p) { return _mm256_loadu_ps(p); }
+inline vec_t load(const lm_ggml_fp16_t * p) { return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) p)); }
+inline vec_t load(const lm_ggml_bf16_t * p) {
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) p)), 16));
+}
+
+// the 32 quants of a block as int8
+inline qvec_t load_q(const block_q8_0 * b) { return _mm256_loadu_si256((const __m256i *) b->qs); }
+inline qvec_t load_q(const block_q4_0 * b) {
+    const __m128i qs = _mm_loadu_si128((const __m128i *) b->qs);
+    const __m256i x  = _mm256_inserti128_si256(_mm256_castsi128_si256(qs), _mm_srli_epi16(qs, 4), 1);
+    return _mm256_sub_epi8(_mm256_and_si256(x, _mm256_set1_epi8(0x0F)), _mm256_set1_epi8(8));
+}
+
+// partial sums of the products of the quants
+inline vec_t dot_q(qvec_t a, qvec_t b) {
+    const __m256i ax = _mm256_sign_epi8(a, a);
+    const __m256i sb = _mm256_sign_epi8(b, a);
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    return _mm256_cvtepi32_ps(_mm256_dpbusd_epi32(_mm256_setzero_si256(), ax, sb));
+#else
+    return _mm256_cvtepi32_ps(_mm256_madd_epi16(_mm256_maddubs_epi16(ax, sb), _mm256_set1_epi16(1)));
+#endif
+}
+
+#else // SGEMM_NEON
+
+typedef float32x4_t vec_t;
+typedef int8x16x2_t qvec_t;
+
+constexpr int KN = 4; // floats per vector
+
+// float tiles: RM*RN accumulators + RM vectors of A + 1 vector of B in the 32 registers
+constexpr int RM_F = 4;
+constexpr int RN_F = 6;
+
+// quantized tiles: each block of quants takes 2 registers
+constexpr int RM_Q = 4;
+constexpr int RN_Q = 4;
+
+inline vec_t vzero() { return vdupq_n_f32(0.0f); }
+inline vec_t vset(float x) { return vdupq_n_f32(x); }
+inline vec_t madd(vec_t a, vec_t b, vec_t c) { return vfmaq_f32(c, a, b); }
+inline float hsum(vec_t x) { return vaddvq_f32(x); }
+
+inline vec_t load(const float * p) { return vld1q_f32(p); }
+inline vec_t load(const lm_ggml_fp16_t * p) { return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p))); }
+inline vec_t load(const lm_ggml_bf16_t * p) { return vreinterpretq_f32_u32(vshll_n_u16(vld1_u16((const uint16_t *) p), 16)); }
+
+// the 32 quants of a block as int8
+inline qvec_t load_q(const block_q8_0 * b) { return { vld1q_s8(b->qs), vld1q_s8(b->qs + 16) }; }
+inline qvec_t load_q(const block_q4_0 * b) {
+    const uint8x16_t qs = vld1q_u8(b->qs);
+    return {
+        vsubq_s8(vreinterpretq_s8_u8(vandq_u8(qs, vdupq_n_u8(0x0F))), vdupq_n_s8(8)),
+        vsubq_s8(vreinterpretq_s8_u8(vshrq_n_u8(qs, 4)),              vdupq_n_s8(8)),
+    };
+}
+
+// partial sums of the products of the quants
+inline vec_t dot_q(qvec_t a, qvec_t b) {
+#if defined(__ARM_FEATURE_DOTPROD)
+    const int32x4_t s = vdotq_s32(vdotq_s32(vdupq_n_s32(0), a.val[0], b.val[0]), a.val[1], b.val[1]);
+#else
+    int32x4_t s = vpaddlq_s16(vmull_s8(vget_low_s8(a.val[0]), vget_low_s8(b.val[0])));
+    s = vpadalq_s16(s, vmull_high_s8(a.val[0], b.val[0]));
+    s = vpadalq_s16(s, vmull_s8(vget_low_s8(a.val[1]), vget_low_s8(b.val[1])));
+    s = vpadalq_s16(s, vmull_high_s8(a.val[1], b.val[1]));
+#endif
+    return vcvtq_f32_s32(s);
+}
+
+#endif
+
+// one tile of C for the float types, A[i] and B[j] point to the rows of the tile
+template <int RM, int RN, typename TA, typename TB>
+inline void gemm_tile_f(int64_t k, const TA * const * A, const TB * const * B, float * C, int64_t ldc, int64_t mc, int64_t nc) {
+    vec_t acc[RN][RM];
+    for (int j = 0; j < RN; ++j) {
+        for (int i = 0; i < RM; ++i) {
+            acc[j][i] = vzero();
+        }
+    }
+
+    for (int64_t l = 0; l < k; l += KN) {
+        vec_t a[RM];
+        for (int i = 0; i < RM; ++i) {
+            a[i] = load(A[i] + l);
+        }
+        for (int j = 0; j < RN; ++j) {
+            const vec_t b = load(B[j] + l);
+            for (int i = 0; i < RM; ++i) {
+                acc[j][i] = madd(a[i], b, acc[j][i]);
+            }
+        }
+    }
+
+    for (int64_t j = 0; j < nc; ++j) {
+        for (int64_t i = 0; i < mc; ++i) {
+            C[ldc*j + i] = hsum(acc[j][i]);
+        }
+    }
+}
+
+// one tile of C for the quantized types, k is the number of blocks
+template <int RM, int RN, typename TA>
+inline void gemm_tile_q(int64_t k, const TA * const * A, const block_q8_0 * const * B, float * C, int64_t ldc, int64_t mc, int64_t nc) {
+    vec_t acc[RN][RM];
+    for (int j = 0; j < RN; ++j) {
+        for (int i = 0; i < RM; ++i) {
+            acc[j][i] = vzero();
+        }
+    }
+
+    for (int64_t l = 0; l < k; ++l) {
+        qvec_t b[RN];
+        float  db[RN];
+        for (int j = 0; j < RN; ++j) {
+            b[j]  = load_q(B[j] + l);
+            db[j] = LM_GGML_CPU_FP16_TO_FP32(B[j][l].d);
+        }
+        for (int i = 0; i < RM; ++i) {
+            const qvec_t a  = load_q(A[i] + l);
+            const float  da = LM_GGML_CPU_FP16_TO_FP32(A[i][l].d);
+            for (int j = 0; j < RN; ++j) {
+                acc[j][i] = madd(dot_q(a, b[j]), vset(da*db[j]), acc[j][i]);
+            }
+        }
+    }
+
+    for (int64_t j = 0; j < nc; ++j) {
+        for (int64_t i = 0; i < mc; ++i) {
+            C[ldc*j + i] = hsum(acc[j][i]);
+        }
+    }
+}
+
+template <int RM, int RN, typename TA, typename TB>
+class tinyBLAS {
+  public:
+    tinyBLAS(const lm_ggml_compute_params * params, int64_t k, const TA * A, int64_t lda, const TB * B, int64_t ldb, float * C, int64_t ldc)
+        : params(params), k(k), A(A), lda(lda), B(B), ldb(ldb), C(C), ldc(ldc) {}
+
+    void matmul(int64_t m, int64_t n) {
+        const int nth = params->nth;
+
+        // blocks of C whose panels of A and B stay in cache
+        int64_t bm = RM*std::clamp<int64_t>(SGEMM_PANEL_SIZE/(k*sizeof(TA))/RM, 1, SGEMM_BLOCK_TILES);
+        int64_t bn = RN*std::clamp<int64_t>(SGEMM_PANEL_SIZE/(k*sizeof(TB))/RN, 1, SGEMM_BLOCK_TILES);
+
+        // smaller blocks of rows if there are too few blocks to keep all the threads busy
+        while (bm > RM && ((m + bm - 1)/bm)*((n + bn - 1)/bn) < 4*nth) {
+            bm = std::max<int64_t>(RM, bm/2/RM*RM);
+        }
+
+        const int64_t xblocks = (m + bm - 1)/bm;
+        const int64_t nblocks = xblocks*((n + bn - 1)/bn);
+
+        if (params->ith == 0) {
+            // every thread starts with the block ith, the first unclaimed one is nth
+            lm_ggml_threadpool_chunk_set(params->threadpool, nth);
+        }
+
+        lm_ggml_barrier(params->threadpool);
+
+        for (int64_t job = params->ith; job < nblocks; job = lm_ggml_threadpool_chunk_add(params->threadpool, 1)) {
+            // consecutive blocks share the same panel of B
+            const int64_t ii0 = (job % xblocks)*bm;
+            const int64_t jj0 = (job / xblocks)*bn;
+            const int64_t ii1 = std::min(ii0 + bm, m);
+            const int64_t jj1 = std::min(jj0 + bn, n);
+
+            for (int64_t jj = jj0; jj < jj1; jj += RN) {
+                // the last tiles are padded by repeating the last row of B / A
+                const TB * Bp[RN];
+                for (int j = 0; j < RN; ++j) {
+                    Bp[j] = B + ldb*std::min(jj + j, n - 1);
+                }
+                for (int64_t ii = ii0; ii < ii1; ii += RM) {
+                    const TA * Ap[RM];
+                    for (int i = 0; i < RM; ++i) {
+                        Ap[i] = A + lda*std::min(ii + i, m - 1);
+                    }
+
+                    float * Cp = C + ldc*jj + ii;
+
+                    if constexpr (std::is_same<TB, block_q8_0>::value) {
+                        gemm_tile_q<RM, RN>(k, Ap, Bp, Cp, ldc, std::min<int64_t>(RM, m - ii), std::min<int64_t>(RN, n - jj));
+                    } else {
+                        gemm_tile_f<RM, RN>(k, Ap, Bp, Cp, ldc, std::min<int64_t>(RM, m - ii), std::min<int64_t>(RN, n - jj));
+                    }
+                }
+            }
+        }
+
+        // the chunk counter is reused by the next call
+        lm_ggml_barrier(params->threadpool);
+    }
+
+  private:
+    const lm_ggml_compute_params * const params;
+    const int64_t k;
+    const TA * const A;
+    const int64_t lda;
+    const TB * const B;
+    const int64_t ldb;
+    float * const C;
+    const int64_t ldc;
+};
+
+template <int RM, int RN, typename TA, typename TB>
+bool sgemm(const lm_ggml_compute_params * params, int64_t m, int64_t n, int64_t k,
+           const void * A, int64_t lda, const void * B, int64_t ldb, void * C, int64_t ldc) {
+    tinyBLAS<RM, RN, TA, TB> tb(params, k, (const TA *) A, lda, (const TB *) B, ldb, (float *) C, ldc);
+    tb.matmul(m, n);
+    return true;
+}
+
+} // namespace
+
+#endif // SGEMM_AVX2 || SGEMM_NEON
+
+bool llamafile_sgemm(const struct lm_ggml_compute_params * params, int64_t m, int64_t n, int64_t k,
+                     const void * A, int64_t lda, const void * B, int64_t ldb, void * C, int64_t ldc,
+                     int Atype, int Btype, int Ctype) {
+    // shapes that the kernels cannot handle fall back to the generic mul_mat path
+    if (m <= 0 || n <= 0 || k <= 0 || lda < k || ldb < k || ldc < m) {
+        return false;
+    }
+
+    if (Ctype != LM_GGML_TYPE_F32) {
+        return false;
+    }
+
+#if defined(SGEMM_AVX2) || defined(SGEMM_NEON)
+    switch (Atype) {
+        case LM_GGML_TYPE_F32:
+            if (Btype != LM_GGML_TYPE_F32 || k % KN != 0) {
+                return false;
+            }
+            return sgemm<RM_F, RN_F, float, float>(params, m, n, k, A, lda, B, ldb, C, ldc);
+        case LM_GGML_TYPE_F16:
+            if (Btype != LM_GGML_TYPE_F16 || k % KN != 0) {
+                return false;
+            }
+            return sgemm<RM_F, RN_F, lm_ggml_fp16_t, lm_ggml_fp16_t>(params, m, n, k, A, lda, B, ldb, C, ldc);
+        case LM_GGML_TYPE_BF16:
+            if (Btype != LM_GGML_TYPE_BF16 || k % KN != 0) {
+                return false;
+            }
+            return sgemm<RM_F, RN_F, lm_ggml_bf16_t, lm_ggml_bf16_t>(params, m, n, k, A, lda, B, ldb, C, ldc);
+        case LM_GGML_TYPE_Q8_0:
+            if (Btype != LM_GGML_TYPE_Q8_0) {
+                return false;
+            }
+            return sgemm<RM_Q, RN_Q, block_q8_0, block_q8_0>(params, m, n, k, A, lda, B, ldb, C, ldc);
+        case LM_GGML_TYPE_Q4_0:
+            if (Btype != LM_GGML_TYPE_Q8_0) {
+                return false;
+            }
+            return sgemm<RM_Q, RN_Q, block_q4_0, block_q8_0>(params, m, n, k, A, lda, B, ldb, C, ldc);
+        default:
+            return false;
+    }
+#else
+    LM_GGML_UNUSED(params);
+    LM_GGML_UNUSED(A);
+    LM_GGML_UNUSED(lda);
+    LM_GGML_UNUSED(B);
+    LM_GGML_UNUSED(ldb);
+    LM_GGML_UNUSED(C);
+    LM_GGML_UNUSED(Atype);
+    LM_GGML_UNUSED(Btype);
+    return false;
+#endif
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../arch-variant.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct lm_ggml_compute_params;
+
+// C = Aᵀ * B, with A: m rows of k elements (row stride lda), B: n rows of k elements (row stride ldb)
+// and C: n rows of m floats (row stride ldc). strides and k count elements, blocks for the quantized types.
+// must be called by all the threads of the graph, returns false (on every thread) if the types are not supported
+bool llamafile_sgemm(const struct lm_ggml_compute_params * params, int64_t m, int64_t n, int64_t k,
+                     const void * A, int64_t lda, const void * B, int64_t ldb, void * C, int64_t ldc,
+                     int Atype, int Btype, int Ctype);
+
+typedef bool (*llamafile_sgemm_t)(const struct lm_ggml_compute_params * params, int64_t m, int64_t n, int64_t k,
+                                  const void * A, int64_t lda, const void * B, int64_t ldb, void * C, int64_t ldc,
+                                  int Atype, int Btype, int Ctype);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1203,7 +1203,6 @@ static void lm_ggml_compute_forward_add_q_f32(
     LM_GGML_TENSOR_BINARY_OP_LOCALS
 
     const int ith = params->ith;
-    const int nth = params->nth;
 
     const lm_ggml_type type = src0->type;
     const lm_ggml_type dtype = dst->type;
@@ -1222,12 +1221,10 @@ static void lm_ggml_compute_forward_add_q_f32(
     LM_GGML_ASSERT(lm_ggml_is_quantized(src0->type));
     LM_GGML_ASSERT(src1->type == LM_GGML_TYPE_F32);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     float * wdata = (float *) params->wdata + (ne00 + CACHE_LINE_SIZE_F32) * ith;
 
@@ -1321,9 +1318,6 @@ static void lm_ggml_compute_forward_add1_f32(
     LM_GGML_ASSERT(lm_ggml_are_same_shape(src0, dst));
     LM_GGML_ASSERT(lm_ggml_is_scalar(src1));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nr  = lm_ggml_nrows(src0);
 
     LM_GGML_TENSOR_UNARY_OP_LOCALS
@@ -1331,12 +1325,10 @@ static void lm_ggml_compute_forward_add1_f32(
     LM_GGML_ASSERT( nb0 == sizeof(float));
     LM_GGML_ASSERT(nb00 == sizeof(float));
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int ir = ir0; ir < ir1; ++ir) {
         // src0 and dst are same shape => same indices
@@ -1374,9 +1366,6 @@ static void lm_ggml_compute_forward_add1_f16_f32(
     // scalar to add
     const float v = *(float *) src1->data;
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nr  = lm_ggml_nrows(src0);
 
     LM_GGML_TENSOR_UNARY_OP_LOCALS
@@ -1388,12 +1377,10 @@ static void lm_ggml_compute_forward_add1_f16_f32(
     LM_GGML_ASSERT( nb0 == sizeof(lm_ggml_fp16_t));
     LM_GGML_ASSERT(nb00 == sizeof(lm_ggml_fp16_t));
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int ir = ir0; ir < ir1; ++ir) {
         // src0 and dst are same shape => same indices
@@ -1422,9 +1409,6 @@ static void lm_ggml_compute_forward_add1_f16_f16(
     // scalar to add
     const float v = LM_GGML_CPU_FP16_TO_FP32(*(lm_ggml_fp16_t *) src1->data);
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nr  = lm_ggml_nrows(src0);
 
     LM_GGML_TENSOR_UNARY_OP_LOCALS
@@ -1436,12 +1420,10 @@ static void lm_ggml_compute_forward_add1_f16_f16(
     LM_GGML_ASSERT( nb0 == sizeof(lm_ggml_fp16_t));
     LM_GGML_ASSERT(nb00 == sizeof(lm_ggml_fp16_t));
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int ir = ir0; ir < ir1; ++ir) {
         // src0 and dst are same shape => same indices
@@ -1471,7 +1453,6 @@ static void lm_ggml_compute_forward_add1_q_f32(
     const float v = *(float *) src1->data;
 
     const int ith = params->ith;
-    const int nth = params->nth;
 
     const int nr  = lm_ggml_nrows(src0);
 
@@ -1493,12 +1474,10 @@ static void lm_ggml_compute_forward_add1_q_f32(
     LM_GGML_ASSERT(dst->type == src0->type);
     LM_GGML_ASSERT(src1->type == LM_GGML_TYPE_F32);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     float * wdata = (float *) params->wdata + (ne0 + CACHE_LINE_SIZE_F32) * ith;
 
@@ -1535,9 +1514,6 @@ static void lm_ggml_compute_forward_add1_bf16_f32(
     // scalar to add
     const float v = *(float *) src1->data;
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nr  = lm_ggml_nrows(src0);
 
     LM_GGML_TENSOR_UNARY_OP_LOCALS
@@ -1549,12 +1525,10 @@ static void lm_ggml_compute_forward_add1_bf16_f32(
     LM_GGML_ASSERT( nb0 == sizeof(lm_ggml_bf16_t));
     LM_GGML_ASSERT(nb00 == sizeof(lm_ggml_bf16_t));
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int ir = ir0; ir < ir1; ++ir) {
         // src0 and dst are same shape => same indices
@@ -1583,9 +1557,6 @@ static void lm_ggml_compute_forward_add1_bf16_bf16(
     // scalar to add
     const float v = LM_GGML_BF16_TO_FP32(*(lm_ggml_bf16_t *) src1->data);
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nr  = lm_ggml_nrows(src0);
 
     LM_GGML_TENSOR_UNARY_OP_LOCALS
@@ -1597,12 +1568,10 @@ static void lm_ggml_compute_forward_add1_bf16_bf16(
     LM_GGML_ASSERT( nb0 == sizeof(lm_ggml_bf16_t));
     LM_GGML_ASSERT(nb00 == sizeof(lm_ggml_bf16_t));
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int ir = ir0; ir < ir1; ++ir) {
         // src0 and dst are same shape => same indices
@@ -1718,9 +1687,6 @@ static void lm_ggml_compute_forward_acc_f32(
         lm_ggml_barrier(params->threadpool);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nr = lm_ggml_nrows(src1);
     const int nc = src1->ne[0];
 
@@ -1740,12 +1706,10 @@ static void lm_ggml_compute_forward_acc_f32(
 
     LM_GGML_ASSERT(nb10 == sizeof(float));
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int ir = ir0; ir < ir1; ++ir) {
         // src0 and dst are viewed with shape of src1 and offset
@@ -2119,12 +2083,10 @@ static void lm_ggml_compute_forward_count_equal_i32(
     int64_t * sums = (int64_t *) params->wdata;
     int64_t sum_thread = 0;
 
-    // rows per thread
-    const int64_t dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int64_t ir0 = dr*ith;
-    const int64_t ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int64_t ir = ir0; ir < ir1; ++ir) {
         const int64_t i03 =  ir                        / (ne02*ne01);
@@ -2591,18 +2553,13 @@ static void lm_ggml_compute_forward_gelu_f32(
     assert(lm_ggml_is_contiguous_1(dst));
     assert(lm_ggml_are_same_shape(src0, dst));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src0->ne[0];
     const int nr = lm_ggml_nrows(src0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_vec_gelu_f32(nc,
@@ -2630,18 +2587,13 @@ static void lm_ggml_compute_forward_gelu_f16(
     assert(lm_ggml_is_contiguous_1(dst));
     assert(lm_ggml_are_same_shape(src0, dst));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src0->ne[0];
     const int nr = lm_ggml_nrows(src0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_vec_gelu_f16(nc,
@@ -2694,18 +2646,13 @@ static void lm_ggml_compute_forward_gelu_erf_f32(
     assert(lm_ggml_is_contiguous_1(dst));
     assert(lm_ggml_are_same_shape(src0, dst));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src0->ne[0];
     const int nr = lm_ggml_nrows(src0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_vec_gelu_erf_f32(nc,
@@ -2733,18 +2680,13 @@ static void lm_ggml_compute_forward_gelu_erf_f16(
     assert(lm_ggml_is_contiguous_1(dst));
     assert(lm_ggml_are_same_shape(src0, dst));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src0->ne[0];
     const int nr = lm_ggml_nrows(src0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_vec_gelu_erf_f16(nc,
@@ -2797,18 +2739,13 @@ static void lm_ggml_compute_forward_gelu_quick_f32(
     assert(lm_ggml_is_contiguous_1(dst));
     assert(lm_ggml_are_same_shape(src0, dst));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src0->ne[0];
     const int nr = lm_ggml_nrows(src0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_vec_gelu_quick_f32(nc,
@@ -2836,18 +2773,13 @@ static void lm_ggml_compute_forward_gelu_quick_f16(
     assert(lm_ggml_is_contiguous_1(dst));
     assert(lm_ggml_are_same_shape(src0, dst));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src0->ne[0];
     const int nr = lm_ggml_nrows(src0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_vec_gelu_quick_f16(nc,
@@ -2900,32 +2832,24 @@ static void lm_ggml_compute_forward_silu_f32(
     assert(lm_ggml_is_contiguous_1(dst));
     assert(lm_ggml_are_same_shape(src0, dst));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src0->ne[0];
     const int nr = lm_ggml_nrows(src0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
-    // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
-
-    for (int i1 = ir0; i1 < ir1; i1++) {
-        lm_ggml_vec_silu_f32(nc,
-                (float *) ((char *) dst->data  + i1*( dst->nb[1])),
-                (float *) ((char *) src0->data + i1*(src0->nb[1])));
+    for (int64_t ir0 = 0, ir1 = 0; lm_ggml_cpu_rows_next(params, nr, &ir0, &ir1); ) {
+        for (int i1 = ir0; i1 < ir1; i1++) {
+            lm_ggml_vec_silu_f32(nc,
+                    (float *) ((char *) dst->data  + i1*( dst->nb[1])),
+                    (float *) ((char *) src0->data + i1*(src0->nb[1])));
 
 #ifndef NDEBUG
-        for (int k = 0; k < nc; k++) {
-            const float x = ((float *) ((char *) dst->data + i1*(dst->nb[1])))[k];
-            LM_GGML_UNUSED(x);
-            assert(!isnan(x));
-            assert(!isinf(x));
-        }
+            for (int k = 0; k < nc; k++) {
+                const float x = ((float *) ((char *) dst->data + i1*(dst->nb[1])))[k];
+                LM_GGML_UNUSED(x);
+                assert(!isnan(x));
+                assert(!isinf(x));
+            }
 #endif
+        }
     }
 }
 
@@ -2939,18 +2863,13 @@ static void lm_ggml_compute_forward_silu_f16(
     assert(lm_ggml_is_contiguous_1(dst));
     assert(lm_ggml_are_same_shape(src0, dst));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src0->ne[0];
     const int nr = lm_ggml_nrows(src0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_vec_silu_f16(nc,
@@ -3089,18 +3008,13 @@ static void lm_ggml_compute_forward_silu_back_f32(
     assert(lm_ggml_are_same_shape(src1, dst));
     assert(lm_ggml_are_same_shape(src1, grad));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1->ne[0];
     const int nr = lm_ggml_nrows(src1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_vec_silu_backward_f32(nc,
@@ -3132,18 +3046,13 @@ static void lm_ggml_compute_forward_silu_back_f16(
     assert(lm_ggml_are_same_shape(src1, dst));
     assert(lm_ggml_are_same_shape(src1, grad));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1->ne[0];
     const int nr = lm_ggml_nrows(src1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_vec_silu_backward_f16(nc,
@@ -3206,9 +3115,6 @@ static void lm_ggml_compute_forward_reglu_f32(
         LM_GGML_ASSERT(src0->type == src1->type);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1 ? src0->ne[0] : src0->ne[0] / 2;
     const int nr = lm_ggml_nrows(src0);
 
@@ -3217,12 +3123,10 @@ static void lm_ggml_compute_forward_reglu_f32(
 
     const int32_t swapped = lm_ggml_get_op_params_i32(dst, 1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         float * src0_p = (float *) (src0_d + i1*src0_o);
@@ -3265,9 +3169,6 @@ static void lm_ggml_compute_forward_reglu_f16(
         LM_GGML_ASSERT(src0->type == src1->type);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1 ? src0->ne[0] : src0->ne[0] / 2;
     const int nr = lm_ggml_nrows(src0);
 
@@ -3276,12 +3177,10 @@ static void lm_ggml_compute_forward_reglu_f16(
 
     const int32_t swapped = lm_ggml_get_op_params_i32(dst, 1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_fp16_t * src0_p = (lm_ggml_fp16_t *) (src0_d + i1*src0_o);
@@ -3349,9 +3248,6 @@ static void lm_ggml_compute_forward_geglu_f32(
         LM_GGML_ASSERT(src0->type == src1->type);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1 ? src0->ne[0] : src0->ne[0] / 2;
     const int nr = lm_ggml_nrows(src0);
 
@@ -3360,12 +3256,10 @@ static void lm_ggml_compute_forward_geglu_f32(
 
     const int32_t swapped = lm_ggml_get_op_params_i32(dst, 1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         float * src0_p = (float *) (src0_d + i1*src0_o);
@@ -3408,9 +3302,6 @@ static void lm_ggml_compute_forward_geglu_f16(
         LM_GGML_ASSERT(src0->type == src1->type);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1 ? src0->ne[0] : src0->ne[0] / 2;
     const int nr = lm_ggml_nrows(src0);
 
@@ -3419,12 +3310,10 @@ static void lm_ggml_compute_forward_geglu_f16(
 
     const int32_t swapped = lm_ggml_get_op_params_i32(dst, 1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_fp16_t * src0_p = (lm_ggml_fp16_t *) (src0_d + i1*src0_o);
@@ -3492,9 +3381,6 @@ static void lm_ggml_compute_forward_swiglu_f32(
         LM_GGML_ASSERT(src0->type == src1->type);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1 ? src0->ne[0] : src0->ne[0] / 2;
     const int nr = lm_ggml_nrows(src0);
 
@@ -3503,32 +3389,27 @@ static void lm_ggml_compute_forward_swiglu_f32(
 
     const int32_t swapped = lm_ggml_get_op_params_i32(dst, 1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
-    // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
-
-    for (int i1 = ir0; i1 < ir1; i1++) {
-        float * src0_p = (float *) (src0_d + i1*src0_o);
-        float * src1_p = (float *) (src1_d + i1*src1_o);
+    for (int64_t ir0 = 0, ir1 = 0; lm_ggml_cpu_rows_next(params, nr, &ir0, &ir1); ) {
+        for (int i1 = ir0; i1 < ir1; i1++) {
+            float * src0_p = (float *) (src0_d + i1*src0_o);
+            float * src1_p = (float *) (src1_d + i1*src1_o);
 
-        if (!src1) {
-            src0_p += swapped ? nc : 0;
-            src1_p += swapped ? 0 : nc;
-        }
+            if (!src1) {
+                src0_p += swapped ? nc : 0;
+                src1_p += swapped ? 0 : nc;
+            }
 
-        lm_ggml_vec_swiglu_f32(nc, (float *) ((char *) dst->data + i1*(dst->nb[1])), src0_p, src1_p);
+            lm_ggml_vec_swiglu_f32(nc, (float *) ((char *) dst->data + i1*(dst->nb[1])), src0_p, src1_p);
 
 #ifndef NDEBUG
-        for (int k = 0; k < nc; k++) {
-            const float x = ((float *) ((char *) dst->data + i1*( dst->nb[1])))[k];
-            LM_GGML_UNUSED(x);
-            assert(!isnan(x));
-            assert(!isinf(x));
-        }
+            for (int k = 0; k < nc; k++) {
+                const float x = ((float *) ((char *) dst->data + i1*( dst->nb[1])))[k];
+                LM_GGML_UNUSED(x);
+                assert(!isnan(x));
+                assert(!isinf(x));
+            }
 #endif
+        }
     }
 }
 
@@ -3551,9 +3432,6 @@ static void lm_ggml_compute_forward_swiglu_f16(
         LM_GGML_ASSERT(src0->type == src1->type);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1 ? src0->ne[0] : src0->ne[0] / 2;
     const int nr = lm_ggml_nrows(src0);
 
@@ -3562,12 +3440,10 @@ static void lm_ggml_compute_forward_swiglu_f16(
 
     const int32_t swapped = lm_ggml_get_op_params_i32(dst, 1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_fp16_t * src0_p = (lm_ggml_fp16_t *) (src0_d + i1*src0_o);
@@ -3635,9 +3511,6 @@ static void lm_ggml_compute_forward_geglu_erf_f32(
         LM_GGML_ASSERT(src0->type == src1->type);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1 ? src0->ne[0] : src0->ne[0] / 2;
     const int nr = lm_ggml_nrows(src0);
 
@@ -3646,12 +3519,10 @@ static void lm_ggml_compute_forward_geglu_erf_f32(
 
     const int32_t swapped = lm_ggml_get_op_params_i32(dst, 1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         float * src0_p = (float *) (src0_d + i1*src0_o);
@@ -3694,9 +3565,6 @@ static void lm_ggml_compute_forward_geglu_erf_f16(
         LM_GGML_ASSERT(src0->type == src1->type);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1 ? src0->ne[0] : src0->ne[0] / 2;
     const int nr = lm_ggml_nrows(src0);
 
@@ -3705,12 +3573,10 @@ static void lm_ggml_compute_forward_geglu_erf_f16(
 
     const int32_t swapped = lm_ggml_get_op_params_i32(dst, 1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_fp16_t * src0_p = (lm_ggml_fp16_t *) (src0_d + i1*src0_o);
@@ -3778,9 +3644,6 @@ static void lm_ggml_compute_forward_geglu_quick_f32(
         LM_GGML_ASSERT(src0->type == src1->type);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1 ? src0->ne[0] : src0->ne[0] / 2;
     const int nr = lm_ggml_nrows(src0);
 
@@ -3789,12 +3652,10 @@ static void lm_ggml_compute_forward_geglu_quick_f32(
 
     const int32_t swapped = lm_ggml_get_op_params_i32(dst, 1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         float * src0_p = (float *) (src0_d + i1*src0_o);
@@ -3837,9 +3698,6 @@ static void lm_ggml_compute_forward_geglu_quick_f16(
         LM_GGML_ASSERT(src0->type == src1->type);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src1 ? src0->ne[0] : src0->ne[0] / 2;
     const int nr = lm_ggml_nrows(src0);
 
@@ -3848,12 +3706,10 @@ static void lm_ggml_compute_forward_geglu_quick_f16(
 
     const int32_t swapped = lm_ggml_get_op_params_i32(dst, 1);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         lm_ggml_fp16_t * src0_p = (lm_ggml_fp16_t *) (src0_d + i1*src0_o);
@@ -3912,9 +3768,6 @@ static void lm_ggml_compute_forward_norm_f32(
 
     LM_GGML_ASSERT(src0->nb[0] == sizeof(float));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     LM_GGML_TENSOR_UNARY_OP_LOCALS
 
     float eps;
@@ -3923,32 +3776,34 @@ static void lm_ggml_compute_forward_norm_f32(
     LM_GGML_ASSERT(eps >= 0.0f);
 
     // TODO: optimize
-    for (int64_t i03 = 0; i03 < ne03; i03++) {
-        for (int64_t i02 = 0; i02 < ne02; i02++) {
-            for (int64_t i01 = ith; i01 < ne01; i01 += nth) {
-                const float * x = (float *) ((char *) src0->data + i01*nb01 + i02*nb02 + i03*nb03);
+    for (int64_t ir0 = 0, ir1 = 0; lm_ggml_cpu_rows_next(params, lm_ggml_nrows(src0), &ir0, &ir1); ) {
+        for (int64_t ir = ir0; ir < ir1; ++ir) {
+            const int64_t i03 = ir/(ne02*ne01);
+            const int64_t i02 = (ir - i03*ne02*ne01)/ne01;
+            const int64_t i01 = (ir - i03*ne02*ne01 - i02*ne01);
 
-                lm_ggml_float sum = 0.0;
-                for (int64_t i00 = 0; i00 < ne00; i00++) {
-                    sum += (lm_ggml_float)x[i00];
-                }
+            const float * x = (float *) ((char *) src0->data + i01*nb01 + i02*nb02 + i03*nb03);
 
-                float mean = sum/ne00;
-
-                float * y = (float *) ((char *) dst->data + i01*nb1 + i02*nb2 + i03*nb3);
+            lm_ggml_float sum = 0.0;
+            for (int64_t i00 = 0; i00 < ne00; i00++) {
+                sum += (lm_ggml_float)x[i00];
+            }
 
-                lm_ggml_float sum2 = 0.0;
-                for (int64_t i00 = 0; i00 < ne00; i00++) {
-                    float v = x[i00] - mean;
-                    y[i00] = v;
-                    sum2 += (lm_ggml_float)(v*v);
-                }
+            float mean = sum/ne00;
 
-                float variance = sum2/ne00;
-                const float scale = 1.0f/sqrtf(variance + eps);
+            float * y = (float *) ((char *) dst->data + i01*nb1 + i02*nb2 + i03*nb3);
 
-                lm_ggml_vec_scale_f32(ne00, y, scale);
+            lm_ggml_float sum2 = 0.0;
+            for (int64_t i00 = 0; i00 < ne00; i00++) {
+                float v = x[i00] - mean;
+                y[i00] = v;
+                sum2 += (lm_ggml_float)(v*v);
             }
+
+            float variance = sum2/ne00;
+            const float scale = 1.0f/sqrtf(variance + eps);
+
+            lm_ggml_vec_scale_f32(ne00, y, scale);
         }
     }
 }
@@ -3983,9 +3838,6 @@ static void lm_ggml_compute_forward_rms_norm_f32(
 
     LM_GGML_ASSERT(src0->nb[0] == sizeof(float));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     LM_GGML_TENSOR_UNARY_OP_LOCALS
 
     float eps;
@@ -3994,32 +3846,34 @@ static void lm_ggml_compute_forward_rms_norm_f32(
     LM_GGML_ASSERT(eps >= 0.0f);
 
     // TODO: optimize
-    for (int64_t i03 = 0; i03 < ne03; i03++) {
-        for (int64_t i02 = 0; i02 < ne02; i02++) {
-            for (int64_t i01 = ith; i01 < ne01; i01 += nth) {
-                const float * x = (float *) ((char *) src0->data + i01*nb01 + i02*nb02 + i03*nb03);
+    for (int64_t ir0 = 0, ir1 = 0; lm_ggml_cpu_rows_next(params, lm_ggml_nrows(src0), &ir0, &ir1); ) {
+        for (int64_t ir = ir0; ir < ir1; ++ir) {
+            const int64_t i03 = ir/(ne02*ne01);
+            const int64_t i02 = (ir - i03*ne02*ne01)/ne01;
+            const int64_t i01 = (ir - i03*ne02*ne01 - i02*ne01);
 
-                lm_ggml_float sum = 0.0;
-                for (int64_t i00 = 0; i00 < ne00; i00++) {
-                    sum += (lm_ggml_float)(x[i00] * x[i00]);
-                }
+            const float * x = (float *) ((char *) src0->data + i01*nb01 + i02*nb02 + i03*nb03);
 
-                const float mean = sum/ne00;
+            lm_ggml_float sum = 0.0;
+            for (int64_t i00 = 0; i00 < ne00; i00++) {
+                sum += (lm_ggml_float)(x[i00] * x[i00]);
+            }
 
-                float * y = (float *) ((char *) dst->data + i01*nb1 + i02*nb2 + i03*nb3);
+            const float mean = sum/ne00;
 
-                memcpy(y, x, ne00 * sizeof(float));
-                // for (int i00 = 0; i00 < ne00; i00++) {
-                //     y[i00] = x[i00];
-                // }
+            float * y = (float *) ((char *) dst->data + i01*nb1 + i02*nb2 + i03*nb3);
 
-                const float scale = 1.0f/sqrtf(mean + eps);
+            memcpy(y, x, ne00 * sizeof(float));
+            // for (int i00 = 0; i00 < ne00; i00++) {
+            //     y[i00] = x[i00];
+            // }
 
-                // if you hit this, likely you got an inf somewhere earlier
-                assert(scale > 0.0f);
+            const float scale = 1.0f/sqrtf(mean + eps);
 
-                lm_ggml_vec_scale_f32(ne00, y, scale);
-            }
+            // if you hit this, likely you got an inf somewhere earlier
+            assert(scale > 0.0f);
+
+            lm_ggml_vec_scale_f32(ne00, y, scale);
         }
     }
 }
@@ -4042,6 +3896,128 @@ void lm_ggml_compute_forward_rms_norm(
     }
 }
 
+// lm_ggml_compute_forward_rms_norm_mul, lm_ggml_compute_forward_add_rms_norm
+
+// y = rms_norm(x)*w, the same operations as the separate rms_norm and mul ops
+static void lm_ggml_rms_norm_mul_row_f32(const int64_t n, float * y, const float * x, const float * w, const float eps) {
+    lm_ggml_float sum = 0.0;
+    for (int64_t i = 0; i < n; i++) {
+        sum += (lm_ggml_float)(x[i] * x[i]);
+    }
+
+    const float mean  = sum/n;
+    const float scale = 1.0f/sqrtf(mean + eps);
+
+    // if you hit this, likely you got an inf somewhere earlier
+    assert(scale > 0.0f);
+
+    if (y != x) {
+        memcpy(y, x, n * sizeof(float));
+    }
+    lm_ggml_vec_scale_f32(n, y, scale);
+
+    if (w) {
+        lm_ggml_vec_mul_f32(n, y, y, w);
+    }
+}
+
+// the weight of the mul that follows a fused rms_norm, broadcast over the rows of the norm
+static const float * lm_ggml_rms_norm_mul_weight_row(const lm_ggml_tensor * mul, const lm_ggml_tensor * norm, int64_t i1, int64_t i2, int64_t i3) {
+    if (mul == nullptr) {
+        return nullptr;
+    }
+
+    const lm_ggml_tensor * w = mul->src[0] == norm ? mul->src[1] : mul->src[0];
+
+    return (const float *) ((const char *) w->data + (i1 % w->ne[1])*w->nb[1] + (i2 % w->ne[2])*w->nb[2] + (i3 % w->ne[3])*w->nb[3]);
+}
+
+void lm_ggml_compute_forward_rms_norm_mul(
+        const lm_ggml_compute_params * params,
+        const lm_ggml_tensor * norm,
+        lm_ggml_tensor * mul) {
+
+    const lm_ggml_tensor * src0 = norm->src[0];
+
+    LM_GGML_ASSERT(src0->type == LM_GGML_TYPE_F32 && mul->type == LM_GGML_TYPE_F32);
+    LM_GGML_ASSERT(lm_ggml_are_same_shape(src0, mul));
+    LM_GGML_ASSERT(src0->nb[0] == sizeof(float) && mul->nb[0] == sizeof(float));
+
+    float eps;
+    memcpy(&eps, norm->op_params, sizeof(float));
+
+    LM_GGML_ASSERT(eps >= 0.0f);
+
+    for (int64_t ir0 = 0, ir1 = 0; lm_ggml_cpu_rows_next(params, lm_ggml_nrows(src0), &ir0, &ir1); ) {
+        for (int64_t ir = ir0; ir < ir1; ++ir) {
+            const int64_t i3 = ir/(src0->ne[2]*src0->ne[1]);
+            const int64_t i2 = (ir - i3*src0->ne[2]*src0->ne[1])/src0->ne[1];
+            const int64_t i1 = (ir - i3*src0->ne[2]*src0->ne[1] - i2*src0->ne[1]);
+
+            const float * x = (const float *) ((const char *) src0->data + i1*src0->nb[1] + i2*src0->nb[2] + i3*src0->nb[3]);
+                  float * y = (float *) ((char *) mul->data + i1*mul->nb[1] + i2*mul->nb[2] + i3*mul->nb[3]);
+
+            lm_ggml_rms_norm_mul_row_f32(src0->ne[0], y, x, lm_ggml_rms_norm_mul_weight_row(mul, norm, i1, i2, i3), eps);
+        }
+    }
+}
+
+void lm_ggml_compute_forward_add_rms_norm(
+        const lm_ggml_compute_params * params,
+        lm_ggml_tensor * add,
+        lm_ggml_tensor * add_row,
+        lm_ggml_tensor * norm,
+        lm_ggml_tensor * mul) {
+
+    const lm_ggml_tensor * src0 = add->src[0];
+    const lm_ggml_tensor * src1 = add->src[1];
+
+    // the first sum is only used by the add of the row, the second one is written out in its place
+    lm_ggml_tensor * sum = add_row ? add_row : add;
+    const float    * row = add_row ? (const float *) add_row->src[1]->data : nullptr;
+
+    // the normalized rows go to the output of the mul if it is fused too
+    lm_ggml_tensor * dst = mul ? mul : norm;
+
+    LM_GGML_ASSERT(src0->type == LM_GGML_TYPE_F32 && src1->type == LM_GGML_TYPE_F32);
+    LM_GGML_ASSERT(sum->type == LM_GGML_TYPE_F32 && (!dst || dst->type == LM_GGML_TYPE_F32));
+    LM_GGML_ASSERT(lm_ggml_are_same_shape(src0, src1) && lm_ggml_are_same_shape(add, sum) && (!dst || lm_ggml_are_same_shape(add, dst)));
+    LM_GGML_ASSERT(src0->nb[0] == sizeof(float) && src1->nb[0] == sizeof(float));
+    LM_GGML_ASSERT(sum->nb[0] == sizeof(float) && (!dst || dst->nb[0] == sizeof(float)));
+
+    float eps = 0.0f;
+    if (norm) {
+        memcpy(&eps, norm->op_params, sizeof(float));
+    }
+
+    LM_GGML_ASSERT(eps >= 0.0f);
+
+    for (int64_t ir0 = 0, ir1 = 0; lm_ggml_cpu_rows_next(params, lm_ggml_nrows(add), &ir0, &ir1); ) {
+        for (int64_t ir = ir0; ir < ir1; ++ir) {
+            const int64_t i3 = ir/(add->ne[2]*add->ne[1]);
+            const int64_t i2 = (ir - i3*add->ne[2]*add->ne[1])/add->ne[1];
+            const int64_t i1 = (ir - i3*add->ne[2]*add->ne[1] - i2*add->ne[1]);
+
+            const float * a = (const float *) ((const char *) src0->data + i1*src0->nb[1] + i2*src0->nb[2] + i3*src0->nb[3]);
+            const float * b = (const float *) ((const char *) src1->data + i1*src1->nb[1] + i2*src1->nb[2] + i3*src1->nb[3]);
+                  float * x = (float *) ((char *) sum->data + i1*sum->nb[1] + i2*sum->nb[2] + i3*sum->nb[3]);
+
+            // the sum is still needed by the other users of the add, the row is normalized while it is in cache
+            lm_ggml_vec_add_f32(add->ne[0], x, a, b);
+
+            if (row) {
+                lm_ggml_vec_acc_f32(add->ne[0], x, row);
+            }
+
+            if (dst) {
+                float * y = (float *) ((char *) dst->data + i1*dst->nb[1] + i2*dst->nb[2] + i3*dst->nb[3]);
+
+                lm_ggml_rms_norm_mul_row_f32(add->ne[0], y, x, lm_ggml_rms_norm_mul_weight_row(mul, norm, i1, i2, i3), eps);
+            }
+        }
+    }
+}
+
 static void lm_ggml_compute_forward_rms_norm_back_f32(
         const lm_ggml_compute_params * params,
         lm_ggml_tensor * dst) {
@@ -4391,7 +4367,6 @@ static void lm_ggml_compute_forward_out_prod_f32(
     LM_GGML_ASSERT(src1->type == LM_GGML_TYPE_F32);
 
     const int ith = params->ith;
-    const int nth = params->nth;
 
     LM_GGML_ASSERT(ne0 == ne00);
     LM_GGML_ASSERT(ne1 == ne10);
@@ -4427,15 +4402,13 @@ static void lm_ggml_compute_forward_out_prod_f32(
 
     // parallelize by last three dimensions
 
-    // total rows in dst
-    const int64_t nr = ne1*ne2*ne3;
-
-    // rows per thread
-    const int64_t dr = (nr + nth - 1)/nth;
+    // total rows in dst
+    const int64_t nr = ne1*ne2*ne3;
 
     // row range for this thread
-    const int64_t ir0 = dr*ith;
-    const int64_t ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     // block-tiling attempt
     const int64_t blck_0 = MAX(LM_GGML_VEC_MAD_UNROLL, 32);
@@ -4508,7 +4481,6 @@ static void lm_ggml_compute_forward_out_prod_q_f32(
     LM_GGML_TENSOR_BINARY_OP_LOCALS;
 
     const int ith = params->ith;
-    const int nth = params->nth;
 
     const lm_ggml_type type = src0->type;
     lm_ggml_to_float_t const dequantize_row_q = lm_ggml_get_type_traits(type)->to_float;
@@ -4545,12 +4517,10 @@ static void lm_ggml_compute_forward_out_prod_q_f32(
     // total rows in dst
     const int64_t nr = ne1*ne2*ne3;
 
-    // rows per thread
-    const int64_t dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int64_t ir0 = dr*ith;
-    const int64_t ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     // dst[:,:,:,:] = 0
     // for i2,i3:
@@ -4652,18 +4622,13 @@ static void lm_ggml_compute_forward_scale_f32(
     memcpy(&s, (float *) dst->op_params + 0, sizeof(float));
     memcpy(&b, (float *) dst->op_params + 1, sizeof(float));
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src0->ne[0];
     const int nr = lm_ggml_nrows(src0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     const size_t nb01 = src0->nb[1];
 
@@ -4738,9 +4703,6 @@ static void lm_ggml_compute_forward_set_f32(
         lm_ggml_barrier(params->threadpool);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nr = lm_ggml_nrows(src1);
     const int nc = src1->ne[0];
 
@@ -4759,12 +4721,10 @@ static void lm_ggml_compute_forward_set_f32(
 
     LM_GGML_ASSERT(nb10 == sizeof(float));
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int ir = ir0; ir < ir1; ++ir) {
         // src0 and dst are viewed with shape of src1 and offset
@@ -4809,9 +4769,6 @@ static void lm_ggml_compute_forward_set_i32(
         lm_ggml_barrier(params->threadpool);
     }
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nr = lm_ggml_nrows(src1);
     const int nc = src1->ne[0];
 
@@ -4830,12 +4787,10 @@ static void lm_ggml_compute_forward_set_i32(
 
     LM_GGML_ASSERT(nb10 == sizeof(int32_t));
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int ir = ir0; ir < ir1; ++ir) {
         // src0 and dst are viewed with shape of src1 and offset
@@ -4974,15 +4929,10 @@ static void lm_ggml_compute_forward_get_rows_q(
     assert(nb00 == lm_ggml_type_size(type));
     assert(lm_ggml_nrows(dst) == nr);
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int64_t i = ir0; i < ir1; ++i) {
         const int64_t i12 = i/(ne11*ne10);
@@ -5015,15 +4965,10 @@ static void lm_ggml_compute_forward_get_rows_f16(
     assert(nb00 == sizeof(lm_ggml_fp16_t));
     assert(lm_ggml_nrows(dst) == nr);
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int64_t i = ir0; i < ir1; ++i) {
         const int64_t i12 = i/(ne11*ne10);
@@ -5056,15 +5001,10 @@ static void lm_ggml_compute_forward_get_rows_bf16(
     assert(nb00 == sizeof(lm_ggml_bf16_t));
     assert(lm_ggml_nrows(dst) == nr);
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int64_t i = ir0; i < ir1; ++i) {
         const int64_t i12 = i/(ne11*ne10);
@@ -5097,15 +5037,10 @@ static void lm_ggml_compute_forward_get_rows_f32(
     assert(nb00 == sizeof(float));
     assert(lm_ggml_nrows(dst) == nr);
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int64_t i = ir0; i < ir1; ++i) {
         const int64_t i12 = i/(ne11*ne10);
@@ -5534,7 +5469,6 @@ static void lm_ggml_compute_forward_soft_max_f32(
     memcpy(&max_bias, (float *) dst->op_params + 1, sizeof(float));
 
     const int ith = params->ith;
-    const int nth = params->nth;
 
     LM_GGML_TENSOR_UNARY_OP_LOCALS
 
@@ -5557,61 +5491,63 @@ static void lm_ggml_compute_forward_soft_max_f32(
 
     const bool use_f16 = (src1 && src1->type == LM_GGML_TYPE_F16);
 
-    for (int64_t i03 = 0; i03 < ne03; i03++) {
-        for (int64_t i02 = 0; i02 < ne02; i02++) {
-            for (int64_t i01 = ith; i01 < ne01; i01 += nth) {
-                const int64_t i11 = i01;
-                const int64_t i12 = i02%ne12;
-                const int64_t i13 = i03%ne13;
-
-                // ALiBi
-                const uint32_t h = i02; // head
-                const float slope = (max_bias > 0.0f) ? h < n_head_log2 ? powf(m0, h + 1) : powf(m1, 2*(h - n_head_log2) + 1) : 1.0f;
-
-                float * sp = (float *)((char *) src0->data + i01*nb01 + i02*nb02 + i03*nb03);
-                float * dp = (float *)((char *)  dst->data + i01*nb1  + i02*nb2  + i03*nb3);
-
-                // broadcast the mask across rows
-                lm_ggml_fp16_t * mp_f16 = src1 ? (lm_ggml_fp16_t *)((char *) src1->data + i11*nb11 + i12*nb12 + i13*nb13) : NULL;
-                float       * mp_f32 = src1 ? (float       *)((char *) src1->data + i11*nb11 + i12*nb12 + i13*nb13) : NULL;
-
-                lm_ggml_vec_cpy_f32  (ne00, wp, sp);
-                lm_ggml_vec_scale_f32(ne00, wp, scale);
-                if (mp_f32) {
-                    if (use_f16) {
-                        for (int i = 0; i < ne00; ++i) {
-                            wp[i] += slope*LM_GGML_CPU_FP16_TO_FP32(mp_f16[i]);
-                        }
-                    } else {
-                        for (int i = 0; i < ne00; ++i) {
-                            wp[i] += slope*mp_f32[i];
-                        }
+    for (int64_t ir0 = 0, ir1 = 0; lm_ggml_cpu_rows_next(params, lm_ggml_nrows(src0), &ir0, &ir1); ) {
+        for (int64_t ir = ir0; ir < ir1; ++ir) {
+            const int64_t i03 = ir/(ne02*ne01);
+            const int64_t i02 = (ir - i03*ne02*ne01)/ne01;
+            const int64_t i01 = (ir - i03*ne02*ne01 - i02*ne01);
+
+            const int64_t i11 = i01;
+            const int64_t i12 = i02%ne12;
+            const int64_t i13 = i03%ne13;
+
+            // ALiBi
+            const uint32_t h = i02; // head
+            const float slope = (max_bias > 0.0f) ? h < n_head_log2 ? powf(m0, h + 1) : powf(m1, 2*(h - n_head_log2) + 1) : 1.0f;
+
+            float * sp = (float *)((char *) src0->data + i01*nb01 + i02*nb02 + i03*nb03);
+            float * dp = (float *)((char *)  dst->data + i01*nb1  + i02*nb2  + i03*nb3);
+
+            // broadcast the mask across rows
+            lm_ggml_fp16_t * mp_f16 = src1 ? (lm_ggml_fp16_t *)((char *) src1->data + i11*nb11 + i12*nb12 + i13*nb13) : NULL;
+            float       * mp_f32 = src1 ? (float       *)((char *) src1->data + i11*nb11 + i12*nb12 + i13*nb13) : NULL;
+
+            lm_ggml_vec_cpy_f32  (ne00, wp, sp);
+            lm_ggml_vec_scale_f32(ne00, wp, scale);
+            if (mp_f32) {
+                if (use_f16) {
+                    for (int i = 0; i < ne00; ++i) {
+                        wp[i] += slope*LM_GGML_CPU_FP16_TO_FP32(mp_f16[i]);
+                    }
+                } else {
+                    for (int i = 0; i < ne00; ++i) {
+                        wp[i] += slope*mp_f32[i];
                     }
                 }
+            }
 
 #ifndef NDEBUG
-                for (int i = 0; i < ne00; ++i) {
-                    //printf("p[%d] = %f\n", i, p[i]);
-                    assert(!isnan(wp[i]));
-                }
+            for (int i = 0; i < ne00; ++i) {
+                //printf("p[%d] = %f\n", i, p[i]);
+                assert(!isnan(wp[i]));
+            }
 #endif
 
-                float max = -INFINITY;
-                lm_ggml_vec_max_f32(ne00, &max, wp);
+            float max = -INFINITY;
+            lm_ggml_vec_max_f32(ne00, &max, wp);
 
-                lm_ggml_float sum = lm_ggml_vec_soft_max_f32(ne00, dp, wp, max);
-                assert(sum > 0.0);
+            lm_ggml_float sum = lm_ggml_vec_soft_max_f32(ne00, dp, wp, max);
+            assert(sum > 0.0);
 
-                sum = 1.0/sum;
-                lm_ggml_vec_scale_f32(ne00, dp, sum);
+            sum = 1.0/sum;
+            lm_ggml_vec_scale_f32(ne00, dp, sum);
 
 #ifndef NDEBUG
-                for (int i = 0; i < ne00; ++i) {
-                    assert(!isnan(dp[i]));
-                    assert(!isinf(dp[i]));
-                }
-#endif
+            for (int i = 0; i < ne00; ++i) {
+                assert(!isnan(dp[i]));
+                assert(!isinf(dp[i]));
             }
+#endif
         }
     }
 }
@@ -5660,18 +5596,13 @@ static void lm_ggml_compute_forward_soft_max_ext_back_f32(
 
     // TODO: handle transposed/permuted matrices
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc = src0->ne[0];
     const int nr = lm_ggml_nrows(src0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int i1 = ir0; i1 < ir1; i1++) {
         float *dy = (float *)((char *) src0->data + i1*src0->nb[1]);
@@ -5999,19 +5930,16 @@ static void lm_ggml_compute_forward_rope_f32(
     LM_GGML_ASSERT(nb00 == sizeof(float));
 
     const int ith = params->ith;
-    const int nth = params->nth;
 
     const int nr = lm_ggml_nrows(dst);
 
     LM_GGML_ASSERT(n_dims <= ne0);
     LM_GGML_ASSERT(n_dims % 2 == 0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     // row index used to determine which thread to use
     int ir = 0;
@@ -6185,19 +6113,16 @@ static void lm_ggml_compute_forward_rope_f16(
     LM_GGML_ASSERT(nb0 == sizeof(lm_ggml_fp16_t));
 
     const int ith = params->ith;
-    const int nth = params->nth;
 
     const int nr = lm_ggml_nrows(dst);
 
     LM_GGML_ASSERT(n_dims <= ne0);
     LM_GGML_ASSERT(n_dims % 2 == 0);
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     // row index used to determine which thread to use
     int ir = 0;
@@ -6397,7 +6322,6 @@ static void lm_ggml_compute_forward_conv_transpose_1d_f16_f32(
     LM_GGML_TENSOR_BINARY_OP_LOCALS
 
     const int ith = params->ith;
-    const int nth = params->nth;
 
     const int nk = ne00*ne01*ne02;
 
@@ -6445,12 +6369,10 @@ static void lm_ggml_compute_forward_conv_transpose_1d_f16_f32(
     // total rows in dst
     const int nr = ne1;
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     lm_ggml_fp16_t * const wdata     = (lm_ggml_fp16_t *) params->wdata + 0;
     lm_ggml_fp16_t * const wdata_src = wdata + nk;
@@ -6485,7 +6407,6 @@ static void lm_ggml_compute_forward_conv_transpose_1d_f32(
     LM_GGML_TENSOR_BINARY_OP_LOCALS
 
     const int ith = params->ith;
-    const int nth = params->nth;
 
     const int nk = ne00*ne01*ne02;
 
@@ -6533,12 +6454,10 @@ static void lm_ggml_compute_forward_conv_transpose_1d_f32(
     // total rows in dst
     const int nr = ne1;
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     float * const wdata     = (float *) params->wdata + 0;
     float * const wdata_src = wdata + nk;
@@ -8038,18 +7957,6 @@ static void lm_ggml_compute_forward_flash_attn_ext_f16(
     const int64_t rv2 = neq2/nev2;
     const int64_t rv3 = neq3/nev3;
 
-    // parallelize by q rows using lm_ggml_vec_dot_f32
-
-    // total rows in q
-    const int nr = neq1*neq2*neq3;
-
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
-    // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
-
     float scale         = 1.0f;
     float max_bias      = 0.0f;
     float logit_softcap = 0.0f;
@@ -8076,133 +7983,283 @@ static void lm_ggml_compute_forward_flash_attn_ext_f16(
     LM_GGML_ASSERT((                            q_to_vec_dot) && "fattn: unsupported K-type");
     LM_GGML_ASSERT((v->type == LM_GGML_TYPE_F32 || v_to_float  ) && "fattn: unsupported V-type");
 
-    // loop over n_batch and n_head
-    for (int ir = ir0; ir < ir1; ++ir) {
-        // q indices
-        const int iq3 = ir/(neq2*neq1);
-        const int iq2 = (ir - iq3*neq2*neq1)/neq1;
-        const int iq1 = (ir - iq3*neq2*neq1 - iq2*neq1);
+    const size_t q_row_size = lm_ggml_row_size(k_vec_dot_type, DK);
 
-        const uint32_t h = iq2; // head index
-        const float slope = (max_bias > 0.0f) ? h < n_head_log2 ? powf(m0, h + 1) : powf(m1, 2*(h - n_head_log2) + 1) : 1.0f;
+    // the q rows that attend to the same K/V head form a group and are processed in tiles of up to TQ rows
+    // within a group the rows are ordered (iq1, head), so that for decode a tile holds the heads of a GQA group
+    // each K/V row is then loaded and dequantized once per tile instead of once per q row
+    const int64_t TQ = LM_GGML_FA_TILE_Q;
+    const int64_t BK = LM_GGML_FA_TILE_KV;
 
-        float S = 0.0f;      // sum
-        float M = -INFINITY; // maximum KQ value
+    const int64_t ngh = rk2 == rv2 ? rk2 : 1; // heads per group
+    const int64_t ngr = neq1*ngh;             // rows per group
+    const int64_t ngt = (ngr + TQ - 1)/TQ;    // tiles per group
+    const int64_t ng2 = neq2/ngh;             // groups per batch
+    const int64_t nt  = ngt*ng2*neq3;         // total tiles
 
-        float       * VKQ32 = (float       *) params->wdata + ith*(1*DK + 2*DV + CACHE_LINE_SIZE_F32); // FP32 VKQ accumulator
-        float       * V32   =                 (VKQ32 + 1*DV); // (temporary) FP32 V buffer
-        lm_ggml_fp16_t * VKQ16 = (lm_ggml_fp16_t *) (VKQ32 + 1*DV); // (temporary) FP16 VKQ accumulator
-        lm_ggml_fp16_t * Q_q   = (lm_ggml_fp16_t *) (VKQ32 + 2*DV); // (temporary) buffer for Q converted to quantized/FP16
+    // for single-token decode there are only a few tiles - split the KV length across the threads as well and
+    // merge the partial results at the end, so that decode scales with the number of threads (split-K)
+    const int64_t n_split = (N == 1 && nth > 1) ? MIN(nth, MAX(1, nek1/BK)) : 1;
 
-        if (v->type == LM_GGML_TYPE_F16) {
-            memset(VKQ16, 0, DV*sizeof(lm_ggml_fp16_t));
-        } else {
-            memset(VKQ32, 0, DV*sizeof(float));
-        }
+    // work units (tile, KV chunk) for this thread
+    const int64_t nu = nt*n_split;
+    const int64_t du = (nu + nth - 1)/nth;
 
-        const lm_ggml_fp16_t * mp = mask ? (lm_ggml_fp16_t *)((char *) mask->data + iq1*mask->nb[1] + (iq2%mask->ne[2])*mask->nb[2] + (iq3%mask->ne[3])*mask->nb[3]) : NULL;
+    const int64_t iu0 = du*ith;
+    const int64_t iu1 = MIN(iu0 + du, nu);
+
+    // per-thread scratch, see lm_ggml_graph_plan
+    float * wdata = (float *) params->wdata + ith*(TQ*(DK + DV + BK + 2) + DV + CACHE_LINE_SIZE_F32);
+
+    char  * Q_q = (char *) wdata;   // [TQ][DK] Q converted to the vec_dot type of K
+    float * VKQ = wdata + TQ*DK;    // [TQ][DV] FP32 VKQ accumulators
+    float * KQ  = VKQ   + TQ*DV;    // [TQ][BK] KQ values of the current KV block
+    float * M   = KQ    + TQ*BK;    // [TQ] maximum KQ value
+    float * S   = M     + TQ;       // [TQ] sum
+    float * V32 = S     + TQ;       // [DV] (temporary) FP32 V row
+
+    // partial results of the KV chunks: [nr][n_split][2 + DV] = (M, S, VKQ)
+    float * part = (float *) params->wdata + nth*(TQ*(DK + DV + BK + 2) + DV + CACHE_LINE_SIZE_F32);
+
+    int64_t                iq1s[LM_GGML_FA_TILE_Q];
+    int64_t                iq2s[LM_GGML_FA_TILE_Q];
+    float                  slopes[LM_GGML_FA_TILE_Q];
+    const lm_ggml_fp16_t * mps[LM_GGML_FA_TILE_Q];
+
+    for (int64_t iu = iu0; iu < iu1; ++iu) {
+        const int64_t it = iu/n_split;
+        const int64_t is = iu%n_split;
+
+        const int64_t ig  = it/ngt;
+        const int64_t ir0 = (it%ngt)*TQ;           // first row of the tile within the group
+        const int64_t nq  = MIN(TQ, ngr - ir0);    // rows in the tile
+
+        const int64_t iq3 = ig/ng2;
+        const int64_t ih0 = (ig%ng2)*ngh;          // first head of the group
 
         // k indices
-        const int ik3 = iq3 / rk3;
-        const int ik2 = iq2 / rk2;
+        const int64_t ik3 = iq3/rk3;
+        const int64_t ik2 = ih0/rk2;
 
         // v indices
-        const int iv3 = iq3 / rv3;
-        const int iv2 = iq2 / rv2;
+        const int64_t iv3 = iq3/rv3;
+        const int64_t iv2 = ih0/rv2;
+
+        // KV chunk
+        const int64_t ic0 = (nek1*is)/n_split;
+        const int64_t ic1 = (nek1*(is + 1))/n_split;
 
-        const float * pq = (const float *) ((char *) q->data + (iq1*nbq1 + iq2*nbq2 + iq3*nbq3));
-        q_to_vec_dot(pq, Q_q, DK);
+        for (int64_t j = 0; j < nq; ++j) {
+            const int64_t iq1 = (ir0 + j)/ngh;
+            const int64_t iq2 = ih0 + (ir0 + j)%ngh;
 
-        // online softmax / attention
-        // loop over n_kv and n_head_kv
+            const uint32_t h = iq2; // head index
+
+            iq1s[j]   = iq1;
+            iq2s[j]   = iq2;
+            slopes[j] = (max_bias > 0.0f) ? h < n_head_log2 ? powf(m0, h + 1) : powf(m1, 2*(h - n_head_log2) + 1) : 1.0f;
+            mps[j]    = mask ? (const lm_ggml_fp16_t *)((const char *) mask->data + iq1*mask->nb[1] + (iq2%mask->ne[2])*mask->nb[2] + (iq3%mask->ne[3])*mask->nb[3]) : NULL;
+
+            const float * pq = (const float *) ((const char *) q->data + (iq1*nbq1 + iq2*nbq2 + iq3*nbq3));
+            q_to_vec_dot(pq, Q_q + j*q_row_size, DK);
+
+            M[j] = -INFINITY;
+            S[j] = 0.0f;
+
+            memset(VKQ + j*DV, 0, DV*sizeof(float));
+        }
+
+        // online softmax / attention, one block of KV rows at a time
         // ref: https://arxiv.org/pdf/2112.05682.pdf
-        for (int64_t ic = 0; ic < nek1; ++ic) {
-            const float mv = mp ? slope*LM_GGML_CPU_FP16_TO_FP32(mp[ic]) : 0.0f;
-            if (mv == -INFINITY) {
-                continue;
-            }
+        for (int64_t ib = ic0; ib < ic1; ib += BK) {
+            const int64_t nb = MIN(BK, ic1 - ib);
 
-            float s; // KQ value
+            // KQ values, each K row is used for all the rows of the tile
+            for (int64_t c = 0; c < nb; ++c) {
+                const int64_t ic = ib + c;
 
-            const char * k_data = (const char *) k->data + ( ic*nbk1 + ik2*nbk2 + ik3*nbk3);
-            kq_vec_dot(DK, &s, 0, k_data, 0, Q_q, 0, 1);
+                const char * k_data = (const char *) k->data + (ic*nbk1 + ik2*nbk2 + ik3*nbk3);
 
-            s = s*scale; // scale KQ value
+                for (int64_t j = 0; j < nq; ++j) {
+                    const float mv = mps[j] ? slopes[j]*LM_GGML_CPU_FP16_TO_FP32(mps[j][ic]) : 0.0f;
+                    if (mv == -INFINITY) {
+                        KQ[j*BK + c] = -INFINITY;
+                        continue;
+                    }
+
+                    float s; // KQ value
+
+                    kq_vec_dot(DK, &s, 0, k_data, 0, Q_q + j*q_row_size, 0, 1);
 
-            if (logit_softcap != 0.0f) {
-                s = logit_softcap*tanhf(s);
+                    s = s*scale; // scale KQ value
+
+                    if (logit_softcap != 0.0f) {
+                        s = logit_softcap*tanhf(s);
+                    }
+
+                    KQ[j*BK + c] = s + mv; // apply mask
+                }
             }
 
-            s += mv; // apply mask
+            // update the maximum once per block and turn the KQ values into expf(s - M)
+            bool any = false;
 
-            const float Mold = M;
+            for (int64_t j = 0; j < nq; ++j) {
+                float * kq = KQ + j*BK;
 
-            float ms = 1.0f; // upon new higher max val, scale VKQ and KQ sum with this value
-            float vs = 1.0f; // post-softmax KQ value, expf(s - M)
+                float Mb = -INFINITY;
+                for (int64_t c = 0; c < nb; ++c) {
+                    Mb = MAX(Mb, kq[c]);
+                }
+
+                if (Mb == -INFINITY) {
+                    // the whole block is masked for this row
+                    memset(kq, 0, nb*sizeof(float));
+                    continue;
+                }
 
-            const char * v_data = ((const char *) v->data + (ic*nbv1 + iv2*nbv2 + iv3*nbv3));
+                if (Mb > M[j]) {
+                    // new maximum, V = V*expf(Mold - M)
+                    const float ms = expf(M[j] - Mb);
 
-            if (v->type == LM_GGML_TYPE_F16) {
-                if (s > M) {
-                    // s is new maximum, ms < 1.0f, vs == expf(s - s) == 1.0f
-                    M = s;
-                    ms = expf(Mold - M);
+                    M[j]  = Mb;
+                    S[j] *= ms;
 
-                    // V = V*expf(Mold - M)
-                    lm_ggml_vec_scale_f16(DV, VKQ16, ms);
-                } else {
-                    // no new maximum, ms == 1.0f, vs != 1.0f
-                    vs = expf(s - M);
+                    lm_ggml_vec_scale_f32(DV, VKQ + j*DV, ms);
                 }
 
-                // V += v*expf(s - M)
-                lm_ggml_vec_mad_f16(DV, VKQ16, (const lm_ggml_fp16_t *) v_data, vs);
-            } else {
-                if (s > M) {
-                    // s is new maximum, ms < 1.0f, vs == expf(s - s) == 1.0f
-                    M = s;
-                    ms = expf(Mold - M);
+                float sum = 0.0f;
+                for (int64_t c = 0; c < nb; ++c) {
+                    kq[c] = expf(kq[c] - M[j]);
+                    sum += kq[c];
+                }
 
-                    // V = V*expf(Mold - M)
-                    lm_ggml_vec_scale_f32(DV, VKQ32, ms);
-                } else {
-                    // no new maximum, ms == 1.0f, vs != 1.0f
-                    vs = expf(s - M);
+                S[j] += sum;
+
+                any = true;
+            }
+
+            if (!any) {
+                continue;
+            }
+
+            // V += v*expf(s - M), each V row is converted to FP32 once for all the rows of the tile
+            for (int64_t c = 0; c < nb; ++c) {
+                int64_t j = 0;
+                while (j < nq && KQ[j*BK + c] == 0.0f) {
+                    ++j;
                 }
 
-                // V += v*expf(s - M)
-                if (v_to_float) {
-                    v_to_float(v_data, V32, DV);
-                    lm_ggml_vec_mad_f32(DV, VKQ32, V32, vs);
+                if (j == nq) {
+                    continue;
+                }
+
+                const int64_t ic = ib + c;
+
+                const char * v_data = (const char *) v->data + (ic*nbv1 + iv2*nbv2 + iv3*nbv3);
+
+                const float * v32;
+
+                if (v->type == LM_GGML_TYPE_F32) {
+                    v32 = (const float *) v_data;
+                } else if (v->type == LM_GGML_TYPE_F16) {
+                    lm_ggml_cpu_fp16_to_fp32((const lm_ggml_fp16_t *) v_data, V32, DV);
+                    v32 = V32;
                 } else {
-                    // V is F32
-                    lm_ggml_vec_mad_f32(DV, VKQ32, (const float *) v_data, vs);
+                    v_to_float(v_data, V32, DV);
+                    v32 = V32;
                 }
-            }
 
-            S = S*ms + vs; // scale and increment sum with partial sum
+                for (; j < nq; ++j) {
+                    const float vs = KQ[j*BK + c];
+                    if (vs != 0.0f) {
+                        lm_ggml_vec_mad_f32(DV, VKQ + j*DV, v32, vs);
+                    }
+                }
+            }
         }
 
-        if (v->type == LM_GGML_TYPE_F16) {
-            for (int64_t d = 0; d < DV; ++d) {
-                VKQ32[d] = LM_GGML_CPU_FP16_TO_FP32(VKQ16[d]);
+        for (int64_t j = 0; j < nq; ++j) {
+            const int64_t i1 = iq1s[j];
+            const int64_t i2 = iq2s[j];
+            const int64_t i3 = iq3;
+
+            if (n_split > 1) {
+                float * pp = part + (((i3*neq2 + i2)*neq1 + i1)*n_split + is)*(2 + DV);
+
+                pp[0] = M[j];
+                pp[1] = S[j];
+
+                memcpy(pp + 2, VKQ + j*DV, DV*sizeof(float));
+
+                continue;
             }
+
+            // V /= S
+            const float S_inv = S[j] == 0.0f ? 0.0f : 1.0f/S[j];
+            lm_ggml_vec_scale_f32(DV, VKQ + j*DV, S_inv);
+
+            // original
+            //memcpy((char *) dst->data + (i1*nb1 + i2*nb2 + i3*nb3), V, nev0*sizeof(float));
+
+            // permute(0, 2, 1, 3)
+            memcpy((char *) dst->data + (i3*ne2*ne1 + i2 + i1*ne1)*nb1, VKQ + j*DV, nb1);
         }
+    }
 
-        // V /= S
-        const float S_inv = 1.0f/S;
-        lm_ggml_vec_scale_f32(DV, VKQ32, S_inv);
+    if (n_split == 1) {
+        return;
+    }
 
-        // dst indices
-        const int i1 = iq1;
-        const int i2 = iq2;
-        const int i3 = iq3;
+    lm_ggml_barrier(params->threadpool);
+
+    // merge the partial results of the KV chunks
 
-        // original
-        //memcpy((char *) dst->data + (i1*nb1 + i2*nb2 + i3*nb3), V, nev0*sizeof(float));
+    // total rows in q
+    const int64_t nr = neq1*neq2*neq3;
+
+    // row range for this thread
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
+
+    for (int64_t ir = ir0; ir < ir1; ++ir) {
+        // q indices
+        const int64_t iq3 = ir/(neq2*neq1);
+        const int64_t iq2 = (ir - iq3*neq2*neq1)/neq1;
+        const int64_t iq1 = (ir - iq3*neq2*neq1 - iq2*neq1);
+
+        const float * pp = part + ir*n_split*(2 + DV);
+
+        float Mx = -INFINITY;
+        for (int64_t is = 0; is < n_split; ++is) {
+            Mx = MAX(Mx, pp[is*(2 + DV)]);
+        }
+
+        float * out = (float *) ((char *) dst->data + (iq3*ne2*ne1 + iq2 + iq1*ne1)*nb1);
+
+        memset(out, 0, DV*sizeof(float));
+
+        float Sx = 0.0f;
+
+        for (int64_t is = 0; is < n_split; ++is) {
+            const float * ps = pp + is*(2 + DV);
+
+            if (ps[0] == -INFINITY) {
+                // all KV rows of the chunk were masked
+                continue;
+            }
 
-        // permute(0, 2, 1, 3)
-        memcpy((char *) dst->data + (i3*ne2*ne1 + i2 + i1*ne1)*nb1, VKQ32, nb1);
+            const float ms = expf(ps[0] - Mx);
+
+            Sx += ps[1]*ms;
+
+            lm_ggml_vec_mad_f32(DV, out, ps + 2, ms);
+        }
+
+        // V /= S
+        const float S_inv = Sx == 0.0f ? 0.0f : 1.0f/Sx;
+        lm_ggml_vec_scale_f32(DV, out, S_inv);
     }
 }
 
@@ -8251,7 +8308,6 @@ static void lm_ggml_compute_forward_flash_attn_back_f32(
     LM_GGML_TENSOR_LOCALS(size_t,  nb,  dst, nb)
 
     const int ith = params->ith;
-    const int nth = params->nth;
 
     const int64_t D = neq0;
     const int64_t N = neq1;
@@ -8322,12 +8378,10 @@ static void lm_ggml_compute_forward_flash_attn_back_f32(
     // total rows in k
     const int nr = nek2*nek3;
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     const float scale = 1.0f/sqrtf(D);
 
@@ -8571,9 +8625,6 @@ static void lm_ggml_compute_forward_ssm_conv_f32(
     const lm_ggml_tensor * src0 = dst->src[0]; // conv_x
     const lm_ggml_tensor * src1 = dst->src[1]; // conv1d.weight
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nc  = src1->ne[0]; // d_conv
     const int ncs = src0->ne[0]; // d_conv - 1 + n_t
     const int nr  = src0->ne[1]; // d_inner
@@ -8585,12 +8636,10 @@ static void lm_ggml_compute_forward_ssm_conv_f32(
     LM_GGML_ASSERT(src1->nb[0] == sizeof(float));
     LM_GGML_ASSERT(src0->nb[1] == src0->ne[0]*sizeof(float));
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
     const int ir  = ir1 - ir0;
 
     for (int i3 = 0; i3 < n_s; ++i3) {
@@ -9095,6 +9144,38 @@ void lm_ggml_compute_forward_glu(
     }
 }
 
+// lm_ggml_compute_forward_silu_mul
+
+void lm_ggml_compute_forward_silu_mul(
+        const lm_ggml_compute_params * params,
+        const lm_ggml_tensor * silu,
+        lm_ggml_tensor * mul) {
+
+    const lm_ggml_tensor * src0 = silu->src[0];
+    const lm_ggml_tensor * gate = mul->src[0] == silu ? mul->src[1] : mul->src[0];
+
+    LM_GGML_ASSERT(src0->type == LM_GGML_TYPE_F32 && gate->type == LM_GGML_TYPE_F32 && mul->type == LM_GGML_TYPE_F32);
+    LM_GGML_ASSERT(lm_ggml_are_same_shape(src0, mul) && lm_ggml_are_same_shape(gate, mul));
+    LM_GGML_ASSERT(src0->nb[0] == sizeof(float) && gate->nb[0] == sizeof(float) && mul->nb[0] == sizeof(float));
+
+    const int64_t nc = mul->ne[0];
+    const int64_t nr = lm_ggml_nrows(mul);
+
+    for (int64_t ir0 = 0, ir1 = 0; lm_ggml_cpu_rows_next(params, nr, &ir0, &ir1); ) {
+        for (int64_t ir = ir0; ir < ir1; ++ir) {
+            const int64_t i3 = ir/(mul->ne[2]*mul->ne[1]);
+            const int64_t i2 = (ir - i3*mul->ne[2]*mul->ne[1])/mul->ne[1];
+            const int64_t i1 = (ir - i3*mul->ne[2]*mul->ne[1] - i2*mul->ne[1]);
+
+            const float * x = (const float *) ((const char *) src0->data + i1*src0->nb[1] + i2*src0->nb[2] + i3*src0->nb[3]);
+            const float * g = (const float *) ((const char *) gate->data + i1*gate->nb[1] + i2*gate->nb[2] + i3*gate->nb[3]);
+                  float * y = (float *) ((char *) mul->data + i1*mul->nb[1] + i2*mul->nb[2] + i3*mul->nb[3]);
+
+            lm_ggml_vec_swiglu_f32(nc, y, x, g);
+        }
+    }
+}
+
 // lm_ggml_compute_forward_get_rel_pos
 
 static void lm_ggml_compute_forward_get_rel_pos_f16(
@@ -9952,12 +10033,10 @@ static void lm_ggml_compute_forward_cross_entropy_loss_f32(
 
     LM_GGML_ASSERT(params->wsize >= sizeof(float) * (nth + nth * nc));
 
-    // rows per thread
-    const int64_t dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int64_t ir0 = dr*ith;
-    const int64_t ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     for (int64_t i1 = ir0; i1 < ir1; ++i1) {
         const float * s0 = (const float *)((const char *) src0->data + i1*src0->nb[1]);
@@ -10034,19 +10113,14 @@ static void lm_ggml_compute_forward_cross_entropy_loss_back_f32(
     LM_GGML_ASSERT(lm_ggml_is_contiguous(grad));
     LM_GGML_ASSERT(lm_ggml_are_same_shape(src0f, src1f) && lm_ggml_are_same_shape(src0f, dst));
 
-    const int64_t ith = params->ith;
-    const int64_t nth = params->nth;
-
     // TODO: handle transposed/permuted matrices
     const int64_t nc = src0f->ne[0];
     const int64_t nr = lm_ggml_nrows(src0f);
 
-    // rows per thread
-    const int64_t dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int64_t ir0 = dr*ith;
-    const int64_t ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     const float d_by_nr = ((const float *) grad->data)[0] / (float) nr;
 
@@ -10116,20 +10190,15 @@ static void lm_ggml_compute_forward_opt_step_adamw_f32(
     LM_GGML_ASSERT(lm_ggml_are_same_shape(src0, src0_grad_v));
     LM_GGML_ASSERT(lm_ggml_nelements(adamw_params) == 7);
 
-    const int ith = params->ith;
-    const int nth = params->nth;
-
     const int nr  = lm_ggml_nrows(src0);
 
     LM_GGML_TENSOR_UNARY_OP_LOCALS
     LM_GGML_ASSERT(nb00 == sizeof(float));
 
-    // rows per thread
-    const int dr = (nr + nth - 1)/nth;
-
     // row range for this thread
-    const int ir0 = dr*ith;
-    const int ir1 = MIN(ir0 + dr, nr);
+    int64_t ir0;
+    int64_t ir1;
+    lm_ggml_cpu_thread_range(params, nr, &ir0, &ir1);
 
     const float * adamw_params_ptr = lm_ggml_get_data_f32(adamw_params);
     const float alpha  = adamw_params_ptr[0];
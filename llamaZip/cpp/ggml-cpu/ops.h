@@ -23,6 +23,10 @@ static const size_t CACHE_LINE_SIZE_F32 = CACHE_LINE_SIZE/sizeof(float);
 // Work buffer size for im2col operations in CONV2D
 #define LM_GGML_IM2COL_WORK_SIZE (16 * 1024 * 1024)
 
+// Tile sizes of the flash attention kernel: q rows and KV rows processed together
+#define LM_GGML_FA_TILE_Q  8
+#define LM_GGML_FA_TILE_KV 64
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -113,6 +117,11 @@ void lm_ggml_compute_forward_cross_entropy_loss_back(const struct lm_ggml_comput
 void lm_ggml_compute_forward_opt_step_adamw(const struct lm_ggml_compute_params * params, struct lm_ggml_tensor * dst);
 void lm_ggml_compute_forward_mul_mat(const struct lm_ggml_compute_params * params, struct lm_ggml_tensor * dst);
 
+// fused ops, see lm_ggml_graph_compute_thread
+void lm_ggml_compute_forward_rms_norm_mul(const struct lm_ggml_compute_params * params, const struct lm_ggml_tensor * norm, struct lm_ggml_tensor * mul);
+void lm_ggml_compute_forward_add_rms_norm(const struct lm_ggml_compute_params * params, struct lm_ggml_tensor * add, struct lm_ggml_tensor * add_row, struct lm_ggml_tensor * norm, struct lm_ggml_tensor * mul);
+void lm_ggml_compute_forward_silu_mul(const struct lm_ggml_compute_params * params, const struct lm_ggml_tensor * silu, struct lm_ggml_tensor * mul);
+
 #ifdef __cplusplus
 }
 #endif
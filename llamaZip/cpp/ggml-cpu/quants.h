@@ -5,6 +5,8 @@
 
 #include "ggml.h"
 
+#include "arch-variant.h"
+
 // GGML CPU internal header
 
 #ifdef __cplusplus
@@ -58,6 +60,18 @@ void lm_ggml_vec_dot_iq4_nl_q8_0 (int n, float * LM_GGML_RESTRICT s, size_t bs,
 void lm_ggml_vec_dot_iq4_xs_q8_K (int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, size_t bx, const void * LM_GGML_RESTRICT vy, size_t by, int nrc);
 void lm_ggml_vec_dot_iq3_s_q8_K  (int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, size_t bx, const void * LM_GGML_RESTRICT vy, size_t by, int nrc);
 
+// Dot products of one row with a few columns at once, for mul_mat with 2 to LM_GGML_VEC_DOT_COLS_MAX columns
+// the row is loaded and unpacked once per block and reused for every column
+#define LM_GGML_VEC_DOT_COLS_MAX 8
+
+#if defined(__AVX2__) || defined(__ARM_NEON)
+#define LM_GGML_CPU_HAS_VEC_DOT_COLS
+void lm_ggml_vec_dot_cols_q4_0_q8_0(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc);
+void lm_ggml_vec_dot_cols_q8_0_q8_0(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc);
+void lm_ggml_vec_dot_cols_q4_K_q8_K(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc);
+void lm_ggml_vec_dot_cols_q6_K_q8_K(int n, float * LM_GGML_RESTRICT s, const void * LM_GGML_RESTRICT vx, const void * LM_GGML_RESTRICT vy, size_t by, int nc);
+#endif
+
 // Generic implementation
 void quantize_row_q8_0_generic(const float * LM_GGML_RESTRICT x, void * LM_GGML_RESTRICT vy, int64_t k);
 void quantize_row_q8_1_generic(const float * LM_GGML_RESTRICT x, void * LM_GGML_RESTRICT vy, int64_t k);
@@ -84,6 +98,12 @@ void lm_ggml_vec_dot_iq1_m_q8_K_generic(int n, float * LM_GGML_RESTRICT s, size_
 void lm_ggml_vec_dot_iq4_nl_q8_0_generic(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, size_t bx, const void * LM_GGML_RESTRICT vy, size_t by, int nrc);
 void lm_ggml_vec_dot_iq4_xs_q8_K_generic(int n, float * LM_GGML_RESTRICT s, size_t bs, const void * LM_GGML_RESTRICT vx, size_t bx, const void * LM_GGML_RESTRICT vy, size_t by, int nrc);
 
+#if defined(LM_GGML_CPU_VARIANT)
+// install the kernels of this variant into the CPU type traits
+struct lm_ggml_type_traits_cpu;
+void lm_ggml_cpu_variant_quants(struct lm_ggml_type_traits_cpu * traits);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -514,6 +514,8 @@ static inline bool lm_ggml_node_has_n_uses(const struct lm_ggml_cgraph * cgraph,
 // - all nodes except the last have only one use and are not views/outputs (see lm_ggml_node_has_N_uses).
 // - all nodes except the last are a src of the following node.
 // - all nodes are the same shape.
+// note: a view created with lm_ggml_view_tensor has no src, so it is not counted as a use of its view_src. backends
+//       that do not write the intermediate results have to check that no tensor of the graph views them
 // TODO: Consider allowing LM_GGML_OP_NONE nodes in between
 static inline bool lm_ggml_can_fuse(const struct lm_ggml_cgraph * cgraph, int node_idx, const enum lm_ggml_op * ops, int num_ops) {
     if (node_idx + num_ops > cgraph->n_nodes) {
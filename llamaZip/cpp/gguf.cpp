@@ -13,8 +13,23 @@
 #include <new>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#    include <io.h>
+#else
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
 template <typename T>
 struct type_to_lm_gguf_type;
 
@@ -946,6 +961,482 @@ size_t lm_gguf_get_tensor_size(const struct lm_gguf_context * ctx, int64_t tenso
     return lm_ggml_nbytes(&ctx->info[tensor_id].t);
 }
 
+// lm_gguf_view
+
+struct lm_gguf_view_kv {
+    const char * key;
+    size_t       key_len;
+
+    enum lm_gguf_type type;      // LM_GGUF_TYPE_ARRAY for arrays
+    enum lm_gguf_type arr_type;
+    uint64_t       n;         // number of array elements, 1 for scalars
+
+    const uint8_t * data;     // first value, for strings the uint64 length before the characters
+    size_t          str_first; // for arrays of strings, index of the first element in lm_gguf_view::strs
+};
+
+struct lm_gguf_view_tensor_info {
+    const char * name;
+    size_t       name_len;
+
+    enum lm_ggml_type type;
+    int64_t        ne[LM_GGML_MAX_DIMS];
+    size_t         size;
+    uint64_t       offset;
+};
+
+struct lm_gguf_view {
+    void * addr = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE hmapping = NULL;
+#endif
+
+    uint32_t version   = 0;
+    size_t   alignment = LM_GGUF_DEFAULT_ALIGNMENT;
+    size_t   offset    = 0; // offset of the tensor data from beginning of file
+
+    std::vector<lm_gguf_view_kv>          kv;
+    std::vector<lm_gguf_view_tensor_info> info;
+
+    // start of each element of the indexed arrays of strings (the uint64 length)
+    std::vector<const uint8_t *> strs;
+
+    ~lm_gguf_view() {
+#ifdef _WIN32
+        if (addr) {
+            UnmapViewOfFile(addr);
+        }
+        if (hmapping) {
+            CloseHandle(hmapping);
+        }
+#else
+        if (addr) {
+            munmap(addr, size);
+        }
+#endif
+    }
+};
+
+// bounds-checked cursor over the mapping, reads are unaligned
+struct lm_gguf_view_reader {
+    const uint8_t * cur;
+    const uint8_t * end;
+
+    template <typename T>
+    bool read(T & dst) {
+        if (size_t(end - cur) < sizeof(dst)) {
+            return false;
+        }
+        memcpy(&dst, cur, sizeof(dst));
+        cur += sizeof(dst);
+        return true;
+    }
+
+    bool read(enum lm_gguf_type & dst) {
+        int32_t tmp = -1;
+        if (!read(tmp)) {
+            return false;
+        }
+        dst = lm_gguf_type(tmp);
+        return true;
+    }
+
+    bool read_str(const char ** str, size_t * len) {
+        uint64_t n = 0;
+        if (!read(n) || n > uint64_t(end - cur)) {
+            return false;
+        }
+        *str = (const char *) cur;
+        *len = n;
+        cur += n;
+        return true;
+    }
+
+    bool skip(uint64_t n, size_t size) {
+        if (size != 0 && n > uint64_t(end - cur)/size) {
+            return false;
+        }
+        cur += n*size;
+        return true;
+    }
+};
+
+static bool lm_gguf_view_key_selected(const char * key, size_t len, const char * const * keys, size_t n_keys) {
+    if (keys == nullptr) {
+        return true;
+    }
+    for (size_t i = 0; i < n_keys; ++i) {
+        if (strlen(keys[i]) == len && memcmp(keys[i], key, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool lm_gguf_view_map(struct lm_gguf_view * view, const char * fname) {
+    FILE * file = lm_ggml_fopen(fname, "rb");
+    if (!file) {
+        LM_GGML_LOG_ERROR("%s: failed to open GGUF file '%s'\n", __func__, fname);
+        return false;
+    }
+
+    bool ok = false;
+#ifdef _WIN32
+    HANDLE hfile = (HANDLE) _get_osfhandle(_fileno(file));
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx(hfile, &file_size) && file_size.QuadPart > 0 && uint64_t(file_size.QuadPart) <= SIZE_MAX) {
+        view->size = file_size.QuadPart;
+        view->hmapping = CreateFileMappingA(hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (view->hmapping) {
+            view->addr = MapViewOfFile(view->hmapping, FILE_MAP_READ, 0, 0, 0);
+            ok = view->addr != NULL;
+        }
+    }
+#else
+    struct stat st;
+    if (fstat(fileno(file), &st) == 0 && st.st_size > 0 && uint64_t(st.st_size) <= SIZE_MAX) {
+        view->size = st.st_size;
+        void * addr = mmap(NULL, view->size, PROT_READ, MAP_SHARED, fileno(file), 0);
+        if (addr != MAP_FAILED) {
+            view->addr = addr;
+            ok = true;
+        }
+    }
+#endif
+    fclose(file);
+
+    if (!ok) {
+        LM_GGML_LOG_ERROR("%s: failed to map GGUF file '%s'\n", __func__, fname);
+    }
+    return ok;
+}
+
+struct lm_gguf_view * lm_gguf_view_init_from_file(const char * fname, const char * const * keys, size_t n_keys) {
+    struct lm_gguf_view * view = new lm_gguf_view;
+
+    if (!lm_gguf_view_map(view, fname)) {
+        delete view;
+        return nullptr;
+    }
+
+    lm_gguf_view_reader gr = { (const uint8_t *) view->addr, (const uint8_t *) view->addr + view->size };
+
+    bool ok = true;
+
+    // file magic and header
+    int64_t n_kv      = 0;
+    int64_t n_tensors = 0;
+
+    char magic[4];
+    ok = ok && gr.read(magic) && memcmp(magic, LM_GGUF_MAGIC, sizeof(magic)) == 0;
+    if (!ok) {
+        LM_GGML_LOG_ERROR("%s: '%s' is not a GGUF file\n", __func__, fname);
+        delete view;
+        return nullptr;
+    }
+
+    ok = ok && gr.read(view->version) && gr.read(n_tensors) && gr.read(n_kv);
+    if (ok && (view->version < 2 || view->version > LM_GGUF_VERSION)) {
+        LM_GGML_LOG_ERROR("%s: unsupported GGUF version %" PRIu32 "\n", __func__, view->version);
+        ok = false;
+    }
+    // every KV pair and tensor info takes at least 8 bytes in the file
+    if (ok && (n_tensors < 0 || n_kv < 0 || uint64_t(n_tensors) + uint64_t(n_kv) > view->size/8)) {
+        LM_GGML_LOG_ERROR("%s: invalid number of tensors (%" PRIi64 ") or key value pairs (%" PRIi64 ")\n", __func__, n_tensors, n_kv);
+        ok = false;
+    }
+    if (!ok) {
+        LM_GGML_LOG_ERROR("%s: failed to read header\n", __func__);
+        delete view;
+        return nullptr;
+    }
+
+    // KV pairs
+    {
+        uint32_t alignment = LM_GGUF_DEFAULT_ALIGNMENT;
+
+        for (int64_t i = 0; ok && i < n_kv; ++i) {
+            lm_gguf_view_kv kv = {};
+            kv.n = 1;
+
+            ok = ok && gr.read_str(&kv.key, &kv.key_len);
+            ok = ok && gr.read(kv.type);
+            if (ok && kv.type == LM_GGUF_TYPE_ARRAY) {
+                ok = ok && gr.read(kv.arr_type);
+                ok = ok && gr.read(kv.n);
+            } else {
+                kv.arr_type = kv.type;
+            }
+            if (!ok) {
+                break;
+            }
+            if (kv.arr_type < 0 || kv.arr_type >= LM_GGUF_TYPE_COUNT || kv.arr_type == LM_GGUF_TYPE_ARRAY) {
+                LM_GGML_LOG_ERROR("%s: key '%.*s' has invalid GGUF type %d\n", __func__, (int) kv.key_len, kv.key, kv.arr_type);
+                ok = false;
+                break;
+            }
+
+            const bool selected = lm_gguf_view_key_selected(kv.key, kv.key_len, keys, n_keys);
+            kv.data      = gr.cur;
+            kv.str_first = view->strs.size();
+
+            if (kv.arr_type == LM_GGUF_TYPE_STRING) {
+                for (uint64_t j = 0; ok && j < kv.n; ++j) {
+                    if (selected && kv.type == LM_GGUF_TYPE_ARRAY) {
+                        view->strs.push_back(gr.cur);
+                    }
+                    const char * str;
+                    size_t       len;
+                    ok = ok && gr.read_str(&str, &len);
+                }
+            } else {
+                ok = ok && gr.skip(kv.n, lm_gguf_type_size(kv.arr_type));
+            }
+            if (!ok) {
+                LM_GGML_LOG_ERROR("%s: value of key '%.*s' is out of bounds\n", __func__, (int) kv.key_len, kv.key);
+                break;
+            }
+
+            if (kv.key_len == strlen(LM_GGUF_KEY_GENERAL_ALIGNMENT) &&
+                memcmp(kv.key, LM_GGUF_KEY_GENERAL_ALIGNMENT, kv.key_len) == 0) {
+                if (kv.type != LM_GGUF_TYPE_UINT32) {
+                    LM_GGML_LOG_ERROR("%s: key '%s' has type %s, expected uint32\n", __func__, LM_GGUF_KEY_GENERAL_ALIGNMENT, lm_gguf_type_name(kv.type));
+                    ok = false;
+                    break;
+                }
+                memcpy(&alignment, kv.data, sizeof(alignment));
+            }
+
+            if (selected) {
+                for (size_t j = 0; ok && j < view->kv.size(); ++j) {
+                    if (view->kv[j].key_len == kv.key_len && memcmp(view->kv[j].key, kv.key, kv.key_len) == 0) {
+                        LM_GGML_LOG_ERROR("%s: duplicate key '%.*s'\n", __func__, (int) kv.key_len, kv.key);
+                        ok = false;
+                    }
+                }
+                view->kv.push_back(kv);
+            }
+        }
+
+        if (!ok) {
+            LM_GGML_LOG_ERROR("%s: failed to read key-value pairs\n", __func__);
+            delete view;
+            return nullptr;
+        }
+
+        view->alignment = alignment;
+        if (view->alignment == 0 || (view->alignment & (view->alignment - 1)) != 0) {
+            LM_GGML_LOG_ERROR("%s: alignment %zu is not a power of 2\n", __func__, view->alignment);
+            delete view;
+            return nullptr;
+        }
+    }
+
+    // tensor infos
+    view->info.resize(n_tensors);
+
+    size_t data_size = 0;
+    for (int64_t i = 0; ok && i < n_tensors; ++i) {
+        lm_gguf_view_tensor_info & info = view->info[i];
+
+        uint32_t n_dims = 0;
+        int32_t  type   = -1;
+
+        ok = ok && gr.read_str(&info.name, &info.name_len) && info.name_len < LM_GGML_MAX_NAME;
+        ok = ok && gr.read(n_dims) && n_dims <= LM_GGML_MAX_DIMS;
+        for (uint32_t j = 0; ok && j < LM_GGML_MAX_DIMS; ++j) {
+            info.ne[j] = 1;
+            if (j < n_dims) {
+                ok = ok && gr.read(info.ne[j]) && info.ne[j] >= 0;
+            }
+        }
+        ok = ok && gr.read(type) && type >= 0 && type < LM_GGML_TYPE_COUNT;
+        ok = ok && gr.read(info.offset);
+        if (!ok) {
+            LM_GGML_LOG_ERROR("%s: tensor info %" PRIi64 " is invalid\n", __func__, i);
+            break;
+        }
+        info.type = lm_ggml_type(type);
+
+        // same checks as lm_gguf_init_from_file_impl, the data of the tensors must be stored contiguously in order
+        const int64_t blck_size = lm_ggml_blck_size(info.type);
+        if (blck_size == 0 || info.ne[0] % blck_size != 0 ||
+            (INT64_MAX/info.ne[1] <= info.ne[0]) ||
+            (INT64_MAX/info.ne[2] <= info.ne[0]*info.ne[1]) ||
+            (INT64_MAX/info.ne[3] <= info.ne[0]*info.ne[1]*info.ne[2])) {
+            LM_GGML_LOG_ERROR("%s: tensor '%.*s' has an invalid shape for type %s\n", __func__, (int) info.name_len, info.name, lm_ggml_type_name(info.type));
+            ok = false;
+            break;
+        }
+        info.size = lm_ggml_row_size(info.type, info.ne[0])*info.ne[1]*info.ne[2]*info.ne[3];
+
+        if (info.offset != data_size) {
+            LM_GGML_LOG_ERROR("%s: tensor '%.*s' has offset %" PRIu64 ", expected %zu\n", __func__, (int) info.name_len, info.name, info.offset, data_size);
+            ok = false;
+            break;
+        }
+        const size_t padded_size = LM_GGML_PAD(info.size, view->alignment);
+        if (SIZE_MAX - data_size < padded_size) {
+            LM_GGML_LOG_ERROR("%s: tensor '%.*s' size overflow\n", __func__, (int) info.name_len, info.name);
+            ok = false;
+            break;
+        }
+        data_size += padded_size;
+    }
+
+    if (ok) {
+        std::unordered_set<std::string_view> names;
+        for (const auto & info : view->info) {
+            if (!names.emplace(info.name, info.name_len).second) {
+                LM_GGML_LOG_ERROR("%s: duplicate tensor name '%.*s'\n", __func__, (int) info.name_len, info.name);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    if (!ok) {
+        LM_GGML_LOG_ERROR("%s: failed to read tensor info\n", __func__);
+        delete view;
+        return nullptr;
+    }
+
+    // the data section starts at the next aligned offset, the last tensor does not need to be padded in the file
+    view->offset = LM_GGML_PAD(gr.cur - (const uint8_t *) view->addr, view->alignment);
+    const size_t data_end = n_tensors == 0 ? view->offset : view->offset + view->info.back().offset + view->info.back().size;
+    if (data_end > view->size || data_end < view->offset) {
+        LM_GGML_LOG_ERROR("%s: '%s' is truncated, the tensor data ends at %zu but the file size is %zu\n", __func__, fname, data_end, view->size);
+        delete view;
+        return nullptr;
+    }
+
+    return view;
+}
+
+void lm_gguf_view_free(struct lm_gguf_view * view) {
+    delete view;
+}
+
+uint32_t lm_gguf_view_get_version(const struct lm_gguf_view * view) {
+    return view->version;
+}
+
+size_t lm_gguf_view_get_alignment(const struct lm_gguf_view * view) {
+    return view->alignment;
+}
+
+size_t lm_gguf_view_get_data_offset(const struct lm_gguf_view * view) {
+    return view->offset;
+}
+
+int64_t lm_gguf_view_get_n_kv(const struct lm_gguf_view * view) {
+    return view->kv.size();
+}
+
+int64_t lm_gguf_view_find_key(const struct lm_gguf_view * view, const char * key) {
+    const size_t len = strlen(key);
+    for (size_t i = 0; i < view->kv.size(); ++i) {
+        if (view->kv[i].key_len == len && memcmp(view->kv[i].key, key, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char * lm_gguf_view_get_key(const struct lm_gguf_view * view, int64_t key_id, size_t * len) {
+    LM_GGML_ASSERT(key_id >= 0 && key_id < lm_gguf_view_get_n_kv(view));
+    *len = view->kv[key_id].key_len;
+    return view->kv[key_id].key;
+}
+
+enum lm_gguf_type lm_gguf_view_get_kv_type(const struct lm_gguf_view * view, int64_t key_id) {
+    LM_GGML_ASSERT(key_id >= 0 && key_id < lm_gguf_view_get_n_kv(view));
+    return view->kv[key_id].type;
+}
+
+enum lm_gguf_type lm_gguf_view_get_arr_type(const struct lm_gguf_view * view, int64_t key_id) {
+    LM_GGML_ASSERT(key_id >= 0 && key_id < lm_gguf_view_get_n_kv(view));
+    LM_GGML_ASSERT(view->kv[key_id].type == LM_GGUF_TYPE_ARRAY);
+    return view->kv[key_id].arr_type;
+}
+
+size_t lm_gguf_view_get_arr_n(const struct lm_gguf_view * view, int64_t key_id) {
+    LM_GGML_ASSERT(key_id >= 0 && key_id < lm_gguf_view_get_n_kv(view));
+    LM_GGML_ASSERT(view->kv[key_id].type == LM_GGUF_TYPE_ARRAY);
+    return view->kv[key_id].n;
+}
+
+const void * lm_gguf_view_get_val_data(const struct lm_gguf_view * view, int64_t key_id) {
+    LM_GGML_ASSERT(key_id >= 0 && key_id < lm_gguf_view_get_n_kv(view));
+    LM_GGML_ASSERT(view->kv[key_id].type != LM_GGUF_TYPE_ARRAY);
+    LM_GGML_ASSERT(view->kv[key_id].type != LM_GGUF_TYPE_STRING);
+    return view->kv[key_id].data;
+}
+
+const void * lm_gguf_view_get_arr_data(const struct lm_gguf_view * view, int64_t key_id) {
+    LM_GGML_ASSERT(key_id >= 0 && key_id < lm_gguf_view_get_n_kv(view));
+    LM_GGML_ASSERT(view->kv[key_id].type == LM_GGUF_TYPE_ARRAY);
+    LM_GGML_ASSERT(view->kv[key_id].arr_type != LM_GGUF_TYPE_STRING);
+    return view->kv[key_id].data;
+}
+
+static const char * lm_gguf_view_str_at(const uint8_t * data, size_t * len) {
+    uint64_t n;
+    memcpy(&n, data, sizeof(n));
+    *len = n;
+    return (const char *) data + sizeof(n);
+}
+
+const char * lm_gguf_view_get_val_str(const struct lm_gguf_view * view, int64_t key_id, size_t * len) {
+    LM_GGML_ASSERT(key_id >= 0 && key_id < lm_gguf_view_get_n_kv(view));
+    LM_GGML_ASSERT(view->kv[key_id].type == LM_GGUF_TYPE_STRING);
+    return lm_gguf_view_str_at(view->kv[key_id].data, len);
+}
+
+const char * lm_gguf_view_get_arr_str(const struct lm_gguf_view * view, int64_t key_id, size_t i, size_t * len) {
+    LM_GGML_ASSERT(key_id >= 0 && key_id < lm_gguf_view_get_n_kv(view));
+    const lm_gguf_view_kv & kv = view->kv[key_id];
+    LM_GGML_ASSERT(kv.type == LM_GGUF_TYPE_ARRAY && kv.arr_type == LM_GGUF_TYPE_STRING);
+    LM_GGML_ASSERT(i < kv.n);
+    return lm_gguf_view_str_at(view->strs[kv.str_first + i], len);
+}
+
+int64_t lm_gguf_view_get_n_tensors(const struct lm_gguf_view * view) {
+    return view->info.size();
+}
+
+int64_t lm_gguf_view_find_tensor(const struct lm_gguf_view * view, const char * name) {
+    const size_t len = strlen(name);
+    for (size_t i = 0; i < view->info.size(); ++i) {
+        if (view->info[i].name_len == len && memcmp(view->info[i].name, name, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+size_t lm_gguf_view_get_tensor_offset(const struct lm_gguf_view * view, int64_t tensor_id) {
+    LM_GGML_ASSERT(tensor_id >= 0 && tensor_id < lm_gguf_view_get_n_tensors(view));
+    return view->info[tensor_id].offset;
+}
+
+const char * lm_gguf_view_get_tensor_name(const struct lm_gguf_view * view, int64_t tensor_id, size_t * len) {
+    LM_GGML_ASSERT(tensor_id >= 0 && tensor_id < lm_gguf_view_get_n_tensors(view));
+    *len = view->info[tensor_id].name_len;
+    return view->info[tensor_id].name;
+}
+
+enum lm_ggml_type lm_gguf_view_get_tensor_type(const struct lm_gguf_view * view, int64_t tensor_id) {
+    LM_GGML_ASSERT(tensor_id >= 0 && tensor_id < lm_gguf_view_get_n_tensors(view));
+    return view->info[tensor_id].type;
+}
+
+size_t lm_gguf_view_get_tensor_size(const struct lm_gguf_view * view, int64_t tensor_id) {
+    LM_GGML_ASSERT(tensor_id >= 0 && tensor_id < lm_gguf_view_get_n_tensors(view));
+    return view->info[tensor_id].size;
+}
+
 int64_t lm_gguf_remove_key(struct lm_gguf_context * ctx, const char * key) {
     const int64_t key_id = lm_gguf_find_key(ctx, key);
     if (key_id >= 0) {
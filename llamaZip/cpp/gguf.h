@@ -125,6 +125,42 @@ extern "C" {
     LM_GGML_API enum lm_ggml_type lm_gguf_get_tensor_type  (const struct lm_gguf_context * ctx, int64_t tensor_id);
     LM_GGML_API size_t         lm_gguf_get_tensor_size  (const struct lm_gguf_context * ctx, int64_t tensor_id);
 
+    // read-only index of the meta data of a GGUF file, parsed in place from a memory mapping of the file
+    //   nothing is copied: keys, string values and tensor names point into the mapping and are NOT NUL-terminated,
+    //   their length is returned in *len; raw values may be unaligned and should be read with memcpy
+    // the header, the tensor infos and the data section bounds are validated like with lm_gguf_init_from_file
+    struct lm_gguf_view;
+
+    // if keys is not NULL, only the n_keys given keys are indexed and the other KV pairs are skipped without being decoded
+    LM_GGML_API struct lm_gguf_view * lm_gguf_view_init_from_file(const char * fname, const char * const * keys, size_t n_keys);
+    LM_GGML_API void                  lm_gguf_view_free(struct lm_gguf_view * view);
+
+    LM_GGML_API uint32_t lm_gguf_view_get_version    (const struct lm_gguf_view * view);
+    LM_GGML_API size_t   lm_gguf_view_get_alignment  (const struct lm_gguf_view * view);
+    LM_GGML_API size_t   lm_gguf_view_get_data_offset(const struct lm_gguf_view * view);
+
+    LM_GGML_API int64_t      lm_gguf_view_get_n_kv(const struct lm_gguf_view * view);
+    LM_GGML_API int64_t      lm_gguf_view_find_key(const struct lm_gguf_view * view, const char * key); // returns -1 if key is not found/indexed
+    LM_GGML_API const char * lm_gguf_view_get_key (const struct lm_gguf_view * view, int64_t key_id, size_t * len);
+
+    LM_GGML_API enum lm_gguf_type lm_gguf_view_get_kv_type (const struct lm_gguf_view * view, int64_t key_id);
+    LM_GGML_API enum lm_gguf_type lm_gguf_view_get_arr_type(const struct lm_gguf_view * view, int64_t key_id);
+    LM_GGML_API size_t         lm_gguf_view_get_arr_n   (const struct lm_gguf_view * view, int64_t key_id);
+
+    // raw little-endian value / first element of the array, will abort for strings and arrays of strings
+    LM_GGML_API const void * lm_gguf_view_get_val_data(const struct lm_gguf_view * view, int64_t key_id);
+    LM_GGML_API const void * lm_gguf_view_get_arr_data(const struct lm_gguf_view * view, int64_t key_id);
+
+    LM_GGML_API const char * lm_gguf_view_get_val_str(const struct lm_gguf_view * view, int64_t key_id, size_t * len);
+    LM_GGML_API const char * lm_gguf_view_get_arr_str(const struct lm_gguf_view * view, int64_t key_id, size_t i, size_t * len);
+
+    LM_GGML_API int64_t        lm_gguf_view_get_n_tensors    (const struct lm_gguf_view * view);
+    LM_GGML_API int64_t        lm_gguf_view_find_tensor      (const struct lm_gguf_view * view, const char * name); // returns -1 if the tensor is not found
+    LM_GGML_API size_t         lm_gguf_view_get_tensor_offset(const struct lm_gguf_view * view, int64_t tensor_id);
+    LM_GGML_API const char *   lm_gguf_view_get_tensor_name  (const struct lm_gguf_view * view, int64_t tensor_id, size_t * len);
+    LM_GGML_API enum lm_ggml_type lm_gguf_view_get_tensor_type  (const struct lm_gguf_view * view, int64_t tensor_id);
+    LM_GGML_API size_t         lm_gguf_view_get_tensor_size  (const struct lm_gguf_view * view, int64_t tensor_id);
+
     // removes key if it exists, returns id that the key had prior to removal (-1 if it didn't exist)
     LM_GGML_API int64_t lm_gguf_remove_key(struct lm_gguf_context * ctx, const char * key);
 
@@ -4,8 +4,10 @@
 #include "llama-mmap.h"
 #include "llama-model.h"
 
+#include <algorithm>
 #include <map>
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 
 // vec
@@ -21,6 +23,7 @@ lm_ggml_tensor * llama_adapter_cvec::tensor_for(int il) const {
 lm_ggml_tensor * llama_adapter_cvec::apply_to(lm_ggml_context * ctx, lm_ggml_tensor * cur, int  il) const {
     lm_ggml_tensor * layer_dir = tensor_for(il);
     if (layer_dir != nullptr) {
+        // the CPU backend fuses this into the residual add that produced cur
         cur = lm_ggml_add(ctx, cur, layer_dir);
     }
 
@@ -145,6 +148,45 @@ llama_adapter_lora_weight * llama_adapter_lora::get_weight(lm_ggml_tensor * w) {
     return nullptr;
 }
 
+lm_ggml_tensor * llama_adapter_lora::get_merged(const lm_ggml_tensor * w, float scale) const {
+    if (merged.empty() || scale != merged_scale) {
+        return nullptr;
+    }
+
+    const auto pos = merged.find(w);
+    if (pos != merged.end()) {
+        return pos->second;
+    }
+
+    return nullptr;
+}
+
+// get extra buffer types of the CPU
+// TODO: a more general solution for non-CPU extra buft should be imlpemented in the future
+//       ref: https://github.com/ggml-org/llama.cpp/pull/12593#pullrequestreview-2718659948
+static std::vector<lm_ggml_backend_buffer_type_t> llama_cpu_extra_bufts() {
+    std::vector<lm_ggml_backend_buffer_type_t> buft_extra;
+
+    auto * cpu_dev = lm_ggml_backend_dev_by_type(LM_GGML_BACKEND_DEVICE_TYPE_CPU);
+    if (!cpu_dev) {
+        throw std::runtime_error(format("%s: no CPU backend found", __func__));
+    }
+    auto * cpu_reg = lm_ggml_backend_dev_backend_reg(cpu_dev);
+
+    auto lm_ggml_backend_dev_get_extra_bufts_fn = (lm_ggml_backend_dev_get_extra_bufts_t)
+        lm_ggml_backend_reg_get_proc_address(cpu_reg, "lm_ggml_backend_dev_get_extra_bufts");
+
+    if (lm_ggml_backend_dev_get_extra_bufts_fn) {
+        lm_ggml_backend_buffer_type_t * extra_bufts = lm_ggml_backend_dev_get_extra_bufts_fn(cpu_dev);
+        while (extra_bufts && *extra_bufts) {
+            buft_extra.emplace_back(*extra_bufts);
+            ++extra_bufts;
+        }
+    }
+
+    return buft_extra;
+}
+
 static void llama_adapter_lora_init_impl(llama_model & model, const char * path_lora, llama_adapter_lora & adapter) {
     LLAMA_LOG_INFO("%s: loading lora adapter from '%s' ...\n", __func__, path_lora);
 
@@ -247,28 +289,7 @@ static void llama_adapter_lora_init_impl(llama_model & model, const char * path_
         }
     }
 
-    // get extra buffer types of the CPU
-    // TODO: a more general solution for non-CPU extra buft should be imlpemented in the future
-    //       ref: https://github.com/ggml-org/llama.cpp/pull/12593#pullrequestreview-2718659948
-    std::vector<lm_ggml_backend_buffer_type_t> buft_extra;
-    {
-        auto * cpu_dev = lm_ggml_backend_dev_by_type(LM_GGML_BACKEND_DEVICE_TYPE_CPU);
-        if (!cpu_dev) {
-            throw std::runtime_error(format("%s: no CPU backend found", __func__));
-        }
-        auto * cpu_reg = lm_ggml_backend_dev_backend_reg(cpu_dev);
-
-        auto lm_ggml_backend_dev_get_extra_bufts_fn = (lm_ggml_backend_dev_get_extra_bufts_t)
-            lm_ggml_backend_reg_get_proc_address(cpu_reg, "lm_ggml_backend_dev_get_extra_bufts");
-
-        if (lm_ggml_backend_dev_get_extra_bufts_fn) {
-            lm_ggml_backend_buffer_type_t * extra_bufts = lm_ggml_backend_dev_get_extra_bufts_fn(cpu_dev);
-            while (extra_bufts && *extra_bufts) {
-                buft_extra.emplace_back(*extra_bufts);
-                ++extra_bufts;
-            }
-        }
-    }
+    const std::vector<lm_ggml_backend_buffer_type_t> buft_extra = llama_cpu_extra_bufts();
 
     // add tensors
     for (auto & it : ab_map) {
@@ -386,3 +407,429 @@ llama_adapter_lora * llama_adapter_lora_init(llama_model * model, const char * p
 void llama_adapter_lora_free(llama_adapter_lora * adapter) {
     delete adapter;
 }
+
+// the merged weights are requantized without an importance matrix, so types that require one are left out
+static bool llama_adapter_lora_can_merge(lm_ggml_type type) {
+    switch (type) {
+        case LM_GGML_TYPE_F32:
+        case LM_GGML_TYPE_F16:
+        case LM_GGML_TYPE_BF16:
+        case LM_GGML_TYPE_Q4_0:
+        case LM_GGML_TYPE_Q4_1:
+        case LM_GGML_TYPE_Q5_0:
+        case LM_GGML_TYPE_Q5_1:
+        case LM_GGML_TYPE_Q8_0:
+        case LM_GGML_TYPE_Q2_K:
+        case LM_GGML_TYPE_Q3_K:
+        case LM_GGML_TYPE_Q4_K:
+        case LM_GGML_TYPE_Q5_K:
+        case LM_GGML_TYPE_Q6_K:
+        case LM_GGML_TYPE_IQ4_NL:
+        case LM_GGML_TYPE_IQ4_XS:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void llama_adapter_lora_to_float(lm_ggml_type type, const void * src, float * dst, int64_t n) {
+    if (type == LM_GGML_TYPE_F32) {
+        memcpy(dst, src, n*sizeof(float));
+        return;
+    }
+
+    const auto * traits = lm_ggml_get_type_traits(type);
+    if (!traits->to_float) {
+        throw std::runtime_error(format("cannot convert %s to f32", lm_ggml_type_name(type)));
+    }
+    traits->to_float(src, dst, n);
+}
+
+// computes w + scale*B*A into copy, a chunk of rows at a time so that the f32 working set stays small
+static void llama_adapter_lora_merge_weight(
+        lm_ggml_backend_t backend,
+        const lm_ggml_tensor * w,
+        const llama_adapter_lora_weight & lw,
+        float scale,
+        lm_ggml_tensor * copy) {
+    const int64_t n_in     = w->ne[0];
+    const int64_t n_out    = w->ne[1];
+    const int64_t rank     = lw.a->ne[1];
+    const size_t  row_size = lm_ggml_row_size(w->type, n_in);
+    const int64_t n_rows   = std::min<int64_t>(n_out, std::max<int64_t>(1, 4*1024*1024 / n_in));
+
+    std::vector<uint8_t> raw;
+    auto read_f32 = [&](const lm_ggml_tensor * t, std::vector<float> & dst) {
+        raw.resize(lm_ggml_nbytes(t));
+        lm_ggml_backend_tensor_get(t, raw.data(), 0, raw.size());
+        dst.resize(lm_ggml_nelements(t));
+        llama_adapter_lora_to_float(t->type, raw.data(), dst.data(), dst.size());
+    };
+
+    std::vector<float> a;
+    std::vector<float> b;
+    read_f32(lw.a, a);
+    read_f32(lw.b, b);
+
+    // A is [n_in, rank], the product needs it as [rank, n_in]
+    std::vector<float> a_t(a.size());
+    for (int64_t r = 0; r < rank; ++r) {
+        for (int64_t i = 0; i < n_in; ++i) {
+            a_t[i*rank + r] = a[r*n_in + i];
+        }
+    }
+
+    lm_ggml_init_params params = {
+        /*.mem_size   =*/ 8*lm_ggml_tensor_overhead() + lm_ggml_graph_overhead(),
+        /*.mem_buffer =*/ nullptr,
+        /*.no_alloc   =*/ true,
+    };
+    lm_ggml_context_ptr ctx { lm_ggml_init(params) };
+    if (!ctx) {
+        throw std::runtime_error("failed to create ggml context");
+    }
+
+    lm_ggml_tensor * t_a = lm_ggml_new_tensor_2d(ctx.get(), LM_GGML_TYPE_F32, rank, n_in);
+    lm_ggml_tensor * t_b = lm_ggml_new_tensor_2d(ctx.get(), LM_GGML_TYPE_F32, rank, n_rows);
+    lm_ggml_tensor * t_w = lm_ggml_new_tensor_2d(ctx.get(), LM_GGML_TYPE_F32, n_in, n_rows);
+
+    lm_ggml_tensor * t_delta = lm_ggml_scale(ctx.get(), lm_ggml_mul_mat(ctx.get(), t_a, t_b), scale);
+    lm_ggml_tensor * t_out   = lm_ggml_add_inplace(ctx.get(), t_w, t_delta);
+
+    lm_ggml_cgraph * gf = lm_ggml_new_graph(ctx.get());
+    lm_ggml_build_forward_expand(gf, t_out);
+
+    lm_ggml_backend_buffer_ptr buf { lm_ggml_backend_alloc_ctx_tensors(ctx.get(), backend) };
+    if (!buf) {
+        throw std::runtime_error("failed to allocate the merge buffer");
+    }
+
+    lm_ggml_backend_tensor_set(t_a, a_t.data(), 0, lm_ggml_nbytes(t_a));
+
+    raw.resize(n_rows*row_size);
+    for (int64_t i0 = 0; i0 < n_out; i0 += n_rows) {
+        const int64_t n = std::min(n_rows, n_out - i0);
+
+        lm_ggml_backend_tensor_get(w, raw.data(), i0*row_size, n*row_size);
+        llama_adapter_lora_to_float(w->type, raw.data(), (float *) t_w->data, n*n_in);
+        memcpy(t_b->data, b.data() + i0*rank, n*rank*sizeof(float));
+
+        if (lm_ggml_backend_graph_compute(backend, gf) != LM_GGML_STATUS_SUCCESS) {
+            throw std::runtime_error("failed to compute the merged weight");
+        }
+
+        lm_ggml_quantize_chunk(w->type, (const float *) t_w->data, raw.data(), 0, n, n_in, nullptr);
+        lm_ggml_backend_tensor_set(copy, raw.data(), i0*row_size, n*row_size);
+    }
+}
+
+static void llama_adapter_lora_merge_impl(const llama_model & model, llama_adapter_lora & adapter, float scale, int32_t n_threads) {
+    const std::vector<lm_ggml_backend_buffer_type_t> buft_extra = llama_cpu_extra_bufts();
+
+    // the copies are created in the buffer types of the base weights
+    std::map<lm_ggml_backend_buffer_type_t, lm_ggml_context *> ctx_map;
+    std::vector<lm_ggml_context_ptr> ctxs;
+    auto ctx_for_buft = [&](lm_ggml_backend_buffer_type_t buft) -> lm_ggml_context * {
+        auto it = ctx_map.find(buft);
+        if (it == ctx_map.end()) {
+            lm_ggml_init_params params = {
+                /*.mem_size   =*/ adapter.ab_map.size()*lm_ggml_tensor_overhead(),
+                /*.mem_buffer =*/ NULL,
+                /*.no_alloc   =*/ true,
+            };
+            lm_ggml_context * buft_ctx = lm_ggml_init(params);
+            if (!buft_ctx) {
+                return nullptr;
+            }
+            ctx_map[buft] = buft_ctx;
+            ctxs.emplace_back(buft_ctx);
+            return buft_ctx;
+        };
+        return it->second;
+    };
+
+    struct merge_item {
+        const lm_ggml_tensor * w;
+        const llama_adapter_lora_weight * lw;
+        lm_ggml_tensor * copy;
+    };
+    std::vector<merge_item> items;
+
+    for (const auto & it : adapter.ab_map) {
+        const lm_ggml_tensor * w = model.get_tensor(it.first.c_str());
+        if (!w || w == model.tok_embd || lm_ggml_n_dims(w) > 2) {
+            continue;
+        }
+
+        // repacked weights cannot be read back, those and the unsupported types keep the runtime path
+        auto * buft = lm_ggml_backend_buffer_get_type(w->buffer);
+        if (!llama_adapter_lora_can_merge(w->type) || std::find(buft_extra.begin(), buft_extra.end(), buft) != buft_extra.end()) {
+            LLAMA_LOG_DEBUG("%s: '%s' (%s, %s) is not merged\n", __func__, w->name, lm_ggml_type_name(w->type), lm_ggml_backend_buft_name(buft));
+            continue;
+        }
+
+        lm_ggml_context * ctx = ctx_for_buft(buft);
+        if (!ctx) {
+            throw std::runtime_error("failed to create ggml context");
+        }
+
+        lm_ggml_tensor * copy = lm_ggml_dup_tensor(ctx, w);
+        lm_ggml_set_name(copy, w->name);
+        items.push_back({ w, &it.second, copy });
+    }
+
+    if (items.empty()) {
+        throw std::runtime_error("none of the adapter weights can be merged");
+    }
+
+    std::vector<lm_ggml_backend_buffer_ptr> bufs;
+    for (auto & it : ctx_map) {
+        lm_ggml_backend_buffer_ptr buf { lm_ggml_backend_alloc_ctx_tensors_from_buft(it.second, it.first) };
+        if (!buf) {
+            throw std::runtime_error("failed to allocate buffer for merged lora weights");
+        }
+        lm_ggml_backend_buffer_set_usage(buf.get(), LM_GGML_BACKEND_BUFFER_USAGE_WEIGHTS);
+        LLAMA_LOG_INFO("%s: %10s merged LoRA buffer size = %8.2f MiB\n", __func__, lm_ggml_backend_buffer_name(buf.get()), lm_ggml_backend_buffer_get_size(buf.get())/1024.0/1024.0);
+        bufs.emplace_back(std::move(buf));
+    }
+
+    lm_ggml_backend_ptr backend { lm_ggml_backend_init_by_type(LM_GGML_BACKEND_DEVICE_TYPE_CPU, nullptr) };
+    if (!backend) {
+        throw std::runtime_error("failed to initialize the CPU backend");
+    }
+    if (n_threads > 0) {
+        auto * reg = lm_ggml_backend_dev_backend_reg(lm_ggml_backend_get_device(backend.get()));
+        auto * set_n_threads_fn = (lm_ggml_backend_set_n_threads_t) lm_ggml_backend_reg_get_proc_address(reg, "lm_ggml_backend_set_n_threads");
+        if (set_n_threads_fn) {
+            set_n_threads_fn(backend.get(), n_threads);
+        }
+    }
+
+    for (const auto & item : items) {
+        llama_adapter_lora_merge_weight(backend.get(), item.w, *item.lw, item.lw->get_scale(adapter.alpha, scale), item.copy);
+        adapter.merged[item.w] = item.copy;
+    }
+
+    adapter.merged_ctxs  = std::move(ctxs);
+    adapter.merged_bufs  = std::move(bufs);
+    adapter.merged_scale = scale;
+
+    LLAMA_LOG_INFO("%s: merged %zu of %zu lora weights\n", __func__, items.size(), adapter.ab_map.size());
+}
+
+int32_t llama_adapter_lora_merge(const llama_model * model, llama_adapter_lora * adapter, float scale, int32_t n_threads) {
+    if (!adapter->merged.empty()) {
+        if (adapter->merged_scale == scale) {
+            return 0;
+        }
+        LLAMA_LOG_ERROR("%s: adapter is already merged with scale %f\n", __func__, adapter->merged_scale);
+        return -1;
+    }
+
+    try {
+        llama_adapter_lora_merge_impl(*model, *adapter, scale, n_threads);
+    } catch (const std::exception & err) {
+        LLAMA_LOG_ERROR("%s: failed to merge lora adapter: %s\n", __func__, err.what());
+
+        adapter->merged.clear();
+        return -1;
+    }
+
+    return 0;
+}
+
+// lora_seq
+
+bool llama_adapter_lora_seq::set(const llama_model & model, llama_seq_id seq_id, llama_adapter_lora * adapter, float scale) {
+    auto routes_new = routes;
+    if (adapter == nullptr || scale == 0.0f) {
+        routes_new.erase(seq_id);
+    } else {
+        routes_new[seq_id] = { adapter, scale };
+    }
+
+    // the stacks are only rebuilt when a route needs a slot that does not exist yet, or freed when no route is left
+    bool rebuild = routes_new.empty() && !slots.empty();
+    for (const auto & it : routes_new) {
+        if (std::find(slots.begin(), slots.end(), it.second) == slots.end()) {
+            rebuild = true;
+            break;
+        }
+    }
+
+    if (rebuild) {
+        std::vector<std::pair<llama_adapter_lora *, float>> slots_new;
+        for (const auto & it : routes_new) {
+            if (std::find(slots_new.begin(), slots_new.end(), it.second) == slots_new.end()) {
+                slots_new.push_back(it.second);
+            }
+        }
+
+        try {
+            build(model, slots_new);
+        } catch (const std::exception & err) {
+            LLAMA_LOG_ERROR("%s: failed to route lora adapters: %s\n", __func__, err.what());
+            return false;
+        }
+    }
+
+    routes = std::move(routes_new);
+
+    return true;
+}
+
+int32_t llama_adapter_lora_seq::slot(llama_seq_id seq_id) const {
+    const auto it = routes.find(seq_id);
+    if (it == routes.end()) {
+        return 0;
+    }
+
+    const auto pos = std::find(slots.begin(), slots.end(), it->second);
+    LM_GGML_ASSERT(pos != slots.end());
+
+    return (int32_t) (pos - slots.begin()) + 1;
+}
+
+const llama_adapter_lora_seq::stack * llama_adapter_lora_seq::get_stack(const lm_ggml_tensor * w) const {
+    if (stacks.empty()) {
+        return nullptr;
+    }
+
+    const auto pos = stacks.find(w->name);
+    if (pos != stacks.end()) {
+        return &pos->second;
+    }
+
+    return nullptr;
+}
+
+void llama_adapter_lora_seq::build(const llama_model & model, const std::vector<std::pair<llama_adapter_lora *, float>> & slots_new) {
+    const int64_t n_slot = (int64_t) slots_new.size() + 1;
+
+    // the lora weights of each slot by base weight name, token embeddings and expert weights keep the
+    // per-context path, they are not computed with a matmul of the base weight
+    std::map<std::string, std::vector<const llama_adapter_lora_weight *>> weights;
+    for (size_t i = 0; i < slots_new.size(); ++i) {
+        for (const auto & it : slots_new[i].first->ab_map) {
+            const lm_ggml_tensor * w = model.get_tensor(it.first.c_str());
+            if (!w || w == model.tok_embd || lm_ggml_n_dims(w) > 2) {
+                continue;
+            }
+            auto & lws = weights[it.first];
+            lws.resize(slots_new.size(), nullptr);
+            lws[i] = &it.second;
+        }
+    }
+
+    // the stacks are placed next to the lora weights of the first adapter that has them
+    std::map<lm_ggml_backend_buffer_type_t, lm_ggml_context *> ctx_map;
+    std::vector<lm_ggml_context_ptr> ctxs_new;
+    auto ctx_for_buft = [&](lm_ggml_backend_buffer_type_t buft) -> lm_ggml_context * {
+        auto it = ctx_map.find(buft);
+        if (it == ctx_map.end()) {
+            lm_ggml_init_params params = {
+                /*.mem_size   =*/ 2*weights.size()*lm_ggml_tensor_overhead(),
+                /*.mem_buffer =*/ NULL,
+                /*.no_alloc   =*/ true,
+            };
+            lm_ggml_context * buft_ctx = lm_ggml_init(params);
+            if (!buft_ctx) {
+                throw std::runtime_error("failed to create ggml context");
+            }
+            ctx_map[buft] = buft_ctx;
+            ctxs_new.emplace_back(buft_ctx);
+            return buft_ctx;
+        };
+        return it->second;
+    };
+
+    std::unordered_map<std::string, stack> stacks_new;
+    for (const auto & it : weights) {
+        const llama_adapter_lora_weight * first = nullptr;
+        int64_t rank_max = 0;
+        for (const auto * lw : it.second) {
+            if (lw) {
+                first    = first ? first : lw;
+                rank_max = std::max(rank_max, lw->a->ne[1]);
+            }
+        }
+
+        lm_ggml_context * ctx = ctx_for_buft(lm_ggml_backend_buffer_get_type(first->a->buffer));
+
+        stack st;
+        st.a = lm_ggml_new_tensor_3d(ctx, LM_GGML_TYPE_F16, first->a->ne[0], rank_max, n_slot);
+        st.b = lm_ggml_new_tensor_3d(ctx, LM_GGML_TYPE_F16, rank_max, first->b->ne[1], n_slot);
+        lm_ggml_format_name(st.a, "%s.lora_a_seq", it.first.c_str());
+        lm_ggml_format_name(st.b, "%s.lora_b_seq", it.first.c_str());
+        stacks_new[it.first] = st;
+    }
+
+    std::vector<lm_ggml_backend_buffer_ptr> bufs_new;
+    for (auto & it : ctx_map) {
+        lm_ggml_backend_buffer_ptr buf { lm_ggml_backend_alloc_ctx_tensors_from_buft(it.second, it.first) };
+        if (!buf) {
+            throw std::runtime_error("failed to allocate buffer for routed lora adapters");
+        }
+        lm_ggml_backend_buffer_set_usage(buf.get(), LM_GGML_BACKEND_BUFFER_USAGE_WEIGHTS);
+        LLAMA_LOG_INFO("%s: %10s routed LoRA buffer size = %8.2f MiB\n", __func__, lm_ggml_backend_buffer_name(buf.get()), lm_ggml_backend_buffer_get_size(buf.get())/1024.0/1024.0);
+        bufs_new.emplace_back(std::move(buf));
+    }
+
+    // rank padding and the slots without the weight stay zero, B is scaled so that the graph does not need
+    // a scale per slot
+    std::vector<uint8_t> raw;
+    std::vector<float> lora_f32;
+    std::vector<float> a_f32;
+    std::vector<float> b_f32;
+    std::vector<lm_ggml_fp16_t> f16;
+    auto read_f32 = [&](const lm_ggml_tensor * t) {
+        raw.resize(lm_ggml_nbytes(t));
+        lm_ggml_backend_tensor_get(t, raw.data(), 0, raw.size());
+        lora_f32.resize(lm_ggml_nelements(t));
+        llama_adapter_lora_to_float(t->type, raw.data(), lora_f32.data(), lora_f32.size());
+    };
+
+    for (const auto & it : weights) {
+        const stack & st = stacks_new.at(it.first);
+        const int64_t n_in     = st.a->ne[0];
+        const int64_t rank_max = st.a->ne[1];
+        const int64_t n_out    = st.b->ne[1];
+
+        a_f32.assign(lm_ggml_nelements(st.a), 0.0f);
+        b_f32.assign(lm_ggml_nelements(st.b), 0.0f);
+
+        for (size_t i = 0; i < it.second.size(); ++i) {
+            const llama_adapter_lora_weight * lw = it.second[i];
+            if (!lw) {
+                continue;
+            }
+
+            const int64_t rank  = lw->a->ne[1];
+            const float   scale = lw->get_scale(slots_new[i].first->alpha, slots_new[i].second);
+
+            read_f32(lw->a);
+            memcpy(a_f32.data() + (i + 1)*n_in*rank_max, lora_f32.data(), n_in*rank*sizeof(float));
+
+            read_f32(lw->b);
+            float * b_slot = b_f32.data() + (i + 1)*rank_max*n_out;
+            for (int64_t o = 0; o < n_out; ++o) {
+                for (int64_t r = 0; r < rank; ++r) {
+                    b_slot[o*rank_max + r] = scale*lora_f32[o*rank + r];
+                }
+            }
+        }
+
+        f16.resize(a_f32.size());
+        lm_ggml_fp32_to_fp16_row(a_f32.data(), f16.data(), f16.size());
+        lm_ggml_backend_tensor_set(st.a, f16.data(), 0, lm_ggml_nbytes(st.a));
+
+        f16.resize(b_f32.size());
+        lm_ggml_fp32_to_fp16_row(b_f32.data(), f16.data(), f16.size());
+        lm_ggml_backend_tensor_set(st.b, f16.data(), 0, lm_ggml_nbytes(st.b));
+    }
+
+    slots  = slots_new;
+    stacks = std::move(stacks_new);
+    ctxs   = std::move(ctxs_new);
+    bufs   = std::move(bufs_new);
+}
@@ -4,6 +4,7 @@
 
 #include "ggml-cpp.h"
 
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -67,10 +68,59 @@ struct llama_adapter_lora {
 
     float alpha;
 
+    // copies of the base weights with the adapter merged in at merged_scale, see llama_adapter_lora_merge
+    // only the weights the adapter modifies are copied, the others stay shared with the model
+    std::unordered_map<const lm_ggml_tensor *, lm_ggml_tensor *> merged;
+
+    std::vector<lm_ggml_context_ptr> merged_ctxs;
+    std::vector<lm_ggml_backend_buffer_ptr> merged_bufs;
+
+    float merged_scale = 0.0f;
+
     llama_adapter_lora() = default;
     ~llama_adapter_lora() = default;
 
     llama_adapter_lora_weight * get_weight(lm_ggml_tensor * w);
+
+    // the merged copy of w if the adapter is applied with the scale it was merged at
+    lm_ggml_tensor * get_merged(const lm_ggml_tensor * w, float scale) const;
 };
 
 using llama_adapter_loras = std::unordered_map<llama_adapter_lora *, float>;
+
+//
+// llama_adapter_lora_seq
+//
+
+// adapters routed to single sequences, so that sequences using different adapters can share a batch
+// the A and B matrices of every routed adapter are stacked per weight, slot 0 is left zero for the tokens of
+// sequences without a route, and the graph picks the slot of each token with mul_mat_id
+struct llama_adapter_lora_seq {
+    struct stack {
+        lm_ggml_tensor * a = nullptr; // [n_in,  rank_max, n_slot]
+        lm_ggml_tensor * b = nullptr; // [rank_max, n_out, n_slot], scaled
+    };
+
+    // returns false if the slots could not be rebuilt, the previous routes are kept in that case
+    bool set(const llama_model & model, llama_seq_id seq_id, llama_adapter_lora * adapter, float scale);
+
+    // 0 if the sequence has no route
+    int32_t slot(llama_seq_id seq_id) const;
+
+    const stack * get_stack(const lm_ggml_tensor * w) const;
+
+    bool empty() const { return stacks.empty(); }
+
+private:
+    void build(const llama_model & model, const std::vector<std::pair<llama_adapter_lora *, float>> & slots_new);
+
+    std::map<llama_seq_id, std::pair<llama_adapter_lora *, float>> routes;
+
+    // slot i + 1 holds slots[i], slots of removed routes are only dropped when the stacks are rebuilt
+    std::vector<std::pair<llama_adapter_lora *, float>> slots;
+
+    std::unordered_map<std::string, stack> stacks; // by base weight name
+
+    std::vector<lm_ggml_context_ptr> ctxs;
+    std::vector<lm_ggml_backend_buffer_ptr> bufs;
+};
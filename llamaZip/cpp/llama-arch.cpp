@@ -176,6 +176,10 @@ static const std::map<llm_kv, const char *> LLM_KV_NAMES = {
     { LLM_KV_SPLIT_COUNT,         "split.count"         },
     { LLM_KV_SPLIT_TENSORS_COUNT, "split.tensors.count" },
 
+    { LLM_KV_COMPRESSION_CODEC,   "compression.codec"   },
+    { LLM_KV_COMPRESSION_OFFSETS, "compression.offsets" },
+    { LLM_KV_COMPRESSION_SIZES,   "compression.sizes"   },
+
     { LLM_KV_SSM_CONV_KERNEL,    "%s.ssm.conv_kernel"    },
     { LLM_KV_SSM_INNER_SIZE,     "%s.ssm.inner_size"     },
     { LLM_KV_SSM_STATE_SIZE,     "%s.ssm.state_size"     },
@@ -180,6 +180,10 @@ enum llm_kv {
     LLM_KV_SPLIT_COUNT,
     LLM_KV_SPLIT_TENSORS_COUNT,
 
+    LLM_KV_COMPRESSION_CODEC,
+    LLM_KV_COMPRESSION_OFFSETS,
+    LLM_KV_COMPRESSION_SIZES,
+
     LLM_KV_SSM_INNER_SIZE,
     LLM_KV_SSM_CONV_KERNEL,
     LLM_KV_SSM_STATE_SIZE,
@@ -3,6 +3,7 @@
 #include "llama-impl.h"
 #include "llama-batch.h"
 #include "llama-io.h"
+#include "llama-kv-cache-unified.h"
 #include "llama-memory.h"
 #include "llama-mmap.h"
 #include "llama-model.h"
@@ -12,6 +13,205 @@
 #include <limits>
 #include <stdexcept>
 
+//
+// warm start cache
+//
+// the compute buffer sizes measured with the worst-case graphs, stored in a GGUF file with one entry per configuration
+//
+
+static const uint32_t LLAMA_WARM_START_VERSION = 1;
+
+struct llama_warm_start_entry {
+    std::vector<size_t> buffer_sizes; // one per backend
+    int32_t n_nodes_pp;
+    int32_t n_nodes_tg;
+    int32_t n_splits_pp;
+    int32_t n_splits_tg;
+};
+
+// everything that shapes the reserved graphs: the model metadata and weights placement, and the context parameters
+static uint64_t llama_warm_start_key(const llama_model & model, const llama_cparams & cparams, const llama_context_params & params,
+        const std::vector<lm_ggml_backend_buffer_type_t> & backend_buft) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto update = [&hash](const void * data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= ((const uint8_t *) data)[i];
+            hash *= 0x100000001b3ULL;
+        }
+    };
+    auto update_str = [&update](const char * str) {
+        update(str, strlen(str) + 1);
+    };
+
+    // the tokenizer only matters through n_vocab, which is in the shape of the embeddings
+    std::vector<const std::pair<const std::string, std::string> *> kvs;
+    for (const auto & kv : model.lm_gguf_kv) {
+        if (kv.first.rfind("tokenizer.", 0) != 0) {
+            kvs.push_back(&kv);
+        }
+    }
+    std::sort(kvs.begin(), kvs.end(), [](const auto * a, const auto * b) { return a->first < b->first; });
+    for (const auto * kv : kvs) {
+        update_str(kv->first.c_str());
+        update_str(kv->second.c_str());
+    }
+
+    // the buffer type of each weight carries the offloading and the repacked types
+    for (const auto & it : model.tensors_by_name) {
+        const lm_ggml_tensor * t = it.second;
+        update_str(it.first.c_str());
+        update(&t->type, sizeof(t->type));
+        update(t->ne, sizeof(t->ne));
+        update_str(t->buffer ? lm_ggml_backend_buft_name(lm_ggml_backend_buffer_get_type(t->buffer)) : "");
+    }
+
+    for (auto * buft : backend_buft) {
+        update_str(lm_ggml_backend_buft_name(buft));
+    }
+
+    const uint32_t u32s[] = {
+        LLAMA_WARM_START_VERSION,
+        cparams.n_ctx, cparams.n_batch, cparams.n_ubatch, cparams.n_seq_max,
+        (uint32_t) cparams.pooling_type, (uint32_t) params.attention_type,
+        (uint32_t) params.type_k, (uint32_t) params.type_v,
+        params.n_rs_ckpt,
+    };
+    const bool flags[] = {
+        cparams.embeddings, cparams.causal_attn, cparams.offload_kqv, cparams.flash_attn, cparams.op_offload, cparams.kv_unified,
+        params.swa_full,
+    };
+    update(u32s, sizeof(u32s));
+    update(flags, sizeof(flags));
+
+    return hash;
+}
+
+static std::string llama_warm_start_prefix(uint64_t key) {
+    return format("warm_start.%016" PRIx64 ".", key);
+}
+
+// verbose = false only looks up the entry, without reporting why there is none
+static bool llama_warm_start_load(const char * path, uint64_t key, size_t n_backends, llama_warm_start_entry & entry, bool verbose = true) {
+    try {
+        llama_file file(path, "rb");
+    } catch (const std::exception &) {
+        if (verbose) {
+            LLAMA_LOG_INFO("%s: no warm start cache at %s, it will be created\n", __func__, path);
+        }
+        return false;
+    }
+
+    const std::string prefix      = llama_warm_start_prefix(key);
+    const std::string key_sizes   = prefix + "buffer_sizes";
+    const std::string key_stats   = prefix + "graph_stats";
+    const char * keys[] = { "warm_start.version", key_sizes.c_str(), key_stats.c_str() };
+
+    // only the entry of this configuration is indexed
+    struct lm_gguf_view * view = lm_gguf_view_init_from_file(path, keys, 3);
+    if (!view) {
+        LLAMA_LOG_WARN("%s: ignoring warm start cache %s: not a valid GGUF file\n", __func__, path);
+        return false;
+    }
+
+    bool ok = false;
+
+    const int64_t kid_version = lm_gguf_view_find_key(view, keys[0]);
+    const int64_t kid_sizes   = lm_gguf_view_find_key(view, keys[1]);
+    const int64_t kid_stats   = lm_gguf_view_find_key(view, keys[2]);
+
+    uint32_t version = 0;
+    if (kid_version >= 0 && lm_gguf_view_get_kv_type(view, kid_version) == LM_GGUF_TYPE_UINT32) {
+        memcpy(&version, lm_gguf_view_get_val_data(view, kid_version), sizeof(version));
+    }
+
+    if (version != LLAMA_WARM_START_VERSION) {
+        LLAMA_LOG_WARN("%s: ignoring warm start cache %s: unsupported version\n", __func__, path);
+    } else if (kid_sizes < 0 || kid_stats < 0) {
+        if (verbose) {
+            LLAMA_LOG_INFO("%s: no entry for this model and context configuration in %s, it will be added\n", __func__, path);
+        }
+    } else if (lm_gguf_view_get_kv_type (view, kid_sizes) == LM_GGUF_TYPE_ARRAY &&
+               lm_gguf_view_get_arr_type(view, kid_sizes) == LM_GGUF_TYPE_UINT64 &&
+               lm_gguf_view_get_arr_n   (view, kid_sizes) == n_backends &&
+               lm_gguf_view_get_kv_type (view, kid_stats) == LM_GGUF_TYPE_ARRAY &&
+               lm_gguf_view_get_arr_type(view, kid_stats) == LM_GGUF_TYPE_INT32 &&
+               lm_gguf_view_get_arr_n   (view, kid_stats) == 4) {
+        const uint8_t * sizes = (const uint8_t *) lm_gguf_view_get_arr_data(view, kid_sizes);
+        entry.buffer_sizes.resize(n_backends);
+        for (size_t i = 0; i < n_backends; ++i) {
+            uint64_t size;
+            memcpy(&size, sizes + i*sizeof(size), sizeof(size));
+            entry.buffer_sizes[i] = size;
+        }
+
+        int32_t stats[4];
+        memcpy(stats, lm_gguf_view_get_arr_data(view, kid_stats), sizeof(stats));
+        entry.n_nodes_pp  = stats[0];
+        entry.n_nodes_tg  = stats[1];
+        entry.n_splits_pp = stats[2];
+        entry.n_splits_tg = stats[3];
+
+        ok = true;
+    } else {
+        LLAMA_LOG_WARN("%s: ignoring warm start cache %s: invalid entry\n", __func__, path);
+    }
+
+    lm_gguf_view_free(view);
+
+    return ok;
+}
+
+static void llama_warm_start_save(const char * path, uint64_t key, const llama_warm_start_entry & entry) {
+    // add the entry to the existing ones, the entries of a different version are dropped
+    lm_gguf_context_ptr ctx;
+    try {
+        llama_file file(path, "rb");
+
+        lm_gguf_init_params params = {
+            /*.no_alloc = */ true,
+            /*.ctx      = */ nullptr,
+        };
+        ctx.reset(lm_gguf_init_from_file(path, params));
+
+        const int64_t kid_version = ctx ? lm_gguf_find_key(ctx.get(), "warm_start.version") : -1;
+        if (kid_version < 0 || lm_gguf_get_kv_type(ctx.get(), kid_version) != LM_GGUF_TYPE_UINT32 ||
+            lm_gguf_get_val_u32(ctx.get(), kid_version) != LLAMA_WARM_START_VERSION) {
+            ctx.reset();
+        }
+    } catch (const std::exception &) {
+        // no cache yet
+    }
+    if (!ctx) {
+        ctx.reset(lm_gguf_init_empty());
+        lm_gguf_set_val_u32(ctx.get(), "warm_start.version", LLAMA_WARM_START_VERSION);
+    }
+
+    const std::string prefix = llama_warm_start_prefix(key);
+
+    const std::vector<uint64_t> sizes(entry.buffer_sizes.begin(), entry.buffer_sizes.end());
+    const int32_t stats[4] = { entry.n_nodes_pp, entry.n_nodes_tg, entry.n_splits_pp, entry.n_splits_tg };
+
+    lm_gguf_set_arr_data(ctx.get(), (prefix + "buffer_sizes").c_str(), LM_GGUF_TYPE_UINT64, sizes.data(), sizes.size());
+    lm_gguf_set_arr_data(ctx.get(), (prefix + "graph_stats").c_str(),  LM_GGUF_TYPE_INT32,  stats, 4);
+
+    const std::string path_tmp = std::string(path) + ".tmp";
+
+    if (!lm_gguf_write_to_file(ctx.get(), path_tmp.c_str(), /*only_meta =*/ true)) {
+        LLAMA_LOG_WARN("%s: failed to write warm start cache %s\n", __func__, path_tmp.c_str());
+        std::remove(path_tmp.c_str());
+        return;
+    }
+
+    if (std::rename(path_tmp.c_str(), path) != 0) {
+        LLAMA_LOG_WARN("%s: failed to rename %s to %s\n", __func__, path_tmp.c_str(), path);
+        std::remove(path_tmp.c_str());
+        return;
+    }
+
+    LLAMA_LOG_INFO("%s: saved the compute buffer sizes to the warm start cache %s\n", __func__, path);
+}
+
 //
 // llama_context
 //
@@ -200,11 +400,19 @@ llama_context::llama_context(
     // init the memory module
     if (!hparams.vocab_only) {
         llama_memory_params params_mem = {
-            /*.type_k   =*/ params.type_k,
-            /*.type_v   =*/ params.type_v,
-            /*.swa_full =*/ params.swa_full,
+            /*.type_k           =*/ params.type_k,
+            /*.type_v           =*/ params.type_v,
+            /*.swa_full         =*/ params.swa_full,
+            /*.spill_path       =*/ params.kv_spill_path ? params.kv_spill_path : "",
+            /*.spill_sync       =*/ {},
+            /*.n_rs_ckpt        =*/ params.rs_ckpt_interval > 0 ? params.n_rs_ckpt : 0,
+            /*.rs_ckpt_interval =*/ params.rs_ckpt_interval,
         };
 
+        for (auto & backend : backends) {
+            params_mem.spill_sync.push_back(backend.get());
+        }
+
         memory.reset(model.create_memory(params_mem, cparams));
     }
 
@@ -289,46 +497,79 @@ llama_context::llama_context(
         int n_splits_tg = -1;
         int n_nodes_tg  = -1;
 
-        // simulate full KV cache
+        // a configuration that was reserved before can allocate the measured buffer sizes directly
+        const char * warm_start_cache = params.warm_start_cache && params.warm_start_cache[0] ? params.warm_start_cache : nullptr;
+        const uint64_t warm_start_key = warm_start_cache ? llama_warm_start_key(model, cparams, params, backend_buft) : 0;
 
-        const auto mctx = memory->init_full();
-        if (!mctx) {
-            throw std::runtime_error("failed to initialize KV cache");
+        llama_warm_start_entry entry;
+        if (warm_start_cache && llama_warm_start_load(warm_start_cache, warm_start_key, backend_ptrs.size(), entry)) {
+            if (lm_ggml_backend_sched_reserve_size(sched.get(), entry.buffer_sizes.data())) {
+                warm_start = true;
+
+                n_nodes_pp  = entry.n_nodes_pp;
+                n_nodes_tg  = entry.n_nodes_tg;
+                n_splits_pp = entry.n_splits_pp;
+                n_splits_tg = entry.n_splits_tg;
+
+                LLAMA_LOG_INFO("%s: compute buffers sized from the warm start cache, skipping the worst-case graph reservation\n", __func__);
+            }
         }
 
-        cross.v_embd.clear();
+        if (!warm_start) {
+            // simulate full KV cache
 
-        // reserve pp graph first so that buffers are only allocated once
-        {
-            auto * gf = graph_reserve(n_tokens, n_seqs, n_tokens, mctx.get());
-            if (!gf) {
-                throw std::runtime_error("failed to allocate compute pp buffers");
+            const auto mctx = memory->init_full();
+            if (!mctx) {
+                throw std::runtime_error("failed to initialize KV cache");
             }
 
-            n_splits_pp = lm_ggml_backend_sched_get_n_splits(sched.get());
-            n_nodes_pp  = lm_ggml_graph_n_nodes(gf);
-        }
+            cross.v_embd.clear();
 
-        // reserve with tg graph to get the number of splits and nodes
-        {
-            auto * gf = graph_reserve(n_seqs, n_seqs, n_seqs, mctx.get());
-            if (!gf) {
-                throw std::runtime_error("failed to allocate compute tg buffers");
+            // reserve pp graph first so that buffers are only allocated once
+            {
+                auto * gf = graph_reserve(n_tokens, n_seqs, n_tokens, mctx.get());
+                if (!gf) {
+                    throw std::runtime_error("failed to allocate compute pp buffers");
+                }
+
+                n_splits_pp = lm_ggml_backend_sched_get_n_splits(sched.get());
+                n_nodes_pp  = lm_ggml_graph_n_nodes(gf);
             }
 
-            n_splits_tg = lm_ggml_backend_sched_get_n_splits(sched.get());
-            n_nodes_tg  = lm_ggml_graph_n_nodes(gf);
-        }
+            // reserve with tg graph to get the number of splits and nodes
+            {
+                auto * gf = graph_reserve(n_seqs, n_seqs, n_seqs, mctx.get());
+                if (!gf) {
+                    throw std::runtime_error("failed to allocate compute tg buffers");
+                }
 
-        // reserve again with pp graph to avoid ggml-alloc reallocations during inference
-        {
-            // TODO: not sure if the following graph would be worster case for multi-stream KV caches:
-            //
-            // auto * gf = graph_reserve(n_tokens, 1, n_tokens, mctx.get());
-            //
-            auto * gf = graph_reserve(n_tokens, n_seqs, n_tokens, mctx.get());
-            if (!gf) {
-                throw std::runtime_error("failed to allocate compute pp buffers");
+                n_splits_tg = lm_ggml_backend_sched_get_n_splits(sched.get());
+                n_nodes_tg  = lm_ggml_graph_n_nodes(gf);
+            }
+
+            // reserve again with pp graph to avoid ggml-alloc reallocations during inference
+            {
+                // TODO: not sure if the following graph would be worster case for multi-stream KV caches:
+                //
+                // auto * gf = graph_reserve(n_tokens, 1, n_tokens, mctx.get());
+                //
+                auto * gf = graph_reserve(n_tokens, n_seqs, n_tokens, mctx.get());
+                if (!gf) {
+                    throw std::runtime_error("failed to allocate compute pp buffers");
+                }
+            }
+
+            if (warm_start_cache) {
+                entry.buffer_sizes.clear();
+                for (auto * backend : backend_ptrs) {
+                    entry.buffer_sizes.push_back(lm_ggml_backend_sched_get_buffer_size(sched.get(), backend));
+                }
+                entry.n_nodes_pp  = n_nodes_pp;
+                entry.n_nodes_tg  = n_nodes_tg;
+                entry.n_splits_pp = n_splits_pp;
+                entry.n_splits_tg = n_splits_tg;
+
+                llama_warm_start_save(warm_start_cache, warm_start_key, entry);
             }
         }
 
@@ -656,12 +897,24 @@ void llama_context::set_warmup(bool value) {
     cparams.warmup = value;
 }
 
+bool llama_context::warm_started() const {
+    return warm_start;
+}
+
 void llama_context::set_adapter_lora(
             llama_adapter_lora * adapter,
             float scale) {
     LLAMA_LOG_DEBUG("%s: adapter = %p, scale = %f\n", __func__, (void *) adapter, scale);
 
+    auto pos = loras.find(adapter);
+    if (pos != loras.end() && pos->second == scale) {
+        return;
+    }
+
     loras[adapter] = scale;
+
+    // the previous graph was built for the old set of adapters
+    gf_res_prev->reset();
 }
 
 bool llama_context::rm_adapter_lora(
@@ -671,6 +924,7 @@ bool llama_context::rm_adapter_lora(
     auto pos = loras.find(adapter);
     if (pos != loras.end()) {
         loras.erase(pos);
+        gf_res_prev->reset();
         return true;
     }
 
@@ -680,7 +934,28 @@ bool llama_context::rm_adapter_lora(
 void llama_context::clear_adapter_lora() {
     LLAMA_LOG_DEBUG("%s: call\n", __func__);
 
+    if (loras.empty()) {
+        return;
+    }
+
     loras.clear();
+    gf_res_prev->reset();
+}
+
+bool llama_context::set_adapter_lora_seq(
+            llama_seq_id seq_id,
+            llama_adapter_lora * adapter,
+            float scale) {
+    LLAMA_LOG_DEBUG("%s: seq_id = %d, adapter = %p, scale = %f\n", __func__, seq_id, (void *) adapter, scale);
+
+    if (!lora_seq.set(model, seq_id, adapter, scale)) {
+        return false;
+    }
+
+    // the slots are read when the graph inputs are set, but the stacks may have been reallocated
+    gf_res_prev->reset();
+
+    return true;
 }
 
 bool llama_context::apply_adapter_cvec(
@@ -691,7 +966,22 @@ bool llama_context::apply_adapter_cvec(
                 int32_t   il_end) {
     LLAMA_LOG_DEBUG("%s: il_start = %d, il_end = %d\n", __func__, il_start, il_end);
 
-    return cvec.apply(model, data, len, n_embd, il_start, il_end);
+    std::vector<lm_ggml_tensor *> layer_dirs(model.hparams.n_layer);
+    for (uint32_t il = 0; il < model.hparams.n_layer; ++il) {
+        layer_dirs[il] = cvec.tensor_for(il);
+    }
+
+    const bool res = cvec.apply(model, data, len, n_embd, il_start, il_end);
+
+    // new data is picked up by the previous graph, but it only adds the vectors of the layers that were enabled
+    for (uint32_t il = 0; il < model.hparams.n_layer; ++il) {
+        if (cvec.tensor_for(il) != layer_dirs[il]) {
+            gf_res_prev->reset();
+            break;
+        }
+    }
+
+    return res;
 }
 
 llm_graph_result * llama_context::process_ubatch(const llama_ubatch & ubatch, llm_graph_type gtype, llama_memory_context_i * mctx, lm_ggml_status & ret) {
@@ -746,7 +1036,17 @@ llm_graph_result * llama_context::process_ubatch(const llama_ubatch & ubatch, ll
         //LLAMA_LOG_INFO("graph set inputs time: %.3f ms\n", (lm_ggml_time_us() - t_start_us)/1000.0);
     }
 
+    // the weights of the layers are paged in while the graph is computed
+    if (model.has_layer_paging()) {
+        model.paging_begin(ubatch.n_tokens);
+    }
+
     const auto status = graph_compute(res->get_gf(), ubatch.n_tokens > 1);
+
+    if (model.has_layer_paging()) {
+        model.paging_end();
+    }
+
     if (status != LM_GGML_STATUS_SUCCESS) {
         LLAMA_LOG_ERROR("%s: failed to compute graph, compute status: %d\n", __func__, status);
         ret = status;
@@ -1377,6 +1677,7 @@ llm_graph_params llama_context::graph_params(
         /*.backend_cpu =*/ backend_cpu,
         /*.cvec        =*/ &cvec,
         /*.loras       =*/ &loras,
+        /*.lora_seq    =*/ &lora_seq,
         /*.mctx        =*/ mctx,
         /*.cross       =*/ &cross,
         /*.n_outputs   =*/ n_outputs,
@@ -2218,6 +2519,10 @@ llama_context_params llama_context_default_params() {
         /*.type_v                      =*/ LM_GGML_TYPE_F16,
         /*.abort_callback              =*/ nullptr,
         /*.abort_callback_data         =*/ nullptr,
+        /*.kv_spill_path               =*/ nullptr,
+        /*.n_rs_ckpt                   =*/ 0,
+        /*.rs_ckpt_interval            =*/ 0,
+        /*.warm_start_cache            =*/ nullptr,
         /*.embeddings                  =*/ false,
         /*.offload_kqv                 =*/ true,
         /*.flash_attn                  =*/ false,
@@ -2268,6 +2573,228 @@ llama_context * llama_init_from_model(
     return nullptr;
 }
 
+//
+// memory plan
+//
+
+// the estimated compute buffer size is increased by 1/LLAMA_MEMORY_PLAN_COMPUTE_MARGIN, see llama_memory_plan
+static const size_t LLAMA_MEMORY_PLAN_COMPUTE_MARGIN = 4;
+
+// the parts of llama_cparams that size the memory and the graphs, set as in the llama_context constructor
+static llama_cparams llama_memory_plan_cparams(const llama_model & model, const llama_context_params & params) {
+    const auto & hparams = model.hparams;
+
+    llama_cparams cparams = {};
+
+    cparams.n_seq_max   = std::max(1u, params.n_seq_max);
+    cparams.n_ctx       = params.n_ctx == 0 ? hparams.n_ctx_train : params.n_ctx;
+    cparams.embeddings  = params.embeddings;
+    cparams.offload_kqv = params.offload_kqv;
+    cparams.flash_attn  = params.flash_attn && model.arch != LLM_ARCH_GROK;
+    cparams.op_offload  = params.op_offload;
+    cparams.kv_unified  = params.kv_unified;
+    cparams.causal_attn = params.attention_type == LLAMA_ATTENTION_TYPE_UNSPECIFIED ? hparams.causal_attn :
+                          params.attention_type == LLAMA_ATTENTION_TYPE_CAUSAL;
+
+    cparams.pooling_type = params.pooling_type;
+    if (cparams.pooling_type == LLAMA_POOLING_TYPE_UNSPECIFIED) {
+        cparams.pooling_type = hparams.pooling_type == LLAMA_POOLING_TYPE_UNSPECIFIED ? LLAMA_POOLING_TYPE_NONE : hparams.pooling_type;
+    }
+
+    cparams.n_batch  = cparams.causal_attn ? std::min(cparams.n_ctx, params.n_batch) : params.n_batch;
+    cparams.n_batch  = std::max(cparams.n_batch, (uint32_t) LM_GGML_KQ_MASK_PAD);
+    cparams.n_ubatch = std::min(cparams.n_batch, params.n_ubatch == 0 ? params.n_batch : params.n_ubatch);
+
+    {
+        const char * LLAMA_SET_ROWS = getenv("LLAMA_SET_ROWS");
+        const bool supports_set_rows = LLAMA_SET_ROWS ? (atoi(LLAMA_SET_ROWS) != 0) : false;
+
+        if (!supports_set_rows) {
+            cparams.kv_unified = true;
+        }
+    }
+
+    return cparams;
+}
+
+// the buffer types of the backends that the llama_context constructor creates for the model
+static std::vector<lm_ggml_backend_buffer_type_t> llama_memory_plan_backend_buft(const llama_model & model) {
+    std::vector<lm_ggml_backend_buffer_type_t> res;
+
+    for (auto * dev : model.devices) {
+        res.push_back(lm_ggml_backend_dev_buffer_type(dev));
+    }
+
+    for (size_t i = 0; i < lm_ggml_backend_dev_count(); ++i) {
+        lm_ggml_backend_dev_t dev = lm_ggml_backend_dev_get(i);
+        if (lm_ggml_backend_dev_type(dev) == LM_GGML_BACKEND_DEVICE_TYPE_ACCEL) {
+            res.push_back(lm_ggml_backend_dev_buffer_type(dev));
+        }
+    }
+
+    lm_ggml_backend_buffer_type_t buft_cpu = lm_ggml_backend_dev_buffer_type(lm_ggml_backend_dev_by_type(LM_GGML_BACKEND_DEVICE_TYPE_CPU));
+    if (!model.devices.empty()) {
+        auto * host_buft = lm_ggml_backend_dev_host_buffer_type(model.devices[0]);
+        if (host_buft) {
+            buft_cpu = host_buft;
+        }
+    }
+    res.push_back(buft_cpu);
+
+    return res;
+}
+
+// the scheduler reuses the memory of the tensors of a layer for the next one, so the peak is the residual
+// stream plus the largest of the attention scores, the FFN activations and the logits of a ubatch
+static size_t llama_memory_plan_compute(const llama_model & model, const llama_cparams & cparams) {
+    const auto & hparams = model.hparams;
+
+    const size_t n_ubatch = cparams.n_ubatch;
+    const size_t n_embd   = hparams.n_embd;
+    const size_t n_vocab  = llama_vocab_n_tokens(&model.vocab);
+
+    const uint32_t padding = llama_kv_cache_unified::get_padding(cparams);
+    const size_t   n_kv    = LM_GGML_PAD(cparams.kv_unified ? cparams.n_ctx : (cparams.n_ctx + cparams.n_seq_max - 1)/cparams.n_seq_max, padding);
+
+    size_t n_head = 0;
+    size_t n_ff   = 0;
+    for (uint32_t il = 0; il < hparams.n_layer; ++il) {
+        n_head = std::max(n_head, (size_t) hparams.n_head(il));
+        n_ff   = std::max(n_ff,   (size_t) hparams.n_ff(il));
+    }
+    if (hparams.n_expert > 0) {
+        n_ff = std::max(n_ff, (size_t) hparams.n_ff_exp*hparams.n_expert_used);
+    }
+
+    const size_t f32 = sizeof(float);
+
+    // the inputs and the KQ mask stay allocated for the whole graph, the largest of the
+    // per-layer intermediates is reused between layers
+    const size_t mask = n_kv*LM_GGML_PAD(n_ubatch, LM_GGML_KQ_MASK_PAD)*(cparams.flash_attn ? sizeof(lm_ggml_fp16_t) : f32);
+    const size_t inp  = 4*n_ubatch*n_embd*f32 + mask;
+    const size_t attn = cparams.flash_attn ?
+        2*n_ubatch*n_head*hparams.n_embd_head_v*f32 :
+        n_kv*n_ubatch*n_head*f32;
+    const size_t ffn  = 4*n_ubatch*n_ff*f32;
+    const size_t out  = n_vocab*n_ubatch*f32;
+
+    return inp + std::max({ attn, ffn, out });
+}
+
+llama_memory_plan llama_memory_plan_estimate(
+        const llama_model * model,
+        llama_context_params params,
+        size_t budget) {
+    llama_memory_plan plan = {};
+
+    model->size_buffers(plan.weights_mapped, plan.weights_alloc);
+
+    llama_cparams cparams = llama_memory_plan_cparams(*model, params);
+
+    llama_memory_params params_mem = {
+        /*.type_k           =*/ params.type_k,
+        /*.type_v           =*/ params.type_v,
+        /*.swa_full         =*/ params.swa_full,
+        /*.spill_path       =*/ "",
+        /*.spill_sync       =*/ {},
+        /*.n_rs_ckpt        =*/ params.rs_ckpt_interval > 0 ? params.n_rs_ckpt : 0,
+        /*.rs_ckpt_interval =*/ params.rs_ckpt_interval,
+    };
+
+    plan.kv = model->memory_size(params_mem, cparams);
+
+    // a configuration that was reserved before has its compute buffers measured in the warm start cache
+    const char * warm_start_cache = params.warm_start_cache && params.warm_start_cache[0] ? params.warm_start_cache : nullptr;
+    const std::vector<lm_ggml_backend_buffer_type_t> backend_buft = llama_memory_plan_backend_buft(*model);
+
+    llama_warm_start_entry entry;
+    if (warm_start_cache && llama_warm_start_load(warm_start_cache, llama_warm_start_key(*model, cparams, params, backend_buft), backend_buft.size(), entry, false)) {
+        for (size_t size : entry.buffer_sizes) {
+            plan.compute += size;
+        }
+    } else {
+        // the estimate does not see every intermediate tensor that the allocator keeps alive
+        const size_t compute = llama_memory_plan_compute(*model, cparams);
+        plan.compute = compute + compute/LLAMA_MEMORY_PLAN_COMPUTE_MARGIN;
+    }
+
+    if (budget > 0) {
+        const size_t weights = plan.weights_mapped + plan.weights_alloc;
+        plan.budget = budget > weights ? budget - weights : 0;
+    } else {
+        // the weights are already loaded and accounted for, some room is kept for the rest of the process
+        // if the available memory is unknown, it does not limit the context
+        const size_t avail = llama_mem_available();
+        plan.budget = avail > 0 ? avail - avail/8 : SIZE_MAX;
+    }
+
+    plan.fits = plan.kv + plan.compute <= plan.budget;
+
+    return plan;
+}
+
+llama_memory_plan llama_memory_plan_fit(
+        const llama_model * model,
+        llama_context_params * params,
+        size_t budget) {
+    const uint32_t n_ubatch_min = 64;
+    const uint32_t n_ctx_min    = 512;
+
+    const llama_context_params params_orig = *params;
+
+    llama_memory_plan plan = llama_memory_plan_estimate(model, *params, budget);
+
+    LLAMA_LOG_INFO("%s: weights = %.2f MiB mapped + %.2f MiB allocated, KV = %.2f MiB, compute = %.2f MiB, budget = %.2f MiB\n", __func__,
+            plan.weights_mapped/1024.0/1024.0, plan.weights_alloc/1024.0/1024.0, plan.kv/1024.0/1024.0, plan.compute/1024.0/1024.0,
+            plan.budget == SIZE_MAX ? -1.0 : plan.budget/1024.0/1024.0);
+
+    // the ubatch only changes the speed of the prompt processing
+    while (!plan.fits && llama_memory_plan_cparams(*model, *params).n_ubatch > n_ubatch_min) {
+        params->n_ubatch = std::max(n_ubatch_min, llama_memory_plan_cparams(*model, *params).n_ubatch/2);
+        plan = llama_memory_plan_estimate(model, *params, budget);
+    }
+
+    // a quantized V cache is only supported with flash attention
+    if (!plan.fits && !lm_ggml_is_quantized(params->type_k)) {
+        llama_context_params params_q8 = *params;
+        params_q8.type_k = LM_GGML_TYPE_Q8_0;
+        if (params_q8.flash_attn && !lm_ggml_is_quantized(params_q8.type_v)) {
+            params_q8.type_v = LM_GGML_TYPE_Q8_0;
+        }
+
+        // models without a KV cache keep their types
+        const llama_memory_plan plan_q8 = llama_memory_plan_estimate(model, params_q8, budget);
+        if (plan_q8.kv < plan.kv) {
+            *params = params_q8;
+            plan    = plan_q8;
+        }
+    }
+
+    while (!plan.fits && llama_memory_plan_cparams(*model, *params).n_ctx > n_ctx_min) {
+        params->n_ctx = std::max(n_ctx_min, llama_memory_plan_cparams(*model, *params).n_ctx/2);
+        plan = llama_memory_plan_estimate(model, *params, budget);
+    }
+
+    if (params->n_ubatch != params_orig.n_ubatch) {
+        LLAMA_LOG_WARN("%s: n_ubatch = %u -> %u\n", __func__, params_orig.n_ubatch, params->n_ubatch);
+    }
+    if (params->type_k != params_orig.type_k || params->type_v != params_orig.type_v) {
+        LLAMA_LOG_WARN("%s: KV cache type = %s/%s -> %s/%s\n", __func__,
+                lm_ggml_type_name(params_orig.type_k), lm_ggml_type_name(params_orig.type_v),
+                lm_ggml_type_name(params->type_k), lm_ggml_type_name(params->type_v));
+    }
+    if (params->n_ctx != params_orig.n_ctx) {
+        LLAMA_LOG_WARN("%s: n_ctx = %u -> %u\n", __func__, llama_memory_plan_cparams(*model, params_orig).n_ctx, params->n_ctx);
+    }
+
+    if (!plan.fits) {
+        LLAMA_LOG_WARN("%s: the context needs %.2f MiB, more than the budget of %.2f MiB\n", __func__,
+                (plan.kv + plan.compute)/1024.0/1024.0, plan.budget/1024.0/1024.0);
+    }
+
+    return plan;
+}
+
 // deprecated
 llama_context * llama_new_context_with_model(
                  llama_model * model,
@@ -2352,6 +2879,10 @@ void llama_set_warmup(llama_context * ctx, bool warmup) {
     ctx->set_warmup(warmup);
 }
 
+bool llama_warm_started(const llama_context * ctx) {
+    return ctx->warm_started();
+}
+
 void llama_synchronize(llama_context * ctx) {
     ctx->synchronize();
 }
@@ -2409,6 +2940,16 @@ void llama_clear_adapter_lora(llama_context * ctx) {
     ctx->clear_adapter_lora();
 }
 
+int32_t llama_set_adapter_lora_seq(
+            llama_context * ctx,
+            llama_seq_id seq_id,
+            llama_adapter_lora * adapter,
+            float scale) {
+    bool res = ctx->set_adapter_lora_seq(seq_id, adapter, scale);
+
+    return res ? 0 : -1;
+}
+
 int32_t llama_apply_adapter_cvec(
         llama_context * ctx,
                  const float * data,
@@ -2526,6 +3067,16 @@ bool llama_memory_can_shift(llama_memory_t mem) {
     return mem->get_can_shift();
 }
 
+bool llama_memory_seq_offload(
+        llama_memory_t mem,
+          llama_seq_id seq_id) {
+    if (!mem) {
+        return false;
+    }
+
+    return mem->seq_offload(seq_id);
+}
+
 //
 // kv cache
 //
@@ -74,6 +74,8 @@ struct llama_context {
     void set_causal_attn(bool value);
     void set_warmup(bool value);
 
+    bool warm_started() const;
+
     void set_adapter_lora(
             llama_adapter_lora * adapter,
             float scale);
@@ -83,6 +85,11 @@ struct llama_context {
 
     void clear_adapter_lora();
 
+    bool set_adapter_lora_seq(
+            llama_seq_id seq_id,
+            llama_adapter_lora * adapter,
+            float scale);
+
     bool apply_adapter_cvec(
             const float * data,
                  size_t   len,
@@ -223,6 +230,8 @@ private:
     llama_adapter_cvec  cvec;
     llama_adapter_loras loras;
 
+    llama_adapter_lora_seq lora_seq; // adapters routed to single sequences
+
     llama_cross cross; // TODO: tmp for handling cross-attention - need something better probably
 
     std::unique_ptr<llama_memory_i> memory;
@@ -278,6 +287,9 @@ private:
 
     bool has_evaluated_once = false;
 
+    // the compute buffers were sized from the warm start cache
+    bool warm_start = false;
+
     // perf
     mutable int64_t t_start_us  = 0;
     mutable int64_t t_load_us   = 0;
@@ -143,6 +143,43 @@ bool llm_graph_input_out_ids::can_reuse(const llm_graph_params & params) {
     return res;
 }
 
+void llm_graph_input_lora_seq::set_input(const llama_ubatch * ubatch) {
+    const int64_t n_tokens = ubatch->n_tokens;
+
+    // the ids are only allocated when a routed matmul of the graph uses them
+    if (ids && ids->buffer) {
+        LM_GGML_ASSERT(lm_ggml_backend_buffer_is_host(ids->buffer));
+
+        int32_t * data = (int32_t *) ids->data;
+        for (int i = 0; i < n_tokens; ++i) {
+            data[i] = lora_seq->slot(ubatch->seq_id[i][0]);
+        }
+    }
+
+    if (ids_out && ids_out->buffer) {
+        LM_GGML_ASSERT(lm_ggml_backend_buffer_is_host(ids_out->buffer));
+        LM_GGML_ASSERT(ubatch->output);
+
+        int32_t * data_out = (int32_t *) ids_out->data;
+
+        int n_outputs = 0;
+        for (int i = 0; i < n_tokens; ++i) {
+            if (ubatch->output[i]) {
+                data_out[n_outputs++] = lora_seq->slot(ubatch->seq_id[i][0]);
+            }
+        }
+    }
+}
+
+bool llm_graph_input_lora_seq::can_reuse(const llm_graph_params & params) {
+    bool res = true;
+
+    res &= n_tokens  == params.ubatch.n_tokens;
+    res &= n_outputs == params.n_outputs;
+
+    return res;
+}
+
 void llm_graph_input_mean::set_input(const llama_ubatch * ubatch) {
     if (cparams.embeddings && cparams.pooling_type == LLAMA_POOLING_TYPE_MEAN) {
         const int64_t n_tokens     = ubatch->n_tokens;
@@ -325,6 +362,8 @@ bool llm_graph_input_attn_kv_unified::can_reuse(const llm_graph_params & params)
     res &= self_kq_mask->ne[0] == mctx->get_n_kv();
     res &= self_kq_mask->ne[1] == LM_GGML_PAD(params.ubatch.n_tokens, LM_GGML_KQ_MASK_PAD);
 
+    res &= n_prefix == (cparams.flash_attn ? 0 : mctx->get_n_prefix());
+
     res &= mctx->get_supports_set_rows(); // TODO: tmp
 
     return res;
@@ -530,6 +569,7 @@ llm_graph_context::llm_graph_context(const llm_graph_params & params) :
     backend_cpu      (params.backend_cpu),
     cvec             (params.cvec),
     loras            (params.loras),
+    lora_seq         (params.lora_seq),
     mctx             (params.mctx),
     cross            (params.cross),
     cb_func          (params.cb),
@@ -537,6 +577,13 @@ llm_graph_context::llm_graph_context(const llm_graph_params & params) :
     ctx0             (res->get_ctx()),
     gf               (res->get_gf()) {
         res->set_params(params);
+
+        if (lora_seq && !lora_seq->empty()) {
+            // the ids are created by the first routed matmul that needs them
+            auto inp = std::make_unique<llm_graph_input_lora_seq>(lora_seq, n_tokens, n_outputs);
+
+            inp_lora_seq = (llm_graph_input_lora_seq *) res->add_input(std::move(inp));
+        }
     }
 
 void llm_graph_context::cb(lm_ggml_tensor * cur, const char * name, int il) const {
@@ -554,9 +601,25 @@ lm_ggml_tensor * llm_graph_context::build_cvec(
 lm_ggml_tensor * llm_graph_context::build_lora_mm(
           lm_ggml_tensor * w,
           lm_ggml_tensor * cur) const {
-    lm_ggml_tensor * res = lm_ggml_mul_mat(ctx0, w, cur);
+    // an adapter merged at the scale it is applied with replaces w instead of adding its product
+    const llama_adapter_lora * merged = nullptr;
+    lm_ggml_tensor * w_mm = w;
+    for (const auto & lora : *loras) {
+        lm_ggml_tensor * w_merged = lora.first->get_merged(w, lora.second);
+        if (w_merged != nullptr) {
+            merged = lora.first;
+            w_mm   = w_merged;
+            break;
+        }
+    }
+
+    lm_ggml_tensor * res = lm_ggml_mul_mat(ctx0, w_mm, cur);
 
     for (const auto & lora : *loras) {
+        if (lora.first == merged) {
+            continue;
+        }
+
         llama_adapter_lora_weight * lw = lora.first->get_weight(w);
         if (lw == nullptr) {
             continue;
@@ -574,6 +637,40 @@ lm_ggml_tensor * llm_graph_context::build_lora_mm(
         res = lm_ggml_add(ctx0, res, ab_cur);
     }
 
+    // adapters routed per sequence: gather the A/B slot of each token, slot 0 is all zeros
+    const llama_adapter_lora_seq::stack * st = inp_lora_seq ? lora_seq->get_stack(w) : nullptr;
+    if (st != nullptr) {
+        const int64_t n_rows = lm_ggml_nelements(cur)/cur->ne[0];
+        if (n_rows == 0) {
+            // a ubatch without outputs skips the rows after the last layer
+            return res;
+        }
+
+        lm_ggml_tensor * ids = nullptr;
+        if (n_rows == n_tokens) {
+            if (inp_lora_seq->ids == nullptr) {
+                inp_lora_seq->ids = lm_ggml_new_tensor_2d(ctx0, LM_GGML_TYPE_I32, 1, n_tokens);
+                lm_ggml_set_input(inp_lora_seq->ids);
+            }
+            ids = inp_lora_seq->ids;
+        } else if (n_rows == n_outputs) {
+            if (inp_lora_seq->ids_out == nullptr) {
+                inp_lora_seq->ids_out = lm_ggml_new_tensor_2d(ctx0, LM_GGML_TYPE_I32, 1, n_outputs);
+                lm_ggml_set_input(inp_lora_seq->ids_out);
+            }
+            ids = inp_lora_seq->ids_out;
+        }
+        LM_GGML_ASSERT(ids != nullptr && "rows of a routed lora matmul do not map to tokens");
+
+        lm_ggml_tensor * x = lm_ggml_reshape_3d(ctx0, lm_ggml_cont(ctx0, cur), cur->ne[0], 1, n_rows);
+
+        lm_ggml_tensor * ab_cur = lm_ggml_mul_mat_id(ctx0, st->b,
+                lm_ggml_mul_mat_id(ctx0, st->a, x, ids),
+                ids);
+
+        res = lm_ggml_add(ctx0, res, lm_ggml_reshape(ctx0, ab_cur, res));
+    }
+
     return res;
 }
 
@@ -1140,12 +1237,16 @@ lm_ggml_tensor * llm_graph_context::build_attn_mha(
          lm_ggml_tensor * kq_b,
          lm_ggml_tensor * kq_mask,
          lm_ggml_tensor * v_mla,
-             float     kq_scale) const {
+             float     kq_scale,
+          uint32_t     n_prefix) const {
     const bool v_trans = v->nb[1] > v->nb[2];
 
     // split the batch into streams if needed
     const auto n_stream = k->ne[3];
 
+    // the queries of all streams together: [n_embd_head_q, n_tokens, n_head_q]
+    lm_ggml_tensor * q_all = n_prefix > 0 ? lm_ggml_permute(ctx0, q, 0, 2, 1, 3) : nullptr;
+
     q = lm_ggml_reshape_4d(ctx0, q, q->ne[0], q->ne[1], q->ne[2]/n_stream, n_stream);
 
     q = lm_ggml_permute(ctx0, q, 0, 2, 1, 3);
@@ -1196,11 +1297,36 @@ lm_ggml_tensor * llm_graph_context::build_attn_mha(
 
         cur = lm_ggml_reshape_2d(ctx0, cur, cur->ne[0]*cur->ne[1], cur->ne[2]*cur->ne[3]);
     } else {
-        lm_ggml_tensor * kq = lm_ggml_mul_mat(ctx0, k, q);
+        lm_ggml_tensor * kq = nullptr;
+
+        if (n_prefix > 0) {
+            // cascade attention: the first n_prefix cells hold the same data in all streams, so the prefix part of KQ is
+            // computed once for the queries of all streams using the cells of the first stream. the suffix part is
+            // computed per stream and the two are joined before the softmax, so it is normalized over all the cells
+            const int64_t n_tps = q->ne[1]; // tokens per stream
+
+            lm_ggml_tensor * k_pre = lm_ggml_view_4d(ctx0, k, k->ne[0], n_prefix,        k->ne[2], 1,        k->nb[1], k->nb[2], k->nb[3], 0);
+            lm_ggml_tensor * k_suf = lm_ggml_view_4d(ctx0, k, k->ne[0], n_kv - n_prefix, k->ne[2], n_stream, k->nb[1], k->nb[2], k->nb[3], n_prefix*k->nb[1]);
+
+            // [n_prefix, n_tps*n_stream, n_head_q] -> [n_prefix, n_tps, n_head_q, n_stream]
+            lm_ggml_tensor * kq_pre = lm_ggml_mul_mat(ctx0, k_pre, q_all);
+            lm_ggml_mul_mat_set_prec(kq_pre, LM_GGML_PREC_F32);
 
-        // note: this op tends to require high floating point range
-        //       while for some models F16 is enough, for others it is not, so we default to F32 here
-        lm_ggml_mul_mat_set_prec(kq, LM_GGML_PREC_F32);
+            kq_pre = lm_ggml_reshape_4d(ctx0, kq_pre, n_prefix, n_tps, n_stream, kq_pre->ne[2]);
+            kq_pre = lm_ggml_permute(ctx0, kq_pre, 0, 1, 3, 2);
+
+            // [n_kv - n_prefix, n_tps, n_head_q, n_stream]
+            lm_ggml_tensor * kq_suf = lm_ggml_mul_mat(ctx0, k_suf, q);
+            lm_ggml_mul_mat_set_prec(kq_suf, LM_GGML_PREC_F32);
+
+            kq = lm_ggml_concat(ctx0, kq_pre, kq_suf, 0);
+        } else {
+            kq = lm_ggml_mul_mat(ctx0, k, q);
+
+            // note: this op tends to require high floating point range
+            //       while for some models F16 is enough, for others it is not, so we default to F32 here
+            lm_ggml_mul_mat_set_prec(kq, LM_GGML_PREC_F32);
+        }
 
         if (arch == LLM_ARCH_GROK) {
             // need to do the following:
@@ -1230,7 +1356,32 @@ lm_ggml_tensor * llm_graph_context::build_attn_mha(
             v = lm_ggml_cont(ctx0, lm_ggml_transpose(ctx0, v));
         }
 
-        lm_ggml_tensor * kqv = lm_ggml_mul_mat(ctx0, v, kq);
+        lm_ggml_tensor * kqv = nullptr;
+
+        if (n_prefix > 0) {
+            // the V of the prefix is also applied once for the queries of all streams
+            const int64_t n_tps = kq->ne[1];
+
+            lm_ggml_tensor * v_pre = lm_ggml_view_4d(ctx0, v, n_prefix,        v->ne[1], v->ne[2], 1,        v->nb[1], v->nb[2], v->nb[3], 0);
+            lm_ggml_tensor * v_suf = lm_ggml_view_4d(ctx0, v, n_kv - n_prefix, v->ne[1], v->ne[2], n_stream, v->nb[1], v->nb[2], v->nb[3], n_prefix*v->nb[0]);
+
+            lm_ggml_tensor * kq_pre = lm_ggml_view_4d(ctx0, kq, n_prefix,        n_tps, kq->ne[2], n_stream, kq->nb[1], kq->nb[2], kq->nb[3], 0);
+            lm_ggml_tensor * kq_suf = lm_ggml_view_4d(ctx0, kq, n_kv - n_prefix, n_tps, kq->ne[2], n_stream, kq->nb[1], kq->nb[2], kq->nb[3], n_prefix*kq->nb[0]);
+
+            // [n_prefix, n_tps, n_head_q, n_stream] -> [n_prefix, n_tps*n_stream, n_head_q]
+            kq_pre = lm_ggml_cont(ctx0, lm_ggml_permute(ctx0, kq_pre, 0, 1, 3, 2));
+            kq_pre = lm_ggml_reshape_3d(ctx0, kq_pre, n_prefix, n_tps*n_stream, kq_pre->ne[3]);
+
+            // [n_embd_head_v, n_tps*n_stream, n_head_q] -> [n_embd_head_v, n_tps, n_head_q, n_stream]
+            lm_ggml_tensor * kqv_pre = lm_ggml_mul_mat(ctx0, v_pre, kq_pre);
+
+            kqv_pre = lm_ggml_reshape_4d(ctx0, kqv_pre, kqv_pre->ne[0], n_tps, n_stream, kqv_pre->ne[2]);
+            kqv_pre = lm_ggml_permute(ctx0, kqv_pre, 0, 1, 3, 2);
+
+            kqv = lm_ggml_add(ctx0, lm_ggml_mul_mat(ctx0, v_suf, kq_suf), kqv_pre);
+        } else {
+            kqv = lm_ggml_mul_mat(ctx0, v, kq);
+        }
 
         // for MLA with the absorption optimization, we need to "decompress" from MQA back to MHA
         if (v_mla) {
@@ -1294,7 +1445,7 @@ lm_ggml_tensor * llm_graph_context::build_attn(
     lm_ggml_tensor * k = k_cur;
     lm_ggml_tensor * v = v_cur;
 
-    lm_ggml_tensor * cur = build_attn_mha(q, k, v, kq_b, kq_mask, v_mla, kq_scale);
+    lm_ggml_tensor * cur = build_attn_mha(q, k, v, kq_b, kq_mask, v_mla, kq_scale, 0);
     cb(cur, "kqv_out", il);
 
     if (wo) {
@@ -1335,6 +1486,9 @@ static std::unique_ptr<llm_graph_input_attn_kv_unified> build_attn_inp_kv_unifie
         lm_ggml_set_input(inp->self_kq_mask);
 
         inp->self_kq_mask_cnv = cparams.flash_attn ? lm_ggml_cast(ctx0, inp->self_kq_mask, LM_GGML_TYPE_F16) : inp->self_kq_mask;
+
+        // cascade attention is implemented only for the KQ + softmax path, see build_attn_mha()
+        inp->n_prefix = cparams.flash_attn ? 0 : mctx_cur->get_n_prefix();
     }
 
     return inp;
@@ -1382,7 +1536,7 @@ lm_ggml_tensor * llm_graph_context::build_attn(
     lm_ggml_tensor * k = mctx_cur->get_k(ctx0, il);
     lm_ggml_tensor * v = mctx_cur->get_v(ctx0, il);
 
-    lm_ggml_tensor * cur = build_attn_mha(q, k, v, kq_b, kq_mask, v_mla, kq_scale);
+    lm_ggml_tensor * cur = build_attn_mha(q, k, v, kq_b, kq_mask, v_mla, kq_scale, inp->n_prefix);
     cb(cur, "kqv_out", il);
 
     if (wo) {
@@ -1448,7 +1602,7 @@ lm_ggml_tensor * llm_graph_context::build_attn(
     lm_ggml_tensor * k = mctx_cur->get_k(ctx0, il);
     lm_ggml_tensor * v = mctx_cur->get_v(ctx0, il);
 
-    lm_ggml_tensor * cur = build_attn_mha(q, k, v, kq_b, kq_mask, v_mla, kq_scale);
+    lm_ggml_tensor * cur = build_attn_mha(q, k, v, kq_b, kq_mask, v_mla, kq_scale, 0);
     cb(cur, "kqv_out", il);
 
     if (wo) {
@@ -1502,7 +1656,7 @@ lm_ggml_tensor * llm_graph_context::build_attn(
     lm_ggml_tensor * k = k_cur;
     lm_ggml_tensor * v = v_cur;
 
-    lm_ggml_tensor * cur = build_attn_mha(q, k, v, kq_b, kq_mask, v_mla, kq_scale);
+    lm_ggml_tensor * cur = build_attn_mha(q, k, v, kq_b, kq_mask, v_mla, kq_scale, 0);
     cb(cur, "kqv_out", il);
 
     if (wo) {
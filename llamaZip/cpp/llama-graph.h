@@ -183,6 +183,27 @@ public:
     const uint32_t n_outputs;
 };
 
+class llm_graph_input_lora_seq : public llm_graph_input_i {
+public:
+    llm_graph_input_lora_seq(
+            const llama_adapter_lora_seq * lora_seq,
+            uint32_t n_tokens,
+            uint32_t n_outputs) : lora_seq(lora_seq), n_tokens(n_tokens), n_outputs(n_outputs) {}
+    virtual ~llm_graph_input_lora_seq() = default;
+
+    void set_input(const llama_ubatch * ubatch) override;
+
+    bool can_reuse(const llm_graph_params & params) override;
+
+    lm_ggml_tensor * ids     = nullptr; // I32 [1, n_tokens]
+    lm_ggml_tensor * ids_out = nullptr; // I32 [1, n_outputs], only when a part of the tokens are outputs
+
+    const llama_adapter_lora_seq * lora_seq;
+
+    const uint32_t n_tokens;
+    const uint32_t n_outputs;
+};
+
 class llm_graph_input_mean : public llm_graph_input_i {
 public:
     llm_graph_input_mean(const llama_cparams & cparams) : cparams(cparams) {}
@@ -278,6 +299,9 @@ public:
     lm_ggml_tensor * self_kq_mask     = nullptr; // F32 [n_kv, n_batch/n_stream, 1, n_stream]
     lm_ggml_tensor * self_kq_mask_cnv = nullptr; //     [n_kv, n_batch/n_stream, 1, n_stream]
 
+    // number of leading KV cells with the same data in all streams
+    uint32_t n_prefix = 0;
+
     const llama_hparams & hparams;
     const llama_cparams & cparams;
 
@@ -391,6 +415,7 @@ struct llm_graph_params {
 
     const llama_adapter_cvec     * cvec;
     const llama_adapter_loras    * loras;
+    const llama_adapter_lora_seq * lora_seq;
     const llama_memory_context_i * mctx;
     const llama_cross            * cross;
 
@@ -438,6 +463,7 @@ struct llm_graph_params {
             gtype     == other.gtype &&
             cvec      == other.cvec  &&
             loras     == other.loras &&
+            lora_seq  == other.lora_seq &&
             cross     == other.cross &&
             n_outputs == other.n_outputs;
     }
@@ -552,11 +578,14 @@ struct llm_graph_context {
 
     const llama_adapter_cvec     * cvec;
     const llama_adapter_loras    * loras;
+    const llama_adapter_lora_seq * lora_seq;
     const llama_memory_context_i * mctx;
     const llama_cross            * cross;
 
     const llm_graph_cb & cb_func;
 
+    llm_graph_input_lora_seq * inp_lora_seq = nullptr;
+
     llm_graph_result * res;
 
     lm_ggml_context * ctx0 = nullptr;
@@ -652,7 +681,8 @@ struct llm_graph_context {
              lm_ggml_tensor * kq_b,
              lm_ggml_tensor * kq_mask,
              lm_ggml_tensor * v_mla,   // [n_embd_head_v_mla, n_embd_head_v, n_head_v]
-                   float   kq_scale) const;
+                   float   kq_scale,
+                uint32_t   n_prefix) const; // leading KV cells shared by all streams, 0 - none (cascade attention)
 
     llm_graph_input_attn_no_cache * build_attn_inp_no_cache() const;
 
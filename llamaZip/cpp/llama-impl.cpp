@@ -112,19 +112,27 @@ std::string llama_format_tensor_shape(const struct lm_ggml_tensor * t) {
     return buf;
 }
 
+// the values of a lm_gguf_view are not aligned
+template <typename T>
+static T lm_gguf_data_at(const void * data, int i) {
+    T val;
+    memcpy(&val, (const uint8_t *) data + i*sizeof(T), sizeof(T));
+    return val;
+}
+
 static std::string lm_gguf_data_to_str(enum lm_gguf_type type, const void * data, int i) {
     switch (type) {
-        case LM_GGUF_TYPE_UINT8:   return std::to_string(((const uint8_t  *)data)[i]);
-        case LM_GGUF_TYPE_INT8:    return std::to_string(((const int8_t   *)data)[i]);
-        case LM_GGUF_TYPE_UINT16:  return std::to_string(((const uint16_t *)data)[i]);
-        case LM_GGUF_TYPE_INT16:   return std::to_string(((const int16_t  *)data)[i]);
-        case LM_GGUF_TYPE_UINT32:  return std::to_string(((const uint32_t *)data)[i]);
-        case LM_GGUF_TYPE_INT32:   return std::to_string(((const int32_t  *)data)[i]);
-        case LM_GGUF_TYPE_UINT64:  return std::to_string(((const uint64_t *)data)[i]);
-        case LM_GGUF_TYPE_INT64:   return std::to_string(((const int64_t  *)data)[i]);
-        case LM_GGUF_TYPE_FLOAT32: return std::to_string(((const float    *)data)[i]);
-        case LM_GGUF_TYPE_FLOAT64: return std::to_string(((const double   *)data)[i]);
-        case LM_GGUF_TYPE_BOOL:    return ((const bool *)data)[i] ? "true" : "false";
+        case LM_GGUF_TYPE_UINT8:   return std::to_string(lm_gguf_data_at<uint8_t> (data, i));
+        case LM_GGUF_TYPE_INT8:    return std::to_string(lm_gguf_data_at<int8_t>  (data, i));
+        case LM_GGUF_TYPE_UINT16:  return std::to_string(lm_gguf_data_at<uint16_t>(data, i));
+        case LM_GGUF_TYPE_INT16:   return std::to_string(lm_gguf_data_at<int16_t> (data, i));
+        case LM_GGUF_TYPE_UINT32:  return std::to_string(lm_gguf_data_at<uint32_t>(data, i));
+        case LM_GGUF_TYPE_INT32:   return std::to_string(lm_gguf_data_at<int32_t> (data, i));
+        case LM_GGUF_TYPE_UINT64:  return std::to_string(lm_gguf_data_at<uint64_t>(data, i));
+        case LM_GGUF_TYPE_INT64:   return std::to_string(lm_gguf_data_at<int64_t> (data, i));
+        case LM_GGUF_TYPE_FLOAT32: return std::to_string(lm_gguf_data_at<float>   (data, i));
+        case LM_GGUF_TYPE_FLOAT64: return std::to_string(lm_gguf_data_at<double>  (data, i));
+        case LM_GGUF_TYPE_BOOL:    return lm_gguf_data_at<int8_t>(data, i) ? "true" : "false";
         default:                return format("unknown type %d", type);
     }
 }
@@ -165,3 +173,44 @@ std::string lm_gguf_kv_to_str(const struct lm_gguf_context * ctx_gguf, int i) {
             return lm_gguf_data_to_str(type, lm_gguf_get_val_data(ctx_gguf, i), 0);
     }
 }
+
+std::string lm_gguf_view_kv_to_str(const struct lm_gguf_view * view, int64_t i) {
+    const enum lm_gguf_type type = lm_gguf_view_get_kv_type(view, i);
+
+    switch (type) {
+        case LM_GGUF_TYPE_STRING:
+            {
+                size_t len;
+                const char * str = lm_gguf_view_get_val_str(view, i, &len);
+                return std::string(str, len);
+            }
+        case LM_GGUF_TYPE_ARRAY:
+            {
+                const enum lm_gguf_type arr_type = lm_gguf_view_get_arr_type(view, i);
+                const size_t arr_n = lm_gguf_view_get_arr_n(view, i);
+                const void * data = arr_type == LM_GGUF_TYPE_STRING ? nullptr : lm_gguf_view_get_arr_data(view, i);
+                std::stringstream ss;
+                ss << "[";
+                for (size_t j = 0; j < arr_n; j++) {
+                    if (arr_type == LM_GGUF_TYPE_STRING) {
+                        size_t len;
+                        const char * str = lm_gguf_view_get_arr_str(view, i, j, &len);
+                        std::string val(str, len);
+                        // escape quotes
+                        replace_all(val, "\\", "\\\\");
+                        replace_all(val, "\"", "\\\"");
+                        ss << '"' << val << '"';
+                    } else {
+                        ss << lm_gguf_data_to_str(arr_type, data, j);
+                    }
+                    if (j < arr_n - 1) {
+                        ss << ", ";
+                    }
+                }
+                ss << "]";
+                return ss.str();
+            }
+        default:
+            return lm_gguf_data_to_str(type, lm_gguf_view_get_val_data(view, i), 0);
+    }
+}
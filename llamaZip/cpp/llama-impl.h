@@ -59,3 +59,4 @@ std::string llama_format_tensor_shape(const std::vector<int64_t> & ne);
 std::string llama_format_tensor_shape(const struct lm_ggml_tensor * t);
 
 std::string lm_gguf_kv_to_str(const struct lm_gguf_context * ctx_gguf, int i);
+std::string lm_gguf_view_kv_to_str(const struct lm_gguf_view * view, int64_t i);
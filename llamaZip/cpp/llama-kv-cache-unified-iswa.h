@@ -24,7 +24,9 @@ public:
                      uint32_t   kv_size,
                      uint32_t   n_seq_max,
                      uint32_t   n_ubatch,
-                     uint32_t   n_pad);
+                     uint32_t   n_pad,
+            const std::string & spill_path,
+    const std::vector<lm_ggml_backend_t> & spill_sync);
 
     ~llama_kv_cache_unified_iswa() = default;
 
@@ -54,6 +56,8 @@ public:
     llama_pos seq_pos_min(llama_seq_id seq_id) const override;
     llama_pos seq_pos_max(llama_seq_id seq_id) const override;
 
+    bool seq_offload(llama_seq_id seq_id) override;
+
     // state write/load
 
     void state_write(llama_io_write_i & io, llama_seq_id seq_id = -1) const override;
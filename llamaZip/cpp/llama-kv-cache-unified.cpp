@@ -2,16 +2,98 @@
 
 #include "llama-impl.h"
 #include "llama-io.h"
+#include "llama-mmap.h"
 #include "llama-model.h"
 #include "llama-context.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <limits>
 #include <map>
 #include <stdexcept>
 
+//
+// spill file io
+//
+
+// writes the sequence state to the spill file, or only counts the bytes if file == nullptr
+class llama_io_write_spill : public llama_io_write_i {
+public:
+    llama_io_write_spill(llama_file * f) : file(f) {}
+
+    void write(const void * src, size_t size) override {
+        if (file) {
+            file->write_raw(src, size);
+        }
+        size_written += size;
+    }
+
+    void write_tensor(const lm_ggml_tensor * tensor, size_t offset, size_t size) override {
+        if (file) {
+            temp_buffer.resize(size);
+            lm_ggml_backend_tensor_get(tensor, temp_buffer.data(), offset, size);
+            file->write_raw(temp_buffer.data(), size);
+        }
+        size_written += size;
+    }
+
+    size_t n_bytes() override {
+        return size_written;
+    }
+
+private:
+    llama_file * file;
+    size_t size_written = 0;
+    std::vector<uint8_t> temp_buffer;
+};
+
+// reads the sequence state from a spill entry in memory
+class llama_io_read_spill : public llama_io_read_i {
+public:
+    llama_io_read_spill(const uint8_t * p, size_t len) : ptr(p), buf_size(len) {}
+
+    const uint8_t * read(size_t size) override {
+        const uint8_t * base_ptr = ptr;
+        if (size > buf_size) {
+            throw std::runtime_error("unexpectedly reached end of spill entry");
+        }
+        ptr += size;
+        size_read += size;
+        buf_size -= size;
+        return base_ptr;
+    }
+
+    void read_to(void * dst, size_t size) override {
+        memcpy(dst, read(size), size);
+    }
+
+    size_t n_bytes() override {
+        return size_read;
+    }
+
+private:
+    const uint8_t * ptr;
+    size_t buf_size = 0;
+    size_t size_read = 0;
+};
+
+// reads a spill entry into memory - only the bytes of the entry are read, regardless of the size of the spill file
+struct llama_spill_view {
+    llama_spill_view(const std::string & path, size_t offs, size_t size) : buf(size) {
+        llama_file file(path.c_str(), "rb");
+        file.read_raw_at(buf.data(), size, offs);
+
+        data = buf.data();
+    }
+
+    std::vector<uint8_t> buf;
+
+    const uint8_t * data = nullptr;
+};
+
 //
 // llama_kv_cache_unified
 //
@@ -28,9 +110,12 @@ llama_kv_cache_unified::llama_kv_cache_unified(
                  uint32_t    n_seq_max,
                  uint32_t    n_pad,
                  uint32_t    n_swa,
-           llama_swa_type    swa_type) :
+           llama_swa_type    swa_type,
+      const std::string &    spill_path,
+        const std::vector<lm_ggml_backend_t> & spill_sync) :
     model(model), hparams(model.hparams), v_trans(v_trans),
-    n_seq_max(n_seq_max), n_stream(unified ? 1 : n_seq_max), n_pad(n_pad), n_swa(n_swa), swa_type(swa_type) {
+    n_seq_max(n_seq_max), n_stream(unified ? 1 : n_seq_max), n_pad(n_pad), n_swa(n_swa), swa_type(swa_type),
+    spill_path(spill_path), spill_sync(spill_sync) {
 
     LM_GGML_ASSERT(kv_size % n_pad == 0);
 
@@ -77,6 +162,9 @@ llama_kv_cache_unified::llama_kv_cache_unified(
         v_cells[s].resize(kv_size);
     }
 
+    v_prefix_id .resize(n_stream, 0);
+    v_prefix_len.resize(n_stream, 0);
+
     // by default, all sequence ids are mapped to the 0th stream
     seq_to_stream.resize(LLAMA_MAX_SEQ, 0);
 
@@ -203,14 +291,32 @@ llama_kv_cache_unified::llama_kv_cache_unified(
     if (!supports_set_rows) {
         LLAMA_LOG_WARN("%s: LLAMA_SET_ROWS=0, using old lm_ggml_cpy() method for backwards compatibility\n", __func__);
     }
+
+    if (!spill_path.empty()) {
+        // create (or truncate) the spill file
+        llama_file file(spill_path.c_str(), "wb");
+
+        LLAMA_LOG_INFO("%s: spilling idle sequences to '%s'\n", __func__, spill_path.c_str());
+    }
+}
+
+llama_kv_cache_unified::~llama_kv_cache_unified() {
+    if (!spill_path.empty()) {
+        std::remove(spill_path.c_str());
+    }
 }
 
 void llama_kv_cache_unified::clear(bool data) {
     for (uint32_t s = 0; s < n_stream; ++s) {
         v_cells[s].reset();
         v_heads[s] = 0;
+
+        v_prefix_id [s] = 0;
+        v_prefix_len[s] = 0;
     }
 
+    spill_reset();
+
     if (data) {
         for (auto & buf : bufs) {
             lm_ggml_backend_buffer_clear(buf.get(), 0);
@@ -234,21 +340,33 @@ bool llama_kv_cache_unified::seq_rm(llama_seq_id seq_id, llama_pos p0, llama_pos
         p1 = std::numeric_limits<llama_pos>::max();
     }
 
-    if (seq_id >= 0) {
-        for (uint32_t i = 0; i < cells.size(); ++i) {
-            if (!cells.pos_in(i, p0, p1)) {
-                continue;
+    // spilled sequences: removing the whole sequence only drops the spilled copy, otherwise read it back first
+    for (llama_seq_id s = 0; s < (llama_seq_id) n_seq_max; ++s) {
+        if ((seq_id >= 0 && s != seq_id) || !spill_has(s)) {
+            continue;
+        }
+
+        const auto & se = spill_map.at(s);
+
+        if (p0 <= se.pos_min && p1 > se.pos_max) {
+            spill_drop(s);
+        } else if (p0 <= se.pos_max && p1 > se.pos_min) {
+            if (!spill_restore(s)) {
+                return false;
             }
+        }
+    }
 
-            if (cells.seq_has(i, seq_id) && cells.seq_rm(i, seq_id)) {
-                if (new_head == cells.size()) {
-                    new_head = i;
-                }
+    if (seq_id >= 0) {
+        // only visit the cells of the sequence in the range
+        for (const uint32_t i : cells.seq_cells(seq_id, p0, p1)) {
+            if (cells.seq_rm(i, seq_id)) {
+                new_head = std::min(new_head, i);
             }
         }
     } else {
         // match any sequence
-        for (uint32_t i = 0; i < cells.size(); ++i) {
+        for (uint32_t i = cells.find_used(0); i < cells.size(); i = cells.find_used(i + 1)) {
             if (!cells.pos_in(i, p0, p1)) {
                 continue;
             }
@@ -273,6 +391,13 @@ void llama_kv_cache_unified::seq_cp(llama_seq_id seq_id_src, llama_seq_id seq_id
     LM_GGML_ASSERT(seq_id_src >= 0 && (size_t) seq_id_src < seq_to_stream.size());
     LM_GGML_ASSERT(seq_id_dst >= 0 && (size_t) seq_id_dst < seq_to_stream.size());
 
+    if (seq_id_src != seq_id_dst) {
+        if (!spill_restore(seq_id_src) || !spill_restore(seq_id_dst)) {
+            LLAMA_LOG_ERROR("%s: failed to restore spilled seq_id = %d or %d, not enough free cells\n", __func__, seq_id_src, seq_id_dst);
+            return;
+        }
+    }
+
     const auto s0 = seq_to_stream[seq_id_src];
     const auto s1 = seq_to_stream[seq_id_dst];
 
@@ -294,14 +419,8 @@ void llama_kv_cache_unified::seq_cp(llama_seq_id seq_id_src, llama_seq_id seq_id
             p1 = std::numeric_limits<llama_pos>::max();
         }
 
-        for (uint32_t i = 0; i < cells.size(); ++i) {
-            if (!cells.pos_in(i, p0, p1)) {
-                continue;
-            }
-
-            if (cells.seq_has(i, seq_id_src)) {
-                cells.seq_add(i, seq_id_dst);
-            }
+        for (const uint32_t i : cells.seq_cells(seq_id_src, p0, p1)) {
+            cells.seq_add(i, seq_id_dst);
         }
 
         return;
@@ -326,27 +445,34 @@ void llama_kv_cache_unified::seq_cp(llama_seq_id seq_id_src, llama_seq_id seq_id
     sc_info.sdst.push_back(s1);
 
     v_cells[s1].reset();
-    for (uint32_t i = 0; i < v_cells[s0].size(); ++i) {
-        if (v_cells[s0].seq_has(i, seq_id_src)) {
-            llama_pos pos   = v_cells[s0].pos_get(i);
-            llama_pos shift = v_cells[s0].get_shift(i);
-
-            if (shift != 0) {
-                pos -= shift;
-                assert(pos >= 0);
-            }
+    for (const uint32_t i : v_cells[s0].seq_cells(seq_id_src, 0, std::numeric_limits<llama_pos>::max())) {
+        llama_pos pos   = v_cells[s0].pos_get(i);
+        llama_pos shift = v_cells[s0].get_shift(i);
 
-            v_cells[s1].pos_set(i, pos);
-            v_cells[s1].seq_add(i, seq_id_dst);
+        if (shift != 0) {
+            pos -= shift;
+            assert(pos >= 0);
+        }
 
-            if (shift != 0) {
-                v_cells[s1].pos_add(i, shift);
-            }
+        v_cells[s1].pos_set(i, pos);
+        v_cells[s1].seq_add(i, seq_id_dst);
+
+        if (shift != 0) {
+            v_cells[s1].pos_add(i, shift);
         }
     }
 
     v_heads[s1] = v_heads[s0];
 
+    // after the copy the two streams hold the same data - join the prefix of the source stream or start a new one
+    if (v_prefix_id[s0] == 0 || v_prefix_len[s0] == 0) {
+        v_prefix_id [s0] = prefix_id_next++;
+        v_prefix_len[s0] = get_size();
+    }
+
+    v_prefix_id [s1] = v_prefix_id [s0];
+    v_prefix_len[s1] = v_prefix_len[s0];
+
     //for (uint32_t s = 0; s < n_stream; ++s) {
     //    LLAMA_LOG_WARN("%s: seq %d: min = %d, max = %d\n", __func__, s, v_cells[s].seq_pos_min(s), v_cells[s].seq_pos_max(s));
     //}
@@ -358,9 +484,15 @@ void llama_kv_cache_unified::seq_keep(llama_seq_id seq_id) {
     auto & cells = v_cells[seq_to_stream[seq_id]];
     auto & head  = v_heads[seq_to_stream[seq_id]];
 
+    for (llama_seq_id s = 0; s < (llama_seq_id) n_seq_max; ++s) {
+        if (s != seq_id && spill_has(s)) {
+            spill_drop(s);
+        }
+    }
+
     uint32_t new_head = cells.size();
 
-    for (uint32_t i = 0; i < cells.size(); ++i) {
+    for (uint32_t i = cells.find_used(0); i < cells.size(); i = cells.find_used(i + 1)) {
         if (cells.seq_keep(i, seq_id)) {
             if (new_head == cells.size()) {
                 new_head = i;
@@ -384,6 +516,11 @@ void llama_kv_cache_unified::seq_add(llama_seq_id seq_id, llama_pos p0, llama_po
         return;
     }
 
+    if (!spill_restore(seq_id)) {
+        LLAMA_LOG_ERROR("%s: failed to restore spilled seq_id = %d, not enough free cells\n", __func__, seq_id);
+        return;
+    }
+
     uint32_t new_head = cells.size();
 
     if (p0 < 0) {
@@ -399,17 +536,12 @@ void llama_kv_cache_unified::seq_add(llama_seq_id seq_id, llama_pos p0, llama_po
         return;
     }
 
-    for (uint32_t i = 0; i < cells.size(); ++i) {
-        if (!cells.pos_in(i, p0, p1)) {
-            continue;
-        }
+    for (const uint32_t i : cells.seq_cells(seq_id, p0, p1)) {
+        // the K-shift will modify the data of the cell
+        prefix_trim(seq_to_stream[seq_id], i);
 
-        if (cells.seq_has(i, seq_id)) {
-            if (cells.pos_add(i, shift)) {
-                if (new_head == cells.size()) {
-                    new_head = i;
-                }
-            }
+        if (cells.pos_add(i, shift)) {
+            new_head = std::min(new_head, i);
         }
     }
 
@@ -427,6 +559,11 @@ void llama_kv_cache_unified::seq_div(llama_seq_id seq_id, llama_pos p0, llama_po
         return;
     }
 
+    if (!spill_restore(seq_id)) {
+        LLAMA_LOG_ERROR("%s: failed to restore spilled seq_id = %d, not enough free cells\n", __func__, seq_id);
+        return;
+    }
+
     if (p0 < 0) {
         p0 = 0;
     }
@@ -440,20 +577,20 @@ void llama_kv_cache_unified::seq_div(llama_seq_id seq_id, llama_pos p0, llama_po
         return;
     }
 
-    for (uint32_t i = 0; i < cells.size(); ++i) {
-        if (!cells.pos_in(i, p0, p1)) {
-            continue;
-        }
+    for (const uint32_t i : cells.seq_cells(seq_id, p0, p1)) {
+        prefix_trim(seq_to_stream[seq_id], i);
 
-        if (cells.seq_has(i, seq_id)) {
-            cells.pos_div(i, d);
-        }
+        cells.pos_div(i, d);
     }
 }
 
 llama_pos llama_kv_cache_unified::seq_pos_min(llama_seq_id seq_id) const {
     LM_GGML_ASSERT(seq_id >= 0 && (size_t) seq_id < seq_to_stream.size());
 
+    if (spill_has(seq_id)) {
+        return spill_map.at(seq_id).pos_min;
+    }
+
     const auto & cells = v_cells[seq_to_stream[seq_id]];
 
     return cells.seq_pos_min(seq_id);
@@ -462,11 +599,93 @@ llama_pos llama_kv_cache_unified::seq_pos_min(llama_seq_id seq_id) const {
 llama_pos llama_kv_cache_unified::seq_pos_max(llama_seq_id seq_id) const {
     LM_GGML_ASSERT(seq_id >= 0 && (size_t) seq_id < seq_to_stream.size());
 
+    if (spill_has(seq_id)) {
+        return spill_map.at(seq_id).pos_max;
+    }
+
     const auto & cells = v_cells[seq_to_stream[seq_id]];
 
     return cells.seq_pos_max(seq_id);
 }
 
+bool llama_kv_cache_unified::seq_offload(llama_seq_id seq_id) {
+    LM_GGML_ASSERT(seq_id >= 0 && (size_t) seq_id < seq_to_stream.size());
+
+    if (spill_path.empty()) {
+        return false;
+    }
+
+    if (spill_has(seq_id)) {
+        return true;
+    }
+
+    const auto & cells = v_cells[seq_to_stream[seq_id]];
+
+    const llama_pos pos_min = cells.seq_pos_min(seq_id);
+    const llama_pos pos_max = cells.seq_pos_max(seq_id);
+
+    if (pos_max < 0) {
+        // nothing to offload
+        return true;
+    }
+
+    const uint32_t n_cells = cells.seq_cells(seq_id, pos_min, pos_max + 1).size();
+
+    // the cells are read from the backend buffers, a graph that is still running may write to them
+    for (auto * backend : spill_sync) {
+        lm_ggml_backend_synchronize(backend);
+    }
+
+    llama_io_write_spill io_size(nullptr);
+    state_write(io_size, seq_id);
+
+    const size_t size = io_size.n_bytes();
+
+    // find a free region of the spill file that fits the sequence, or append at the end
+    size_t offs = spill_size;
+    for (auto it = spill_free.begin(); it != spill_free.end(); ++it) {
+        if (it->second >= size) {
+            offs = it->first;
+
+            it->first  += size;
+            it->second -= size;
+            if (it->second == 0) {
+                spill_free.erase(it);
+            }
+            break;
+        }
+    }
+
+    try {
+        llama_file file(spill_path.c_str(), "r+b");
+        file.seek(offs, SEEK_SET);
+
+        llama_io_write_spill io(&file);
+        state_write(io, seq_id);
+
+        LM_GGML_ASSERT(io.n_bytes() == size);
+    } catch (const std::exception & err) {
+        LLAMA_LOG_ERROR("%s: failed to spill seq_id = %d: %s\n", __func__, seq_id, err.what());
+
+        if (offs != spill_size) {
+            spill_release(offs, size);
+        }
+        return false;
+    }
+
+    spill_size = std::max(spill_size, offs + size);
+
+    LLAMA_LOG_DEBUG("%s: spilled seq_id = %d, pos = [%d, %d], %.2f MiB at offset %zu\n",
+            __func__, seq_id, pos_min, pos_max, size/1024.0/1024.0, offs);
+
+    // free the cells - note: this has to happen before registering the spill entry, otherwise seq_rm() would drop it
+    seq_rm(seq_id, -1, -1);
+
+    spill_map[seq_id] = { offs, size, n_cells, pos_min, pos_max };
+
+    return true;
+}
+
 llama_memory_context_ptr llama_kv_cache_unified::init_batch(
             llama_batch_allocr & balloc,
             uint32_t n_ubatch,
@@ -547,6 +766,23 @@ llama_memory_context_ptr llama_kv_cache_unified::init_update(llama_context * lct
 llama_kv_cache_unified::slot_info_vec_t llama_kv_cache_unified::prepare(const std::vector<llama_ubatch> & ubatches) {
     llama_kv_cache_unified::slot_info_vec_t res;
 
+    // read back the spilled sequences that are about to be used
+    if (!spill_map.empty()) {
+        for (const auto & ubatch : ubatches) {
+            for (uint32_t s = 0; s < ubatch.n_seqs_unq; ++s) {
+                const llama_seq_id seq_id = ubatch.seq_id_unq[s];
+
+                while (spill_has(seq_id) && !spill_restore(seq_id)) {
+                    // no room for the sequence - spill another one
+                    if (!spill_evict(ubatches)) {
+                        LLAMA_LOG_ERROR("%s: failed to restore spilled seq_id = %d\n", __func__, seq_id);
+                        return {};
+                    }
+                }
+            }
+        }
+    }
+
     struct state_t {
         slot_info sinfo; // slot info for the ubatch
 
@@ -558,6 +794,8 @@ llama_kv_cache_unified::slot_info_vec_t llama_kv_cache_unified::prepare(const st
     // remember the old state of the cells so we can restore it in the end
     std::vector<state_t> states;
 
+    const auto v_prefix_len_old = v_prefix_len;
+
     bool success = true;
 
     for (const auto & ubatch : ubatches) {
@@ -606,7 +844,14 @@ llama_kv_cache_unified::slot_info_vec_t llama_kv_cache_unified::prepare(const st
         }
     }
 
+    v_prefix_len = v_prefix_len_old;
+
     if (!success) {
+        // make room by spilling an idle sequence and try again
+        if (spill_evict(ubatches)) {
+            return prepare(ubatches);
+        }
+
         return {};
     }
 
@@ -702,6 +947,8 @@ bool llama_kv_cache_unified::update(llama_context * lctx, bool do_shift, const d
                 }
 
                 cells.mv(i, dinfo.ids[i]);
+
+                prefix_trim(seq_to_stream[0], dinfo.ids[i]);
             }
 
             // reset the head so we can find the first free slot during the next ubatch
@@ -845,6 +1092,38 @@ llama_kv_cache_unified::slot_info llama_kv_cache_unified::find_slot(const llama_
             return { };
         }
 
+        // without SWA only empty cells can be used - look them up in the free-cell bitmap instead of testing each cell
+        if (swa_type == LLAMA_SWA_TYPE_NONE) {
+            if (cont) {
+                uint32_t idx = cells.find_empty_run(head_cur, n_tokens);
+                if (idx == cells.size()) {
+                    idx = cells.find_empty_run(0, n_tokens);
+                }
+
+                if (idx == cells.size()) {
+                    return { };
+                }
+
+                for (uint32_t i = 0; i < n_tokens; ++i) {
+                    res.idxs[s].push_back(idx + i);
+                }
+            } else {
+                for (uint32_t idx = cells.find_empty(head_cur); idx < cells.size() && res.idxs[s].size() < n_tokens; idx = cells.find_empty(idx + 1)) {
+                    res.idxs[s].push_back(idx);
+                }
+
+                for (uint32_t idx = cells.find_empty(0); idx < head_cur && res.idxs[s].size() < n_tokens; idx = cells.find_empty(idx + 1)) {
+                    res.idxs[s].push_back(idx);
+                }
+
+                if (res.idxs[s].size() < n_tokens) {
+                    return { };
+                }
+            }
+
+            continue;
+        }
+
         uint32_t n_tested = 0;
 
         // for continuous slots, we test that all tokens in the ubatch fit, starting from the current head
@@ -946,6 +1225,8 @@ void llama_kv_cache_unified::apply_ubatch(const slot_info & sinfo, const llama_u
 
             const auto idx = sinfo.idxs[s][ii];
 
+            prefix_trim(sinfo.strm[s], idx);
+
             if (!cells.is_empty(idx)) {
                 assert(cells.seq_count(idx) == 1);
 
@@ -991,6 +1272,11 @@ void llama_kv_cache_unified::apply_ubatch(const slot_info & sinfo, const llama_u
 
         head = sinfo.idxs[s].back() + 1;
     }
+
+    ++seq_tick;
+    for (uint32_t s = 0; s < ubatch.n_seqs_unq; ++s) {
+        seq_last_used[ubatch.seq_id_unq[s]] = seq_tick;
+    }
 }
 
 bool llama_kv_cache_unified::get_can_shift() const {
@@ -1029,6 +1315,33 @@ uint32_t llama_kv_cache_unified::get_n_kv() const {
     return result;
 }
 
+uint32_t llama_kv_cache_unified::get_n_prefix(uint32_t n_kv, const slot_info & sinfo) const {
+    if (sinfo.s1 == sinfo.s0) {
+        return 0;
+    }
+
+    const uint32_t id = v_prefix_id[sinfo.s0];
+    if (id == 0) {
+        return 0;
+    }
+
+    uint32_t result = n_kv;
+
+    for (llama_seq_id s = sinfo.s0; s <= sinfo.s1; ++s) {
+        if (v_prefix_id[s] != id) {
+            return 0;
+        }
+
+        result = std::min(result, v_prefix_len[s]);
+    }
+
+    // round down to the padding, so that the shape of the graph changes as rarely as n_kv does
+    result -= result % n_pad;
+
+    // at least one cell of each stream has to be private - the ones of the current ubatch
+    return result < n_kv ? result : 0;
+}
+
 bool llama_kv_cache_unified::get_supports_set_rows() const {
     return supports_set_rows;
 }
@@ -1809,6 +2122,16 @@ bool llama_kv_cache_unified::is_masked_swa(llama_pos p0, llama_pos p1) const {
 }
 
 void llama_kv_cache_unified::state_write(llama_io_write_i & io, llama_seq_id seq_id) const {
+    if (seq_id >= 0 && spill_has(seq_id)) {
+        // the spill entry is already in the sequence state format
+        const auto & se = spill_map.at(seq_id);
+
+        llama_spill_view view(spill_path, se.offs, se.size);
+        io.write(view.data, se.size);
+
+        return;
+    }
+
     io.write(&n_stream, sizeof(n_stream));
 
     for (uint32_t s = 0; s < n_stream; ++s) {
@@ -1857,6 +2180,10 @@ void llama_kv_cache_unified::state_write(llama_io_write_i & io, llama_seq_id seq
         state_write_meta(io, cr, seq_id);
         state_write_data(io, cr);
     }
+
+    if (seq_id == -1) {
+        state_write_spill(io);
+    }
 }
 
 void llama_kv_cache_unified::state_read(llama_io_read_i & io, llama_seq_id seq_id) {
@@ -1891,6 +2218,10 @@ void llama_kv_cache_unified::state_read(llama_io_read_i & io, llama_seq_id seq_i
             throw std::runtime_error("failed to restore kv cache");
         }
     }
+
+    if (seq_id == -1) {
+        state_read_spill(io);
+    }
 }
 
 void llama_kv_cache_unified::state_write_meta(llama_io_write_i & io, const cell_ranges_t & cr, llama_seq_id seq_id) const {
@@ -2249,6 +2580,233 @@ bool llama_kv_cache_unified::state_read_data(llama_io_read_i & io, uint32_t strm
     return true;
 }
 
+void llama_kv_cache_unified::state_write_spill(llama_io_write_i & io) const {
+    // the spilled sequences are not in the cells, they follow them in the sequence state format
+    const uint32_t n_spilled = spill_map.size();
+    io.write(&n_spilled, sizeof(n_spilled));
+
+    for (const auto & it : spill_map) {
+        const llama_seq_id  seq_id = it.first;
+        const spill_entry & se     = it.second;
+
+        const uint64_t size = se.size;
+
+        io.write(&seq_id,     sizeof(seq_id));
+        io.write(&se.n_cells, sizeof(se.n_cells));
+        io.write(&se.pos_min, sizeof(se.pos_min));
+        io.write(&se.pos_max, sizeof(se.pos_max));
+        io.write(&size,       sizeof(size));
+
+        llama_spill_view view(spill_path, se.offs, se.size);
+        io.write(view.data, se.size);
+    }
+}
+
+void llama_kv_cache_unified::state_read_spill(llama_io_read_i & io) {
+    // the spill file of the previous state is not referenced anymore
+    spill_reset();
+
+    uint32_t n_spilled;
+    io.read_to(&n_spilled, sizeof(n_spilled));
+
+    for (uint32_t i = 0; i < n_spilled; ++i) {
+        llama_seq_id seq_id;
+        spill_entry  se;
+        uint64_t     size;
+
+        io.read_to(&seq_id,     sizeof(seq_id));
+        io.read_to(&se.n_cells, sizeof(se.n_cells));
+        io.read_to(&se.pos_min, sizeof(se.pos_min));
+        io.read_to(&se.pos_max, sizeof(se.pos_max));
+        io.read_to(&size,       sizeof(size));
+
+        if (seq_id < 0 || (uint32_t) seq_id >= n_seq_max) {
+            throw std::runtime_error("invalid spilled seq_id");
+        }
+
+        const uint8_t * data = io.read(size);
+
+        if (spill_path.empty()) {
+            // spilling is disabled in this context, the sequence has to fit in the cells
+            llama_io_read_spill io_seq(data, size);
+            state_read(io_seq, seq_id);
+
+            continue;
+        }
+
+        se.offs = spill_size;
+        se.size = size;
+
+        llama_file file(spill_path.c_str(), "r+b");
+        file.seek(se.offs, SEEK_SET);
+        file.write_raw(data, size);
+
+        spill_size += size;
+        spill_map[seq_id] = se;
+    }
+}
+
+void llama_kv_cache_unified::prefix_trim(uint32_t s, uint32_t i) {
+    v_prefix_len[s] = std::min(v_prefix_len[s], i);
+}
+
+bool llama_kv_cache_unified::spill_has(llama_seq_id seq_id) const {
+    return spill_map.find(seq_id) != spill_map.end();
+}
+
+bool llama_kv_cache_unified::spill_restore(llama_seq_id seq_id) {
+    auto it = spill_map.find(seq_id);
+    if (it == spill_map.end()) {
+        return true;
+    }
+
+    const spill_entry se = it->second;
+
+    // the cells are read back into one contiguous slot, without SWA this is exactly what find_slot() looks for
+    // with SWA, cells masked by the window can be reused as well, so it is left to state_read()
+    if (swa_type == LLAMA_SWA_TYPE_NONE) {
+        const auto & cells = v_cells[seq_to_stream[seq_id]];
+
+        if (cells.find_empty_run(0, se.n_cells) == cells.size()) {
+            return false;
+        }
+    }
+
+    // unregister first - state_read() starts by removing the sequence
+    spill_map.erase(it);
+
+    bool res = true;
+
+    try {
+        llama_spill_view view(spill_path, se.offs, se.size);
+
+        llama_io_read_spill io(view.data, se.size);
+        state_read(io, seq_id);
+    } catch (const std::exception & err) {
+        LLAMA_LOG_DEBUG("%s: failed to restore seq_id = %d: %s\n", __func__, seq_id, err.what());
+        res = false;
+    }
+
+    if (!res) {
+        // keep the sequence spilled, the caller can make room and try again
+        spill_map[seq_id] = se;
+
+        return false;
+    }
+
+    LLAMA_LOG_DEBUG("%s: restored seq_id = %d, pos = [%d, %d]\n", __func__, seq_id, se.pos_min, se.pos_max);
+
+    spill_release(se.offs, se.size);
+
+    return true;
+}
+
+void llama_kv_cache_unified::spill_drop(llama_seq_id seq_id) {
+    auto it = spill_map.find(seq_id);
+    if (it == spill_map.end()) {
+        return;
+    }
+
+    spill_release(it->second.offs, it->second.size);
+    spill_map.erase(it);
+}
+
+void llama_kv_cache_unified::spill_release(size_t offs, size_t size) {
+    auto it = spill_free.insert(std::lower_bound(spill_free.begin(), spill_free.end(), std::make_pair(offs, size)), { offs, size });
+
+    // merge with the neighbours, so that the churn of offload/restore does not fragment the file
+    if (it + 1 != spill_free.end() && it->first + it->second == (it + 1)->first) {
+        it->second += (it + 1)->second;
+        spill_free.erase(it + 1);
+    }
+
+    if (it != spill_free.begin() && (it - 1)->first + (it - 1)->second == it->first) {
+        (it - 1)->second += it->second;
+        it = spill_free.erase(it) - 1;
+    }
+
+    if (it->first + it->second != spill_size) {
+        return;
+    }
+
+    // the tail of the file is free - give it back
+    spill_size = it->first;
+    spill_free.erase(it);
+
+    try {
+        llama_file file(spill_path.c_str(), "r+b");
+        file.truncate(spill_size);
+    } catch (const std::exception & err) {
+        // not fatal, the region is overwritten by the next spill
+        LLAMA_LOG_WARN("%s: failed to truncate the spill file: %s\n", __func__, err.what());
+    }
+}
+
+void llama_kv_cache_unified::spill_reset() {
+    spill_map.clear();
+    spill_free.clear();
+
+    if (spill_size == 0) {
+        return;
+    }
+
+    spill_size = 0;
+
+    try {
+        llama_file file(spill_path.c_str(), "r+b");
+        file.truncate(0);
+    } catch (const std::exception & err) {
+        LLAMA_LOG_WARN("%s: failed to truncate the spill file: %s\n", __func__, err.what());
+    }
+}
+
+bool llama_kv_cache_unified::spill_evict(const std::vector<llama_ubatch> & ubatches) {
+    if (spill_path.empty()) {
+        return false;
+    }
+
+    bool in_use[LLAMA_MAX_SEQ] = {};
+
+    for (const auto & ubatch : ubatches) {
+        for (uint32_t s = 0; s < ubatch.n_seqs_unq; ++s) {
+            in_use[ubatch.seq_id_unq[s]] = true;
+        }
+    }
+
+    // only sequences that share a stream with the ubatches free up useful cells
+    bool strm_used[LLAMA_MAX_SEQ] = {};
+
+    for (llama_seq_id s = 0; s < (llama_seq_id) n_seq_max; ++s) {
+        if (in_use[s]) {
+            strm_used[seq_to_stream[s]] = true;
+        }
+    }
+
+    llama_seq_id victim = -1;
+
+    for (llama_seq_id s = 0; s < (llama_seq_id) n_seq_max; ++s) {
+        if (in_use[s] || !strm_used[seq_to_stream[s]] || spill_has(s)) {
+            continue;
+        }
+
+        if (v_cells[seq_to_stream[s]].seq_pos_max(s) < 0) {
+            continue;
+        }
+
+        if (victim == -1 || seq_last_used[s] < seq_last_used[victim]) {
+            victim = s;
+        }
+    }
+
+    if (victim == -1) {
+        return false;
+    }
+
+    LLAMA_LOG_DEBUG("%s: spilling idle seq_id = %d\n", __func__, victim);
+
+    return seq_offload(victim);
+}
+
 //
 // llama_kv_cache_unified_context
 //
@@ -2315,6 +2873,8 @@ bool llama_kv_cache_unified_context::apply() {
 
     n_kv = kv->get_n_kv();
 
+    n_prefix = kv->get_n_prefix(n_kv, sinfos[i_cur]);
+
     return true;
 }
 
@@ -2332,6 +2892,10 @@ uint32_t llama_kv_cache_unified_context::get_n_kv() const {
     return n_kv;
 }
 
+uint32_t llama_kv_cache_unified_context::get_n_prefix() const {
+    return n_prefix;
+}
+
 bool llama_kv_cache_unified_context::get_supports_set_rows() const {
     return kv->get_supports_set_rows();
 }
@@ -5,6 +5,8 @@
 #include "llama-kv-cells.h"
 #include "llama-memory.h"
 
+#include <map>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -104,9 +106,11 @@ public:
                      uint32_t    n_seq_max,
                      uint32_t    n_pad,
                      uint32_t    n_swa,
-               llama_swa_type    swa_type);
+               llama_swa_type    swa_type,
+          const std::string &    spill_path,
+    const std::vector<lm_ggml_backend_t> & spill_sync);
 
-    ~llama_kv_cache_unified() = default;
+    ~llama_kv_cache_unified();
 
     //
     // llama_memory_i
@@ -134,6 +138,8 @@ public:
     llama_pos seq_pos_min(llama_seq_id seq_id) const override;
     llama_pos seq_pos_max(llama_seq_id seq_id) const override;
 
+    bool seq_offload(llama_seq_id seq_id) override;
+
     // state write/load
 
     void state_write(llama_io_write_i & io, llama_seq_id seq_id = -1) const override;
@@ -154,6 +160,10 @@ public:
 
     uint32_t get_n_kv() const;
 
+    // number of leading cells that hold the same data in all streams of the slot (see v_prefix_id)
+    // returns 0 for a single stream or if there is nothing to share
+    uint32_t get_n_prefix(uint32_t n_kv, const slot_info & sinfo) const;
+
     // TODO: temporary
     bool get_supports_set_rows() const;
 
@@ -249,6 +259,17 @@ private:
     // pending stream copies that will be applied during the next update
     stream_copy_info sc_info;
 
+    // streams that were copied from one another with seq_cp() hold the same data in their leading cells
+    // v_prefix_id[s] identifies the copy (0 - none) and v_prefix_len[s] is the number of leading cells of stream s
+    // that have not been written since then. streams with the same id share the first min(v_prefix_len) cells
+    std::vector<uint32_t> v_prefix_id;
+    std::vector<uint32_t> v_prefix_len;
+
+    uint32_t prefix_id_next = 1;
+
+    // a write to cell i of stream s ends the shared prefix of the stream at i
+    void prefix_trim(uint32_t s, uint32_t i);
+
     std::vector<kv_layer> layers;
 
     // model layer id -> KV cache layer id
@@ -293,6 +314,66 @@ private:
 
     bool state_read_meta(llama_io_read_i & io, uint32_t strm, uint32_t cell_count, llama_seq_id dest_seq_id = -1);
     bool state_read_data(llama_io_read_i & io, uint32_t strm, uint32_t cell_count);
+
+    // the spilled sequences of a full state, after the cells
+    void state_write_spill(llama_io_write_i & io) const;
+    void state_read_spill (llama_io_read_i  & io);
+
+    //
+    // spill file
+    //
+
+    // the cells of idle sequences can be moved to the spill file in the format of state_write(io, seq_id)
+    // this frees the cells for the active sequences. the spilled sequences are read back into the cache
+    // when they are used again (see prepare())
+
+    struct spill_entry {
+        size_t offs;
+        size_t size;
+
+        // number of cells of the sequence, they are restored into a contiguous slot
+        uint32_t n_cells;
+
+        // the positions of the sequence at the time of spilling - reported by seq_pos_min/max()
+        llama_pos pos_min;
+        llama_pos pos_max;
+    };
+
+    // empty = spilling is disabled
+    const std::string spill_path;
+
+    // waited for before the cells are read back from the backend buffers
+    const std::vector<lm_ggml_backend_t> spill_sync;
+
+    // end of the used region of the spill file
+    size_t spill_size = 0;
+
+    std::map<llama_seq_id, spill_entry> spill_map;
+
+    // released regions of the spill file, [offs, offs + size), sorted by offset and without adjacent regions
+    std::vector<std::pair<size_t, size_t>> spill_free;
+
+    // used to pick the least recently used sequence when the cache runs out of cells
+    uint64_t seq_tick = 0;
+    uint64_t seq_last_used[LLAMA_MAX_SEQ] = {};
+
+    bool spill_has(llama_seq_id seq_id) const;
+
+    // read a spilled sequence back into the cache. returns false if it cannot be placed
+    bool spill_restore(llama_seq_id seq_id);
+
+    // forget a spilled sequence without restoring it
+    void spill_drop(llama_seq_id seq_id);
+
+    // return a region of the spill file to the free list, the file is truncated when its tail becomes free
+    void spill_release(size_t offs, size_t size);
+
+    // forget all spilled sequences and truncate the spill file
+    void spill_reset();
+
+    // spill the least recently used sequence that is not part of the ubatches
+    // returns false if there is no such sequence
+    bool spill_evict(const std::vector<llama_ubatch> & ubatches);
 };
 
 class llama_kv_cache_unified_context : public llama_memory_context_i {
@@ -341,6 +422,9 @@ public:
 
     uint32_t get_n_kv() const;
 
+    // number of leading KV cells shared by all streams of the ubatch (cascade attention)
+    uint32_t get_n_prefix() const;
+
     // TODO: temporary
     bool get_supports_set_rows() const;
 
@@ -396,4 +480,6 @@ private:
     // a heuristic, to avoid attending the full cache if it is not yet utilized
     // as the cache gets filled, the benefit from this heuristic disappears
     int32_t n_kv;
+
+    uint32_t n_prefix = 0;
 };
@@ -4,10 +4,16 @@
 #include "llama-cparams.h"
 
 #include <bitset>
+#include <algorithm>
 #include <cassert>
 #include <vector>
 #include <set>
 #include <map>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 // meta information about KV cells that can be part of multiple sequences at the same time
 // TODO: add unit tests
@@ -22,7 +28,8 @@ public:
 
         has_shift = false;
 
-        used.clear();
+        used.assign((pos.size() + 63)/64, 0);
+        n_used = 0;
 
         for (uint32_t s = 0; s < LLAMA_MAX_SEQ; ++s) {
             seq_pos[s].clear();
@@ -57,19 +64,85 @@ public:
     }
 
     uint32_t get_used() const {
-        return used.size();
+        return n_used;
     }
 
     // the index of the first cell that is used
     // return 0 if no cells are used
     uint32_t used_min() const {
-        return used.empty() ? 0 : *used.begin();
+        return n_used == 0 ? 0 : find_used(0);
     }
 
     // the index of the last cell that is used + 1
     // return 0 if no cells are used
     uint32_t used_max_p1() const {
-        return used.empty() ? 0 : *used.rbegin() + 1;
+        for (size_t w = used.size(); w-- > 0;) {
+            if (used[w]) {
+                return w*64 + bit_last(used[w]) + 1;
+            }
+        }
+
+        return 0;
+    }
+
+    // the index of the first empty cell in [i, size())
+    // return size() if there is no such cell
+    uint32_t find_empty(uint32_t i) const {
+        const uint32_t n = pos.size();
+
+        while (i < n) {
+            const uint32_t w = i/64;
+
+            // skip fully used words at once
+            const uint64_t bits = ~used[w] & (~uint64_t(0) << (i%64));
+            if (bits) {
+                return std::min<uint32_t>(w*64 + bit_first(bits), n);
+            }
+
+            i = (w + 1)*64;
+        }
+
+        return n;
+    }
+
+    // the index of the first used cell in [i, size())
+    // return size() if there is no such cell
+    uint32_t find_used(uint32_t i) const {
+        const uint32_t n = pos.size();
+
+        while (i < n) {
+            const uint32_t w = i/64;
+
+            const uint64_t bits = used[w] & (~uint64_t(0) << (i%64));
+            if (bits) {
+                return std::min<uint32_t>(w*64 + bit_first(bits), n);
+            }
+
+            i = (w + 1)*64;
+        }
+
+        return n;
+    }
+
+    // the start of the first run of at least n consecutive empty cells in [i, size())
+    // hops from run to run, so the cost is proportional to the number of runs and not the number of cells
+    // return size() if there is no such run
+    uint32_t find_empty_run(uint32_t i, uint32_t n) const {
+        const uint32_t size = pos.size();
+
+        while (true) {
+            i = find_empty(i);
+            if (i >= size || size - i < n) {
+                return size;
+            }
+
+            const uint32_t j = find_used(i);
+            if (j - i >= n) {
+                return i;
+            }
+
+            i = j;
+        }
     }
 
     bool get_has_shift() const {
@@ -84,16 +157,21 @@ public:
         assert(pos[idst] == -1);
         assert(pos[isrc] != -1);
 
+        // seq_pos is keyed by the cell index too
+        seq_pos_rm(isrc);
+
         pos  [idst] = pos  [isrc];
         shift[idst] = shift[isrc];
         seq  [idst] = seq  [isrc];
 
+        seq_pos_add(idst);
+
         pos  [isrc] = -1;
         shift[isrc] =  0;
         seq  [isrc].reset();
 
-        used.erase (isrc);
-        used.insert(idst);
+        used_clr(isrc);
+        used_set(idst);
     }
 
     // copy the state of cells [i, i + n) (used for save/restore the state of the cells)
@@ -142,11 +220,11 @@ public:
             const auto idx = i + j;
 
             if (pos[idx] == -1 && other.pos[j] != -1) {
-                used.insert(i + j);
+                used_set(i + j);
             }
 
             if (pos[idx] != -1 && other.pos[j] == -1) {
-                used.erase(i + j);
+                used_clr(i + j);
             }
 
             if (pos[idx] != -1) {
@@ -172,11 +250,11 @@ public:
             const auto idx = idxs[j];
 
             if (pos[idx] == -1 && other.pos[j] != -1) {
-                used.insert(idx);
+                used_set(idx);
             }
 
             if (pos[idx] != -1 && other.pos[j] == -1) {
-                used.erase(idx);
+                used_clr(idx);
             }
 
             if (pos[idx] != -1) {
@@ -205,7 +283,7 @@ public:
         pos[i] = -1;
         shift[i] = 0;
 
-        used.erase(i);
+        used_clr(i);
     }
 
     // note: call only if the cell has seq_id
@@ -217,13 +295,13 @@ public:
         assert(seq_id >= 0);
 
         seq[i].reset(seq_id);
-        seq_pos_dec(seq_id, pos[i]);
+        seq_pos_dec(seq_id, i);
 
         if (seq[i].none()) {
             pos[i] = -1;
             shift[i] = 0;
 
-            used.erase(i);
+            used_clr(i);
 
             return true;
         }
@@ -240,7 +318,7 @@ public:
             seq[i].reset();
 
             seq[i].set(seq_id);
-            seq_pos_inc(seq_id, pos[i]);
+            seq_pos_inc(seq_id, i);
 
             return false;
         }
@@ -252,7 +330,7 @@ public:
             pos[i] = -1;
             shift[i] = 0;
 
-            used.erase(i);
+            used_clr(i);
 
             return true;
         }
@@ -285,7 +363,7 @@ public:
         assert(!seq[i].test(seq_id));
 
         seq[i].set(seq_id);
-        seq_pos_inc(seq_id, pos[i]);
+        seq_pos_inc(seq_id, i);
     }
 
     // return the sequence id of this cell
@@ -312,8 +390,6 @@ public:
             return -1;
         }
 
-        assert(seq_pos[seq_id].begin()->second > 0);
-
         return seq_pos[seq_id].begin()->first;
     }
 
@@ -327,11 +403,31 @@ public:
             return -1;
         }
 
-        assert(seq_pos[seq_id].rbegin()->second > 0);
-
         return seq_pos[seq_id].rbegin()->first;
     }
 
+    // the indices of the cells of sequence seq_id with positions in [p0, p1), ordered by position
+    // only the cells of the sequence are visited, so this is cheap even for large caches
+    std::vector<uint32_t> seq_cells(llama_seq_id seq_id, llama_pos p0, llama_pos p1) const {
+        assert(seq_id >= 0);
+        assert(seq_id < LLAMA_MAX_SEQ);
+
+        std::vector<uint32_t> res;
+
+        if (p0 >= p1) {
+            return res;
+        }
+
+        const auto it0 = seq_pos[seq_id].lower_bound({ p0, 0 });
+        const auto it1 = seq_pos[seq_id].lower_bound({ p1, 0 });
+
+        for (auto it = it0; it != it1; ++it) {
+            res.push_back(it->second);
+        }
+
+        return res;
+    }
+
     // note: call only if the cell is not empty
     llama_pos pos_get(uint32_t i) const {
         assert(i < pos.size());
@@ -365,7 +461,7 @@ public:
 
         pos[i] = p;
 
-        used.insert(i);
+        used_set(i);
     }
 
     // pos[i] = pos[i] + d
@@ -387,7 +483,7 @@ public:
             pos[i] = -1;
             shift[i] = 0;
 
-            used.erase(i);
+            used_clr(i);
 
             return true;
         }
@@ -419,8 +515,12 @@ public:
 private:
     bool has_shift = false;
 
-    // set of indices of used cells (i.e. pos[i] != -1, allowed to not have any seq_id)
-    std::set<uint32_t> used;
+    // bitmap of the used cells (i.e. pos[i] != -1, allowed to not have any seq_id), 64 cells per word
+    // runs of empty cells are found by skipping whole words and counting bits, see find_empty_run()
+    std::vector<uint64_t> used;
+
+    // number of bits set in `used`
+    uint32_t n_used = 0;
 
     std::vector<llama_pos> pos;
 
@@ -446,36 +546,70 @@ private:
     // the bitset seq[i] tells us which sequences are currently occupying the i-th cell
     std::vector<seq_set_t> seq;
 
-    // the set seq_pos[s][p] tells us how many times the position p is currently present for sequence s
-    // if the position p is not present, seq_pos[s][p] is not set
+    // the set seq_pos[s] contains a (p, i) pair for each cell i that holds position p of sequence s
     // this way seq_pos[s].begin() and seq_pos[s].rbegin() give us the min/max positions currently in the cache
+    // and the cells of a position range of the sequence can be visited without scanning the whole cache
     //
-    // note that we cannot a use an std::set because in some cases a position can occur more than once for the same seq:
+    // note that the cell index is part of the key because in some cases a position can occur more than once for the same seq:
     //  - during performing a cache reuse via (rm + add)
     //  - some vision models have input embeddings with repeating positions
     //
-    std::map<llama_pos, int> seq_pos[LLAMA_MAX_SEQ];
+    std::set<std::pair<llama_pos, uint32_t>> seq_pos[LLAMA_MAX_SEQ];
 
-    // helper functions for updating `seq_pos`, once cell at a time:
+    // helper functions for updating `used`:
 
-    void seq_pos_dec(llama_seq_id s, llama_pos p) {
-        auto it = seq_pos[s].find(p);
-        assert(it != seq_pos[s].end());
+    void used_set(uint32_t i) {
+        assert(!(used[i/64] & (uint64_t(1) << (i%64))));
 
-        if (--it->second == 0) {
-            seq_pos[s].erase(it);
-        }
+        used[i/64] |= uint64_t(1) << (i%64);
+        n_used++;
+    }
+
+    void used_clr(uint32_t i) {
+        assert(used[i/64] & (uint64_t(1) << (i%64)));
+
+        used[i/64] &= ~(uint64_t(1) << (i%64));
+        n_used--;
+    }
+
+    // index of the lowest/highest set bit, note: call only with x != 0
+    static uint32_t bit_first(uint64_t x) {
+#if defined(_MSC_VER)
+        unsigned long r;
+        _BitScanForward64(&r, x);
+        return r;
+#else
+        return __builtin_ctzll(x);
+#endif
+    }
+
+    static uint32_t bit_last(uint64_t x) {
+#if defined(_MSC_VER)
+        unsigned long r;
+        _BitScanReverse64(&r, x);
+        return r;
+#else
+        return 63 - __builtin_clzll(x);
+#endif
+    }
+
+    // helper functions for updating `seq_pos`, once cell at a time:
+
+    void seq_pos_dec(llama_seq_id s, uint32_t i) {
+        const auto n = seq_pos[s].erase({ pos[i], i });
+        assert(n == 1);
+        (void) n;
     }
 
-    void seq_pos_inc(llama_seq_id s, llama_pos p) {
-        seq_pos[s][p]++;
+    void seq_pos_inc(llama_seq_id s, uint32_t i) {
+        seq_pos[s].insert({ pos[i], i });
     }
 
     // remove cell i
     void seq_pos_rm(uint32_t i) {
         for (int s = 0; s < LLAMA_MAX_SEQ; ++s) {
             if (seq[i].test(s)) {
-                seq_pos_dec(s, pos[i]);
+                seq_pos_dec(s, i);
             }
         }
     }
@@ -484,7 +618,7 @@ private:
     void seq_pos_add(uint32_t i) {
         for (int s = 0; s < LLAMA_MAX_SEQ; ++s) {
             if (seq[i].test(s)) {
-                seq_pos_inc(s, pos[i]);
+                seq_pos_inc(s, i);
             }
         }
     }
@@ -18,10 +18,14 @@ llama_memory_hybrid::llama_memory_hybrid(
              uint32_t    n_pad,
              uint32_t    n_swa,
        llama_swa_type    swa_type,
+  const std::string &    spill_path,
+    const std::vector<lm_ggml_backend_t> & spill_sync,
                          /* recurrent */
             lm_ggml_type    type_r,
             lm_ggml_type    type_s,
              uint32_t    rs_size,
+             uint32_t    rs_n_ckpt,
+             uint32_t    rs_ckpt_interval,
                          /* common */
              uint32_t    n_seq_max,
                  bool    offload,
@@ -43,7 +47,9 @@ llama_memory_hybrid::llama_memory_hybrid(
         n_seq_max,
         n_pad,
         n_swa,
-        swa_type
+        swa_type,
+        spill_path,
+        spill_sync
     )),
     mem_recr(new llama_memory_recurrent(
         model,
@@ -54,7 +60,9 @@ llama_memory_hybrid::llama_memory_hybrid(
         type_s,
         offload,
         rs_size,
-        n_seq_max
+        n_seq_max,
+        rs_n_ckpt,
+        rs_ckpt_interval
     )) {}
 
 llama_memory_context_ptr llama_memory_hybrid::init_batch(llama_batch_allocr & balloc, uint32_t n_ubatch, bool embd_all) {
@@ -131,6 +139,15 @@ bool llama_memory_hybrid::seq_rm(llama_seq_id seq_id, llama_pos p0, llama_pos p1
     if (!mem_recr->seq_rm(seq_id, p0, p1)) {
         return false;
     }
+
+    // the recurrent state might have gone back to a checkpoint before p0
+    if (seq_id >= 0 && p0 > 0) {
+        const llama_pos pos_max = mem_recr->seq_pos_max(seq_id);
+        if (pos_max >= 0 && pos_max + 1 < p0) {
+            p0 = pos_max + 1;
+        }
+    }
+
     return mem_attn->seq_rm(seq_id, p0, p1);
 }
 
@@ -164,6 +181,11 @@ llama_pos llama_memory_hybrid::seq_pos_max(llama_seq_id seq_id) const {
     return std::min(mem_attn->seq_pos_max(seq_id), mem_recr->seq_pos_max(seq_id));
 }
 
+bool llama_memory_hybrid::seq_offload(llama_seq_id seq_id) {
+    // the recurrent state is a single cell per sequence, only the attention cells are worth offloading
+    return mem_attn->seq_offload(seq_id);
+}
+
 void llama_memory_hybrid::state_write(llama_io_write_i & io, llama_seq_id seq_id) const {
     mem_attn->state_write(io, seq_id);
     mem_recr->state_write(io, seq_id);
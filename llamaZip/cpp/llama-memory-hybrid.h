@@ -32,10 +32,14 @@ public:
                  uint32_t    n_pad,
                  uint32_t    n_swa,
            llama_swa_type    swa_type,
+      const std::string &    spill_path,
+        const std::vector<lm_ggml_backend_t> & spill_sync,
                              /* recurrent */
                 lm_ggml_type    type_r,
                 lm_ggml_type    type_s,
                  uint32_t    rs_size,
+                 uint32_t    rs_n_ckpt,
+                 uint32_t    rs_ckpt_interval,
                              /* common */
                  uint32_t    n_seq_max,
                      bool    offload,
@@ -71,6 +75,8 @@ public:
     llama_pos seq_pos_min(llama_seq_id seq_id) const override;
     llama_pos seq_pos_max(llama_seq_id seq_id) const override;
 
+    bool seq_offload(llama_seq_id seq_id) override;
+
     // state write/load
 
     void state_write(llama_io_write_i & io, llama_seq_id seq_id = -1) const override;
@@ -22,7 +22,10 @@ llama_memory_recurrent::llama_memory_recurrent(
                 lm_ggml_type    type_s,
                      bool    offload,
                  uint32_t    mem_size,
-                 uint32_t    n_seq_max) : hparams(model.hparams), n_seq_max(n_seq_max) {
+                 uint32_t    n_seq_max,
+                 uint32_t    n_ckpt,
+                 uint32_t    ckpt_interval) : hparams(model.hparams), n_seq_max(n_seq_max),
+    n_ckpt(ckpt_interval > 0 ? n_ckpt : 0), ckpt_interval(ckpt_interval) {
     const int32_t n_layer = hparams.n_layer;
 
     head = 0;
@@ -114,6 +117,10 @@ llama_memory_recurrent::llama_memory_recurrent(
                 (float)(memory_size_r + memory_size_s) / (1024.0f * 1024.0f), mem_size, n_layer, n_seq_max,
                 lm_ggml_type_name(type_r), (float)memory_size_r / (1024.0f * 1024.0f),
                 lm_ggml_type_name(type_s), (float)memory_size_s / (1024.0f * 1024.0f));
+
+        if (this->n_ckpt > 0) {
+            LLAMA_LOG_INFO("%s: keeping up to %u state checkpoints per sequence, every %u tokens\n", __func__, this->n_ckpt, this->ckpt_interval);
+        }
     }
 }
 
@@ -123,6 +130,7 @@ void llama_memory_recurrent::clear(bool data) {
         cells[i].seq_id.clear();
         cells[i].src = -1;
         cells[i].tail = -1;
+        cells[i].ckpt = -1;
     }
 
     head = 0;
@@ -155,6 +163,48 @@ bool llama_memory_recurrent::seq_rm(llama_seq_id seq_id, llama_pos p0, llama_pos
         int32_t & tail_id = cells[seq_id].tail;
         if (tail_id >= 0) {
             const auto & cell = cells[tail_id];
+            // removing the end of the sequence can be done by going back to a checkpoint before p0,
+            // the tokens between the checkpoint and p0 then have to be evaluated again by the caller
+            if (0 < p0 && p0 <= cell.pos && cell.pos < p1) {
+                const int32_t ckpt_id = ckpt_find(seq_id, p0);
+                if (ckpt_id < 0) {
+                    return false;
+                }
+
+                // the checkpoint is kept, the state is copied from it into the tail cell on the next ubatch
+                auto & tail = cells[tail_id];
+                if (tail.seq_id.size() > 1) {
+                    tail.seq_id.erase(seq_id);
+
+                    uint32_t i = 0;
+                    for (; i < size; ++i) {
+                        if (cells[i].is_empty()) {
+                            break;
+                        }
+                    }
+                    if (i == size) {
+                        // no space for a copy, the checkpoint becomes the tail
+                        cells[ckpt_id].ckpt = -1;
+                        cells[ckpt_id].seq_id.insert(seq_id);
+                        tail_id = ckpt_id;
+
+                        ckpt_rm(seq_id, p0, p1);
+
+                        return true;
+                    }
+
+                    cells[i].seq_id.insert(seq_id);
+                    tail_id = i;
+                    used += 1;
+                }
+
+                cells[tail_id].pos = cells[ckpt_id].pos;
+                cells[tail_id].src = ckpt_id;
+
+                ckpt_rm(seq_id, p0, p1);
+
+                return true;
+            }
             // partial intersection is invalid
             if ((0 < p0 && p0 <= cell.pos) || (0 < p1 && p1 <= cell.pos)) {
                 return false;
@@ -171,6 +221,8 @@ bool llama_memory_recurrent::seq_rm(llama_seq_id seq_id, llama_pos p0, llama_pos
         }
     }
 
+    ckpt_rm(seq_id, p0, p1);
+
     for (uint32_t i = 0; i < size; ++i) {
         if (cells[i].pos >= p0 && cells[i].pos < p1) {
             if (seq_id < 0) {
@@ -218,6 +270,10 @@ void llama_memory_recurrent::seq_cp(llama_seq_id seq_id_src, llama_seq_id seq_id
     if ((uint32_t) seq_id_dst < size && (uint32_t) seq_id_src < size) {
         auto & tail_src = cells[seq_id_src];
         auto & tail_dst = cells[seq_id_dst];
+
+        // the checkpoints are not shared, the destination starts without any
+        ckpt_rm(seq_id_dst, 0, std::numeric_limits<llama_pos>::max());
+
         if (tail_dst.tail >= 0) {
             // clear destination seq_id if it wasn't empty
             auto & cell_dst = cells[tail_dst.tail];
@@ -247,6 +303,14 @@ void llama_memory_recurrent::seq_keep(llama_seq_id seq_id) {
             cells[i].tail = -1;
         }
 
+        if (cells[i].ckpt >= 0) {
+            if (cells[i].ckpt == seq_id) {
+                continue;
+            }
+
+            cells[i].ckpt = -1;
+        }
+
         if (!cells[i].has_seq_id(seq_id)) {
             if (cells[i].pos >= 0) {
                 used--;
@@ -298,6 +362,13 @@ void llama_memory_recurrent::seq_add(llama_seq_id seq_id, llama_pos p0, llama_po
                 cell.pos += shift;
             }
         }
+
+        for (uint32_t i = 0; i < size; ++i) {
+            auto & cell = cells[i];
+            if (cell.ckpt == seq_id && p0 <= cell.pos && cell.pos < p1) {
+                cell.pos += shift;
+            }
+        }
     }
 }
 
@@ -328,6 +399,13 @@ void llama_memory_recurrent::seq_div(llama_seq_id seq_id, llama_pos p0, llama_po
                 cell.pos /= d;
             }
         }
+
+        for (uint32_t i = 0; i < size; ++i) {
+            auto & cell = cells[i];
+            if (cell.ckpt == seq_id && p0 <= cell.pos && cell.pos < p1) {
+                cell.pos /= d;
+            }
+        }
     }
 }
 
@@ -359,6 +437,11 @@ llama_pos llama_memory_recurrent::seq_pos_max(llama_seq_id seq_id) const {
     return result;
 }
 
+bool llama_memory_recurrent::seq_offload(llama_seq_id /*seq_id*/) {
+    // the recurrent states are small, there is nothing to gain from offloading them
+    return false;
+}
+
 llama_memory_context_ptr llama_memory_recurrent::init_batch(llama_batch_allocr & balloc, uint32_t n_ubatch, bool embd_all) {
     do {
         balloc.split_reset();
@@ -459,7 +542,7 @@ bool llama_memory_recurrent::find_slot(const llama_ubatch & ubatch) {
         for (uint32_t j = 0; j < n_seq_id; ++j) {
             const llama_seq_id seq_id = ubatch.seq_id[i][j];
 
-            if (seq_id < 0 || (uint32_t) seq_id >= size) {
+            if (seq_id < 0 || (uint32_t) seq_id >= n_seq_max) {
                 // too big seq_id
                 // TODO: would it be possible to resize the cache instead?
                 LLAMA_LOG_ERROR("%s: seq_id=%d >= n_seq_max=%u Try using a bigger --parallel value\n", __func__, seq_id, n_seq_max);
@@ -479,6 +562,7 @@ bool llama_memory_recurrent::find_slot(const llama_ubatch & ubatch) {
                         used -= 1;
                     }
                 }
+                ckpt_rm(seq_id, 0, std::numeric_limits<llama_pos>::max());
             }
         }
     }
@@ -504,6 +588,49 @@ bool llama_memory_recurrent::find_slot(const llama_ubatch & ubatch) {
     }
 #endif
 
+    // checkpoint the sequences which advanced by at least ckpt_interval tokens since their last checkpoint:
+    // the current tail cell is kept as the checkpoint and the sequence continues in a new cell (see below)
+    std::vector<bool> ckpt_due(n_seqs, false);
+
+    if (n_ckpt > 0) {
+        for (uint32_t s = 0; s < n_seqs; ++s) {
+            const uint32_t i = s*n_seq_tokens;
+            const llama_seq_id seq_id = ubatch.seq_id[i][0];
+            const int32_t tail_id = cells[seq_id].tail;
+            if (tail_id < 0) {
+                continue;
+            }
+
+            // only when the state of the tail is owned by the sequence and already stored in the cell
+            const auto & tail = cells[tail_id];
+            if (tail.seq_id.size() != 1 || tail.src != tail_id || tail.pos < 0) {
+                continue;
+            }
+
+            const int32_t last_id = ckpt_find(seq_id, std::numeric_limits<llama_pos>::max());
+            if (tail.pos + 1 - (last_id >= 0 ? cells[last_id].pos + 1 : 0) < (llama_pos) ckpt_interval) {
+                continue;
+            }
+
+            // the ring is full -> drop the oldest checkpoint
+            uint32_t n_seq_ckpt = 0;
+            int32_t  oldest_id  = -1;
+            for (uint32_t j = 0; j < size; ++j) {
+                if (cells[j].ckpt == seq_id) {
+                    n_seq_ckpt++;
+                    if (oldest_id < 0 || cells[j].pos < cells[oldest_id].pos) {
+                        oldest_id = j;
+                    }
+                }
+            }
+            if (n_seq_ckpt >= n_ckpt) {
+                ckpt_rm(seq_id, cells[oldest_id].pos, cells[oldest_id].pos + 1);
+            }
+
+            ckpt_due[s] = true;
+        }
+    }
+
     // find next empty cell
     uint32_t next_empty_cell = head;
 
@@ -525,6 +652,8 @@ bool llama_memory_recurrent::find_slot(const llama_ubatch & ubatch) {
             LM_GGML_ASSERT(cell.has_seq_id(seq_id));
             // does this seq_id "own" the cell?
             if (cell.seq_id.size() == 1) { has_cell = true; }
+            // move to a new cell when the current one becomes a checkpoint and there is room for it
+            if (ckpt_due[s] && cells[next_empty_cell].is_empty()) { has_cell = false; }
         }
         if (!has_cell) {
             auto & empty_cell = cells[next_empty_cell];
@@ -535,8 +664,12 @@ bool llama_memory_recurrent::find_slot(const llama_ubatch & ubatch) {
                 empty_cell.pos = orig_cell.pos;
                 empty_cell.src = orig_cell.src;
                 orig_cell.seq_id.erase(seq_id);
+                if (orig_cell.seq_id.empty()) {
+                    // keep the previous state as a checkpoint
+                    orig_cell.ckpt = seq_id;
+                }
                 empty_cell.seq_id.insert(seq_id); // will be overwritten
-                LM_GGML_ASSERT(!orig_cell.is_empty()); // has at least one remaining seq_id
+                LM_GGML_ASSERT(!orig_cell.is_empty()); // has at least one remaining seq_id or is a checkpoint
             }
             seq_meta.tail = next_empty_cell;
             // find next empty cell
@@ -565,6 +698,7 @@ bool llama_memory_recurrent::find_slot(const llama_ubatch & ubatch) {
             std::swap(dst_cell.pos, src_cell.pos);
             std::swap(dst_cell.src, src_cell.src);
             std::swap(dst_cell.seq_id, src_cell.seq_id);
+            std::swap(dst_cell.ckpt,   src_cell.ckpt);
 
             // swap tails
             for (uint32_t j = 0; j < size; ++j) {
@@ -647,6 +781,44 @@ bool llama_memory_recurrent::get_can_shift() const {
     return true;
 }
 
+void llama_memory_recurrent::ckpt_rm(llama_seq_id seq_id, llama_pos p0, llama_pos p1) {
+    if (n_ckpt == 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < size; ++i) {
+        auto & cell = cells[i];
+        if (cell.ckpt < 0 || (seq_id >= 0 && cell.ckpt != seq_id)) {
+            continue;
+        }
+
+        if (cell.pos >= p0 && cell.pos < p1) {
+            cell.pos  = -1;
+            cell.src  = -1;
+            cell.ckpt = -1;
+
+            used -= 1;
+
+            if (i < head) {
+                head = i;
+            }
+        }
+    }
+}
+
+int32_t llama_memory_recurrent::ckpt_find(llama_seq_id seq_id, llama_pos p1) const {
+    int32_t result = -1;
+
+    for (uint32_t i = 0; i < size; ++i) {
+        const auto & cell = cells[i];
+        if (cell.ckpt >= 0 && cell.ckpt == seq_id && cell.pos < p1 && (result < 0 || cell.pos > cells[result].pos)) {
+            result = i;
+        }
+    }
+
+    return result;
+}
+
 size_t llama_memory_recurrent::total_size() const {
     size_t size = 0;
     for (const auto & buf : bufs) {
@@ -689,7 +861,8 @@ void llama_memory_recurrent::state_write(llama_io_write_i & io, llama_seq_id seq
     uint32_t cell_range_begin = size;
     for (uint32_t i = 0; i < size; ++i) {
         const auto & cell = cells[i];
-        if ((seq_id == -1 && !cell.is_empty()) || cell.has_seq_id(seq_id)) {
+        // the checkpoints are not part of the saved state
+        if ((seq_id == -1 && !cell.seq_id.empty()) || cell.has_seq_id(seq_id)) {
             ++cell_count;
             if (cell_range_begin == size) {
                 cell_range_begin = i;
@@ -26,7 +26,9 @@ public:
                     lm_ggml_type    type_s,
                          bool    offload,
                      uint32_t    mem_size,
-                     uint32_t    n_seq_max);
+                     uint32_t    n_seq_max,
+                     uint32_t    n_ckpt,
+                     uint32_t    ckpt_interval);
 
     ~llama_memory_recurrent() = default;
 
@@ -54,6 +56,8 @@ public:
     llama_pos seq_pos_min(llama_seq_id seq_id) const override;
     llama_pos seq_pos_max(llama_seq_id seq_id) const override;
 
+    bool seq_offload(llama_seq_id seq_id) override;
+
     bool prepare(const std::vector<llama_ubatch> & ubatches);
 
     // find a contiguous slot of memory cells and emplace the ubatch there
@@ -83,6 +87,9 @@ public:
         int32_t   src0 = -1; // like src, but only used when setting the inputs (allowing to copy once)
         int32_t   tail = -1;
 
+        // the cell holds a checkpoint of the state of this sequence at pos (see find_slot())
+        llama_seq_id ckpt = -1;
+
         std::set<llama_seq_id> seq_id;
 
         bool has_seq_id(const llama_seq_id & id) const {
@@ -90,7 +97,7 @@ public:
         }
 
         bool is_empty() const {
-            return seq_id.empty();
+            return seq_id.empty() && ckpt < 0;
         }
 
         bool is_same_seq(const mem_cell & other) const {
@@ -110,11 +117,21 @@ private:
 
     const uint32_t n_seq_max = 1;
 
+    // number of state checkpoints kept per sequence and the number of tokens between them
+    const uint32_t n_ckpt        = 0;
+    const uint32_t ckpt_interval = 0;
+
     std::vector<lm_ggml_context_ptr>        ctxs;
     std::vector<lm_ggml_backend_buffer_ptr> bufs;
 
     size_t total_size() const;
 
+    // free the checkpoint cells of seq_id (all sequences if seq_id < 0) with pos in [p0, p1)
+    void ckpt_rm(llama_seq_id seq_id, llama_pos p0, llama_pos p1);
+
+    // return the checkpoint cell of seq_id with the highest pos < p1, or -1 if there is none
+    int32_t ckpt_find(llama_seq_id seq_id, llama_pos p1) const;
+
     size_t size_r_bytes() const;
     size_t size_s_bytes() const;
 
@@ -3,6 +3,8 @@
 #include "llama.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 struct llama_ubatch;
 
@@ -18,6 +20,16 @@ struct llama_memory_params {
 
     // use full-size SWA cache
     bool swa_full;
+
+    // file for the cells of idle sequences that are offloaded from the KV cache, empty = disabled
+    std::string spill_path;
+
+    // backends that compute with the memory, they are synchronized before the cells are written to the spill file
+    std::vector<lm_ggml_backend_t> spill_sync;
+
+    // recurrent state checkpoints kept per sequence for partial removal, 0 = disabled
+    uint32_t n_rs_ckpt;
+    uint32_t rs_ckpt_interval;
 };
 
 enum llama_memory_status {
@@ -100,6 +112,11 @@ struct llama_memory_i {
     virtual llama_pos seq_pos_min(llama_seq_id seq_id) const = 0;
     virtual llama_pos seq_pos_max(llama_seq_id seq_id) const = 0;
 
+    // move the memory of an idle sequence out of RAM and free its cells
+    // the sequence is restored transparently the next time it is used
+    // return false if the memory type does not support offloading
+    virtual bool seq_offload(llama_seq_id seq_id) = 0;
+
     //
     // state write/read
     //
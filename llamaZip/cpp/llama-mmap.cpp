@@ -4,6 +4,7 @@
 
 #include "ggml.h"
 
+#include <cstdio>
 #include <cstring>
 #include <climits>
 #include <stdexcept>
@@ -37,6 +38,10 @@
 
 #if defined(__APPLE__)
 #include <TargetConditionals.h>
+#include <mach/mach.h>
+#if TARGET_OS_IPHONE
+#include <os/proc.h>
+#endif
 #endif
 
 // TODO: consider moving to llama-impl.h if needed in more places
@@ -132,6 +137,27 @@ struct llama_file::impl {
         return val;
     }
 
+    void read_raw_at(void * ptr, size_t len, size_t offset) const {
+        size_t bytes_read = 0;
+        while (bytes_read < len) {
+            size_t chunk_size = std::min<size_t>(len - bytes_read, 64*1024*1024);
+            const uint64_t pos = offset + bytes_read;
+            OVERLAPPED overlapped = {};
+            overlapped.Offset     = (DWORD) (pos & 0xFFFFFFFF);
+            overlapped.OffsetHigh = (DWORD) (pos >> 32);
+            DWORD chunk_read = 0;
+            BOOL result = ReadFile(fp_win32, reinterpret_cast<char*>(ptr) + bytes_read, chunk_size, &chunk_read, &overlapped);
+            if (!result) {
+                throw std::runtime_error(format("read error: %s", GetErrorMessageWin32(GetLastError()).c_str()));
+            }
+            if (chunk_read < chunk_size || chunk_read == 0) {
+                throw std::runtime_error("unexpectedly reached end of file");
+            }
+
+            bytes_read += chunk_read;
+        }
+    }
+
     void write_raw(const void * ptr, size_t len) const {
         size_t bytes_written = 0;
         while (bytes_written < len) {
@@ -153,6 +179,13 @@ struct llama_file::impl {
         write_raw(&val, sizeof(val));
     }
 
+    void truncate(size_t len) const {
+        seek(len, SEEK_SET);
+        if (!SetEndOfFile(fp_win32)) {
+            throw std::runtime_error(format("truncate error: %s", GetErrorMessageWin32(GetLastError()).c_str()));
+        }
+    }
+
     ~impl() {
         if (fp) {
             std::fclose(fp);
@@ -215,6 +248,25 @@ struct llama_file::impl {
         return ret;
     }
 
+    void read_raw_at(void * ptr, size_t len, size_t offset) const {
+        const int fd = fileno(fp);
+        size_t bytes_read = 0;
+        while (bytes_read < len) {
+            const ssize_t ret = pread(fd, (char *) ptr + bytes_read, len - bytes_read, (off_t) (offset + bytes_read));
+            if (ret == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(format("read error: %s", strerror(errno)));
+            }
+            if (ret == 0) {
+                throw std::runtime_error("unexpectedly reached end of file");
+            }
+
+            bytes_read += ret;
+        }
+    }
+
     void write_raw(const void * ptr, size_t len) const {
         if (len == 0) {
             return;
@@ -230,6 +282,13 @@ struct llama_file::impl {
         write_raw(&val, sizeof(val));
     }
 
+    void truncate(size_t len) const {
+        std::fflush(fp);
+        if (ftruncate(fileno(fp), (off_t) len) != 0) {
+            throw std::runtime_error(format("truncate error: %s", strerror(errno)));
+        }
+    }
+
     ~impl() {
         if (fp) {
             std::fclose(fp);
@@ -261,12 +320,15 @@ int llama_file::file_id() const {
 
 void llama_file::seek(size_t offset, int whence) const { pimpl->seek(offset, whence); }
 void llama_file::read_raw(void * ptr, size_t len) const { pimpl->read_raw(ptr, len); }
+void llama_file::read_raw_at(void * ptr, size_t len, size_t offset) const { pimpl->read_raw_at(ptr, len, offset); }
 
 uint32_t llama_file::read_u32() const { return pimpl->read_u32(); }
 
 void llama_file::write_raw(const void * ptr, size_t len) const { pimpl->write_raw(ptr, len); }
 void llama_file::write_u32(uint32_t val) const { pimpl->write_u32(val); }
 
+void llama_file::truncate(size_t len) const { pimpl->truncate(len); }
+
 // llama_mmap
 
 struct llama_mmap::impl {
@@ -354,6 +416,37 @@ struct llama_mmap::impl {
         mapped_fragments = std::move(new_mapped_fragments);
     }
 
+    void prefetch(size_t first, size_t last) const {
+        const size_t page_size = sysconf(_SC_PAGESIZE);
+        first &= ~(page_size - 1);
+        if (last <= first) {
+            return;
+        }
+
+        if (madvise((uint8_t *) addr + first, last - first, MADV_WILLNEED)) {
+            LLAMA_LOG_DEBUG("%s: madvise(.., MADV_WILLNEED) failed: %s\n", __func__, strerror(errno));
+        }
+    }
+
+    void evict(size_t first, size_t last) const {
+        // only whole pages inside the range, the pages at the ends may be shared with a neighbouring range
+        align_range(&first, &last, sysconf(_SC_PAGESIZE));
+        if (last == first) {
+            return;
+        }
+
+        void * start = (uint8_t *) addr + first;
+#ifdef MADV_PAGEOUT
+        // reclaim the clean file pages now instead of waiting for the kernel to find them cold
+        if (madvise(start, last - first, MADV_PAGEOUT) == 0) {
+            return;
+        }
+#endif
+        if (madvise(start, last - first, MADV_DONTNEED)) {
+            LLAMA_LOG_DEBUG("%s: madvise(.., MADV_DONTNEED) failed: %s\n", __func__, strerror(errno));
+        }
+    }
+
     ~impl() {
         for (const auto & frag : mapped_fragments) {
             if (munmap((char *) addr + frag.first, frag.second - frag.first)) {
@@ -411,6 +504,36 @@ struct llama_mmap::impl {
         LM_GGML_UNUSED(last);
     }
 
+    void prefetch(size_t first, size_t last) const {
+        if (last <= first) {
+            return;
+        }
+#if _WIN32_WINNT >= 0x602
+        BOOL (WINAPI *pPrefetchVirtualMemory) (HANDLE, ULONG_PTR, PWIN32_MEMORY_RANGE_ENTRY, ULONG);
+        HMODULE hKernel32 = GetModuleHandleW(L"kernel32.dll");
+
+        pPrefetchVirtualMemory = (decltype(pPrefetchVirtualMemory))(void *) GetProcAddress(hKernel32, "PrefetchVirtualMemory");
+
+        if (pPrefetchVirtualMemory) {
+            WIN32_MEMORY_RANGE_ENTRY range;
+            range.VirtualAddress = (uint8_t *) addr + first;
+            range.NumberOfBytes = (SIZE_T) (last - first);
+            if (!pPrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0)) {
+                LLAMA_LOG_DEBUG("%s: PrefetchVirtualMemory failed: %s\n", __func__,
+                        llama_format_win_err(GetLastError()).c_str());
+            }
+        }
+#endif
+    }
+
+    void evict(size_t first, size_t last) const {
+        if (last <= first) {
+            return;
+        }
+        // unlocking pages that are not locked removes them from the working set, the call then reports ERROR_NOT_LOCKED
+        VirtualUnlock((uint8_t *) addr + first, last - first);
+    }
+
     ~impl() {
         if (!UnmapViewOfFile(addr)) {
             LLAMA_LOG_WARN("warning: UnmapViewOfFile failed: %s\n",
@@ -432,6 +555,16 @@ struct llama_mmap::impl {
 
         throw std::runtime_error("mmap not supported");
     }
+
+    void prefetch(size_t first, size_t last) const {
+        LM_GGML_UNUSED(first);
+        LM_GGML_UNUSED(last);
+    }
+
+    void evict(size_t first, size_t last) const {
+        LM_GGML_UNUSED(first);
+        LM_GGML_UNUSED(last);
+    }
 #endif
 
     void * addr;
@@ -445,6 +578,8 @@ size_t llama_mmap::size() const { return pimpl->size; }
 void * llama_mmap::addr() const { return pimpl->addr; }
 
 void llama_mmap::unmap_fragment(size_t first, size_t last) { pimpl->unmap_fragment(first, last); }
+void llama_mmap::prefetch(size_t first, size_t last) const { pimpl->prefetch(first, last); }
+void llama_mmap::evict(size_t first, size_t last) const { pimpl->evict(first, last); }
 
 #if defined(_POSIX_MEMLOCK_RANGE) || defined(_WIN32)
 const bool llama_mmap::SUPPORTED  = true;
@@ -598,3 +733,71 @@ const bool llama_mlock::SUPPORTED = false;
 size_t llama_path_max() {
     return PATH_MAX;
 }
+
+#if defined(__linux__)
+// reads the first number of a file, returns false if there is none (e.g. "max")
+static bool llama_read_u64(const char * path, uint64_t & val) {
+    FILE * f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    unsigned long long v = 0;
+    const bool ok = fscanf(f, "%llu", &v) == 1;
+    fclose(f);
+    val = v;
+    return ok;
+}
+#endif
+
+size_t llama_mem_available() {
+#if defined(__linux__)
+    uint64_t avail = 0;
+
+    FILE * f = fopen("/proc/meminfo", "r");
+    if (f) {
+        char line[256];
+        unsigned long long kb;
+        while (fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "MemAvailable: %llu kB", &kb) == 1) {
+                avail = kb*1024;
+                break;
+            }
+        }
+        fclose(f);
+    }
+
+    // cgroup v2, then v1, a limit above the physical memory means no limit
+    uint64_t limit = 0;
+    uint64_t usage = 0;
+    if ((llama_read_u64("/sys/fs/cgroup/memory.max", limit) && llama_read_u64("/sys/fs/cgroup/memory.current", usage)) ||
+        (llama_read_u64("/sys/fs/cgroup/memory/memory.limit_in_bytes", limit) && llama_read_u64("/sys/fs/cgroup/memory/memory.usage_in_bytes", usage))) {
+        const uint64_t room = limit > usage ? limit - usage : 0;
+        if (avail == 0 || room < avail) {
+            avail = room;
+        }
+    }
+
+    return avail;
+#elif defined(__APPLE__)
+#if TARGET_OS_IPHONE
+    // the jetsam limit of the process, which is far below the free memory of the device
+    return os_proc_available_memory();
+#else
+    vm_statistics64_data_t stats;
+    mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
+    if (host_statistics64(mach_host_self(), HOST_VM_INFO64, (host_info64_t) &stats, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return (size_t) (stats.free_count + stats.inactive_count + stats.purgeable_count)*vm_page_size;
+#endif
+#elif defined(_WIN32)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (!GlobalMemoryStatusEx(&status)) {
+        return 0;
+    }
+    return status.ullAvailPhys;
+#else
+    return 0;
+#endif
+}
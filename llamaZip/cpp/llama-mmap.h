@@ -26,9 +26,15 @@ struct llama_file {
     void read_raw(void * ptr, size_t len) const;
     uint32_t read_u32() const;
 
+    // positional read that can be called from several threads at once, the file position is left undefined
+    void read_raw_at(void * ptr, size_t len, size_t offset) const;
+
     void write_raw(const void * ptr, size_t len) const;
     void write_u32(uint32_t val) const;
 
+    // set the size of the file to len bytes, the file position is left undefined
+    void truncate(size_t len) const;
+
 private:
     struct impl;
     std::unique_ptr<impl> pimpl;
@@ -44,6 +50,10 @@ struct llama_mmap {
 
     void unmap_fragment(size_t first, size_t last);
 
+    // hint that the range [first, last) will be read soon / is not needed for a while, both are best effort
+    void prefetch(size_t first, size_t last) const;
+    void evict(size_t first, size_t last) const;
+
     static const bool SUPPORTED;
 
 private:
@@ -66,3 +76,7 @@ private:
 };
 
 size_t llama_path_max();
+
+// memory the process can still allocate, the lower of the free system memory and the room left in its cgroup
+// returns 0 if it cannot be determined
+size_t llama_mem_available();
@@ -4,8 +4,16 @@
 
 #include <array>
 #include <cinttypes>
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
 #include <future>
+#include <mutex>
+#include <thread>
+
+#include <zlib.h>
 
 static const size_t kiB = 1024;
 static const size_t MiB = 1024*kiB;
@@ -465,6 +473,36 @@ namespace GGUFMeta {
     template bool llama_model_loader::get_key_or_arr<std::array<int, 4>>(enum llm_kv kid, std::array<int, 4> & result, uint32_t n, bool required);
     template bool llama_model_loader::get_key_or_arr<std::array<uint32_t, 512>>(enum llm_kv kid, std::array<uint32_t, 512> & result, uint32_t n, bool required);
 
+// validates the compression keys of a GGUF file, the index is empty if its tensor data is stored as is
+static llama_model_loader::llama_compression_index llama_get_compression_index(const lm_gguf_context * ctx, const LLM_KV & llm_kv, const char * fname) {
+    llama_model_loader::llama_compression_index zindex;
+
+    const std::string key_codec = llm_kv(LLM_KV_COMPRESSION_CODEC);
+    const int64_t kid_codec = lm_gguf_find_key(ctx, key_codec.c_str());
+    if (kid_codec < 0) {
+        return zindex;
+    }
+    if (lm_gguf_get_kv_type(ctx, kid_codec) != LM_GGUF_TYPE_STRING || strcmp(lm_gguf_get_val_str(ctx, kid_codec), "deflate") != 0) {
+        throw std::runtime_error(format("%s: unsupported tensor data compression (%s)", fname, lm_gguf_kv_to_str(ctx, kid_codec).c_str()));
+    }
+
+    const int64_t n_tensors = lm_gguf_get_n_tensors(ctx);
+    auto get_arr = [&](enum llm_kv kid) {
+        const std::string key = llm_kv(kid);
+        const int64_t id = lm_gguf_find_key(ctx, key.c_str());
+        if (id < 0 || lm_gguf_get_kv_type(ctx, id) != LM_GGUF_TYPE_ARRAY || lm_gguf_get_arr_type(ctx, id) != LM_GGUF_TYPE_UINT64 ||
+                (int64_t) lm_gguf_get_arr_n(ctx, id) != n_tensors) {
+            throw std::runtime_error(format("%s: key %s must be a uint64 array with one entry per tensor", fname, key.c_str()));
+        }
+        return (const uint64_t *) lm_gguf_get_arr_data(ctx, id);
+    };
+
+    zindex.offs = get_arr(LLM_KV_COMPRESSION_OFFSETS);
+    zindex.size = get_arr(LLM_KV_COMPRESSION_SIZES);
+
+    return zindex;
+}
+
 llama_model_loader::llama_model_loader(
         const std::string & fname,
         std::vector<std::string> & splits,
@@ -503,6 +541,9 @@ llama_model_loader::llama_model_loader(
     files.emplace_back(new llama_file(fname.c_str(), "rb"));
     contexts.emplace_back(ctx);
 
+    const llama_compression_index zindex = llama_get_compression_index(meta.get(), llm_kv, fname.c_str());
+    compressed = zindex.offs != nullptr;
+
     // Save tensors data offset of the main file.
     // For subsidiary files, `meta` tensor data offset must not be used,
     // so we build a unified tensors index for weights.
@@ -514,7 +555,7 @@ llama_model_loader::llama_model_loader(
         }
         n_elements += lm_ggml_nelements(cur);
         n_bytes    += lm_ggml_nbytes(cur);
-        weights_map.emplace(tensor_name, llama_tensor_weight(files.back().get(), 0, meta.get(), cur));
+        weights_map.emplace(tensor_name, llama_tensor_weight(files.back().get(), 0, meta.get(), cur, &zindex));
     }
     uint16_t n_split = 0;
     get_key(llm_kv(LLM_KV_SPLIT_COUNT), n_split, false);
@@ -571,6 +612,10 @@ llama_model_loader::llama_model_loader(
             files.emplace_back(new llama_file(fname_split, "rb"));
             contexts.emplace_back(ctx);
 
+            // each shard may be compressed on its own
+            const llama_compression_index zindex_split = llama_get_compression_index(ctx_gguf.get(), llm_kv, fname_split);
+            compressed = compressed || zindex_split.offs != nullptr;
+
             // Save tensors data offset info of the shard.
             for (lm_ggml_tensor * cur = lm_ggml_get_first_tensor(ctx); cur; cur = lm_ggml_get_next_tensor(ctx, cur)) {
                 std::string tensor_name = std::string(cur->name);
@@ -580,7 +625,7 @@ llama_model_loader::llama_model_loader(
                 }
                 n_elements += lm_ggml_nelements(cur);
                 n_bytes    += lm_ggml_nbytes(cur);
-                weights_map.emplace(tensor_name, llama_tensor_weight(files.back().get(), idx, ctx_gguf.get(), cur));
+                weights_map.emplace(tensor_name, llama_tensor_weight(files.back().get(), idx, ctx_gguf.get(), cur, &zindex_split));
             }
         }
 
@@ -711,6 +756,11 @@ llama_model_loader::llama_model_loader(
         use_mmap = false;
     }
 
+    if (use_mmap && compressed) {
+        LLAMA_LOG_INFO("%s: tensor data is compressed, reading it without mmap\n", __func__);
+        use_mmap = false;
+    }
+
     this->use_mmap = use_mmap;
     this->check_tensors = check_tensors;
 }
@@ -892,6 +942,271 @@ void llama_model_loader::get_mapping_range(size_t * first, size_t * last, void *
     }
 }
 
+static void * llama_cpu_proc_address(const char * name) {
+    auto * dev = lm_ggml_backend_dev_by_type(LM_GGML_BACKEND_DEVICE_TYPE_CPU);
+    if (!dev) {
+        return nullptr;
+    }
+    return lm_ggml_backend_reg_get_proc_address(lm_ggml_backend_dev_backend_reg(dev), name);
+}
+
+static const uint32_t LLAMA_REPACK_CACHE_VERSION = 1;
+
+uint64_t llama_model_loader::repack_cache_fingerprint(lm_ggml_context * ctx) const {
+    // FNV-1a over the file sizes, the names, types, shapes and offsets of the tensors, and the ends of their data
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto update = [&hash](const void * data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= ((const uint8_t *) data)[i];
+            hash *= 0x100000001b3ULL;
+        }
+    };
+
+    for (const auto & file : files) {
+        const size_t size = file->size();
+        update(&size, sizeof(size));
+    }
+
+    for (lm_ggml_tensor * cur = lm_ggml_get_first_tensor(ctx); cur; cur = lm_ggml_get_next_tensor(ctx, cur)) {
+        const auto & w = require_weight(lm_ggml_get_name(cur));
+        update(cur->name, strlen(cur->name));
+        update(&cur->type, sizeof(cur->type));
+        update(cur->ne, sizeof(cur->ne));
+        update(&w.idx, sizeof(w.idx));
+        update(&w.offs, sizeof(w.offs));
+
+        // fine-tunes of the same base model share the layout above, a sample of the data tells them apart
+        const uint8_t * data = (const uint8_t *) mappings.at(w.idx)->addr() + w.offs;
+        const size_t n_size  = lm_ggml_nbytes(cur);
+        const size_t n_probe = std::min<size_t>(n_size, 4*kiB);
+        update(data, n_probe);
+        update(data + n_size - n_probe, n_probe);
+    }
+
+    return hash;
+}
+
+lm_ggml_backend_buffer_t llama_model_loader::load_repack_cache(const std::string & path, lm_ggml_context * ctx, uint64_t fingerprint, llama_mmaps & cache_mappings, llama_mlocks * mlock_mmaps) {
+    auto * layout_fn   = (decltype(lm_ggml_backend_cpu_repack_layout) *)          llama_cpu_proc_address("lm_ggml_backend_cpu_repack_layout");
+    auto * from_ptr_fn = (decltype(lm_ggml_backend_cpu_repack_buffer_from_ptr) *) llama_cpu_proc_address("lm_ggml_backend_cpu_repack_buffer_from_ptr");
+    if (!use_mmap || !layout_fn || !from_ptr_fn) {
+        return nullptr;
+    }
+
+    std::unique_ptr<llama_file> file;
+    try {
+        file = std::make_unique<llama_file>(path.c_str(), "rb");
+    } catch (const std::exception &) {
+        LLAMA_LOG_INFO("%s: no repacked weights cache at %s, it will be created\n", __func__, path.c_str());
+        return nullptr;
+    }
+
+    lm_gguf_init_params params = {
+        /*.no_alloc = */ true,
+        /*.ctx      = */ nullptr,
+    };
+    lm_gguf_context_ptr cache { lm_gguf_init_from_file(path.c_str(), params) };
+
+    auto stale = [&](const char * reason) {
+        LLAMA_LOG_WARN("%s: ignoring repacked weights cache %s: %s\n", __func__, path.c_str(), reason);
+        return nullptr;
+    };
+
+    if (!cache) {
+        return stale("not a valid GGUF file");
+    }
+
+    const int64_t kid_version     = lm_gguf_find_key(cache.get(), "repack.version");
+    const int64_t kid_fingerprint = lm_gguf_find_key(cache.get(), "repack.fingerprint");
+    const int64_t kid_layouts     = lm_gguf_find_key(cache.get(), "repack.layouts");
+    if (kid_version < 0 || kid_fingerprint < 0 || kid_layouts < 0 ||
+        lm_gguf_get_kv_type (cache.get(), kid_version)     != LM_GGUF_TYPE_UINT32 ||
+        lm_gguf_get_kv_type (cache.get(), kid_fingerprint) != LM_GGUF_TYPE_UINT64 ||
+        lm_gguf_get_kv_type (cache.get(), kid_layouts)     != LM_GGUF_TYPE_ARRAY  ||
+        lm_gguf_get_arr_type(cache.get(), kid_layouts)     != LM_GGUF_TYPE_UINT32) {
+        return stale("missing repack metadata");
+    }
+    if (lm_gguf_get_val_u32(cache.get(), kid_version) != LLAMA_REPACK_CACHE_VERSION) {
+        return stale("unsupported version");
+    }
+    if (lm_gguf_get_val_u64(cache.get(), kid_fingerprint) != fingerprint) {
+        return stale("written for a different model");
+    }
+
+    const int64_t    n_tensors   = lm_gguf_get_n_tensors(cache.get());
+    const uint32_t * layouts     = (const uint32_t *) lm_gguf_get_arr_data(cache.get(), kid_layouts);
+    const size_t     data_offset = lm_gguf_get_data_offset(cache.get());
+    if ((int64_t) lm_gguf_get_arr_n(cache.get(), kid_layouts) != n_tensors) {
+        return stale("missing repack metadata");
+    }
+
+    // the cache holds the tensors of ctx in order, each in the layout this CPU would repack it to
+    int64_t i = 0;
+    for (lm_ggml_tensor * cur = lm_ggml_get_first_tensor(ctx); cur; cur = lm_ggml_get_next_tensor(ctx, cur), ++i) {
+        if (i >= n_tensors ||
+            strcmp(lm_gguf_get_tensor_name(cache.get(), i), lm_ggml_get_name(cur)) != 0 ||
+            lm_gguf_get_tensor_type(cache.get(), i) != cur->type ||
+            lm_gguf_get_tensor_size(cache.get(), i) != lm_ggml_nbytes(cur)) {
+            return stale("tensors do not match the model");
+        }
+        if (layouts[i] != layout_fn(cur)) {
+            return stale("written for a different CPU or repack layout");
+        }
+        if (data_offset + lm_gguf_get_tensor_offset(cache.get(), i) + lm_ggml_nbytes(cur) > file->size()) {
+            return stale("file is truncated");
+        }
+    }
+    if (i != n_tensors) {
+        return stale("tensors do not match the model");
+    }
+
+    bool is_numa = false;
+    auto * is_numa_fn = (decltype(lm_ggml_is_numa) *) llama_cpu_proc_address("lm_ggml_backend_cpu_is_numa");
+    if (is_numa_fn) {
+        is_numa = is_numa_fn();
+    }
+
+    auto mapping = std::make_unique<llama_mmap>(file.get(), -1, is_numa);
+    uint8_t * base = (uint8_t *) mapping->addr() + data_offset;
+
+    lm_ggml_backend_buffer_t buf = from_ptr_fn(base, mapping->size() - data_offset);
+    if (buf == nullptr) {
+        return stale("unable to create the CPU_REPACK buffer");
+    }
+
+    i = 0;
+    for (lm_ggml_tensor * cur = lm_ggml_get_first_tensor(ctx); cur; cur = lm_ggml_get_next_tensor(ctx, cur), ++i) {
+        if (lm_ggml_backend_tensor_alloc(buf, cur, base + lm_gguf_get_tensor_offset(cache.get(), i)) != LM_GGML_STATUS_SUCCESS) {
+            lm_ggml_backend_buffer_free(buf);
+            return stale("unable to place the tensors");
+        }
+        size_done += lm_ggml_nbytes(cur);
+    }
+
+    if (mlock_mmaps) {
+        std::unique_ptr<llama_mlock> mlock_mmap(new llama_mlock());
+        mlock_mmap->init(mapping->addr());
+        mlock_mmap->grow_to(mapping->size());
+        mlock_mmaps->emplace_back(std::move(mlock_mmap));
+    }
+    cache_mappings.emplace_back(std::move(mapping));
+
+    LLAMA_LOG_INFO("%s: mapped %" PRId64 " repacked tensors from %s\n", __func__, n_tensors, path.c_str());
+
+    return buf;
+}
+
+void llama_model_loader::save_repack_cache(const std::string & path, lm_ggml_context * ctx, uint64_t fingerprint) const {
+    auto * layout_fn = (decltype(lm_ggml_backend_cpu_repack_layout) *) llama_cpu_proc_address("lm_ggml_backend_cpu_repack_layout");
+    if (!use_mmap || !layout_fn) {
+        return;
+    }
+
+    lm_gguf_context_ptr cache { lm_gguf_init_empty() };
+
+    std::vector<uint32_t> layouts;
+    for (lm_ggml_tensor * cur = lm_ggml_get_first_tensor(ctx); cur; cur = lm_ggml_get_next_tensor(ctx, cur)) {
+        if (!get_weight(lm_ggml_get_name(cur)) || cur->data == nullptr) {
+            LLAMA_LOG_WARN("%s: tensor '%s' has no data, not writing a repacked weights cache\n", __func__, lm_ggml_get_name(cur));
+            return;
+        }
+        lm_gguf_add_tensor(cache.get(), cur);
+        layouts.push_back(layout_fn(cur));
+    }
+
+    lm_gguf_set_val_u32 (cache.get(), "repack.version",     LLAMA_REPACK_CACHE_VERSION);
+    lm_gguf_set_val_u64 (cache.get(), "repack.fingerprint", fingerprint);
+    lm_gguf_set_arr_data(cache.get(), "repack.layouts",     LM_GGUF_TYPE_UINT32, layouts.data(), layouts.size());
+
+    // write to a temporary file first so that an interrupted write never leaves a cache that looks valid
+    const std::string path_tmp = path + ".tmp";
+    size_t size_written = 0;
+    try {
+        llama_file file(path_tmp.c_str(), "wb");
+
+        std::vector<uint8_t> meta(lm_gguf_get_meta_size(cache.get()));
+        lm_gguf_get_meta_data(cache.get(), meta.data());
+        file.write_raw(meta.data(), meta.size());
+        size_written += meta.size();
+
+        const size_t alignment = lm_gguf_get_alignment(cache.get());
+        const std::vector<uint8_t> padding(alignment, 0);
+        for (lm_ggml_tensor * cur = lm_ggml_get_first_tensor(ctx); cur; cur = lm_ggml_get_next_tensor(ctx, cur)) {
+            const size_t n_size = lm_ggml_nbytes(cur);
+            file.write_raw(cur->data, n_size);
+            file.write_raw(padding.data(), LM_GGML_PAD(n_size, alignment) - n_size);
+            size_written += LM_GGML_PAD(n_size, alignment);
+        }
+    } catch (const std::exception & e) {
+        LLAMA_LOG_WARN("%s: failed to write repacked weights cache %s: %s\n", __func__, path_tmp.c_str(), e.what());
+        std::remove(path_tmp.c_str());
+        return;
+    }
+
+    if (std::rename(path_tmp.c_str(), path.c_str()) != 0) {
+        LLAMA_LOG_WARN("%s: failed to rename %s to %s\n", __func__, path_tmp.c_str(), path.c_str());
+        std::remove(path_tmp.c_str());
+        return;
+    }
+
+    LLAMA_LOG_INFO("%s: wrote repacked weights cache %s (%.2f MiB)\n", __func__, path.c_str(), size_written/1024.0/1024.0);
+}
+
+void llama_model_loader::read_weight_data(const llama_tensor_weight & w, void * dst, std::vector<no_init<uint8_t>> & buf) const {
+    const auto & file = files.at(w.idx);
+    const size_t size = lm_ggml_nbytes(w.tensor);
+
+    if (w.zsize == 0) {
+        file->read_raw_at(dst, size, w.offs);
+        return;
+    }
+
+    // the stream is read in pieces, so that inflating a large tensor needs little more memory than the tensor itself
+    constexpr size_t chunk_size = 1*MiB;
+    buf.resize(std::min(chunk_size, w.zsize));
+
+    z_stream zs = {};
+    if (inflateInit(&zs) != Z_OK) {
+        throw std::runtime_error(format("tensor '%s': failed to initialize zlib", lm_ggml_get_name(w.tensor)));
+    }
+
+    size_t n_in  = 0;
+    size_t n_out = 0;
+    int ret = Z_OK;
+    try {
+        while (ret != Z_STREAM_END) {
+            if (zs.avail_in == 0) {
+                if (n_in == w.zsize) {
+                    break;
+                }
+                const size_t n = std::min(buf.size(), w.zsize - n_in);
+                file->read_raw_at(buf.data(), n, w.zoffs + n_in);
+                zs.next_in  = (Bytef *) buf.data();
+                zs.avail_in = (uInt) n;
+                n_in += n;
+            }
+
+            const uInt avail_out = (uInt) std::min<size_t>(size - n_out, UINT_MAX);
+            zs.next_out  = (Bytef *) dst + n_out;
+            zs.avail_out = avail_out;
+
+            ret = inflate(&zs, Z_NO_FLUSH);
+            n_out += avail_out - zs.avail_out;
+            if (ret != Z_OK && ret != Z_STREAM_END) {
+                break;
+            }
+        }
+    } catch (...) {
+        inflateEnd(&zs);
+        throw;
+    }
+    inflateEnd(&zs);
+
+    if (ret != Z_STREAM_END || n_out != size) {
+        throw std::runtime_error(format("tensor '%s' compressed data is corrupted (%s)", lm_ggml_get_name(w.tensor), zs.msg ? zs.msg : "size mismatch"));
+    }
+}
+
 void llama_model_loader::load_data_for(struct lm_ggml_tensor * cur) const {
     const auto & w = require_weight(lm_ggml_get_name(cur));
 
@@ -905,9 +1220,14 @@ void llama_model_loader::load_data_for(struct lm_ggml_tensor * cur) const {
     } else {
         LM_GGML_ASSERT(cur->data != nullptr);
         LM_GGML_ASSERT(w.idx < files.size());
-        const auto & file = files.at(w.idx);
-        file->seek(w.offs, SEEK_SET);
-        file->read_raw(cur->data, lm_ggml_nbytes(cur));
+        if (w.zsize != 0) {
+            std::vector<no_init<uint8_t>> buf;
+            read_weight_data(w, cur->data, buf);
+        } else {
+            const auto & file = files.at(w.idx);
+            file->seek(w.offs, SEEK_SET);
+            file->read_raw(cur->data, lm_ggml_nbytes(cur));
+        }
     }
 
     if (check_tensors && !lm_ggml_validate_row_data(cur->type, cur->data, lm_ggml_nbytes(cur))) {
@@ -915,6 +1235,207 @@ void llama_model_loader::load_data_for(struct lm_ggml_tensor * cur) const {
     }
 }
 
+bool llama_model_loader::load_data_parallel(
+        struct lm_ggml_context * ctx,
+        std::unordered_set<const lm_ggml_tensor *> & loaded,
+        llama_progress_callback progress_callback,
+        void * progress_callback_user_data) {
+    // large tensors are split into chunks of whole rows so that a single tensor can be read by several threads
+    constexpr size_t chunk_size = 8*MiB;
+
+    // tensors in buffers that are not host are read whole into a staging buffer, as set_tensor of e.g. CPU_REPACK
+    // only accepts whole tensors. the threads share a few staging buffers, so that the peak memory of the load
+    // does not grow with the number of threads
+    constexpr int n_staging = 2;
+
+    struct load_item {
+        lm_ggml_tensor * tensor;
+        const llama_tensor_weight * weight;
+        size_t offs; // within the tensor
+        size_t size;
+        bool   host; // read in place, otherwise the whole tensor goes through lm_ggml_backend_tensor_set
+    };
+
+    const int n_threads = (int) std::min<unsigned>(8, std::thread::hardware_concurrency());
+    if (use_mmap || n_threads < 2) {
+        return true;
+    }
+
+    std::vector<load_item> items;
+    size_t size_items = 0;
+
+    for (struct lm_ggml_tensor * cur = lm_ggml_get_first_tensor(ctx); cur != NULL; cur = lm_ggml_get_next_tensor(ctx, cur)) {
+        const auto * weight = get_weight(lm_ggml_get_name(cur));
+        if (weight == nullptr || cur->buffer == nullptr) {
+            continue;
+        }
+
+        const size_t n_size = lm_ggml_nbytes(cur);
+
+        if (lm_ggml_backend_buffer_is_host(cur->buffer) && weight->zsize != 0) {
+            // a deflate stream can only be inflated from its start, so compressed tensors are not split
+            items.push_back({ cur, weight, 0, n_size, true });
+        } else if (lm_ggml_backend_buffer_is_host(cur->buffer)) {
+            const size_t row_size = lm_ggml_row_size(cur->type, cur->ne[0]);
+            const size_t step = std::max(row_size, chunk_size - chunk_size % row_size);
+            for (size_t offs = 0; offs < n_size; offs += step) {
+                items.push_back({ cur, weight, offs, std::min(step, n_size - offs), true });
+            }
+        } else {
+            // CPU buffers that are not host, e.g. CPU_REPACK, convert the data in set_tensor, which is safe
+            // to run concurrently for different tensors; other devices keep the sequential (async) upload
+            auto * dev = lm_ggml_backend_buft_get_device(lm_ggml_backend_buffer_get_type(cur->buffer));
+            if (!dev || lm_ggml_backend_dev_type(dev) != LM_GGML_BACKEND_DEVICE_TYPE_CPU) {
+                continue;
+            }
+            items.push_back({ cur, weight, 0, n_size, false });
+        }
+
+        loaded.insert(cur);
+        size_items += n_size;
+    }
+
+    if (items.empty()) {
+        return true;
+    }
+
+    // keep the reads of each file roughly in order, so the threads advance through it together
+    std::sort(items.begin(), items.end(), [](const load_item & a, const load_item & b) {
+        if (a.weight->idx != b.weight->idx) {
+            return a.weight->idx < b.weight->idx;
+        }
+        const size_t a_offs = a.weight->zsize ? a.weight->zoffs : a.weight->offs + a.offs;
+        const size_t b_offs = b.weight->zsize ? b.weight->zoffs : b.weight->offs + b.offs;
+        return a_offs < b_offs;
+    });
+
+    std::atomic<size_t> next_item{0};
+    std::atomic<size_t> bytes_done{0};
+    std::atomic<bool>   stop{false};
+    std::atomic<bool>   validation_failed{false};
+    std::exception_ptr  error;
+    std::mutex          error_mutex;
+
+    std::vector<std::vector<no_init<uint8_t>>> staging(n_staging);
+    std::vector<int>        staging_free;
+    std::mutex              staging_mutex;
+    std::condition_variable staging_cv;
+
+    for (int i = 0; i < n_staging; ++i) {
+        staging_free.push_back(i);
+    }
+
+    // returns the staging buffer to the pool when the item is done, also if it throws
+    struct staging_lock {
+        std::vector<int>        & free;
+        std::mutex              & mutex;
+        std::condition_variable & cv;
+        int idx = -1;
+
+        ~staging_lock() {
+            if (idx >= 0) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    free.push_back(idx);
+                }
+                cv.notify_all();
+            }
+        }
+    };
+
+    // the calling thread takes part in the loading and is the only one to report progress
+    auto worker = [&](bool main_thread) {
+        std::vector<no_init<uint8_t>> zbuf;
+        try {
+            while (!stop.load(std::memory_order_relaxed)) {
+                const size_t i = next_item.fetch_add(1);
+                if (i >= items.size()) {
+                    break;
+                }
+                const load_item & item = items[i];
+                const auto & file = files.at(item.weight->idx);
+
+                staging_lock staged { staging_free, staging_mutex, staging_cv };
+
+                uint8_t * data;
+                if (item.host) {
+                    data = (uint8_t *) item.tensor->data + item.offs;
+                } else {
+                    {
+                        std::unique_lock<std::mutex> lock(staging_mutex);
+                        staging_cv.wait(lock, [&] { return !staging_free.empty() || stop.load(std::memory_order_relaxed); });
+                        if (stop.load(std::memory_order_relaxed)) {
+                            break;
+                        }
+                        staged.idx = staging_free.back();
+                        staging_free.pop_back();
+                    }
+
+                    auto & buf = staging[staged.idx];
+                    buf.resize(item.size);
+                    data = (uint8_t *) buf.data();
+                }
+
+                if (item.weight->zsize != 0) {
+                    read_weight_data(*item.weight, data, zbuf);
+                } else {
+                    file->read_raw_at(data, item.size, item.weight->offs + item.offs);
+                }
+
+                if (check_tensors && !lm_ggml_validate_row_data(item.tensor->type, data, item.size)) {
+                    LLAMA_LOG_ERROR("%s: tensor '%s' has invalid data\n", __func__, lm_ggml_get_name(item.tensor));
+                    validation_failed = true;
+                }
+
+                if (!item.host) {
+                    lm_ggml_backend_tensor_set(item.tensor, data, 0, item.size);
+                }
+
+                const size_t done = bytes_done.fetch_add(item.size) + item.size;
+                if (main_thread && progress_callback) {
+                    if (!progress_callback((float) (size_done + done) / size_data, progress_callback_user_data)) {
+                        stop = true;
+                        return false;
+                    }
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            stop = true;
+        }
+        return true;
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(n_threads - 1);
+    for (int i = 1; i < n_threads; ++i) {
+        workers.emplace_back(worker, false);
+    }
+    const bool completed = worker(true);
+    for (auto & t : workers) {
+        t.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if (!completed) {
+        return false;
+    }
+    if (validation_failed) {
+        throw std::runtime_error("found tensors with invalid data");
+    }
+
+    LLAMA_LOG_DEBUG("%s: read %zu tensors (%.2f MiB) with %d threads\n", __func__, loaded.size(), size_items/1024.0/1024.0, n_threads);
+
+    size_done += size_items;
+
+    return true;
+}
+
 bool llama_model_loader::load_all_data(
         struct lm_ggml_context * ctx,
         llama_buf_map & bufs,
@@ -923,7 +1444,13 @@ bool llama_model_loader::load_all_data(
         void * progress_callback_user_data) {
     LM_GGML_ASSERT(size_data != 0 && "call init_mappings() first");
 
+    std::unordered_set<const lm_ggml_tensor *> loaded;
+    if (!load_data_parallel(ctx, loaded, progress_callback, progress_callback_user_data)) {
+        return false;
+    }
+
     std::vector<no_init<uint8_t>> read_buf;
+    std::vector<no_init<uint8_t>> zbuf;
     std::vector<std::future<std::pair<lm_ggml_tensor *, bool>>> validation_result;
 
     // 4 staging buffers for async uploads, each sized 1MB seems to be a good default for single NVMe drives.
@@ -1022,6 +1549,10 @@ bool llama_model_loader::load_all_data(
             continue;
         }
 
+        if (loaded.count(cur)) {
+            continue;
+        }
+
         if (progress_callback) {
             if (!progress_callback((float) size_done / size_data, progress_callback_user_data)) {
                 return false;
@@ -1058,6 +1589,20 @@ bool llama_model_loader::load_all_data(
             } else {
                 lm_ggml_backend_tensor_set(cur, data, 0, n_size);
             }
+        } else if (weight->zsize != 0) {
+            // compressed tensors are inflated whole, then uploaded if they are not in host memory
+            uint8_t * data = (uint8_t *) cur->data;
+            if (!lm_ggml_backend_buffer_is_host(cur->buffer)) {
+                read_buf.resize(n_size);
+                data = (uint8_t *) read_buf.data();
+            }
+            read_weight_data(*weight, data, zbuf);
+            if (check_tensors && !lm_ggml_validate_row_data(cur->type, data, n_size)) {
+                throw std::runtime_error(format("tensor '%s' has invalid data", lm_ggml_get_name(cur)));
+            }
+            if (data != cur->data) {
+                lm_ggml_backend_tensor_set(cur, data, 0, n_size);
+            }
         } else {
             const auto & file = files.at(weight->idx);
             if (lm_ggml_backend_buffer_is_host(cur->buffer)) {
@@ -1148,6 +1693,133 @@ bool llama_model_loader::load_all_data(
     return true;
 }
 
+// deflates size bytes of inp at offs to the current position of out, returns the size of the stream
+static size_t llama_deflate_range(const llama_file & inp, size_t offs, size_t size, const llama_file & out, int32_t level,
+        std::vector<no_init<uint8_t>> & buf_in, std::vector<no_init<uint8_t>> & buf_out) {
+    z_stream zs = {};
+    if (deflateInit(&zs, level) != Z_OK) {
+        throw std::runtime_error("failed to initialize zlib");
+    }
+
+    size_t n_in  = 0;
+    size_t n_out = 0;
+    try {
+        int flush = Z_NO_FLUSH;
+        while (flush != Z_FINISH) {
+            const size_t n = std::min(buf_in.size(), size - n_in);
+            inp.read_raw_at(buf_in.data(), n, offs + n_in);
+            n_in += n;
+            flush = n_in == size ? Z_FINISH : Z_NO_FLUSH;
+
+            zs.next_in  = (Bytef *) buf_in.data();
+            zs.avail_in = (uInt) n;
+            do {
+                zs.next_out  = (Bytef *) buf_out.data();
+                zs.avail_out = (uInt) buf_out.size();
+                deflate(&zs, flush);
+                const size_t n_have = buf_out.size() - zs.avail_out;
+                out.write_raw(buf_out.data(), n_have);
+                n_out += n_have;
+            } while (zs.avail_out == 0);
+        }
+    } catch (...) {
+        deflateEnd(&zs);
+        throw;
+    }
+    deflateEnd(&zs);
+
+    return n_out;
+}
+
+uint32_t llama_model_compress(const char * fname_inp, const char * fname_out, int32_t level) {
+    const std::string path_tmp = std::string(fname_out) + ".tmp";
+
+    try {
+        struct lm_ggml_context * ctx = nullptr;
+        struct lm_gguf_init_params params = {
+            /*.no_alloc = */ true,
+            /*.ctx      = */ &ctx,
+        };
+        lm_gguf_context_ptr ctx_inp { lm_gguf_init_from_file(fname_inp, params) };
+        if (!ctx_inp) {
+            throw std::runtime_error(format("failed to load GGUF from %s", fname_inp));
+        }
+        lm_ggml_context_ptr ctx_meta { ctx };
+
+        const LLM_KV kv(LLM_ARCH_UNKNOWN);
+        if (lm_gguf_find_key(ctx_inp.get(), kv(LLM_KV_COMPRESSION_CODEC).c_str()) >= 0) {
+            throw std::runtime_error(format("%s is already compressed", fname_inp));
+        }
+
+        // the tensor infos keep the uncompressed layout with the default alignment, the streams are not padded
+        lm_gguf_context_ptr ctx_out { lm_gguf_init_empty() };
+        lm_gguf_set_kv(ctx_out.get(), ctx_inp.get());
+        lm_gguf_remove_key(ctx_out.get(), LM_GGUF_KEY_GENERAL_ALIGNMENT);
+        lm_gguf_set_val_str(ctx_out.get(), kv(LLM_KV_COMPRESSION_CODEC).c_str(), "deflate");
+
+        const int64_t n_tensors = lm_gguf_get_n_tensors(ctx_inp.get());
+        for (int64_t i = 0; i < n_tensors; ++i) {
+            lm_gguf_add_tensor(ctx_out.get(), lm_ggml_get_tensor(ctx, lm_gguf_get_tensor_name(ctx_inp.get(), i)));
+        }
+
+        // the index has a fixed size, so the metadata is written once with a placeholder and again once it is known
+        std::vector<uint64_t> zoffs(n_tensors, 0);
+        std::vector<uint64_t> zsize(n_tensors, 0);
+        auto set_index = [&]() {
+            lm_gguf_set_arr_data(ctx_out.get(), kv(LLM_KV_COMPRESSION_OFFSETS).c_str(), LM_GGUF_TYPE_UINT64, zoffs.data(), zoffs.size());
+            lm_gguf_set_arr_data(ctx_out.get(), kv(LLM_KV_COMPRESSION_SIZES).c_str(),   LM_GGUF_TYPE_UINT64, zsize.data(), zsize.size());
+        };
+        set_index();
+
+        std::vector<no_init<uint8_t>> meta(lm_gguf_get_meta_size(ctx_out.get()));
+
+        llama_file inp(fname_inp, "rb");
+        llama_file out(path_tmp.c_str(), "wb");
+
+        out.seek(meta.size(), SEEK_SET);
+
+        std::vector<no_init<uint8_t>> buf_in(4*MiB);
+        std::vector<no_init<uint8_t>> buf_out(4*MiB);
+
+        size_t size_inp = 0;
+        size_t size_out = 0;
+        for (int64_t i = 0; i < n_tensors; ++i) {
+            const size_t offs = lm_gguf_get_data_offset(ctx_inp.get()) + lm_gguf_get_tensor_offset(ctx_inp.get(), i);
+            const size_t size = lm_gguf_get_tensor_size(ctx_inp.get(), i);
+            if (offs + size < offs || offs + size > inp.size()) {
+                throw std::runtime_error(format("tensor '%s' data is not within the file bounds", lm_gguf_get_tensor_name(ctx_inp.get(), i)));
+            }
+
+            zoffs[i] = size_out;
+            zsize[i] = llama_deflate_range(inp, offs, size, out, level, buf_in, buf_out);
+
+            size_inp += size;
+            size_out += zsize[i];
+        }
+
+        set_index();
+        LM_GGML_ASSERT(lm_gguf_get_meta_size(ctx_out.get()) == meta.size());
+        lm_gguf_get_meta_data(ctx_out.get(), meta.data());
+
+        out.seek(0, SEEK_SET);
+        out.write_raw(meta.data(), meta.size());
+
+        LLAMA_LOG_INFO("%s: compressed %s: %.2f MiB -> %.2f MiB\n", __func__, fname_inp, size_inp/1024.0/1024.0, size_out/1024.0/1024.0);
+    } catch (const std::exception & err) {
+        LLAMA_LOG_ERROR("%s: failed to compress: %s\n", __func__, err.what());
+        std::remove(path_tmp.c_str());
+        return 1;
+    }
+
+    if (std::rename(path_tmp.c_str(), fname_out) != 0) {
+        LLAMA_LOG_ERROR("%s: failed to rename %s to %s\n", __func__, path_tmp.c_str(), fname_out);
+        std::remove(path_tmp.c_str());
+        return 1;
+    }
+
+    return 0;
+}
+
 std::string llama_model_loader::ftype_name() const {
     return llama_model_ftype_name(ftype);
 }
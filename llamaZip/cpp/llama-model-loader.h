@@ -12,6 +12,7 @@
 #include <map>
 #include <stdexcept>
 #include <unordered_map>
+#include <unordered_set>
 
 using llama_buf_map = std::unordered_map<uint32_t, lm_ggml_backend_buffer_t>;
 
@@ -24,21 +25,36 @@ enum llama_fver {
 const char * llama_file_version_name(llama_fver version);
 
 struct llama_model_loader {
+    // In a compressed container (see llama_model_compress) the data of each tensor is stored as one deflate stream,
+    // the tensor infos keep the uncompressed layout and these arrays, indexed like them, locate the streams
+    struct llama_compression_index {
+        const uint64_t * offs = nullptr; // relative to the data section
+        const uint64_t * size = nullptr;
+    };
+
     // Holds information on a model weight
     struct llama_tensor_weight {
         uint16_t  idx; // source file index
         size_t   offs; // tensor data offset in the original file
+        size_t  zoffs = 0; // deflate stream offset in a compressed container
+        size_t  zsize = 0; // deflate stream size, 0 if the data is stored as is
 
         lm_ggml_tensor * tensor;
 
-        llama_tensor_weight(const llama_file * file, uint16_t idx, const struct lm_gguf_context * lm_gguf_ctx, lm_ggml_tensor * tensor) : idx(idx), tensor(tensor) {
+        llama_tensor_weight(const llama_file * file, uint16_t idx, const struct lm_gguf_context * lm_gguf_ctx, lm_ggml_tensor * tensor, const llama_compression_index * zindex = nullptr) : idx(idx), tensor(tensor) {
             const int tensor_idx = lm_gguf_find_tensor(lm_gguf_ctx,  lm_ggml_get_name(tensor));
             if (tensor_idx < 0) {
                 throw std::runtime_error(format("tensor '%s' not found in the model", lm_ggml_get_name(tensor)));
             }
 
             offs = lm_gguf_get_data_offset(lm_gguf_ctx) + lm_gguf_get_tensor_offset(lm_gguf_ctx, tensor_idx);
-            if (offs + lm_ggml_nbytes(tensor) < offs || offs + lm_ggml_nbytes(tensor) > file->size()) {
+            if (zindex && zindex->offs) {
+                zoffs = lm_gguf_get_data_offset(lm_gguf_ctx) + zindex->offs[tensor_idx];
+                zsize = zindex->size[tensor_idx];
+                if (zsize == 0 || zoffs + zsize < zoffs || zoffs + zsize > file->size()) {
+                    throw std::runtime_error(format("tensor '%s' compressed data is not within the file bounds, model is corrupted or incomplete", lm_ggml_get_name(tensor)));
+                }
+            } else if (offs + lm_ggml_nbytes(tensor) < offs || offs + lm_ggml_nbytes(tensor) > file->size()) {
                 throw std::runtime_error(format("tensor '%s' data is not within the file bounds, model is corrupted or incomplete", lm_ggml_get_name(tensor)));
             }
         }
@@ -70,6 +86,7 @@ struct llama_model_loader {
 
     bool use_mmap = false;
     bool check_tensors;
+    bool compressed = false; // at least one file is a compressed container, so the data cannot be mapped
 
     llama_files files;
     llama_ftype ftype;
@@ -152,9 +169,28 @@ struct llama_model_loader {
 
     void get_mapping_range(size_t * first, size_t * last, void ** addr, int idx, lm_ggml_context * ctx) const;
 
+    // the CPU_REPACK tensors of ctx can be saved once in their interleaved layout and mapped back by later loads
+    // the fingerprint samples the mapped weights, so it must be taken before load_all_data unmaps the unused fragments
+    // load_repack_cache returns nullptr if the cache is missing or was written for another model, CPU or layout version
+    uint64_t repack_cache_fingerprint(lm_ggml_context * ctx) const;
+    lm_ggml_backend_buffer_t load_repack_cache(const std::string & path, lm_ggml_context * ctx, uint64_t fingerprint, llama_mmaps & cache_mappings, llama_mlocks * mlock_mmaps);
+    void save_repack_cache(const std::string & path, lm_ggml_context * ctx, uint64_t fingerprint) const;
+
+    // reads the data of w into dst, inflating it if w is compressed; buf holds the compressed input between reads
+    void read_weight_data(const llama_tensor_weight & w, void * dst, std::vector<no_init<uint8_t>> & buf) const;
+
     // for backwards compatibility, does not support ggml-backend
     void load_data_for(struct lm_ggml_tensor * cur) const;
 
+    // without mmap, the tensors of ctx in host or CPU buffers are read with positional reads from several threads,
+    // CPU_REPACK tensors are converted by the thread that read them; the tensors done here are added to loaded
+    // Returns false if cancelled by progress_callback
+    bool load_data_parallel(
+            struct lm_ggml_context * ctx,
+            std::unordered_set<const lm_ggml_tensor *> & loaded,
+            llama_progress_callback progress_callback,
+            void * progress_callback_user_data);
+
     // Returns false if cancelled by progress_callback
     bool load_all_data(
             struct lm_ggml_context * ctx,
@@ -17,13 +17,17 @@
 #include <cassert>
 #include <cmath>
 #include <cfloat>
+#include <chrono>
 #include <cstring>
 #include <cmath>
+#include <condition_variable>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <regex>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 
 const char * llm_type_name(llm_type type) {
     switch (type) {
@@ -382,7 +386,16 @@ static buft_list_t make_gpu_buft_list(lm_ggml_backend_dev_t dev, llama_split_mod
 
 struct llama_model::impl {
     impl() {}
-    ~impl() {}
+    ~impl() {
+        if (pager.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(pager_mutex);
+                pager_exit = true;
+            }
+            pager_cv.notify_one();
+            pager.join();
+        }
+    }
 
     uint64_t n_elements = 0;
 
@@ -416,6 +429,100 @@ struct llama_model::impl {
     std::vector<layer_dev> dev_layer;
 
     bool has_tensor_overrides;
+
+    // mapped ranges of the weights of each layer, the output and the other non-repeating tensors are at n_layer
+    struct mapped_range {
+        const llama_mmap * mapping;
+        size_t first;
+        size_t last;
+    };
+
+    std::vector<std::vector<mapped_range>> layer_ranges;
+
+    // the layers are paged in by a thread in the order of the graph, while the graph is computed. the thread does not
+    // observe the computation, which would need a split of the graph per layer, but follows it with the compute time per
+    // layer measured for the previous graphs with at least as many tokens
+    std::thread                 pager;
+    std::mutex                  pager_mutex;
+    std::condition_variable     pager_cv;
+    std::map<uint32_t, int64_t> pager_t_layer; // n_tokens -> compute time of a layer in us
+    uint32_t                    pager_n_tokens = 0;
+    uint64_t                    pager_n_begin  = 0;
+    uint64_t                    pager_n_end    = 0;
+    bool                        pager_exit     = false;
+
+    std::chrono::steady_clock::time_point pager_t_start;
+
+    void pager_page(int il, bool evict) const {
+        if (il < 0 || il >= (int) layer_ranges.size()) {
+            return;
+        }
+        for (const auto & range : layer_ranges[il]) {
+            if (evict) {
+                range.mapping->evict(range.first, range.last);
+            } else {
+                range.mapping->prefetch(range.first, range.last);
+            }
+        }
+    }
+
+    void pager_loop(bool evict) {
+        const int n_layer = (int) layer_ranges.size() - 1;
+
+        pager_page(0, false);
+        pager_page(1, false);
+
+        uint64_t n_done = 0;
+
+        std::unique_lock<std::mutex> lock(pager_mutex);
+        while (true) {
+            pager_cv.wait(lock, [&] { return pager_exit || pager_n_begin > n_done; });
+            if (pager_exit) {
+                return;
+            }
+
+            // when the thread falls behind, only the latest graph is followed
+            const uint64_t n_graph = pager_n_begin;
+            const auto     t_start = pager_t_start;
+
+            // no estimate for graphs of this size yet: the weights are faulted in by the computation
+            const auto it = pager_t_layer.lower_bound(pager_n_tokens);
+            const auto t_layer = std::chrono::microseconds(it != pager_t_layer.end() ? it->second : 0);
+
+            // layers 0 and 1 are paged in already. when layer il is expected to be computed, request layer il + 2
+            // and release layer il - 2, with a margin of two layers for the error of the estimate
+            int il_evict = 0;
+            for (int il = 0; t_layer.count() > 0 && il + 2 <= n_layer; ++il) {
+                if (pager_cv.wait_until(lock, t_start + il*t_layer, [&] { return pager_exit || pager_n_end >= n_graph; })) {
+                    break;
+                }
+                lock.unlock();
+                pager_page(il + 2, false);
+                if (evict && il >= 2) {
+                    pager_page(il - 2, true);
+                    il_evict = il - 1;
+                }
+                lock.lock();
+            }
+
+            pager_cv.wait(lock, [&] { return pager_exit || pager_n_end >= n_graph; });
+            if (pager_exit) {
+                return;
+            }
+            n_done = n_graph;
+
+            // the first layers of the next graph
+            lock.unlock();
+            if (evict) {
+                for (int il = il_evict; il < n_layer; ++il) {
+                    pager_page(il, true);
+                }
+            }
+            pager_page(0, false);
+            pager_page(1, false);
+            lock.lock();
+        }
+    }
 };
 
 llama_model::llama_model(const llama_model_params & params) : params(params), pimpl(std::make_unique<impl>()) {
@@ -5175,7 +5282,8 @@ bool llama_model::load_tensors(llama_model_loader & ml) {
 
     ml.done_getting_tensors();
 
-    ml.init_mappings(true, use_mlock ? &pimpl->mlock_mmaps : nullptr);
+    // with prefetch_layers the weights are paged in ahead of each layer instead of all at once here
+    ml.init_mappings(!params.prefetch_layers, use_mlock ? &pimpl->mlock_mmaps : nullptr);
     pimpl->mappings.reserve(ml.mappings.size());
 
     // create the backend buffers
@@ -5186,6 +5294,21 @@ bool llama_model::load_tensors(llama_model_loader & ml) {
     const size_t n_max_backend_buffer = ctx_map.size() * ml.files.size();
     pimpl->bufs.reserve(n_max_backend_buffer);
 
+    // the CPU_REPACK weights can be mapped from a cache of a previous load instead of being repacked again
+    lm_ggml_backend_buffer_type_t repack_buft = nullptr;
+    lm_ggml_context * ctx_repack_save = nullptr;
+    uint64_t repack_fingerprint = 0;
+    if (params.repack_cache && params.repack_cache[0] && ml.use_mmap) {
+        auto * cpu_dev = lm_ggml_backend_dev_by_type(LM_GGML_BACKEND_DEVICE_TYPE_CPU);
+        if (cpu_dev) {
+            auto * repack_buft_fn = (lm_ggml_backend_buffer_type_t (*)(void))
+                lm_ggml_backend_reg_get_proc_address(lm_ggml_backend_dev_backend_reg(cpu_dev), "lm_ggml_backend_cpu_repack_buffer_type");
+            if (repack_buft_fn) {
+                repack_buft = repack_buft_fn();
+            }
+        }
+    }
+
     for (auto & it : ctx_map) {
         lm_ggml_backend_buffer_type_t buft = it.first;
         lm_ggml_context * ctx              = it.second;
@@ -5212,6 +5335,18 @@ bool llama_model::load_tensors(llama_model_loader & ml) {
         bool buffer_from_host_ptr_supported = props.caps.buffer_from_host_ptr;
         bool is_default_buft = buft == lm_ggml_backend_dev_buffer_type(dev);
 
+        if (buft == repack_buft) {
+            repack_fingerprint = ml.repack_cache_fingerprint(ctx);
+            lm_ggml_backend_buffer_t buf = ml.load_repack_cache(params.repack_cache, ctx, repack_fingerprint, pimpl->mappings, use_mlock ? &pimpl->mlock_mmaps : nullptr);
+            if (buf != nullptr) {
+                // the tensors are already placed and hold their final data, they are not loaded again below
+                pimpl->bufs.emplace_back(buf);
+                lm_ggml_backend_buffer_set_usage(buf, LM_GGML_BACKEND_BUFFER_USAGE_WEIGHTS);
+                continue;
+            }
+            ctx_repack_save = ctx;
+        }
+
         if (ml.use_mmap && use_mmap_buffer && buffer_from_host_ptr_supported && is_default_buft) {
             for (uint32_t idx = 0; idx < ml.files.size(); idx++) {
                 // only the mmap region containing the tensors in the model is mapped to the backend buffer
@@ -5297,12 +5432,75 @@ bool llama_model::load_tensors(llama_model_loader & ml) {
         }
     }
 
+    if (ctx_repack_save) {
+        ml.save_repack_cache(params.repack_cache, ctx_repack_save, repack_fingerprint);
+    }
+
     if (use_mmap_buffer) {
         for (auto & mapping : ml.mappings) {
             pimpl->mappings.emplace_back(std::move(mapping));
         }
     }
 
+    if (params.prefetch_layers && !pimpl->mappings.empty()) {
+        // group the tensors that are used in place from a mapping by layer
+        const int n_layer = hparams.n_layer;
+        auto & layer_ranges = pimpl->layer_ranges;
+        layer_ranges.resize(n_layer + 1);
+
+        for (const auto & it : tensors_by_name) {
+            const uint8_t * data = (const uint8_t *) it.second->data;
+            if (data == nullptr) {
+                continue;
+            }
+
+            // only the rows of the tokens are read from the token embeddings, unless they are the output too
+            if (it.second == tok_embd && (output == nullptr || output->data != tok_embd->data)) {
+                continue;
+            }
+
+            int il = -1;
+            if (sscanf(it.first.c_str(), "blk.%d.", &il) != 1 || il < 0 || il >= n_layer) {
+                il = n_layer;
+            }
+
+            for (const auto & mapping : pimpl->mappings) {
+                const uint8_t * base = (const uint8_t *) mapping->addr();
+                if (data >= base && data < base + mapping->size()) {
+                    const size_t first = data - base;
+                    layer_ranges[il].push_back({ mapping.get(), first, first + lm_ggml_nbytes(it.second) });
+                    break;
+                }
+            }
+        }
+
+        // merge the ranges that are (almost) adjacent, the weights of a layer are usually stored together
+        size_t n_ranges = 0;
+        for (auto & ranges : layer_ranges) {
+            std::sort(ranges.begin(), ranges.end(), [](const impl::mapped_range & a, const impl::mapped_range & b) {
+                return a.mapping != b.mapping ? a.mapping < b.mapping : a.first < b.first;
+            });
+            std::vector<impl::mapped_range> merged;
+            for (const auto & range : ranges) {
+                if (!merged.empty() && merged.back().mapping == range.mapping && range.first <= merged.back().last + 64*1024) {
+                    merged.back().last = std::max(merged.back().last, range.last);
+                } else {
+                    merged.push_back(range);
+                }
+            }
+            ranges = std::move(merged);
+            n_ranges += ranges.size();
+        }
+
+        if (n_ranges > 0) {
+            LLAMA_LOG_INFO("%s: prefetching the mapped weights layer by layer (%zu ranges)%s\n", __func__, n_ranges,
+                    params.evict_layers ? ", evicting computed layers" : "");
+            pimpl->pager = std::thread(&impl::pager_loop, pimpl.get(), params.evict_layers);
+        } else {
+            layer_ranges.clear();
+        }
+    }
+
     return true;
 }
 
@@ -5330,6 +5528,29 @@ size_t llama_model::n_devices() const {
     return devices.size();
 }
 
+void llama_model::size_buffers(size_t & mapped, size_t & alloc) const {
+    mapped = 0;
+    alloc  = 0;
+
+    for (const auto & buf : pimpl->bufs) {
+        const size_t size = lm_ggml_backend_buffer_get_size(buf.get());
+
+        bool is_mapped = false;
+        if (lm_ggml_backend_buffer_is_host(buf.get())) {
+            const char * base = (const char *) lm_ggml_backend_buffer_get_base(buf.get());
+            for (const auto & mapping : pimpl->mappings) {
+                const char * addr = (const char *) mapping->addr();
+                if (base >= addr && base < addr + mapping->size()) {
+                    is_mapped = true;
+                    break;
+                }
+            }
+        }
+
+        (is_mapped ? mapped : alloc) += size;
+    }
+}
+
 uint64_t llama_model::n_elements() const {
     return pimpl->n_elements;
 }
@@ -5548,6 +5769,31 @@ lm_ggml_backend_buffer_type_t llama_model::select_buft(int il) const {
             });
 }
 
+bool llama_model::has_layer_paging() const {
+    return !pimpl->layer_ranges.empty();
+}
+
+void llama_model::paging_begin(uint32_t n_tokens) const {
+    {
+        std::lock_guard<std::mutex> lock(pimpl->pager_mutex);
+        pimpl->pager_n_tokens = n_tokens;
+        pimpl->pager_t_start  = std::chrono::steady_clock::now();
+        pimpl->pager_n_begin++;
+    }
+    pimpl->pager_cv.notify_one();
+}
+
+void llama_model::paging_end() const {
+    {
+        std::lock_guard<std::mutex> lock(pimpl->pager_mutex);
+        const auto t_graph = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - pimpl->pager_t_start);
+        // the output and the other non-repeating tensors count as one more layer
+        pimpl->pager_t_layer[pimpl->pager_n_tokens] = t_graph.count() / (int64_t) pimpl->layer_ranges.size();
+        pimpl->pager_n_end = pimpl->pager_n_begin;
+    }
+    pimpl->pager_cv.notify_one();
+}
+
 bool llama_model::has_tensor_overrides() const {
     return pimpl->has_tensor_overrides;
 }
@@ -17034,8 +17280,10 @@ llama_memory_i * llama_model::create_memory(const llama_memory_params & params,
                             LM_GGML_TYPE_F32,
                             LM_GGML_TYPE_F32,
                             cparams.offload_kqv,
-                            std::max((uint32_t) 1, cparams.n_seq_max),
-                            cparams.n_seq_max);
+                            std::max((uint32_t) 1, cparams.n_seq_max)*(1 + params.n_rs_ckpt),
+                            cparams.n_seq_max,
+                            params.n_rs_ckpt,
+                            params.rs_ckpt_interval);
                 } else if (llm_arch_is_hybrid(arch)) {
                     const auto padding = llama_kv_cache_unified::get_padding(cparams);
 
@@ -17050,9 +17298,13 @@ llama_memory_i * llama_model::create_memory(const llama_memory_params & params,
                         /* attn_n_pad        */ padding,
                         /* attn_n_swa        */ hparams.n_swa,
                         /* attn_swa_type     */ hparams.swa_type,
+                        /* attn_spill_path   */ params.spill_path,
+                        /* attn_spill_sync   */ params.spill_sync,
                         /* recurrent_type_k  */ LM_GGML_TYPE_F32,
                         /* recurrent_type_v  */ LM_GGML_TYPE_F32,
-                        /* recurrent_kv_size */ std::max((uint32_t) 1, cparams.n_seq_max),
+                        /* recurrent_kv_size */ std::max((uint32_t) 1, cparams.n_seq_max)*(1 + params.n_rs_ckpt),
+                        /* rs_n_ckpt         */ params.n_rs_ckpt,
+                        /* rs_ckpt_interval  */ params.rs_ckpt_interval,
                         /* n_seq_max         */ cparams.n_seq_max,
                         /* offload           */ cparams.offload_kqv,
                         /* filter_attn       */ (arch == LLM_ARCH_FALCON_H1) ? [&](int32_t) { return true; } : (llama_memory_hybrid::layer_filter_cb)nullptr,
@@ -17089,7 +17341,9 @@ llama_memory_i * llama_model::create_memory(const llama_memory_params & params,
                                 n_ctx_per_stream,
                                 cparams.n_seq_max,
                                 cparams.n_ubatch,
-                                padding);
+                                padding,
+                                params.spill_path,
+                                params.spill_sync);
                     } else {
                         LM_GGML_ASSERT(!hparams.is_swa_any());
 
@@ -17105,7 +17359,9 @@ llama_memory_i * llama_model::create_memory(const llama_memory_params & params,
                                 cparams.n_seq_max,
                                 padding,
                                 hparams.n_swa,
-                                hparams.swa_type);
+                                hparams.swa_type,
+                                params.spill_path,
+                                params.spill_sync);
                     }
                 }
             }
@@ -17114,6 +17370,78 @@ llama_memory_i * llama_model::create_memory(const llama_memory_params & params,
     return res;
 }
 
+size_t llama_model::memory_size(const llama_memory_params & params, llama_cparams & cparams) const {
+    // follows the cases of create_memory and the tensors created by the memory modules, including the padding of n_ctx
+    switch (arch) {
+        case LLM_ARCH_BERT:
+        case LLM_ARCH_JINA_BERT_V2:
+        case LLM_ARCH_NOMIC_BERT:
+        case LLM_ARCH_NOMIC_BERT_MOE:
+        case LLM_ARCH_NEO_BERT:
+        case LLM_ARCH_WAVTOKENIZER_DEC:
+        case LLM_ARCH_DREAM:
+            return 0;
+        default:
+            break;
+    }
+
+    const bool recurrent = llm_arch_is_recurrent(arch);
+    const bool hybrid    = llm_arch_is_hybrid(arch);
+
+    const uint32_t rs_size = std::max((uint32_t) 1, cparams.n_seq_max)*(1 + params.n_rs_ckpt);
+
+    const size_t size_recr =
+        lm_ggml_row_size(LM_GGML_TYPE_F32, hparams.n_embd_r())*rs_size +
+        lm_ggml_row_size(LM_GGML_TYPE_F32, hparams.n_embd_s())*rs_size;
+
+    const auto padding = llama_kv_cache_unified::get_padding(cparams);
+
+    uint32_t kv_size  = LM_GGML_PAD(cparams.n_ctx, padding);
+    uint32_t n_stream = 1;
+    if (!recurrent && !hybrid && !cparams.kv_unified) {
+        kv_size  = LM_GGML_PAD((cparams.n_ctx + cparams.n_seq_max - 1)/cparams.n_seq_max, padding);
+        n_stream = cparams.n_seq_max;
+    }
+
+    uint32_t kv_size_swa = kv_size;
+    if (!recurrent && !hybrid && hparams.swa_type != LLAMA_SWA_TYPE_NONE && !params.swa_full) {
+        kv_size_swa = std::min(kv_size, LM_GGML_PAD(hparams.n_swa*(cparams.kv_unified ? cparams.n_seq_max : 1) + cparams.n_ubatch, padding));
+    }
+
+    if (!recurrent) {
+        cparams.n_ctx = kv_size*n_stream;
+    }
+
+    auto size_attn = [&](uint32_t il) -> size_t {
+        const bool v_trans = !cparams.flash_attn;
+
+        const uint32_t n_embd_k_gqa =            hparams.n_embd_k_gqa(il);
+        const uint32_t n_embd_v_gqa = !v_trans ? hparams.n_embd_v_gqa(il) : hparams.n_embd_v_gqa_max();
+
+        const uint32_t size = !hybrid && hparams.is_swa(il) ? kv_size_swa : kv_size;
+
+        return (lm_ggml_row_size(params.type_k, n_embd_k_gqa) + lm_ggml_row_size(params.type_v, n_embd_v_gqa))*size*n_stream;
+    };
+
+    // TODO: this is temporary until we support passing reuse layer filters [KV_REUSE]
+    const uint32_t n_layer_cache = arch == LLM_ARCH_GEMMA3N ? 20 : hparams.n_layer;
+
+    size_t res = 0;
+    for (uint32_t il = 0; il < hparams.n_layer; ++il) {
+        if (recurrent) {
+            res += size_recr;
+        } else if (hybrid && arch != LLM_ARCH_FALCON_H1) {
+            res += hparams.is_recurrent(il) ? size_recr : size_attn(il);
+        } else if (hybrid) {
+            res += size_recr + size_attn(il);
+        } else if (il < n_layer_cache) {
+            res += size_attn(il);
+        }
+    }
+
+    return res;
+}
+
 lm_ggml_cgraph * llama_model::build_graph(const llm_graph_params & params) const {
     std::unique_ptr<llm_graph_context> llm;
 
@@ -17474,6 +17802,9 @@ llama_model_params llama_model_default_params() {
         /*.use_mmap                    =*/ true,
         /*.use_mlock                   =*/ false,
         /*.check_tensors               =*/ false,
+        /*.prefetch_layers             =*/ false,
+        /*.evict_layers                =*/ false,
+        /*.repack_cache                =*/ nullptr,
     };
 
 #ifdef LM_GGML_USE_METAL
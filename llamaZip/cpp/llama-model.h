@@ -430,6 +430,10 @@ struct llama_model {
     size_t n_tensors() const;
     size_t n_devices() const;
 
+    // bytes of the weight buffers that point into the file mappings, and of the ones that were allocated
+    // (repacked weights, device buffers, or a load without mmap)
+    void size_buffers(size_t & mapped, size_t & alloc) const;
+
     // total number of parameters in the model
     uint64_t n_elements() const;
 
@@ -442,6 +446,12 @@ struct llama_model {
 
     bool has_tensor_overrides() const;
 
+    // with params.prefetch_layers, the mapped weights are paged in (and released) layer by layer in the background
+    // between paging_begin and paging_end, which enclose the computation of a graph with n_tokens tokens
+    bool has_layer_paging() const;
+    void paging_begin(uint32_t n_tokens) const;
+    void paging_end() const;
+
     const struct lm_ggml_tensor * get_tensor(const char * name) const;
 
     float get_rope_freq_base (const llama_cparams & cparams, int il) const;
@@ -453,6 +463,9 @@ struct llama_model {
     // TODO: move this to new llm_arch_model_i interface
     llama_memory_i * create_memory(const llama_memory_params & params, llama_cparams & cparams) const;
 
+    // bytes of the tensors of the memory that create_memory would allocate, without allocating it
+    size_t memory_size(const llama_memory_params & params, llama_cparams & cparams) const;
+
     // TODO: move this to new llm_arch_model_i interface
     lm_ggml_cgraph * build_graph(const llm_graph_params & params) const;
 
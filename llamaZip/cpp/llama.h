@@ -42,7 +42,7 @@
 #define LLAMA_FILE_MAGIC_GGSQ 0x67677371u // 'ggsq'
 
 #define LLAMA_SESSION_MAGIC   LLAMA_FILE_MAGIC_GGSN
-#define LLAMA_SESSION_VERSION 9
+#define LLAMA_SESSION_VERSION 10
 
 #define LLAMA_STATE_SEQ_MAGIC   LLAMA_FILE_MAGIC_GGSQ
 #define LLAMA_STATE_SEQ_VERSION 2
@@ -288,6 +288,11 @@ extern "C" {
         bool use_mmap;      // use mmap if possible
         bool use_mlock;     // force system to keep model in RAM
         bool check_tensors; // validate model tensor data
+        bool prefetch_layers; // with mmap, page in the weights of the next layer while a layer is computed instead of the whole model at load
+        bool evict_layers;    // with prefetch_layers, release the pages of each layer once it is computed (for models larger than the free memory)
+
+        // path of a cache of the CPU-repacked weights, written on the first load and mapped by later ones (NULL = disabled)
+        const char * repack_cache;
     };
 
     // NOTE: changing the default values of parameters marked as [EXPERIMENTAL] may cause crashes or incorrect results in certain configurations
@@ -326,6 +331,19 @@ extern "C" {
         lm_ggml_abort_callback abort_callback;
         void *              abort_callback_data;
 
+        // file for offloading the KV cells of idle sequences when the cache is full [EXPERIMENTAL]
+        // the sequences are read back transparently when they are used again, NULL = disabled
+        const char * kv_spill_path;
+
+        // number of recurrent state checkpoints kept per sequence, taken every rs_ckpt_interval tokens [EXPERIMENTAL]
+        // they allow removing the end of a sequence of a recurrent model by going back to the last checkpoint, 0 = disabled
+        uint32_t n_rs_ckpt;
+        uint32_t rs_ckpt_interval;
+
+        // path of a cache of the compute buffer sizes measured for this model and context configuration
+        // a later context with the same configuration allocates them directly instead of reserving worst-case graphs (NULL = disabled)
+        const char * warm_start_cache;
+
         // Keep the booleans together and at the end of the struct to avoid misalignment during copy-by-value.
         bool embeddings;  // if true, extract embeddings (together with logits)
         bool offload_kqv; // offload the KQV ops (including the KV cache) to GPU
@@ -340,6 +358,17 @@ extern "C" {
                           // ref: https://github.com/ggml-org/llama.cpp/pull/14363
     };
 
+    // memory of a loaded model and of a context that would be created for it, in bytes
+    struct llama_memory_plan {
+        size_t weights_mapped; // weights that point into the file mappings, their pages can be dropped and read again
+        size_t weights_alloc;  // weights in allocated buffers: repacked for the CPU, on a device, or loaded without mmap
+        size_t kv;             // KV cache and recurrent states
+        size_t compute;        // compute buffers: the measured size from the warm start cache if it has this configuration,
+                               // otherwise estimated from the largest intermediate tensors of a ubatch plus a 25% safety margin
+        size_t budget;         // bytes left for the KV cache and the compute buffers
+        bool   fits;           // kv + compute <= budget
+    };
+
     // model quantization parameters
     typedef struct llama_model_quantize_params {
         int32_t nthread;                      // number of threads to use for quantizing, if <=0 will use std::thread::hardware_concurrency()
@@ -433,6 +462,23 @@ extern "C" {
                      struct llama_model * model,
             struct llama_context_params   params);
 
+    // Memory that llama_init_from_model(model, params) would need, checked against budget bytes for the model
+    // and the context, or against the memory still available to the process if budget is 0
+    LLAMA_API struct llama_memory_plan llama_memory_plan_estimate(
+            const struct llama_model * model,
+            struct llama_context_params   params,
+                                 size_t   budget);
+
+    // Lower the memory of the context params until the plan fits, trying in order:
+    //   - a smaller n_ubatch, halved down to 64
+    //   - a q8_0 K cache, and a q8_0 V cache if flash_attn is enabled
+    //   - a smaller n_ctx, halved down to 512
+    // The changes are logged, the returned plan is the one of the final params (fits is false if nothing fits)
+    LLAMA_API struct llama_memory_plan llama_memory_plan_fit(
+            const struct llama_model * model,
+            struct llama_context_params * params,
+                                 size_t   budget);
+
     DEPRECATED(LLAMA_API struct llama_context * llama_new_context_with_model(
                      struct llama_model * model,
             struct llama_context_params   params),
@@ -543,6 +589,15 @@ extern "C" {
             const char * fname_out,
             const llama_model_quantize_params * params);
 
+    // Writes a copy of a GGUF file with the data of each tensor stored as a deflate stream, which the loader
+    // inflates from several threads straight into the weight buffers; split models are compressed shard by shard
+    // level is the zlib compression level (0-9, -1 for the default)
+    // Returns 0 on success
+    LLAMA_API uint32_t llama_model_compress(
+            const char * fname_inp,
+            const char * fname_out,
+               int32_t   level);
+
     //
     // Adapters
     //
@@ -556,6 +611,18 @@ extern "C" {
     // Note: loaded adapters will be free when the associated model is deleted
     LLAMA_API void llama_adapter_lora_free(struct llama_adapter_lora * adapter);
 
+    // Merge a LoRA adapter at the given scale into copies of only the weights it modifies
+    // While the adapter is set on a context with that scale, the copies replace the base weights and the adapter
+    // costs no more per token than the base model; all other weights stay shared with the model
+    // Repacked weights, expert weights and types that need an importance matrix are not merged and keep the runtime path
+    // The copies are kept until the adapter is freed, so an adapter can only be merged at one scale
+    // Returns 0 on success
+    LLAMA_API int32_t llama_adapter_lora_merge(
+            const struct llama_model * model,
+            struct llama_adapter_lora * adapter,
+            float scale,
+            int32_t n_threads);
+
     // The following functions operate on a llama_context, hence the naming: llama_verb_...
 
     // Add a loaded LoRA adapter to given context
@@ -574,6 +641,18 @@ extern "C" {
     // Remove all LoRA adapters from given context
     LLAMA_API void llama_clear_adapter_lora(struct llama_context * ctx);
 
+    // Route a loaded LoRA adapter to the tokens of a single sequence, so that one batch can serve
+    // sequences with different adapters. Pass a NULL adapter or a scale of 0 to remove the route
+    // Routed adapters are applied on top of the ones set with llama_set_adapter_lora
+    // Expert weights and token embeddings are not routed
+    // The KV cache of the sequence is not updated, clear it when switching its adapter mid-sequence
+    // Return -1 if the routed weights could not be allocated
+    LLAMA_API int32_t llama_set_adapter_lora_seq(
+            struct llama_context * ctx,
+                    llama_seq_id   seq_id,
+            struct llama_adapter_lora * adapter,
+                           float   scale);
+
     // Apply a loaded control vector to a llama_context, or if data is NULL, clear
     // the currently loaded vector.
     // n_embd should be the size of a single layer's control, and data should point
@@ -662,6 +741,13 @@ extern "C" {
     // Check if the memory supports shifting
     LLAMA_API bool llama_memory_can_shift(llama_memory_t mem);
 
+    // Move the cells of an idle sequence to the spill file (see llama_context_params.kv_spill_path) and free them
+    // The sequence is read back transparently the next time it is used
+    // Returns false if offloading is not enabled or not supported by the memory type
+    LLAMA_API bool llama_memory_seq_offload(
+            llama_memory_t mem,
+              llama_seq_id seq_id);
+
     //
     // KV cache for self-attention (TODO: deprecate in favor of llama_memory)
     //
@@ -943,6 +1029,10 @@ extern "C" {
     // If true, all model tensors are activated during llama_decode() to load and cache their weights.
     LLAMA_API void llama_set_warmup(struct llama_context * ctx, bool warmup);
 
+    // Returns true if the compute buffers were sized from the warm start cache
+    // The graphs of this configuration have been run before, so the warmup run can be skipped
+    LLAMA_API bool llama_warm_started(const struct llama_context * ctx);
+
     // Set abort callback
     LLAMA_API void llama_set_abort_callback(struct llama_context * ctx, lm_ggml_abort_callback abort_callback, void * abort_callback_data);
 
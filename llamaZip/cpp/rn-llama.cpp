@@ -6,6 +6,9 @@
 #include "tools/mtmd/mtmd-helper.h"
 #include "tools/mtmd/clip.h"
 
+#include <map>
+#include <mutex>
+
 namespace rnllama {
 
 // Computes FNV-1a hash of the data
@@ -240,6 +243,7 @@ llama_rn_context::~llama_rn_context() {
     }
 
     releaseMultimodal();
+    releaseThreadpools();
 }
 
 void llama_rn_context::rewind() {
@@ -274,11 +278,72 @@ bool llama_rn_context::initSampling() {
     return ctx_sampling != nullptr;
 }
 
+// Loaded models by path and load params, shared by the contexts created on them
+// A model is freed when the last context using it is released
+static std::mutex shared_models_mutex;
+static std::map<std::string, std::weak_ptr<llama_model>> shared_models;
+
+// Returns an empty key for models that are not shared
+static std::string shared_model_key(const common_params &params) {
+    if (params.model.path.empty() || !params.kv_overrides.empty() || !params.tensor_buft_overrides.empty()) {
+        return "";
+    }
+
+    std::string key = params.model.path;
+    key += "|" + std::to_string(params.n_gpu_layers);
+    key += "|" + std::to_string(params.main_gpu);
+    key += "|" + std::to_string(params.split_mode);
+    for (float split : params.tensor_split) {
+        key += "," + std::to_string(split);
+    }
+    for (auto *dev : params.devices) {
+        key += "|" + std::string(lm_ggml_backend_dev_name(dev));
+    }
+    key += "|" + std::to_string(params.use_mmap) + std::to_string(params.use_mlock) + std::to_string(params.check_tensors);
+    key += "|" + std::to_string(params.vocab_only);
+    key += "|" + std::to_string(params.prefetch_layers) + std::to_string(params.evict_layers);
+    key += "|" + params.repack_cache;
+    return key;
+}
+
 bool llama_rn_context::loadModel(common_params &params_)
 {
     params = params_;
-    llama_init = common_init_from_params(params);
-    model = llama_init.model.get();
+
+    const std::string key = shared_model_key(params);
+    if (!key.empty()) {
+        std::lock_guard<std::mutex> lock(shared_models_mutex);
+        auto it = shared_models.find(key);
+        if (it != shared_models.end()) {
+            model_ref = it->second.lock();
+        }
+    }
+
+    if (model_ref) {
+        // only the KV cache and the compute buffers of this context are allocated
+        LOG_INFO("reusing loaded model: %s", params_.model.path.c_str());
+        if (params.progress_callback != nullptr) {
+            params.progress_callback(1.0f, params.progress_callback_user_data);
+        }
+        llama_init = common_init_from_model(params, model_ref.get());
+        if (llama_init.context == nullptr) {
+            model_ref.reset();
+        }
+    } else {
+        llama_init = common_init_from_params(params);
+        if (llama_init.model != nullptr) {
+            model_ref = std::shared_ptr<llama_model>(llama_init.model.release(), llama_model_free);
+            if (!key.empty()) {
+                std::lock_guard<std::mutex> lock(shared_models_mutex);
+                for (auto it = shared_models.begin(); it != shared_models.end();) {
+                    it = it->second.expired() ? shared_models.erase(it) : std::next(it);
+                }
+                shared_models[key] = model_ref;
+            }
+        }
+    }
+
+    model = model_ref.get();
     ctx = llama_init.context.get();
     if (model == nullptr)
     {
@@ -287,6 +352,7 @@ bool llama_rn_context::loadModel(common_params &params_)
     }
     templates = common_chat_templates_init(model, params.chat_template);
     n_ctx = llama_n_ctx(ctx);
+    memory_plan = llama_memory_plan_estimate(model, common_context_params_to_llama(params), params.memory_budget);
 
     // Initialize context shift flag
     LOG_INFO("ctx_shift: %s", params.ctx_shift ? "enabled" : "disabled");
@@ -427,7 +493,13 @@ void llama_rn_context::loadPrompt(const std::vector<std::string> &media_paths) {
 
         // Manage KV cache
         auto * kv = llama_get_memory(ctx);
-        llama_memory_seq_rm(kv, 0, n_past, -1);
+        if (!llama_memory_seq_rm(kv, 0, n_past, -1)) {
+            // recurrent state without a checkpoint before n_past
+            llama_memory_seq_rm(kv, 0, -1, -1);
+            n_past = 0;
+        }
+        // recurrent models may have gone back to an earlier checkpoint
+        n_past = std::min(n_past, llama_memory_seq_pos_max(kv, 0) + 1);
 
         LOG_VERBOSE("prompt ingested, n_past: %d, cached: %s, to_eval: %s",
             n_past,
@@ -911,12 +983,319 @@ std::string llama_rn_context::bench(int pp, int tg, int pl, int nr)
         std::string("]");
 }
 
+// Per-CPU performance hint used to group cores into clusters: the scheduler's
+// cpu_capacity when available, otherwise the max frequency. Empty when the
+// topology can't be read (e.g. iOS), in which case no affinity is tried.
+static std::vector<long> cpu_perf_levels() {
+    std::vector<long> levels;
+#if defined(__linux__)
+    const int n_cpu = std::min<int>(std::thread::hardware_concurrency(), LM_GGML_MAX_N_THREADS);
+    for (const char *file : {"cpu_capacity", "cpufreq/cpuinfo_max_freq"}) {
+        levels.clear();
+        for (int i = 0; i < n_cpu; i++) {
+            std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(i) + "/" + file);
+            long level = 0;
+            if (!(in >> level) || level <= 0) {
+                break;
+            }
+            levels.push_back(level);
+        }
+        if ((int) levels.size() == n_cpu) {
+            return levels;
+        }
+    }
+    levels.clear();
+#endif
+    return levels;
+}
+
+// Inverse of parse_cpu_mask
+static std::string cpu_mask_to_hex(const std::vector<int> &cpus) {
+    int max_cpu = 0;
+    for (int cpu : cpus) max_cpu = std::max(max_cpu, cpu);
+    std::string hex((max_cpu / 4) + 1, '0');
+    for (int cpu : cpus) {
+        char &c = hex[hex.size() - 1 - cpu / 4];
+        int digit = (c <= '9' ? c - '0' : c - 'a' + 10) | (1 << (cpu % 4));
+        c = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    }
+    return "0x" + hex;
+}
+
+struct thread_candidate {
+    int n_threads;
+    std::string cpumask;
+};
+
+// Candidate configs: for every cluster boundary the mask of the cores at or above it
+// (fastest cluster first, the last one being all cores without pinning) combined with
+// a few thread counts up to the number of cores in the mask.
+static std::vector<thread_candidate> thread_candidates(const std::vector<long> &levels) {
+    std::vector<thread_candidate> candidates;
+    const int max_threads = std::max(1, std::min<int>(std::thread::hardware_concurrency(), LM_GGML_MAX_N_THREADS));
+
+    auto add_counts = [&](int n_cpu, const std::string &cpumask) {
+        std::vector<int> counts;
+        for (int n : {n_cpu == 1 ? 1 : 2, 4, n_cpu / 2, n_cpu}) {
+            if (n >= 1 && n <= n_cpu && std::find(counts.begin(), counts.end(), n) == counts.end()) {
+                counts.push_back(n);
+                candidates.push_back({n, cpumask});
+            }
+        }
+    };
+
+    std::vector<long> tiers(levels.begin(), levels.end());
+    std::sort(tiers.begin(), tiers.end(), std::greater<long>());
+    tiers.erase(std::unique(tiers.begin(), tiers.end()), tiers.end());
+
+    for (size_t t = 0; t + 1 < tiers.size(); t++) {
+        std::vector<int> cpus;
+        for (size_t i = 0; i < levels.size(); i++) {
+            if (levels[i] >= tiers[t]) cpus.push_back(i);
+        }
+        add_counts(cpus.size(), cpu_mask_to_hex(cpus));
+    }
+    add_counts(max_threads, "");
+
+    return candidates;
+}
+
+static lm_ggml_threadpool_params thread_config_params(int n_threads, const std::string &cpumask) {
+    lm_ggml_threadpool_params tpp = lm_ggml_threadpool_params_default(n_threads);
+    if (!cpumask.empty() && !parse_cpu_mask(cpumask, tpp.cpumask)) {
+        tpp.n_threads = 0;
+    }
+    return tpp;
+}
+
+bool llama_rn_context::applyThreadConfig(const llama_rn_thread_config &config)
+{
+    lm_ggml_threadpool_params tpp = thread_config_params(config.n_threads, config.cpumask);
+    lm_ggml_threadpool_params tpp_batch = thread_config_params(config.n_threads_batch, config.cpumask_batch);
+    if (tpp.n_threads <= 0 || tpp_batch.n_threads <= 0) {
+        LOG_ERROR("invalid thread config: %d (%s) / %d (%s)", config.n_threads, config.cpumask.c_str(),
+            config.n_threads_batch, config.cpumask_batch.c_str());
+        return false;
+    }
+
+    releaseThreadpools();
+
+    if (!lm_ggml_threadpool_params_match(&tpp, &tpp_batch)) {
+        threadpool_batch = lm_ggml_threadpool_new(&tpp_batch);
+        if (threadpool_batch == nullptr) {
+            LOG_ERROR("failed to create batch threadpool with %d threads", config.n_threads_batch);
+            return false;
+        }
+        // Start the decode threadpool paused, the batch one runs the prompt first
+        tpp.paused = true;
+    }
+    threadpool = lm_ggml_threadpool_new(&tpp);
+    if (threadpool == nullptr) {
+        LOG_ERROR("failed to create threadpool with %d threads", config.n_threads);
+        releaseThreadpools();
+        return false;
+    }
+
+    llama_attach_threadpool(ctx, threadpool, threadpool_batch);
+    llama_set_n_threads(ctx, config.n_threads, config.n_threads_batch);
+    params.cpuparams.n_threads = config.n_threads;
+    params.cpuparams_batch.n_threads = config.n_threads_batch;
+    thread_config = config;
+    return true;
+}
+
+void llama_rn_context::releaseThreadpools()
+{
+    if (ctx != nullptr && (threadpool != nullptr || threadpool_batch != nullptr)) {
+        llama_detach_threadpool(ctx);
+    }
+    if (threadpool_batch != nullptr) {
+        lm_ggml_threadpool_free(threadpool_batch);
+        threadpool_batch = nullptr;
+    }
+    if (threadpool != nullptr) {
+        lm_ggml_threadpool_free(threadpool);
+        threadpool = nullptr;
+    }
+}
+
+llama_rn_thread_config llama_rn_context::tuneThreads(const std::string &cache_path, bool force)
+{
+    if (is_predicting) {
+        LOG_ERROR("cannot tune threads while predicting");
+        return thread_config;
+    }
+
+    // The best config depends on the model, the offload and the device
+    const std::vector<long> levels = cpu_perf_levels();
+    char model_desc[128];
+    llama_model_desc(model, model_desc, sizeof(model_desc));
+    std::string key = std::string(model_desc) + "|" +
+        std::to_string(llama_model_size(model)) + "|" +
+        std::to_string(llama_model_n_params(model)) + "|" +
+        std::to_string(params.n_gpu_layers) + "|" +
+        std::to_string(std::thread::hardware_concurrency());
+    for (long level : levels) {
+        key += ":" + std::to_string(level);
+    }
+
+    json cache = json::object();
+    if (!cache_path.empty()) {
+        std::ifstream in(cache_path);
+        if (in) {
+            cache = json::parse(in, nullptr, false);
+            if (!cache.is_object()) {
+                cache = json::object();
+            }
+        }
+    }
+
+    if (!force && cache.contains(key) && cache[key].is_object()) {
+        const json &entry = cache[key];
+        llama_rn_thread_config config;
+        config.n_threads = entry.value("n_threads", 0);
+        config.cpumask = entry.value("cpumask", "");
+        config.n_threads_batch = entry.value("n_threads_batch", 0);
+        config.cpumask_batch = entry.value("cpumask_batch", "");
+        config.tg_speed = entry.value("tg_speed", 0.0);
+        config.pp_speed = entry.value("pp_speed", 0.0);
+        if (applyThreadConfig(config)) {
+            LOG_INFO("using cached thread config: tg %d (%s), pp %d (%s)", config.n_threads,
+                config.cpumask.c_str(), config.n_threads_batch, config.cpumask_batch.c_str());
+            return thread_config;
+        }
+    }
+
+    is_predicting = true;
+
+    const llama_rn_thread_config previous = thread_config;
+    releaseThreadpools();
+
+    const int n_pp = std::max(1, std::min({(int) params.n_ubatch, n_ctx / 2, 64}));
+    const int n_tg = std::max(1, std::min(n_ctx / 2, 8));
+
+    llama_batch batch = llama_batch_init(n_pp, 0, 1);
+    auto decode = [&](int n_tokens, llama_pos pos) {
+        llama_batch_clear(&batch);
+        for (int i = 0; i < n_tokens; i++) {
+            llama_batch_add(&batch, 0, pos + i, {0}, i == n_tokens - 1);
+        }
+        return llama_decode(ctx, batch) == 0;
+    };
+
+    // Page in the weights once so the first candidate isn't penalized
+    llama_memory_clear(llama_get_memory(ctx), true);
+    decode(n_pp, 0);
+
+    llama_rn_thread_config best;
+    for (const auto &candidate : thread_candidates(levels)) {
+        if (is_interrupted) break;
+
+        lm_ggml_threadpool_params tpp = thread_config_params(candidate.n_threads, candidate.cpumask);
+        lm_ggml_threadpool_t tp = lm_ggml_threadpool_new(&tpp);
+        if (tp == nullptr) {
+            continue;
+        }
+        llama_attach_threadpool(ctx, tp, nullptr);
+        llama_set_n_threads(ctx, candidate.n_threads, candidate.n_threads);
+
+        bool ok = true;
+
+        // Single-token decode, the first token warms up the threadpool
+        llama_memory_clear(llama_get_memory(ctx), true);
+        ok = ok && decode(1, 0);
+        const int64_t t_tg_start = llama_time_us();
+        for (int i = 1; ok && i <= n_tg && !is_interrupted; i++) {
+            ok = decode(1, i);
+        }
+        const int64_t t_tg_end = llama_time_us();
+
+        llama_memory_clear(llama_get_memory(ctx), true);
+        const int64_t t_pp_start = llama_time_us();
+        ok = ok && decode(n_pp, 0);
+        const int64_t t_pp_end = llama_time_us();
+
+        llama_memory_clear(llama_get_memory(ctx), true);
+        llama_detach_threadpool(ctx);
+        lm_ggml_threadpool_free(tp);
+
+        if (!ok || is_interrupted) {
+            if (!ok) LOG_ERROR("llama_decode() failed with %d threads", candidate.n_threads);
+            continue;
+        }
+
+        const double tg_speed = n_tg / ((t_tg_end - t_tg_start) / 1000000.0);
+        const double pp_speed = n_pp / ((t_pp_end - t_pp_start) / 1000000.0);
+        LOG_INFO("threads %d (%s): pp %.2f t/s, tg %.2f t/s", candidate.n_threads,
+            candidate.cpumask.empty() ? "any" : candidate.cpumask.c_str(), pp_speed, tg_speed);
+
+        if (tg_speed > best.tg_speed) {
+            best.n_threads = candidate.n_threads;
+            best.cpumask = candidate.cpumask;
+            best.tg_speed = tg_speed;
+        }
+        if (pp_speed > best.pp_speed) {
+            best.n_threads_batch = candidate.n_threads;
+            best.cpumask_batch = candidate.cpumask;
+            best.pp_speed = pp_speed;
+        }
+    }
+
+    llama_batch_free(batch);
+
+    // The benchmark overwrote the KV cache
+    llama_memory_clear(llama_get_memory(ctx), true);
+    embd.clear();
+    n_past = 0;
+    mtmd_bitmap_past_hashes.clear();
+
+    const bool tuned = !is_interrupted && best.n_threads > 0 && best.n_threads_batch > 0;
+    if (!tuned || !applyThreadConfig(best)) {
+        if (previous.n_threads <= 0 || !applyThreadConfig(previous)) {
+            thread_config = llama_rn_thread_config();
+            llama_set_n_threads(ctx, params.cpuparams.n_threads,
+                params.cpuparams_batch.n_threads == -1 ? params.cpuparams.n_threads : params.cpuparams_batch.n_threads);
+        }
+        endCompletion();
+        return thread_config;
+    }
+
+    LOG_INFO("tuned thread config: tg %d (%s), pp %d (%s)", best.n_threads, best.cpumask.c_str(),
+        best.n_threads_batch, best.cpumask_batch.c_str());
+
+    if (!cache_path.empty()) {
+        cache[key] = {
+            {"n_threads", best.n_threads},
+            {"cpumask", best.cpumask},
+            {"n_threads_batch", best.n_threads_batch},
+            {"cpumask_batch", best.cpumask_batch},
+            {"tg_speed", best.tg_speed},
+            {"pp_speed", best.pp_speed},
+        };
+        std::ofstream out(cache_path);
+        if (!(out << cache.dump())) {
+            LOG_WARNING("failed to write thread config cache: %s", cache_path.c_str());
+        }
+    }
+
+    endCompletion();
+    return thread_config;
+}
+
 int llama_rn_context::applyLoraAdapters(std::vector<common_adapter_lora_info> lora) {
     for (auto &la : lora) {
-        la.ptr = llama_adapter_lora_init(model, la.path.c_str());
-        if (la.ptr == nullptr) {
-            LOG_ERROR("failed to apply lora adapter '%s'\n", la.path.c_str());
-            return -1;
+        auto it = lora_loaded.find(la.path);
+        if (it == lora_loaded.end()) {
+            llama_adapter_lora_ptr adapter(llama_adapter_lora_init(model, la.path.c_str()));
+            if (adapter == nullptr) {
+                LOG_ERROR("failed to apply lora adapter '%s'\n", la.path.c_str());
+                return -1;
+            }
+            it = lora_loaded.emplace(la.path, std::move(adapter)).first;
+        }
+        la.ptr = it->second.get();
+        if (la.merged && llama_adapter_lora_merge(model, la.ptr, la.scale, params.cpuparams.n_threads) != 0) {
+            LOG_WARNING("failed to merge lora adapter '%s', it is applied at runtime", la.path.c_str());
         }
     }
     this->lora = lora;
@@ -933,6 +1312,64 @@ std::vector<common_adapter_lora_info> llama_rn_context::getLoadedLoraAdapters()
     return this->lora;
 }
 
+int llama_rn_context::applyControlVectors(std::vector<common_control_vector_load_info> cvecs, int layer_start, int layer_end) {
+    common_control_vector_data data = common_control_vector_load(cvecs);
+    if (data.n_embd == -1) {
+        LOG_ERROR("failed to load control vectors", "");
+        return -1;
+    }
+    if (layer_start <= 0) layer_start = 1;
+    if (layer_end   <= 0) layer_end   = llama_model_n_layer(model);
+
+    control_vectors = cvecs;
+    cvec = std::move(data);
+    params.control_vector_layer_start = layer_start;
+    params.control_vector_layer_end = layer_end;
+    cvec_strength = 0.0f;
+    int err = setControlVectorStrength(1.0f);
+    if (err) {
+        removeControlVectors();
+    }
+    return err;
+}
+
+int llama_rn_context::setControlVectorStrength(float strength) {
+    if (cvec.n_embd == -1 || strength == cvec_strength) {
+        return 0;
+    }
+
+    // the vectors are added to the residual in a fused pass, only their data changes here
+    std::vector<float> scaled(cvec.data);
+    for (float &v : scaled) {
+        v *= strength;
+    }
+    int err = llama_apply_adapter_cvec(
+        ctx,
+        scaled.data(),
+        scaled.size(),
+        cvec.n_embd,
+        params.control_vector_layer_start,
+        params.control_vector_layer_end
+    );
+    if (err) {
+        LOG_ERROR("failed to apply control vectors", "");
+        return err;
+    }
+    cvec_strength = strength;
+    return 0;
+}
+
+void llama_rn_context::removeControlVectors() {
+    control_vectors.clear();
+    cvec = { -1, {} };
+    cvec_strength = 0.0f;
+    llama_apply_adapter_cvec(ctx, nullptr, 0, 0, 0, 0);
+}
+
+std::vector<common_control_vector_load_info> llama_rn_context::getLoadedControlVectors() {
+    return control_vectors;
+}
+
 bool llama_rn_context::initMultimodal(const std::string &mmproj_path, bool use_gpu) {
     LOG_INFO("[DEBUG] Initializing multimodal with mmproj path: %s", mmproj_path.c_str());
 
@@ -1,7 +1,9 @@
 #ifndef RNLLAMA_H
 #define RNLLAMA_H
 
+#include <memory>
 #include <sstream>
+#include <fstream>
 #include <iostream>
 #include <thread>
 #include <codecvt>
@@ -59,6 +61,16 @@ struct llama_rn_tokenize_result {
     std::vector<size_t> chunk_pos_media; // media only
 };
 
+// Thread count and CPU affinity picked per phase by tuneThreads
+struct llama_rn_thread_config {
+    int n_threads = 0;            // single-token decode
+    std::string cpumask;          // hex mask, empty means any CPU
+    int n_threads_batch = 0;      // prompt processing
+    std::string cpumask_batch;
+    double tg_speed = 0;          // measured tokens/s
+    double pp_speed = 0;
+};
+
 enum tts_type {
     UNKNOWN = -1,
     OUTETTS_V0_2 = 1,
@@ -82,6 +94,8 @@ struct llama_rn_context {
 
     std::vector<llama_token> embd;
     common_params params;
+    // the model may be shared with other contexts, it is released after llama_init
+    std::shared_ptr<llama_model> model_ref;
     common_init_result llama_init;
 
     bool next_token_uses_guide_token = true;
@@ -96,6 +110,8 @@ struct llama_rn_context {
     common_chat_templates_ptr templates;
 
     int n_ctx;
+    // memory the context needs, as planned for the params it was created with
+    llama_memory_plan memory_plan = {};
 
     bool context_full = false;
     bool truncated = false;
@@ -106,6 +122,13 @@ struct llama_rn_context {
     bool incomplete = false;
 
     std::vector<common_adapter_lora_info> lora;
+    // adapters stay loaded once applied, so switching between them does not read them again
+    std::map<std::string, llama_adapter_lora_ptr> lora_loaded;
+
+    // control vectors are kept unscaled, so that each completion can pick its own strength
+    std::vector<common_control_vector_load_info> control_vectors;
+    common_control_vector_data cvec = { -1, {} };
+    float cvec_strength = 0.0f;
 
     llama_rn_context_mtmd *mtmd_wrapper = nullptr;
     bool has_multimodal = false;
@@ -113,6 +136,10 @@ struct llama_rn_context {
     llama_rn_context_vocoder *vocoder_wrapper = nullptr;
     bool has_vocoder = false;
 
+    lm_ggml_threadpool_t threadpool = nullptr;
+    lm_ggml_threadpool_t threadpool_batch = nullptr;
+    llama_rn_thread_config thread_config;
+
     ~llama_rn_context();
 
     void rewind();
@@ -143,9 +170,18 @@ struct llama_rn_context {
     std::vector<float> getEmbedding(common_params &embd_params);
     std::vector<float> rerank(const std::string &query, const std::vector<std::string> &documents);
     std::string bench(int pp, int tg, int pl, int nr);
+
+    // Thread tuning methods
+    bool applyThreadConfig(const llama_rn_thread_config &config);
+    llama_rn_thread_config tuneThreads(const std::string &cache_path, bool force);
+    void releaseThreadpools();
     int applyLoraAdapters(std::vector<common_adapter_lora_info> lora);
     void removeLoraAdapters();
     std::vector<common_adapter_lora_info> getLoadedLoraAdapters();
+    int applyControlVectors(std::vector<common_control_vector_load_info> cvecs, int layer_start, int layer_end);
+    int setControlVectorStrength(float strength);
+    void removeControlVectors();
+    std::vector<common_control_vector_load_info> getLoadedControlVectors();
 
     // Multimodal methods
     bool initMultimodal(const std::string &mmproj_path, bool use_gpu);
@@ -332,6 +332,25 @@ RCT_EXPORT_METHOD(bench:(double)contextId
     }
 }
 
+RCT_EXPORT_METHOD(tuneThreads:(double)contextId
+                  cachePath:(NSString *)cachePath
+                  force:(BOOL)force
+                  withResolver:(RCTPromiseResolveBlock)resolve
+                  withRejecter:(RCTPromiseRejectBlock)reject)
+{
+    RNLlamaContext *context = llamaContexts[[NSNumber numberWithDouble:contextId]];
+    if (context == nil) {
+        reject(@"llama_error", @"Context not found", nil);
+        return;
+    }
+    @try {
+        NSDictionary *threadConfig = [context tuneThreads:cachePath force:force];
+        resolve(threadConfig);
+    } @catch (NSException *exception) {
+        reject(@"llama_cpp_error", exception.reason, nil);
+    }
+}
+
 RCT_EXPORT_METHOD(applyLoraAdapters:(double)contextId
                  withLoraAdapters:(NSArray *)loraAdapters
                  withResolver:(RCTPromiseResolveBlock)resolve
@@ -379,6 +398,59 @@ RCT_EXPORT_METHOD(getLoadedLoraAdapters:(double)contextId
     resolve([context getLoadedLoraAdapters]);
 }
 
+RCT_EXPORT_METHOD(applyControlVectors:(double)contextId
+                 withControlVectors:(NSArray *)controlVectors
+                 withLayerStart:(double)layerStart
+                 withLayerEnd:(double)layerEnd
+                 withResolver:(RCTPromiseResolveBlock)resolve
+                 withRejecter:(RCTPromiseRejectBlock)reject)
+{
+    RNLlamaContext *context = llamaContexts[[NSNumber numberWithDouble:contextId]];
+    if (context == nil) {
+        reject(@"llama_error", @"Context not found", nil);
+        return;
+    }
+    if ([context isPredicting]) {
+        reject(@"llama_error", @"Context is busy", nil);
+        return;
+    }
+    @try {
+        [context applyControlVectors:controlVectors layerStart:(int)layerStart layerEnd:(int)layerEnd];
+        resolve(nil);
+    } @catch (NSException *exception) {
+        reject(@"llama_cpp_error", exception.reason, nil);
+    }
+}
+
+RCT_EXPORT_METHOD(removeControlVectors:(double)contextId
+                 withResolver:(RCTPromiseResolveBlock)resolve
+                 withRejecter:(RCTPromiseRejectBlock)reject)
+{
+    RNLlamaContext *context = llamaContexts[[NSNumber numberWithDouble:contextId]];
+    if (context == nil) {
+        reject(@"llama_error", @"Context not found", nil);
+        return;
+    }
+    if ([context isPredicting]) {
+        reject(@"llama_error", @"Context is busy", nil);
+        return;
+    }
+    [context removeControlVectors];
+    resolve(nil);
+}
+
+RCT_EXPORT_METHOD(getLoadedControlVectors:(double)contextId
+                 withResolver:(RCTPromiseResolveBlock)resolve
+                 withRejecter:(RCTPromiseRejectBlock)reject)
+{
+    RNLlamaContext *context = llamaContexts[[NSNumber numberWithDouble:contextId]];
+    if (context == nil) {
+        reject(@"llama_error", @"Context not found", nil);
+        return;
+    }
+    resolve([context getLoadedControlVectors]);
+}
+
 RCT_EXPORT_METHOD(initMultimodal:(double)contextId
                  withParams:(NSDictionary *)params
                  withResolver:(RCTPromiseResolveBlock)resolve
@@ -55,9 +55,13 @@
 - (NSDictionary *)loadSession:(NSString *)path;
 - (int)saveSession:(NSString *)path size:(int)size;
 - (NSString *)bench:(int)pp tg:(int)tg pl:(int)pl nr:(int)nr;
+- (NSDictionary *)tuneThreads:(NSString *)cachePath force:(BOOL)force;
 - (void)applyLoraAdapters:(NSArray *)loraAdapters;
 - (void)removeLoraAdapters;
 - (NSArray *)getLoadedLoraAdapters;
+- (void)applyControlVectors:(NSArray *)controlVectors layerStart:(int)layerStart layerEnd:(int)layerEnd;
+- (void)removeControlVectors;
+- (NSArray *)getLoadedControlVectors;
 - (bool)initVocoder:(NSString *)vocoderModelPath;
 - (bool)isVocoderEnabled;
 - (NSString *)getFormattedAudioCompletion:(NSString *)speakerJsonStr textToSpeak:(NSString *)textToSpeak;
@@ -31,40 +31,38 @@
 }
 
 + (NSDictionary *)modelInfo:(NSString *)path skip:(NSArray *)skip {
-    struct lm_gguf_init_params params = {
-        /*.no_alloc = */ false,
-        /*.ctx      = */ NULL,
-    };
-
-    struct lm_gguf_context * ctx = lm_gguf_init_from_file([path UTF8String], params);
+    // the header is indexed in place from a mapping of the file, the skipped keys are never formatted
+    struct lm_gguf_view * view = lm_gguf_view_init_from_file([path UTF8String], NULL, 0);
 
-    if (!ctx) {
+    if (!view) {
         NSLog(@"%s: failed to load '%s'\n", __func__, [path UTF8String]);
         return @{};
     }
 
     NSMutableDictionary *info = [[NSMutableDictionary alloc] init];
 
-    info[@"version"] = @(lm_gguf_get_version(ctx));
-    info[@"alignment"] = @(lm_gguf_get_alignment(ctx));
-    info[@"data_offset"] = @(lm_gguf_get_data_offset(ctx));
+    info[@"version"] = @(lm_gguf_view_get_version(view));
+    info[@"alignment"] = @(lm_gguf_view_get_alignment(view));
+    info[@"data_offset"] = @(lm_gguf_view_get_data_offset(view));
 
     // kv
     {
-        const int n_kv = lm_gguf_get_n_kv(ctx);
+        const int n_kv = lm_gguf_view_get_n_kv(view);
 
         for (int i = 0; i < n_kv; ++i) {
-            const char * key = lm_gguf_get_key(ctx, i);
+            size_t key_len;
+            const char * key_chars = lm_gguf_view_get_key(view, i, &key_len);
+            NSString *key = [[NSString alloc] initWithBytes:key_chars length:key_len encoding:NSUTF8StringEncoding];
 
-            if (skip && [skip containsObject:[NSString stringWithUTF8String:key]]) {
+            if (!key || (skip && [skip containsObject:key])) {
                 continue;
             }
-            const std::string value = lm_gguf_kv_to_str(ctx, i);
-            info[[NSString stringWithUTF8String:key]] = [NSString stringWithUTF8String:value.c_str()];
+            const std::string value = lm_gguf_view_kv_to_str(view, i);
+            info[key] = [NSString stringWithUTF8String:value.c_str()];
         }
     }
 
-    lm_gguf_free(ctx);
+    lm_gguf_view_free(view);
 
     return info;
 }
@@ -149,6 +147,15 @@
     if (params[@"n_batch"]) defaultParams.n_batch = [params[@"n_batch"] intValue];
     if (params[@"n_ubatch"]) defaultParams.n_ubatch = [params[@"n_ubatch"] intValue];
     if (params[@"use_mmap"]) defaultParams.use_mmap = [params[@"use_mmap"] boolValue];
+    if (params[@"prefetch_layers"]) defaultParams.prefetch_layers = [params[@"prefetch_layers"] boolValue];
+    if (params[@"evict_layers"]) defaultParams.evict_layers = [params[@"evict_layers"] boolValue];
+    if (params[@"repack_cache"]) defaultParams.repack_cache = [params[@"repack_cache"] UTF8String];
+    if (params[@"warm_start_cache"]) defaultParams.warm_start_cache = [params[@"warm_start_cache"] UTF8String];
+    if (params[@"kv_spill_path"]) defaultParams.kv_spill_path = [params[@"kv_spill_path"] UTF8String];
+    if (params[@"fit_memory"]) defaultParams.fit_memory = [params[@"fit_memory"] boolValue];
+    if (params[@"memory_budget"] && [params[@"memory_budget"] doubleValue] > 0) {
+        defaultParams.memory_budget = (size_t) [params[@"memory_budget"] doubleValue];
+    }
 
     if (params[@"pooling_type"] && [params[@"pooling_type"] isKindOfClass:[NSNumber class]]) {
       defaultParams.pooling_type = static_cast<enum llama_pooling_type>([params[@"pooling_type"] intValue]);
@@ -171,6 +178,9 @@
 
     if (params[@"ctx_shift"]) defaultParams.ctx_shift = [params[@"ctx_shift"] boolValue];
 
+    if (params[@"n_rs_ckpt"]) defaultParams.n_rs_ckpt = [params[@"n_rs_ckpt"] intValue];
+    if (params[@"rs_ckpt_interval"]) defaultParams.rs_ckpt_interval = [params[@"rs_ckpt_interval"] intValue];
+
     if (params[@"cache_type_k"]) defaultParams.cache_type_k = rnllama::kv_cache_type_from_str([params[@"cache_type_k"] UTF8String]);
     if (params[@"cache_type_v"]) defaultParams.cache_type_v = rnllama::kv_cache_type_from_str([params[@"cache_type_v"] UTF8String]);
 
@@ -226,6 +236,7 @@
           common_adapter_lora_info la;
           la.path = [path UTF8String];
           la.scale = scale;
+          la.merged = [lora_adapter[@"merged"] boolValue];
           lora.push_back(la);
         }
     }
@@ -289,6 +300,8 @@
     auto default_tmpl = llama->templates.get()->template_default.get();
     auto default_tmpl_caps = default_tmpl->original_caps();
 
+    const auto & plan = llama->memory_plan;
+
     return @{
         @"desc": [NSString stringWithUTF8String:desc],
         @"size": @(llama_model_size(llama->model)),
@@ -311,6 +324,18 @@
             }
         },
         @"metadata": meta,
+        @"memoryPlan": @{
+            @"nCtx": @(llama_n_ctx(llama->ctx)),
+            @"nUbatch": @(llama_n_ubatch(llama->ctx)),
+            @"cacheTypeK": [NSString stringWithUTF8String:lm_ggml_type_name(llama->params.cache_type_k)],
+            @"cacheTypeV": [NSString stringWithUTF8String:lm_ggml_type_name(llama->params.cache_type_v)],
+            @"weightsMapped": @(plan.weights_mapped),
+            @"weightsAllocated": @(plan.weights_alloc),
+            @"kv": @(plan.kv),
+            @"compute": @(plan.compute),
+            @"budget": @(plan.budget == SIZE_MAX ? -1.0 : (double) plan.budget),
+            @"fits": @(plan.fits)
+        },
 
         // deprecated
         @"isChatTemplateSupported": @(llama->validateModelChatTemplate(false, nullptr))
@@ -478,6 +503,11 @@
 
     if (params[@"top_n_sigma"]) sparams.top_n_sigma = [params[@"top_n_sigma"] doubleValue];
 
+    float control_vector_strength = params[@"control_vector_strength"] ? [params[@"control_vector_strength"] floatValue] : 1.0f;
+    if (llama->setControlVectorStrength(control_vector_strength) != 0) {
+        NSLog(@"Failed to set control vector strength");
+    }
+
     // dry break seq
     if (params[@"dry_sequence_breakers"] && [params[@"dry_sequence_breakers"] isKindOfClass:[NSArray class]]) {
         NSArray *dry_sequence_breakers = params[@"dry_sequence_breakers"];
@@ -950,16 +980,25 @@
     return [NSString stringWithUTF8String:llama->bench(pp, tg, pl, nr).c_str()];
 }
 
+- (NSDictionary *)tuneThreads:(NSString *)cachePath force:(BOOL)force {
+    rnllama::llama_rn_thread_config config = llama->tuneThreads(cachePath ? [cachePath UTF8String] : "", force);
+    return @{
+        @"n_threads": @(config.n_threads),
+        @"cpumask": [NSString stringWithUTF8String:config.cpumask.c_str()],
+        @"n_threads_batch": @(config.n_threads_batch),
+        @"cpumask_batch": [NSString stringWithUTF8String:config.cpumask_batch.c_str()],
+        @"tg_speed": @(config.tg_speed),
+        @"pp_speed": @(config.pp_speed)
+    };
+}
+
 - (void)applyLoraAdapters:(NSArray *)loraAdapters {
     std::vector<common_adapter_lora_info> lora_adapters;
     for (NSDictionary *loraAdapter in loraAdapters) {
         common_adapter_lora_info la;
         la.path = [loraAdapter[@"path"] UTF8String];
         la.scale = [loraAdapter[@"scaled"] doubleValue];
-        la.ptr = llama_adapter_lora_init(llama->model, la.path.c_str());
-        if (la.ptr == nullptr) {
-            @throw [NSException exceptionWithName:@"LlamaException" reason:@"Failed to apply lora adapter" userInfo:nil];
-        }
+        la.merged = [loraAdapter[@"merged"] boolValue];
         lora_adapters.push_back(la);
     }
     int result = llama->applyLoraAdapters(lora_adapters);
@@ -984,6 +1023,36 @@
     return result;
 }
 
+- (void)applyControlVectors:(NSArray *)controlVectors layerStart:(int)layerStart layerEnd:(int)layerEnd {
+    std::vector<common_control_vector_load_info> control_vectors;
+    for (NSDictionary *controlVector in controlVectors) {
+        common_control_vector_load_info cv;
+        cv.fname = [controlVector[@"path"] UTF8String];
+        cv.strength = controlVector[@"strength"] ? [controlVector[@"strength"] floatValue] : 1.0f;
+        control_vectors.push_back(cv);
+    }
+    int result = llama->applyControlVectors(control_vectors, layerStart, layerEnd);
+    if (result != 0) {
+        @throw [NSException exceptionWithName:@"LlamaException" reason:@"Failed to apply control vectors" userInfo:nil];
+    }
+}
+
+- (void)removeControlVectors {
+    llama->removeControlVectors();
+}
+
+- (NSArray *)getLoadedControlVectors {
+    std::vector<common_control_vector_load_info> loaded_control_vectors = llama->getLoadedControlVectors();
+    NSMutableArray *result = [[NSMutableArray alloc] init];
+    for (common_control_vector_load_info &cv : loaded_control_vectors) {
+        [result addObject:@{
+            @"path": [NSString stringWithUTF8String:cv.fname.c_str()],
+            @"strength": @(cv.strength)
+        }];
+    }
+    return result;
+}
+
 - (bool)initVocoder:(NSString *)vocoderModelPath {
     return llama->initVocoder([vocoderModelPath UTF8String]);
 }
@@ -209,6 +209,15 @@ if (!NativeModules.RNLlama) {
         '["test 3B Q4_0",1600655360,2779683840,16.211304,0.021748,38.570646,1.195800]',
     ),
 
+    tuneThreads: jest.fn(async () => ({
+      n_threads: 4,
+      cpumask: '0xf0',
+      n_threads_batch: 8,
+      cpumask_batch: '',
+      tg_speed: 38.57,
+      pp_speed: 16.21,
+    })),
+
     releaseContext: jest.fn(() => Promise.resolve()),
     releaseAllContexts: jest.fn(() => Promise.resolve()),
 
@@ -220,6 +229,10 @@ if (!NativeModules.RNLlama) {
     removeLoraAdapters: jest.fn(async () => {}),
     getLoadedLoraAdapters: jest.fn(async () => []),
 
+    applyControlVectors: jest.fn(async () => {}),
+    removeControlVectors: jest.fn(async () => {}),
+    getLoadedControlVectors: jest.fn(async () => []),
+
     initMultimodal: jest.fn(async (id) => {
       contextMap[id] = true
       return true
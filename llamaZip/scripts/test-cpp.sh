@@ -0,0 +1,88 @@
+#!/bin/bash -e
+
+# Build the ggml sources in cpp/ for the host CPU and run the native tests in test/cpp
+
+CC=${CC:-cc}
+CXX=${CXX:-c++}
+
+n_cpu=1
+if uname -a | grep -q "Darwin"; then
+  n_cpu=$(sysctl -n hw.logicalcpu)
+elif uname -a | grep -q "Linux"; then
+  n_cpu=$(nproc)
+fi
+
+case $(uname -m) in
+  x86_64|amd64)
+    ARCH=x86
+    ARCH_FLAGS="-march=native"
+    ;;
+  arm64|aarch64)
+    ARCH=arm
+    ARCH_FLAGS=""
+    ;;
+  *)
+    echo "Unsupported host architecture: $(uname -m)"
+    exit 1
+    ;;
+esac
+
+cd "$(dirname "$0")/.."
+
+BUILD_DIR=build-test-cpp
+FLAGS="-O2 -g -Icpp -Icpp/ggml-cpu -DLM_GGML_USE_CPU -D_GNU_SOURCE -pthread $ARCH_FLAGS"
+
+SOURCES="
+  cpp/ggml.c
+  cpp/ggml-alloc.c
+  cpp/ggml-quants.c
+  cpp/ggml-backend.cpp
+  cpp/ggml-backend-reg.cpp
+  cpp/ggml-threading.cpp
+  cpp/ggml-cpu/ggml-cpu.c
+  cpp/ggml-cpu/ggml-cpu.cpp
+  cpp/ggml-cpu/quants.c
+  cpp/ggml-cpu/traits.cpp
+  cpp/ggml-cpu/repack.cpp
+  cpp/ggml-cpu/unary-ops.cpp
+  cpp/ggml-cpu/binary-ops.cpp
+  cpp/ggml-cpu/vec.cpp
+  cpp/ggml-cpu/ops.cpp
+  cpp/ggml-cpu/amx/amx.cpp
+  cpp/ggml-cpu/amx/mmq.cpp
+  cpp/ggml-cpu/arch/$ARCH/quants.c
+  cpp/ggml-cpu/arch/$ARCH/repack.cpp
+"
+
+mkdir -p $BUILD_DIR
+
+OBJECTS=""
+for src in $SOURCES; do
+  OBJECTS="$OBJECTS $BUILD_DIR/$(echo $src | tr '/' '_').o"
+done
+
+for src in $SOURCES; do
+  obj=$BUILD_DIR/$(echo $src | tr '/' '_').o
+  if [[ $src == *.c ]]; then
+    echo "$CC -std=gnu11 $FLAGS -c $src -o $obj"
+  else
+    echo "$CXX -std=c++17 $FLAGS -c $src -o $obj"
+  fi
+done | xargs -P $n_cpu -I {} sh -c "{}"
+
+n_fail=0
+for test in test/cpp/test-*.cpp; do
+  name=$(basename $test .cpp)
+  $CXX -std=c++17 $FLAGS $test $OBJECTS -o $BUILD_DIR/$name
+  if ./$BUILD_DIR/$name; then
+    echo "$name: passed"
+  else
+    echo "$name: FAILED"
+    n_fail=$((n_fail + 1))
+  fi
+done
+
+if [ $n_fail -gt 0 ]; then
+  echo "$n_fail test(s) failed"
+  exit 1
+fi
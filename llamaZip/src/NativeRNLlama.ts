@@ -46,6 +46,45 @@ export type NativeContextParams = {
 
   use_mlock?: boolean
   use_mmap?: boolean
+  /**
+   * Page in the mapped weights one layer ahead of the computation instead of the
+   * whole model at load. Requires use_mmap.
+   */
+  prefetch_layers?: boolean
+  /**
+   * With prefetch_layers, release the pages of each layer once it is computed.
+   * For models larger than the free memory.
+   */
+  evict_layers?: boolean
+  /**
+   * Path of a cache of the CPU-repacked weights. It is written on the first load
+   * and mapped by later loads of the same model on the same CPU instead of
+   * repacking again. Requires use_mmap.
+   */
+  repack_cache?: string
+  /**
+   * Path of a cache of the compute buffer sizes measured for this model and
+   * context configuration. A later load with the same configuration allocates
+   * them directly and skips the worst-case graph reservation and the warmup run.
+   */
+  warm_start_cache?: string
+  /**
+   * Path of a file the KV cells of idle sequences are moved to when the cache runs
+   * out of cells. They are read back when the sequence is used again.
+   * Default: empty (disabled)
+   */
+  kv_spill_path?: string
+  /**
+   * Shrink n_ubatch, then quantize the KV cache to q8_0, then halve n_ctx
+   * until the KV cache and the compute buffers fit the memory budget.
+   * The chosen values are reported in `model.memoryPlan`.
+   */
+  fit_memory?: boolean
+  /**
+   * Memory budget in bytes for the model weights, the KV cache and the compute
+   * buffers, used with fit_memory. Default: 0 (the memory available to the app)
+   */
+  memory_budget?: number
   vocab_only?: boolean
 
   /**
@@ -58,8 +97,9 @@ export type NativeContextParams = {
   lora_scaled?: number
   /**
    * LoRA adapter list
+   * merged: merge the adapter into copies of the weights it modifies, so it costs no more per token than the base model
    */
-  lora_list?: Array<{ path: string; scaled?: number }>
+  lora_list?: Array<{ path: string; scaled?: number; merged?: boolean }>
 
   rope_freq_base?: number
   rope_freq_scale?: number
@@ -71,6 +111,18 @@ export type NativeContextParams = {
    */
   ctx_shift?: boolean
 
+  /**
+   * Number of recurrent state checkpoints kept per sequence (recurrent and hybrid models).
+   * Lets a prompt that shares only a prefix with the previous one reuse the state
+   * up to the last checkpoint instead of evaluating the whole prompt again.
+   * Default: 0 (disabled)
+   */
+  n_rs_ckpt?: number
+  /**
+   * Number of tokens between recurrent state checkpoints. Default: 256
+   */
+  rs_ckpt_interval?: number
+
   // Embedding params
   embedding?: boolean
   embd_normalize?: number
@@ -218,6 +270,10 @@ export type NativeCompletionParams = {
    * Top n sigma sampling as described in academic paper "Top-nσ: Not All Logits Are You Need" https://arxiv.org/pdf/2411.07641. Default: `-1.0` (Disabled)
    */
   top_n_sigma?: number
+  /**
+   * Strength of the control vectors applied with `applyControlVectors` for this completion, `0` disables them. Default: `1.0`
+   */
+  control_vector_strength?: number
 
   /**
    * Ignore end of stream token and continue generating. Default: `false`
@@ -362,6 +418,21 @@ export type NativeLlamaContext = {
       }
     }
     metadata: Object
+    /**
+     * Memory needed by the context in bytes, and the configuration it was created with
+     */
+    memoryPlan: {
+      nCtx: number
+      nUbatch: number
+      cacheTypeK: string
+      cacheTypeV: string
+      weightsMapped: number
+      weightsAllocated: number
+      kv: number
+      compute: number
+      budget: number // -1 if the available memory is unknown
+      fits: boolean
+    }
     isChatTemplateSupported: boolean // Deprecated
   }
   /**
@@ -377,6 +448,33 @@ export type NativeSessionLoadResult = {
   prompt: string
 }
 
+export type NativeThreadConfig = {
+  /**
+   * Threads used for single-token decode
+   */
+  n_threads: number
+  /**
+   * CPU affinity mask (hex) for single-token decode, empty for any CPU
+   */
+  cpumask: string
+  /**
+   * Threads used for prompt processing
+   */
+  n_threads_batch: number
+  /**
+   * CPU affinity mask (hex) for prompt processing, empty for any CPU
+   */
+  cpumask_batch: string
+  /**
+   * Measured decode speed (tokens/s)
+   */
+  tg_speed: number
+  /**
+   * Measured prompt processing speed (tokens/s)
+   */
+  pp_speed: number
+}
+
 export type NativeLlamaMessagePart = {
   type: 'text'
   text: string
@@ -480,16 +578,32 @@ export interface Spec extends TurboModule {
     pl: number,
     nr: number,
   ): Promise<string>
+  tuneThreads(
+    contextId: number,
+    cachePath: string,
+    force: boolean,
+  ): Promise<NativeThreadConfig>
 
   applyLoraAdapters(
     contextId: number,
-    loraAdapters: Array<{ path: string; scaled?: number }>,
+    loraAdapters: Array<{ path: string; scaled?: number; merged?: boolean }>,
   ): Promise<void>
   removeLoraAdapters(contextId: number): Promise<void>
   getLoadedLoraAdapters(
     contextId: number,
   ): Promise<Array<{ path: string; scaled?: number }>>
 
+  applyControlVectors(
+    contextId: number,
+    controlVectors: Array<{ path: string; strength?: number }>,
+    layerStart: number,
+    layerEnd: number,
+  ): Promise<void>
+  removeControlVectors(contextId: number): Promise<void>
+  getLoadedControlVectors(
+    contextId: number,
+  ): Promise<Array<{ path: string; strength?: number }>>
+
   // Multimodal methods
   initMultimodal(
     contextId: number,
@@ -10,6 +10,7 @@ import type {
   NativeTokenizeResult,
   NativeEmbeddingResult,
   NativeSessionLoadResult,
+  NativeThreadConfig,
   NativeEmbeddingParams,
   NativeRerankParams,
   NativeRerankResult,
@@ -53,6 +54,7 @@ export type {
   NativeTokenizeResult,
   NativeEmbeddingResult,
   NativeSessionLoadResult,
+  NativeThreadConfig,
   NativeEmbeddingParams,
   NativeRerankParams,
   NativeRerankResult,
@@ -498,14 +500,31 @@ export class LlamaContext {
     }
   }
 
+  /**
+   * Pick thread counts and CPU affinity separately for prompt processing and
+   * single-token decode, and attach matching threadpools to the context.
+   * The result is cached per model and device in `cachePath` (if given); a cached
+   * config is applied without benchmarking unless `force` is set.
+   * Benchmarking clears the KV cache.
+   */
+  async tuneThreads(options?: {
+    cachePath?: string
+    force?: boolean
+  }): Promise<NativeThreadConfig> {
+    let path = options?.cachePath || ''
+    if (path.startsWith('file://')) path = path.slice(7)
+    return RNLlama.tuneThreads(this.id, path, options?.force ?? false)
+  }
+
   async applyLoraAdapters(
-    loraList: Array<{ path: string; scaled?: number }>,
+    loraList: Array<{ path: string; scaled?: number; merged?: boolean }>,
   ): Promise<void> {
-    let loraAdapters: Array<{ path: string; scaled?: number }> = []
+    let loraAdapters: Array<{ path: string; scaled?: number; merged?: boolean }> = []
     if (loraList)
       loraAdapters = loraList.map((l) => ({
         path: l.path.replace(/file:\/\//, ''),
         scaled: l.scaled,
+        merged: l.merged,
       }))
     return RNLlama.applyLoraAdapters(this.id, loraAdapters)
   }
@@ -520,6 +539,39 @@ export class LlamaContext {
     return RNLlama.getLoadedLoraAdapters(this.id)
   }
 
+  /**
+   * Load control vectors and add them to the residual stream of every completion
+   * @param controlVectors Control vector files, summed with their strengths
+   * @param options.layer_start First layer to steer, default: 1
+   * @param options.layer_end Last layer to steer, default: the last layer
+   * The strength can be changed per completion with `control_vector_strength`
+   */
+  async applyControlVectors(
+    controlVectors: Array<{ path: string; strength?: number }>,
+    options?: { layer_start?: number; layer_end?: number },
+  ): Promise<void> {
+    const vectors = controlVectors.map((cv) => ({
+      path: cv.path.replace(/file:\/\//, ''),
+      strength: cv.strength,
+    }))
+    return RNLlama.applyControlVectors(
+      this.id,
+      vectors,
+      options?.layer_start ?? -1,
+      options?.layer_end ?? -1,
+    )
+  }
+
+  async removeControlVectors(): Promise<void> {
+    return RNLlama.removeControlVectors(this.id)
+  }
+
+  async getLoadedControlVectors(): Promise<
+    Array<{ path: string; strength?: number }>
+  > {
+    return RNLlama.getLoadedControlVectors(this.id)
+  }
+
   /**
    * Initialize multimodal support with a mmproj file
    * @param params Parameters for multimodal support
@@ -699,11 +751,12 @@ export async function initLlama(
   let loraPath = lora
   if (loraPath?.startsWith('file://')) loraPath = loraPath.slice(7)
 
-  let loraAdapters: Array<{ path: string; scaled?: number }> = []
+  let loraAdapters: Array<{ path: string; scaled?: number; merged?: boolean }> = []
   if (loraList)
     loraAdapters = loraList.map((l) => ({
       path: l.path.replace(/file:\/\//, ''),
       scaled: l.scaled,
+      merged: l.merged,
     }))
 
   const contextId = contextIdCounter + contextIdRandom()
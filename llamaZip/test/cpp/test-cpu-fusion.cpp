@@ -0,0 +1,93 @@
+// checks that the fused node chains of the CPU backend give the same results as the unfused nodes
+// run with scripts/test-cpp.sh
+
+#include "ggml.h"
+#include "ggml-cpu.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static void fill(lm_ggml_tensor * t, float f) {
+    float * data = (float *) t->data;
+    for (int64_t i = 0; i < lm_ggml_nelements(t); ++i) {
+        data[i] = sinf(i*f + f);
+    }
+}
+
+// the residual pass of a few layers of a model with a control vector:
+//   add (residual) + add (control vector row) + rms_norm + mul (norm weight), i.e. the longest fused chain
+// with unfused = true, the intermediate results are flagged as outputs, which prevents the fusion
+static std::vector<float> eval_cvec(bool unfused, int n_threads) {
+    const int n_embd   = 256;
+    const int n_tokens = 7;
+    const int n_layer  = 4;
+
+    lm_ggml_init_params params = { 64*1024*1024, nullptr, false };
+    lm_ggml_context * ctx = lm_ggml_init(params);
+
+    lm_ggml_tensor * inp = lm_ggml_new_tensor_2d(ctx, LM_GGML_TYPE_F32, n_embd, n_tokens);
+    fill(inp, 0.1f);
+
+    lm_ggml_tensor * cur = inp;
+
+    for (int il = 0; il < n_layer; ++il) {
+        lm_ggml_tensor * ffn_out = lm_ggml_new_tensor_2d(ctx, LM_GGML_TYPE_F32, n_embd, n_tokens);
+        lm_ggml_tensor * cvec    = lm_ggml_new_tensor_1d(ctx, LM_GGML_TYPE_F32, n_embd);
+        lm_ggml_tensor * norm_w  = lm_ggml_new_tensor_1d(ctx, LM_GGML_TYPE_F32, n_embd);
+        fill(ffn_out, 0.3f + il);
+        fill(cvec,    0.7f + il);
+        fill(norm_w,  0.9f + il);
+
+        lm_ggml_tensor * res  = lm_ggml_add(ctx, ffn_out, cur);
+        lm_ggml_tensor * res2 = lm_ggml_add(ctx, res, cvec);
+        lm_ggml_tensor * norm = lm_ggml_rms_norm(ctx, res2, 1e-5f);
+        lm_ggml_tensor * out  = lm_ggml_mul(ctx, norm, norm_w);
+
+        if (unfused) {
+            lm_ggml_set_output(res);
+            lm_ggml_set_output(res2);
+            lm_ggml_set_output(norm);
+        }
+
+        // the residual of the next layer
+        cur = lm_ggml_add(ctx, out, res2);
+    }
+
+    lm_ggml_cgraph * gf = lm_ggml_new_graph(ctx);
+    lm_ggml_build_forward_expand(gf, cur);
+
+    if (lm_ggml_graph_compute_with_ctx(ctx, gf, n_threads) != LM_GGML_STATUS_SUCCESS) {
+        fprintf(stderr, "%s: graph compute failed\n", __func__);
+        lm_ggml_free(ctx);
+        return {};
+    }
+
+    std::vector<float> res((float *) cur->data, (float *) cur->data + lm_ggml_nelements(cur));
+
+    lm_ggml_free(ctx);
+
+    return res;
+}
+
+int main(void) {
+    const std::vector<float> ref = eval_cvec(true, 1);
+    if (ref.empty()) {
+        return 1;
+    }
+
+    int n_fail = 0;
+
+    for (int n_threads : { 1, 2, 3, 4, 8 }) {
+        const std::vector<float> res = eval_cvec(false, n_threads);
+
+        const bool ok = res.size() == ref.size() && memcmp(res.data(), ref.data(), ref.size()*sizeof(float)) == 0;
+
+        printf("cvec residual, n_threads = %d: %s\n", n_threads, ok ? "OK" : "FAIL (not bit-identical to the unfused graph)");
+
+        n_fail += !ok;
+    }
+
+    return n_fail > 0 ? 1 : 0;
+}